@@ -0,0 +1,1057 @@
+/*
+ * bench_stream - end-to-end streaming throughput and integrity benchmark.
+ *
+ * Streams every mode of a sensor for a few seconds with its test pattern
+ * enabled and checks each frame against the pattern's checksum. It reports
+ * sustained fps, dropped and corrupt frames, the delay from the driver's
+ * buffer timestamp to the frame reaching userspace, frame interval jitter
+ * and the CPU time spent per frame:
+ *
+ *	bench_stream -m /dev/media1 -s ov5645 -p 0 -t 10
+ *
+ * The OV5645 processes its pre-ISP colour bars through AWB and AE, so
+ * those are switched to manual for the run and restored afterwards. The
+ * sensor's colour bars cannot be computed on the host, so each mode's
+ * reference checksum comes from a file written by an earlier run (-w
+ * ref.txt on a known good build, -r ref.txt later). Without one, the
+ * first frame of the mode becomes the reference.
+ *
+ * Without --media the frames come from a simulated sensor: the same bars
+ * rendered on the host, delivered at the mode's frame rate, with a
+ * checksum that is computed up front. -e N makes it drop one frame and
+ * corrupt another in every N, which checks the checker:
+ *
+ *	bench_stream -s ov5645 -t 2 -e 50
+ *
+ * The exit status is non-zero if any frame was dropped or corrupt, so the
+ * simulated run can gate regressions off-device.
+ *
+ * With -L the benchmark measures control latency instead: it toggles the
+ * test pattern or HFLIP (over the bars) on a timer that is not locked to
+ * the frame rate, and counts the frames completed after each write up to
+ * the first one that shows it. 1 means the frame in flight at the write
+ * already shows it. Per mode it prints the distribution in frames and in
+ * microseconds from the write to that frame's timestamp; -u stores the
+ * median in the driver's control delay property for the mode, where
+ * camd_3a picks it up:
+ *
+ *	bench_stream -m /dev/media1 -s ov5645 -p 0 -L hflip -u
+ *
+ * The simulated sensor applies writes -D frames late (default 2).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "camss.h"
+#include "media.h"
+#include "v4l2.h"
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+#define BENCH_BUFFERS		4
+#define BENCH_MAX_SAMPLES	65536
+#define BENCH_MAX_REFS		32
+#define BENCH_TIMEOUT_MS	2000
+
+#define LAT_SETTLE		8	/* frames before learning a state */
+#define LAT_MAX_FRAMES		15	/* give up on a toggle after this */
+#define LAT_MAX_TOGGLES		256
+
+struct bench_ref {
+	char sensor[16];
+	uint32_t width;
+	uint32_t height;
+	uint64_t sum;
+};
+
+struct bench_frame {
+	const uint8_t *data;
+	uint32_t sequence;
+	uint64_t timestamp_ns;
+	unsigned int index;
+};
+
+struct bench_result {
+	unsigned long frames;
+	unsigned long dropped;
+	unsigned long corrupt;
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint32_t last_seq;
+	double interval_sum;
+	double interval_sq;
+	unsigned long intervals;
+	float latency[BENCH_MAX_SAMPLES];	/* ms */
+	unsigned int num_latency;
+	uint64_t cpu_ns;
+	uint64_t wall_ns;
+};
+
+/* The control -L toggles, and the two values it toggles between. */
+struct lat_ctrl {
+	const char *name;
+	uint32_t id;
+	int pattern_value;	/* state 0/1 value is the test pattern */
+	int32_t value[2];
+};
+
+struct bench {
+	const struct camss_sensor *sensor;
+	const struct camss_mode *mode;
+	unsigned int seconds;
+	int32_t pattern;
+
+	/* Real sensor */
+	const char *media;
+	unsigned int port;
+	int subdev_fd;
+	int32_t saved[5];
+	int saved_ok[5];
+	struct v4l2_dev dev;
+
+	/* Simulated sensor */
+	int sim;
+	unsigned int error_every;
+	unsigned int sim_delay;
+	uint8_t *sim_buf[2];	/* control state 0 and 1 */
+	uint8_t *sim_corrupt;	/* byte flipped in the current frame */
+	uint32_t sim_seq;
+	uint64_t sim_next;
+	uint64_t sim_period;
+	unsigned int sim_state;
+	unsigned int sim_pending;
+	uint32_t sim_apply;	/* first sequence showing sim_pending */
+
+	/* Current stream */
+	uint32_t bytesperline;
+	uint32_t row_bytes;
+	uint64_t expected;
+	int have_expected;
+
+	/* Control latency mode */
+	const struct lat_ctrl *lat;
+	unsigned int toggles;
+	unsigned int interval_ms;
+	int update;
+
+	struct bench_ref refs[BENCH_MAX_REFS];
+	unsigned int num_refs;
+};
+
+/* Controls forced for a deterministic pattern, and their run values. */
+static const struct {
+	uint32_t id;
+	int32_t value;
+} bench_ctrls[5] = {
+	{ V4L2_CID_TEST_PATTERN, 0 },	/* set to bench->pattern */
+	{ V4L2_CID_AUTO_WHITE_BALANCE, 0 },
+	{ V4L2_CID_AUTOGAIN, 0 },
+	{ V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL },
+	{ V4L2_CID_HFLIP, 0 },
+};
+
+static const struct lat_ctrl lat_ctrls[] = {
+	/* Bars on, then off: the live image never matches the bars. */
+	{ "pattern", V4L2_CID_TEST_PATTERN, 1, { 0, 0 } },
+	/* Bars mirrored: two distinct stable images. */
+	{ "hflip", V4L2_CID_HFLIP, 0, { 0, 1 } },
+};
+
+static uint64_t now_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t ns)
+{
+	struct timespec ts = {
+		.tv_sec = ns / 1000000000ull,
+		.tv_nsec = ns % 1000000000ull,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR)
+		;
+}
+
+/*
+ * Multiply-xor hash over the pixel bytes of every row, skipping the line
+ * padding, whose content the hardware does not define.
+ */
+static uint64_t frame_checksum(const uint8_t *data, uint32_t stride,
+			       uint32_t row_bytes, uint32_t height)
+{
+	uint64_t h = 0xcbf29ce484222325ull, w;
+	uint32_t x, y;
+
+	for (y = 0; y < height; y++) {
+		const uint8_t *row = data + (size_t)y * stride;
+
+		for (x = 0; x + 8 <= row_bytes; x += 8) {
+			memcpy(&w, row + x, 8);
+			h = (h ^ w) * 0x100000001b3ull;
+			h ^= h >> 29;
+		}
+		for (; x < row_bytes; x++)
+			h = (h ^ row[x]) * 0x100000001b3ull;
+	}
+
+	return h;
+}
+
+static uint32_t row_bytes(uint32_t fourcc, uint32_t width, uint32_t stride)
+{
+	switch (fourcc) {
+	case V4L2_PIX_FMT_UYVY:
+	case V4L2_PIX_FMT_SRGGB10:
+		return width * 2;
+	case V4L2_PIX_FMT_SRGGB10P:
+		return width * 5 / 4;
+	default:
+		return stride;
+	}
+}
+
+static uint64_t bench_checksum(const struct bench *b,
+			       const struct bench_frame *f)
+{
+	return frame_checksum(f->data, b->bytesperline, b->row_bytes,
+			      b->mode->height);
+}
+
+static struct bench_ref *bench_ref_find(struct bench *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < b->num_refs; i++)
+		if (!strcmp(b->refs[i].sensor, b->sensor->name) &&
+		    b->refs[i].width == b->mode->width &&
+		    b->refs[i].height == b->mode->height)
+			return &b->refs[i];
+
+	return NULL;
+}
+
+static void bench_ref_load(struct bench *b, const char *path)
+{
+	struct bench_ref *r;
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		perror(path);
+		return;
+	}
+
+	while (b->num_refs < BENCH_MAX_REFS) {
+		r = &b->refs[b->num_refs];
+		if (fscanf(f, "%15s %ux%u %" SCNx64, r->sensor, &r->width,
+			   &r->height, &r->sum) != 4)
+			break;
+		b->num_refs++;
+	}
+
+	fclose(f);
+}
+
+/* Vertical bars: white, yellow, cyan, green, magenta, red, blue, black. */
+static void sim_render(uint8_t *buf, uint32_t fourcc, uint32_t width,
+		       uint32_t height, uint32_t stride, int mirror)
+{
+	static const uint8_t yuv[8][3] = {
+		{ 235, 128, 128 }, { 210, 16, 146 }, { 170, 166, 16 },
+		{ 145, 54, 34 }, { 106, 202, 222 }, { 81, 90, 240 },
+		{ 41, 240, 110 }, { 16, 128, 128 },
+	};
+	static const uint16_t rgb[8][3] = {
+		{ 1023, 1023, 1023 }, { 1023, 1023, 0 }, { 0, 1023, 1023 },
+		{ 0, 1023, 0 }, { 1023, 0, 1023 }, { 1023, 0, 0 },
+		{ 0, 0, 1023 }, { 0, 0, 0 },
+	};
+	uint32_t x, y;
+
+	for (y = 0; y < height; y++) {
+		uint8_t *row = buf + (size_t)y * stride;
+
+		for (x = 0; x < width; x++) {
+			unsigned int bar = x * 8 / width;
+
+			if (mirror)
+				bar = 7 - bar;
+
+			if (fourcc == V4L2_PIX_FMT_UYVY) {
+				row[2 * x] = yuv[bar][x & 1 ? 2 : 1];
+				row[2 * x + 1] = yuv[bar][0];
+			} else {
+				/* RGGB, 16 bits per pixel. */
+				unsigned int c = (y & 1) + (x & 1);
+				uint16_t v = rgb[bar][c];
+
+				memcpy(row + 2 * x, &v, 2);
+			}
+		}
+	}
+}
+
+static void sim_stop(struct bench *b)
+{
+	free(b->sim_buf[0]);
+	free(b->sim_buf[1]);
+	b->sim_buf[0] = b->sim_buf[1] = NULL;
+}
+
+static int sim_start(struct bench *b)
+{
+	size_t size;
+	unsigned int i;
+
+	if (b->sensor->fourcc != V4L2_PIX_FMT_UYVY &&
+	    b->sensor->fourcc != V4L2_PIX_FMT_SRGGB10) {
+		fprintf(stderr, "cannot simulate %.4s\n",
+			(const char *)&b->sensor->fourcc);
+		return -1;
+	}
+
+	b->bytesperline = b->mode->width * 2;
+	b->row_bytes = b->bytesperline;
+	size = (size_t)b->bytesperline * b->mode->height;
+
+	for (i = 0; i < 2; i++) {
+		b->sim_buf[i] = malloc(size);
+		if (!b->sim_buf[i]) {
+			sim_stop(b);
+			return -1;
+		}
+		sim_render(b->sim_buf[i], b->sensor->fourcc, b->mode->width,
+			   b->mode->height, b->bytesperline, i);
+	}
+
+	/* The simulated pattern is known: precompute its checksum. */
+	b->expected = frame_checksum(b->sim_buf[0], b->bytesperline,
+				     b->row_bytes, b->mode->height);
+	b->have_expected = 1;
+
+	b->sim_seq = 0;
+	b->sim_state = b->sim_pending = 0;
+	b->sim_apply = 0;
+	b->sim_period = 1000000000ull / b->mode->fps;
+	b->sim_next = now_ns(CLOCK_MONOTONIC) + b->sim_period;
+
+	return 0;
+}
+
+/* Like a sensor latching a register, from the -D'th frame completed on. */
+static void sim_set_state(struct bench *b, unsigned int state)
+{
+	b->sim_pending = state;
+	b->sim_apply = b->sim_seq + b->sim_delay - 1;
+}
+
+/*
+ * Wait for the end of the next simulated frame, or return 0 at @until if
+ * it ends later. With -e N, frame k * N is dropped and frame k * N + N / 2
+ * has one byte flipped until it is returned.
+ */
+static int sim_next(struct bench *b, struct bench_frame *f, uint64_t until)
+{
+	uint8_t *buf;
+
+	for (;;) {
+		if (b->sim_next > until) {
+			sleep_until(until);
+			return 0;
+		}
+		sleep_until(b->sim_next);
+
+		if ((int32_t)(b->sim_seq - b->sim_apply) >= 0)
+			b->sim_state = b->sim_pending;
+
+		if (!b->error_every || b->sim_seq % b->error_every ||
+		    !b->sim_seq)
+			break;
+
+		b->sim_seq++;
+		b->sim_next += b->sim_period;
+	}
+
+	buf = b->sim_buf[b->sim_state];
+	f->data = buf;
+	f->sequence = b->sim_seq;
+	f->timestamp_ns = b->sim_next;
+	f->index = 0;
+
+	if (b->error_every &&
+	    b->sim_seq % b->error_every == b->error_every / 2) {
+		b->sim_corrupt = buf + b->bytesperline * (b->mode->height / 2);
+		*b->sim_corrupt ^= 0x01;
+	}
+
+	b->sim_seq++;
+	b->sim_next += b->sim_period;
+
+	return 1;
+}
+
+static void sim_done(struct bench *b)
+{
+	if (b->sim_corrupt) {
+		*b->sim_corrupt ^= 0x01;
+		b->sim_corrupt = NULL;
+	}
+}
+
+static int sensor_open(struct bench *b, int mfd)
+{
+	struct media_entity_desc entity;
+	char subdev[64];
+	unsigned int i;
+
+	if (camss_sensor_entity(mfd, b->sensor, b->port, &entity) < 0 ||
+	    media_entity_devnode(&entity, subdev, sizeof(subdev)) < 0)
+		return -1;
+
+	b->subdev_fd = open(subdev, O_RDWR | O_CLOEXEC);
+	if (b->subdev_fd < 0) {
+		fprintf(stderr, "%s: %s\n", subdev, strerror(errno));
+		return -1;
+	}
+
+	/* Not every sensor has all of them; only the pattern is needed. */
+	for (i = 0; i < ARRAY_SIZE(bench_ctrls); i++) {
+		b->saved_ok[i] = v4l2_ctrl_get(b->subdev_fd, bench_ctrls[i].id,
+					       &b->saved[i]) == 0;
+		if (b->saved_ok[i])
+			v4l2_ctrl_set(b->subdev_fd, bench_ctrls[i].id,
+				      i ? bench_ctrls[i].value : b->pattern);
+	}
+
+	if (!b->saved_ok[0]) {
+		fprintf(stderr, "%s has no test pattern control\n",
+			b->sensor->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void sensor_restore(struct bench *b)
+{
+	unsigned int i;
+
+	if (b->subdev_fd < 0)
+		return;
+
+	for (i = ARRAY_SIZE(bench_ctrls); i-- > 0;)
+		if (b->saved_ok[i])
+			v4l2_ctrl_set(b->subdev_fd, bench_ctrls[i].id,
+				      b->saved[i]);
+
+	close(b->subdev_fd);
+	b->subdev_fd = -1;
+}
+
+static int real_start(struct bench *b)
+{
+	char video[64];
+	int mfd, ret;
+
+	mfd = media_open(b->media);
+	if (mfd < 0)
+		return -1;
+
+	ret = camss_pipeline_setup(mfd, b->sensor, b->port, b->mode->width,
+				   b->mode->height, video, sizeof(video));
+	if (ret == 0 && b->subdev_fd < 0)
+		ret = sensor_open(b, mfd);
+	close(mfd);
+	if (ret < 0)
+		return -1;
+
+	if (v4l2_dev_open(&b->dev, video) < 0)
+		return -1;
+
+	if (v4l2_dev_set_format(&b->dev, b->mode->width, b->mode->height,
+				b->sensor->fourcc) < 0 ||
+	    v4l2_dev_alloc_buffers(&b->dev, BENCH_BUFFERS, 1, 0) < 0 ||
+	    v4l2_dev_queue_all(&b->dev) < 0 ||
+	    v4l2_dev_stream_on(&b->dev) < 0) {
+		v4l2_dev_close(&b->dev);
+		return -1;
+	}
+
+	b->bytesperline = b->dev.bytesperline;
+	b->row_bytes = row_bytes(b->dev.fourcc, b->dev.width,
+				 b->dev.bytesperline);
+
+	return 0;
+}
+
+/* The next frame, or 0 if none arrives before @until. */
+static int real_next(struct bench *b, struct bench_frame *f, uint64_t until)
+{
+	struct v4l2_dev_frame frame;
+	struct pollfd pfd = { .fd = b->dev.fd, .events = POLLIN };
+	uint64_t now;
+	int ret;
+
+	for (;;) {
+		if (v4l2_dev_dequeue(&b->dev, &frame) == 0)
+			break;
+		if (errno != EAGAIN)
+			return -1;
+
+		now = now_ns(CLOCK_MONOTONIC);
+		if (now >= until)
+			return 0;
+
+		ret = poll(&pfd, 1, (until - now + 999999) / 1000000);
+		if (ret < 0 && errno != EINTR)
+			return -1;
+	}
+
+	f->data = b->dev.bufs[frame.index].start;
+	f->sequence = frame.sequence;
+	f->timestamp_ns = frame.timestamp_ns;
+	f->index = frame.index;
+
+	return 1;
+}
+
+static void real_stop(struct bench *b)
+{
+	v4l2_dev_stream_off(&b->dev);
+	v4l2_dev_close(&b->dev);
+}
+
+static int bench_start(struct bench *b)
+{
+	if ((b->sim ? sim_start(b) : real_start(b)) < 0) {
+		fprintf(stderr, "%s %ux%u: cannot start streaming\n",
+			b->sensor->name, b->mode->width, b->mode->height);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int bench_next(struct bench *b, struct bench_frame *f, uint64_t until)
+{
+	return b->sim ? sim_next(b, f, until) : real_next(b, f, until);
+}
+
+static void bench_done(struct bench *b, const struct bench_frame *f)
+{
+	if (b->sim)
+		sim_done(b);
+	else
+		v4l2_dev_queue(&b->dev, f->index);
+}
+
+static void bench_stop(struct bench *b)
+{
+	if (b->sim)
+		sim_stop(b);
+	else
+		real_stop(b);
+}
+
+/* Next frame within BENCH_TIMEOUT_MS, reporting the failure otherwise. */
+static int bench_wait(struct bench *b, struct bench_frame *f)
+{
+	int ret;
+
+	ret = bench_next(b, f, now_ns(CLOCK_MONOTONIC) +
+			 BENCH_TIMEOUT_MS * 1000000ull);
+	if (ret <= 0)
+		fprintf(stderr, "%s %ux%u: %s\n", b->sensor->name,
+			b->mode->width, b->mode->height,
+			ret ? strerror(errno) : "no frame");
+
+	return ret;
+}
+
+static void bench_account(struct bench *b, struct bench_result *res,
+			  const struct bench_frame *f, uint64_t arrival)
+{
+	uint64_t sum;
+
+	if (res->frames) {
+		double interval = (f->timestamp_ns - res->last_ts) / 1e6;
+
+		if (f->sequence != res->last_seq + 1) {
+			res->dropped += f->sequence - res->last_seq - 1;
+		} else {
+			res->interval_sum += interval;
+			res->interval_sq += interval * interval;
+			res->intervals++;
+		}
+	} else {
+		res->first_ts = f->timestamp_ns;
+	}
+	res->last_ts = f->timestamp_ns;
+	res->last_seq = f->sequence;
+	res->frames++;
+
+	if (res->num_latency < BENCH_MAX_SAMPLES)
+		res->latency[res->num_latency++] =
+			arrival > f->timestamp_ns ?
+			(arrival - f->timestamp_ns) / 1e6 : 0;
+
+	sum = bench_checksum(b, f);
+	if (!b->have_expected) {
+		b->expected = sum;
+		b->have_expected = 1;
+	} else if (sum != b->expected) {
+		res->corrupt++;
+	}
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void bench_report(const struct bench *b, struct bench_result *res)
+{
+	double secs = (res->last_ts - res->first_ts) / 1e9;
+	double mean = 0, jitter = 0;
+	unsigned int n = res->num_latency;
+
+	if (res->intervals) {
+		mean = res->interval_sum / res->intervals;
+		jitter = sqrt(fmax(res->interval_sq / res->intervals -
+				   mean * mean, 0));
+	}
+
+	qsort(res->latency, n, sizeof(res->latency[0]), cmp_float);
+
+	printf("%s %ux%u@%u: %lu frames, %.2f fps, %lu dropped, %lu corrupt\n",
+	       b->sensor->name, b->mode->width, b->mode->height, b->mode->fps,
+	       res->frames, secs > 0 ? (res->frames - 1) / secs : 0,
+	       res->dropped, res->corrupt);
+	printf("    latency p50 %.2f p99 %.2f max %.2f ms, interval %.3f "
+	       "+- %.3f ms, cpu %.1f%% (%.3f ms/frame)\n",
+	       n ? res->latency[n / 2] : 0, n ? res->latency[n * 99 / 100] : 0,
+	       n ? res->latency[n - 1] : 0, mean, jitter,
+	       res->wall_ns ? 100.0 * res->cpu_ns / res->wall_ns : 0,
+	       res->frames ? res->cpu_ns / 1e6 / res->frames : 0);
+}
+
+static int bench_mode(struct bench *b, struct bench_result *res, FILE *ref_out)
+{
+	struct bench_ref *ref;
+	struct bench_frame f;
+	uint64_t wall, cpu, end;
+
+	memset(res, 0, sizeof(*res));
+	b->have_expected = 0;
+
+	if (bench_start(b) < 0)
+		return -1;
+
+	ref = b->sim ? NULL : bench_ref_find(b);
+	if (ref) {
+		b->expected = ref->sum;
+		b->have_expected = 1;
+	}
+
+	wall = now_ns(CLOCK_MONOTONIC);
+	cpu = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+	end = wall + b->seconds * 1000000000ull;
+
+	while (now_ns(CLOCK_MONOTONIC) < end) {
+		if (bench_wait(b, &f) <= 0)
+			break;
+
+		bench_account(b, res, &f, now_ns(CLOCK_MONOTONIC));
+		bench_done(b, &f);
+	}
+
+	res->wall_ns = now_ns(CLOCK_MONOTONIC) - wall;
+	res->cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	bench_stop(b);
+
+	if (ref_out && b->have_expected)
+		fprintf(ref_out, "%s %ux%u %016" PRIx64 "\n", b->sensor->name,
+			b->mode->width, b->mode->height, b->expected);
+
+	bench_report(b, res);
+
+	return res->frames ? 0 : -1;
+}
+
+/*
+ * Control latency. What each control state looks like is learnt first: a
+ * state whose frames repeat has a signature, a state that does not (the
+ * live image with the pattern off) is recognised as "not the other one".
+ */
+struct lat_state {
+	uint64_t sig[2];
+	int stable[2];
+};
+
+static int lat_set(struct bench *b, unsigned int state)
+{
+	int32_t value = b->lat->pattern_value && !state ? b->pattern :
+			b->lat->value[state];
+
+	if (b->sim) {
+		sim_set_state(b, state);
+		return 0;
+	}
+
+	if (v4l2_ctrl_set(b->subdev_fd, b->lat->id, value) < 0) {
+		fprintf(stderr, "%s: cannot set %s: %s\n", b->sensor->name,
+			b->lat->name, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int lat_shows(const struct lat_state *ls, unsigned int state,
+		     uint64_t sum)
+{
+	return ls->stable[state] ? sum == ls->sig[state] :
+				   sum != ls->sig[!state];
+}
+
+/* Skip LAT_SETTLE frames, then compare two in a row. */
+static int lat_learn(struct bench *b, struct lat_state *ls, unsigned int state)
+{
+	struct bench_frame f;
+	uint64_t sum[2];
+	unsigned int i;
+
+	if (lat_set(b, state) < 0)
+		return -1;
+
+	for (i = 0; i < LAT_SETTLE + 2; i++) {
+		if (bench_wait(b, &f) <= 0)
+			return -1;
+		if (i >= LAT_SETTLE)
+			sum[i - LAT_SETTLE] = bench_checksum(b, &f);
+		bench_done(b, &f);
+	}
+
+	ls->sig[state] = sum[1];
+	ls->stable[state] = sum[0] == sum[1];
+
+	return 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int lat_mode(struct bench *b)
+{
+	uint32_t frames[LAT_MAX_TOGGLES], us[LAT_MAX_TOGGLES];
+	unsigned int hist[LAT_MAX_FRAMES + 1] = { 0 };
+	unsigned int n = 0, missed = 0, state = 0, count, i;
+	uint64_t interval = b->interval_ms * 1000000ull;
+	uint64_t toggle, written = 0, until;
+	struct lat_state ls;
+	struct bench_frame f;
+	int pending = 0, ret;
+
+	if (bench_start(b) < 0)
+		return -1;
+
+	if (lat_learn(b, &ls, 1) < 0 || lat_learn(b, &ls, 0) < 0)
+		goto err;
+
+	if ((!ls.stable[0] && !ls.stable[1]) ||
+	    (ls.stable[0] && ls.stable[1] && ls.sig[0] == ls.sig[1])) {
+		fprintf(stderr, "%s %ux%u: %s makes no steady visible change\n",
+			b->sensor->name, b->mode->width, b->mode->height,
+			b->lat->name);
+		goto err;
+	}
+
+	count = 0;
+	toggle = now_ns(CLOCK_MONOTONIC) + interval;
+
+	while (n + missed < b->toggles) {
+		until = pending ? now_ns(CLOCK_MONOTONIC) +
+				  BENCH_TIMEOUT_MS * 1000000ull : toggle;
+
+		ret = bench_next(b, &f, until);
+		if (ret < 0 || (ret == 0 && pending)) {
+			fprintf(stderr, "%s %ux%u: %s\n", b->sensor->name,
+				b->mode->width, b->mode->height,
+				ret ? strerror(errno) : "no frame");
+			goto err;
+		}
+
+		if (ret == 0) {
+			/* Timer: write between frames, at whatever phase. */
+			state = !state;
+			written = now_ns(CLOCK_MONOTONIC);
+			if (lat_set(b, state) < 0)
+				goto err;
+			toggle += interval;
+			pending = 1;
+			count = 0;
+			continue;
+		}
+
+		/* Completed before the write, only dequeued after it. */
+		if (!pending || f.timestamp_ns <= written) {
+			bench_done(b, &f);
+			continue;
+		}
+
+		count++;
+		if (lat_shows(&ls, state, bench_checksum(b, &f))) {
+			frames[n] = count;
+			us[n] = (f.timestamp_ns - written) / 1000;
+			hist[count]++;
+			n++;
+			pending = 0;
+		} else if (count == LAT_MAX_FRAMES) {
+			missed++;
+			pending = 0;
+		}
+		bench_done(b, &f);
+
+		if (!pending && toggle < now_ns(CLOCK_MONOTONIC))
+			toggle = now_ns(CLOCK_MONOTONIC) + interval;
+	}
+
+	lat_set(b, 0);
+	bench_stop(b);
+
+	printf("%s %ux%u@%u: %s, %u changes seen, %u missed\n",
+	       b->sensor->name, b->mode->width, b->mode->height, b->mode->fps,
+	       b->lat->name, n, missed);
+	if (!n)
+		return -1;
+
+	qsort(frames, n, sizeof(frames[0]), cmp_u32);
+	qsort(us, n, sizeof(us[0]), cmp_u32);
+
+	printf("    frames:");
+	for (i = 1; i <= LAT_MAX_FRAMES; i++)
+		if (hist[i])
+			printf(" %u:%u", i, hist[i]);
+	printf(", median %u\n", frames[n / 2]);
+	printf("    us: min %u p50 %u p99 %u max %u\n", us[0], us[n / 2],
+	       us[n * 99 / 100], us[n - 1]);
+
+	if (b->update && !b->sim) {
+		if (v4l2_ctrl_set(b->subdev_fd, CAMSS_CID_CTRL_DELAY,
+				  frames[n / 2]) < 0)
+			fprintf(stderr, "%s: cannot store the control delay: "
+				"%s\n", b->sensor->name, strerror(errno));
+		else
+			printf("    stored as the mode's control delay\n");
+	}
+
+	return missed ? -1 : 0;
+
+err:
+	bench_stop(b);
+	return -1;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -s, --sensor NAME    sensor: ov5645, ov7251, ov9281,\n"
+		"                       imx185\n"
+		"  -m, --media DEV      stream from the sensor (default: simulate)\n"
+		"  -p, --port N         CSI port (0 = J3, 1 = J4)\n"
+		"  -W, --width N        only the mode of this width ...\n"
+		"  -H, --height N       ... and height\n"
+		"  -t, --time S         seconds per mode (default 5)\n"
+		"  -P, --pattern N      test pattern menu index (default 1)\n"
+		"  -r, --ref FILE       reference checksums\n"
+		"  -w, --write-ref FILE write the checksums seen\n"
+		"  -e, --errors N       simulated: bad frame 1 in N\n"
+		"  -L, --latency CTRL   control latency of pattern or hflip\n"
+		"  -n, --toggles N      changes per mode (default 20)\n"
+		"  -i, --interval MS    time between changes (default 307)\n"
+		"  -u, --update         store the result in the driver\n"
+		"  -D, --delay N        simulated: write to frame delay\n",
+		argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "sensor", required_argument, NULL, 's' },
+		{ "media", required_argument, NULL, 'm' },
+		{ "port", required_argument, NULL, 'p' },
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "time", required_argument, NULL, 't' },
+		{ "pattern", required_argument, NULL, 'P' },
+		{ "ref", required_argument, NULL, 'r' },
+		{ "write-ref", required_argument, NULL, 'w' },
+		{ "errors", required_argument, NULL, 'e' },
+		{ "latency", required_argument, NULL, 'L' },
+		{ "toggles", required_argument, NULL, 'n' },
+		{ "interval", required_argument, NULL, 'i' },
+		{ "update", no_argument, NULL, 'u' },
+		{ "delay", required_argument, NULL, 'D' },
+		{ "help", no_argument, NULL, 'h' },
+		{ }
+	};
+	static struct bench_result res;
+	uint32_t width = 0, height = 0;
+	unsigned long dropped = 0, corrupt = 0;
+	FILE *ref_out = NULL;
+	unsigned int i, modes = 0;
+	struct bench b;
+	int opt, failed = 0;
+
+	memset(&b, 0, sizeof(b));
+	b.seconds = 5;
+	b.pattern = 1;
+	b.subdev_fd = -1;
+	b.toggles = 20;
+	b.interval_ms = 307;
+	b.sim_delay = 2;
+
+	while ((opt = getopt_long(argc, argv, "s:m:p:W:H:t:P:r:w:e:L:n:i:uD:h",
+				  opts, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			b.sensor = camss_sensor_lookup(optarg);
+			if (!b.sensor) {
+				fprintf(stderr, "unknown sensor %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'm':
+			b.media = optarg;
+			break;
+		case 'p':
+			b.port = atoi(optarg);
+			break;
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 't':
+			b.seconds = atoi(optarg);
+			break;
+		case 'P':
+			b.pattern = atoi(optarg);
+			break;
+		case 'r':
+			bench_ref_load(&b, optarg);
+			break;
+		case 'w':
+			ref_out = fopen(optarg, "w");
+			if (!ref_out) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'e':
+			b.error_every = atoi(optarg);
+			break;
+		case 'L':
+			for (i = 0; i < ARRAY_SIZE(lat_ctrls); i++)
+				if (!strcmp(lat_ctrls[i].name, optarg))
+					b.lat = &lat_ctrls[i];
+			if (!b.lat) {
+				fprintf(stderr, "unknown control %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'n':
+			b.toggles = atoi(optarg);
+			break;
+		case 'i':
+			b.interval_ms = atoi(optarg);
+			break;
+		case 'u':
+			b.update = 1;
+			break;
+		case 'D':
+			b.sim_delay = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!b.sensor || !b.seconds || b.error_every == 1 ||
+	    !b.toggles || b.toggles > LAT_MAX_TOGGLES || !b.interval_ms ||
+	    !b.sim_delay || b.sim_delay > LAT_MAX_FRAMES) {
+		usage(argv[0]);
+		return 1;
+	}
+	b.sim = !b.media;
+	/* Errors would be taken for control changes. */
+	if (b.lat)
+		b.error_every = 0;
+
+	if (b.lat)
+		printf("%s, %s, %u %s changes per mode\n", b.sensor->name,
+		       b.sim ? "simulated" : b.media, b.toggles, b.lat->name);
+	else
+		printf("%s, %s, %u s per mode\n", b.sensor->name,
+		       b.sim ? "simulated" : b.media, b.seconds);
+
+	for (i = 0; i < b.sensor->num_modes; i++) {
+		b.mode = &b.sensor->modes[i];
+		if ((width && b.mode->width != width) ||
+		    (height && b.mode->height != height))
+			continue;
+
+		modes++;
+		if (b.lat) {
+			if (lat_mode(&b) < 0)
+				failed = 1;
+			continue;
+		}
+
+		if (bench_mode(&b, &res, ref_out) < 0)
+			failed = 1;
+		dropped += res.dropped;
+		corrupt += res.corrupt;
+	}
+
+	sensor_restore(&b);
+	if (ref_out)
+		fclose(ref_out);
+
+	if (!modes) {
+		fprintf(stderr, "no matching mode\n");
+		return 1;
+	}
+
+	return failed || dropped || corrupt ? 1 : 0;
+}
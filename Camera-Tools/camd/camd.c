@@ -0,0 +1,1290 @@
+/*
+ * camd - capture daemon exporting V4L2 buffers as DMABUF fds.
+ *
+ * camd configures the CAMSS pipeline for one sensor on one CSI port,
+ * streams into a pool of MMAP buffers and shares them with any number of
+ * consumer processes over a Unix socket (see common/camd_proto.h). Frames
+ * are never copied: consumers import the DMABUF fds once and then only
+ * exchange buffer indices with the daemon.
+ *
+ * Typical use on the Dragonboard, replacing the media-ctl lines of the
+ * Pre-built readmes:
+ *
+ *	camd -m /dev/media1 -s ov5645 -p 0 -W 1920 -H 1080
+ *
+ * and against the vivid virtual driver, which needs no pipeline setup:
+ *
+ *	camd -d /dev/video0 -W 1280 -H 720 -f UYVY
+ *
+ * When no frame arrives for the watchdog period (-w), camd restarts the
+ * stream in place: STREAMOFF, a sensor hard reset through the driver's
+ * recovery control when it has one, requeue and STREAMON. Consumers stay
+ * connected and only see a gap in the sequence numbers.
+ *
+ * With --media camd also reads the sensor driver's exposure / gain records
+ * (CAMSS_CID_FRAME_META) once per frame and sends the one that applies
+ * with the frame, so consumers know what each buffer was exposed with.
+ *
+ * With -M camd writes a JSON line per second (-I) with sequence gaps,
+ * timestamp-to-dequeue latency, queue depth and the time spent reading
+ * metadata and delivering each frame, as histograms (common/streammon.h):
+ *
+ *	camd -m /dev/media1 -s imx185 -p 0 -W 1920 -H 1080 -M /tmp/camd.jsonl
+ *
+ * With -z camd streams at full resolution and keeps the last N frames
+ * for zero-shutter-lag stills (see camd/camd_still.c):
+ *
+ *	camd -m /dev/media1 -s ov5645 -p 0 -W 2592 -H 1944 -n 10 -z 4
+ *
+ * With -P (or -D) camd also streams the second sensor of a stereo board,
+ * pairs the two streams' frames by timestamp and delivers pairs: both
+ * buffers, or with -C one buffer both nodes captured into side by side.
+ * Pairing skew goes to the statistics and, per frame, to the consumers:
+ *
+ *	camd -m /dev/media1 -s ov5645 -p 0 -P 1 -W 1280 -H 960
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#include "camd_proto.h"
+#include "camss.h"
+#include "media.h"
+#include "stereopair.h"
+#include "streammon.h"
+#include "v4l2.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC		0x0001U
+#endif
+
+#define CAMD_MAX_CONNS		16
+#define CAMD_MIN_QUEUED		2
+#define CAMD_STATS_INTERVAL_NS	5000000000ull
+#define CAMD_POLL_MS		250
+
+struct camd_shutter {
+	uint64_t trigger_ns;
+	uint32_t cookie;
+};
+
+struct camd_conn {
+	int fd;
+	unsigned int held;
+	unsigned char holds[CAMD_MAX_BUFFERS];	/* references per buffer */
+	uint64_t skipped;
+
+	/* Shutter requests waiting for a frame at or after their trigger. */
+	struct camd_shutter shutters[CAMD_MAX_SHUTTERS];
+	unsigned int num_shutters;
+};
+
+struct camd {
+	struct v4l2_dev dev;
+	int listen_fd;
+	const char *socket_path;
+
+	/*
+	 * Stereo: the right camera. Buffer indices below right_base are the
+	 * left node's and, in CAMD_STEREO_PAIR mode, the ones from it on the
+	 * right node's; partner[] is the right buffer delivered with each
+	 * left one. In CAMD_STEREO_SBS mode an index names one memfd slot
+	 * whose halves are queued to both nodes together.
+	 */
+	struct v4l2_dev right;
+	enum camd_stereo stereo;
+	unsigned int num_buffers;	/* in the hello */
+	unsigned int right_base;
+	unsigned int partner[CAMD_MAX_BUFFERS];
+	struct stereopair pair;
+	int pair_resync;	/* SBS halves went out of step */
+	unsigned int pair_restarts;
+	int sbs_fd[CAMD_MAX_BUFFERS];
+	void *sbs_mem[CAMD_MAX_BUFFERS];
+	size_t sbs_length;
+
+	struct camd_conn conns[CAMD_MAX_CONNS];
+	unsigned int num_conns;
+
+	unsigned int refs[CAMD_MAX_BUFFERS];
+	unsigned int max_held;
+
+	/* ZSL ring of the most recent frames, oldest at zsl_head. */
+	struct camd_msg_frame zsl[CAMD_MAX_BUFFERS];
+	unsigned int zsl_depth;	/* 0 disables ZSL */
+	unsigned int zsl_head;
+	unsigned int zsl_count;
+
+	uint64_t frames;
+	uint64_t lost;
+	uint32_t last_sequence;
+	int resync;		/* sequence restarts after a stream restart */
+	uint64_t last_ts;
+	uint64_t interval_ns;	/* between consecutive frames, 0 if unknown */
+	int meta;		/* sensor_fd has CAMSS_CID_FRAME_META */
+
+	int sensor_fd;		/* sensor subdev, -1 without --media */
+	int right_sensor_fd;
+	uint64_t stall_ns;	/* 0 disables the watchdog */
+	uint64_t last_frame_ns;
+	unsigned int restarts;
+	uint64_t stats_ts;
+	uint64_t stats_frames;
+
+	struct streammon mon;
+	struct streammon mon_right;
+	int stage_meta;
+	int stage_deliver;
+	int stage_skew;
+};
+
+static volatile sig_atomic_t camd_stop;
+
+static void camd_signal(int sig)
+{
+	(void)sig;
+	camd_stop = 1;
+}
+
+static uint64_t camd_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int camd_listen(struct camd *camd)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s",
+		 camd->socket_path);
+	unlink(camd->socket_path);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, CAMD_MAX_CONNS) < 0) {
+		fprintf(stderr, "%s: %s\n", camd->socket_path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	camd->listen_fd = fd;
+
+	return 0;
+}
+
+static int camd_send_hello(struct camd *camd, int fd)
+{
+	char cbuf[CMSG_SPACE(sizeof(int) * CAMD_MAX_BUFFERS)];
+	struct camd_msg_hello hello;
+	struct iovec iov = { .iov_base = &hello, .iov_len = sizeof(hello) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+	};
+	struct cmsghdr *cmsg;
+	unsigned int i, n = camd->num_buffers;
+	int *fds;
+
+	memset(&hello, 0, sizeof(hello));
+	hello.type = CAMD_MSG_HELLO;
+	hello.version = CAMD_PROTO_VERSION;
+	hello.width = camd->dev.width;
+	hello.height = camd->dev.height;
+	hello.fourcc = camd->dev.fourcc;
+	hello.bytesperline = camd->dev.bytesperline;
+	hello.sizeimage = camd->dev.sizeimage;
+	hello.num_buffers = n;
+	hello.zsl_depth = camd->zsl_depth;
+	hello.stereo = camd->stereo;
+	hello.right_base = camd->right_base;
+	if (camd->stereo == CAMD_STEREO_SBS)
+		hello.width *= 2;
+
+	memset(cbuf, 0, sizeof(cbuf));
+	msg.msg_controllen = CMSG_SPACE(sizeof(int) * n);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n);
+	fds = (int *)CMSG_DATA(cmsg);
+
+	for (i = 0; i < n; i++) {
+		const struct v4l2_dev_buf *b;
+
+		if (camd->stereo == CAMD_STEREO_SBS) {
+			hello.buf_length[i] = camd->sbs_length;
+			fds[i] = camd->sbs_fd[i];
+			continue;
+		}
+
+		b = i < camd->right_base ? &camd->dev.bufs[i] :
+		    &camd->right.bufs[i - camd->right_base];
+		hello.buf_length[i] = b->length;
+		fds[i] = b->dmabuf_fd;
+	}
+
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(hello))
+		return -1;
+
+	return 0;
+}
+
+static void camd_accept(struct camd *camd)
+{
+	struct camd_conn *conn;
+	int fd;
+
+	fd = accept4(camd->listen_fd, NULL, NULL,
+		     SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (camd->num_conns == CAMD_MAX_CONNS) {
+		fprintf(stderr, "camd: too many consumers\n");
+		close(fd);
+		return;
+	}
+
+	if (camd_send_hello(camd, fd) < 0) {
+		close(fd);
+		return;
+	}
+
+	conn = &camd->conns[camd->num_conns++];
+	memset(conn, 0, sizeof(*conn));
+	conn->fd = fd;
+}
+
+/* Give buffer @index back to the node, or both nodes, it captures on. */
+static void camd_queue(struct camd *camd, unsigned int index)
+{
+	if (camd->stereo == CAMD_STEREO_SBS) {
+		v4l2_dev_queue(&camd->dev, index);
+		v4l2_dev_queue(&camd->right, index);
+	} else if (index >= camd->right_base) {
+		v4l2_dev_queue(&camd->right, index - camd->right_base);
+	} else {
+		v4l2_dev_queue(&camd->dev, index);
+	}
+}
+
+static void camd_put_buffer(struct camd *camd, unsigned int index)
+{
+	if (--camd->refs[index])
+		return;
+
+	camd_queue(camd, index);
+	if (camd->partner[index] != CAMD_INDEX_NONE) {
+		camd_queue(camd, camd->partner[index]);
+		camd->partner[index] = CAMD_INDEX_NONE;
+	}
+}
+
+static void camd_drop_conn(struct camd *camd, unsigned int n)
+{
+	struct camd_conn *conn = &camd->conns[n];
+	unsigned int i;
+
+	for (i = 0; i < camd->num_buffers; i++)
+		for (; conn->holds[i]; conn->holds[i]--)
+			camd_put_buffer(camd, i);
+
+	close(conn->fd);
+	camd->conns[n] = camd->conns[--camd->num_conns];
+}
+
+/*
+ * Answer a shutter request with @f, or with CAMD_INDEX_NONE when @f is
+ * NULL or the consumer already holds all the buffers it may.
+ */
+static void camd_send_still(struct camd *camd, struct camd_conn *conn,
+			    const struct camd_msg_frame *f, uint32_t cookie)
+{
+	struct camd_msg_frame msg;
+
+	if (conn->held >= camd->max_held)
+		f = NULL;
+
+	if (f) {
+		msg = *f;
+	} else {
+		memset(&msg, 0, sizeof(msg));
+		msg.index = CAMD_INDEX_NONE;
+		msg.right_index = CAMD_INDEX_NONE;
+	}
+	msg.type = CAMD_MSG_STILL;
+	msg.cookie = cookie;
+
+	if (send(conn->fd, &msg, sizeof(msg),
+		 MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(msg) || !f)
+		return;
+
+	conn->holds[f->index]++;
+	conn->held++;
+	camd->refs[f->index]++;
+}
+
+static const struct camd_msg_frame *camd_zsl_newest(struct camd *camd)
+{
+	if (!camd->zsl_count)
+		return NULL;
+
+	return &camd->zsl[(camd->zsl_head + camd->zsl_count - 1) %
+			  camd->zsl_depth];
+}
+
+/* The ring frame whose timestamp is closest to @trigger_ns. */
+static const struct camd_msg_frame *camd_zsl_pick(struct camd *camd,
+						   uint64_t trigger_ns)
+{
+	const struct camd_msg_frame *best = NULL;
+	uint64_t best_dist = 0;
+	unsigned int i;
+
+	for (i = 0; i < camd->zsl_count; i++) {
+		const struct camd_msg_frame *f;
+		uint64_t dist;
+
+		f = &camd->zsl[(camd->zsl_head + i) % camd->zsl_depth];
+		dist = f->timestamp_ns > trigger_ns ?
+		       f->timestamp_ns - trigger_ns :
+		       trigger_ns - f->timestamp_ns;
+		if (!best || dist < best_dist) {
+			best = f;
+			best_dist = dist;
+		}
+	}
+
+	return best;
+}
+
+/* Answer the requests of @conn that the ring can now decide. */
+static void camd_zsl_resolve(struct camd *camd, struct camd_conn *conn)
+{
+	const struct camd_msg_frame *newest = camd_zsl_newest(camd);
+
+	while (conn->num_shutters && newest &&
+	       newest->timestamp_ns >= conn->shutters[0].trigger_ns) {
+		camd_send_still(camd, conn,
+				camd_zsl_pick(camd,
+					      conn->shutters[0].trigger_ns),
+				conn->shutters[0].cookie);
+		memmove(&conn->shutters[0], &conn->shutters[1],
+			--conn->num_shutters * sizeof(conn->shutters[0]));
+	}
+}
+
+/*
+ * Keep @f in the ring, dropping the oldest frame when it is full, and
+ * answer the shutter requests it completes.
+ */
+static void camd_zsl_push(struct camd *camd, const struct camd_msg_frame *f)
+{
+	unsigned int i;
+
+	if (camd->zsl_count == camd->zsl_depth) {
+		camd_put_buffer(camd, camd->zsl[camd->zsl_head].index);
+		camd->zsl_head = (camd->zsl_head + 1) % camd->zsl_depth;
+		camd->zsl_count--;
+	}
+
+	camd->zsl[(camd->zsl_head + camd->zsl_count) % camd->zsl_depth] = *f;
+	camd->zsl_count++;
+	camd->refs[f->index]++;
+
+	for (i = 0; i < camd->num_conns; i++)
+		camd_zsl_resolve(camd, &camd->conns[i]);
+}
+
+static void camd_shutter(struct camd *camd, struct camd_conn *conn,
+			 const struct camd_msg_shutter *msg)
+{
+	struct camd_shutter *s;
+
+	if (!camd->zsl_depth || conn->num_shutters == CAMD_MAX_SHUTTERS) {
+		camd_send_still(camd, conn, NULL, msg->cookie);
+		return;
+	}
+
+	s = &conn->shutters[conn->num_shutters++];
+	s->trigger_ns = msg->trigger_ns ? msg->trigger_ns : camd_now_ns();
+	s->cookie = msg->cookie;
+
+	camd_zsl_resolve(camd, conn);
+}
+
+static void camd_conn_input(struct camd *camd, unsigned int n)
+{
+	struct camd_conn *conn = &camd->conns[n];
+	union {
+		uint32_t type;
+		struct camd_msg_release release;
+		struct camd_msg_shutter shutter;
+	} msg;
+	ssize_t len;
+
+	for (;;) {
+		len = recv(conn->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+		if (len < 0 && errno == EAGAIN)
+			return;
+
+		if (len == sizeof(msg.release) &&
+		    msg.type == CAMD_MSG_RELEASE &&
+		    msg.release.index < camd->right_base &&
+		    conn->holds[msg.release.index]) {
+			conn->holds[msg.release.index]--;
+			conn->held--;
+			camd_put_buffer(camd, msg.release.index);
+		} else if (len == sizeof(msg.shutter) &&
+			   msg.type == CAMD_MSG_SHUTTER) {
+			camd_shutter(camd, conn, &msg.shutter);
+		} else {
+			camd_drop_conn(camd, n);
+			return;
+		}
+	}
+}
+
+/*
+ * The driver record for frame @f: the newest one older than its start,
+ * estimated as one frame interval before the buffer timestamp, which
+ * CAMSS takes at the end of the frame.
+ */
+static void camd_frame_meta(struct camd *camd, const struct v4l2_dev_frame *f,
+			    struct camd_frame_meta *meta)
+{
+	struct camss_frame_meta_rec recs[CAMSS_FRAME_META_DEPTH];
+	const struct camss_frame_meta_rec *rec = NULL;
+	uint64_t sof, ts;
+	unsigned int i;
+
+	memset(meta, 0, sizeof(*meta));
+
+	if (!camd->meta || !camd->interval_ns ||
+	    f->timestamp_ns < camd->interval_ns)
+		return;
+
+	sof = f->timestamp_ns - camd->interval_ns;
+	meta->sof_ns = sof;
+
+	if (v4l2_ctrl_get_array(camd->sensor_fd, CAMSS_CID_FRAME_META, recs,
+				sizeof(recs)) < 0) {
+		fprintf(stderr, "camd: no frame metadata from the sensor: %s\n",
+			strerror(errno));
+		camd->meta = 0;
+		return;
+	}
+
+	/* Oldest first: the last match is the newest. */
+	for (i = 0; i < CAMSS_FRAME_META_DEPTH; i++) {
+		ts = (uint64_t)recs[i].ts_hi << 32 | recs[i].ts_lo;
+		if (recs[i].seq && ts < sof)
+			rec = &recs[i];
+	}
+	if (!rec)
+		return;
+
+	meta->valid = 1;
+	meta->exposure = rec->exposure;
+	meta->gain = rec->gain;
+	memcpy(meta->awb_gain, rec->awb_gain, sizeof(meta->awb_gain));
+}
+
+static void camd_deliver(struct camd *camd, const struct v4l2_dev_frame *f,
+			 const struct stereopair_result *pair,
+			 const struct camd_frame_meta *meta)
+{
+	struct camd_msg_frame msg;
+	unsigned int i;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type = CAMD_MSG_FRAME;
+	msg.index = f->index;
+	msg.sequence = f->sequence;
+	msg.bytesused = f->bytesused;
+	msg.timestamp_ns = f->timestamp_ns;
+	msg.flags = f->flags;
+	msg.meta = *meta;
+	msg.right_index = CAMD_INDEX_NONE;
+
+	if (pair) {
+		const struct v4l2_dev_frame *r = &pair->frame[STEREOPAIR_RIGHT];
+
+		if (camd->stereo == CAMD_STEREO_PAIR) {
+			msg.right_index = camd->right_base + r->index;
+			camd->partner[f->index] = msg.right_index;
+		}
+		msg.right_sequence = r->sequence;
+		msg.right_timestamp_ns = r->timestamp_ns;
+		msg.skew_ns = pair->skew_ns;
+	}
+
+	/*
+	 * Hold one reference while delivering so a consumer that releases
+	 * synchronously cannot requeue the buffer under our feet.
+	 */
+	camd->refs[f->index] = 1;
+
+	for (i = 0; i < camd->num_conns; i++) {
+		struct camd_conn *conn = &camd->conns[i];
+
+		/* A slow consumer only loses frames, it never stalls capture. */
+		if (conn->held >= camd->max_held) {
+			conn->skipped++;
+			continue;
+		}
+
+		if (send(conn->fd, &msg, sizeof(msg),
+			 MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(msg)) {
+			conn->skipped++;
+			continue;
+		}
+
+		conn->holds[f->index]++;
+		conn->held++;
+		camd->refs[f->index]++;
+	}
+
+	if (camd->zsl_depth)
+		camd_zsl_push(camd, &msg);
+
+	camd_put_buffer(camd, f->index);
+}
+
+static void camd_pair_stats(struct camd *camd)
+{
+	struct stereopair_stats *st = &camd->pair.stats;
+
+	fprintf(stderr, "camd: %llu pairs, %llu/%llu unpaired left/right, "
+		"skew mean %+lld us p99 <%u us max %u us, tolerance %llu us, "
+		"%u resyncs\n",
+		(unsigned long long)st->pairs,
+		(unsigned long long)st->unpaired[STEREOPAIR_LEFT],
+		(unsigned long long)st->unpaired[STEREOPAIR_RIGHT],
+		st->pairs ? (long long)st->skew_sum_ns /
+			    (long long)st->pairs / 1000 : 0,
+		streammon_hist_percentile(&st->skew, 990), st->skew.max_us,
+		(unsigned long long)stereopair_tolerance(&camd->pair) / 1000,
+		camd->pair_restarts);
+
+	memset(st, 0, sizeof(*st));
+}
+
+static void camd_stats(struct camd *camd, uint64_t now)
+{
+	double secs = (now - camd->stats_ts) / 1e9;
+
+	fprintf(stderr, "camd: %.1f fps, %llu frames, %llu lost, %u restarts, "
+		"%u consumers\n", (camd->frames - camd->stats_frames) / secs,
+		(unsigned long long)camd->frames,
+		(unsigned long long)camd->lost, camd->restarts,
+		camd->num_conns);
+
+	camd->stats_ts = now;
+	camd->stats_frames = camd->frames;
+
+	if (camd->stereo)
+		camd_pair_stats(camd);
+}
+
+/* Read the metadata of left frame @f and deliver it, with @pair if any. */
+static void camd_process(struct camd *camd, const struct v4l2_dev_frame *f,
+			 const struct stereopair_result *pair, uint64_t start)
+{
+	struct camd_frame_meta meta;
+
+	camd->last_frame_ns = start;
+
+	camd_frame_meta(camd, f, &meta);
+	streammon_stage(&camd->mon, camd->stage_meta, start);
+	start = camd_now_ns();
+	camd_deliver(camd, f, pair, &meta);
+	streammon_stage(&camd->mon, camd->stage_deliver, start);
+}
+
+/*
+ * Pair a frame of @side with the other camera's and deliver what pairs.
+ * An unpaired frame goes straight back to its node. In SBS mode it, or a
+ * pair from two different buffers, means one node filled a buffer more
+ * than the other; only restarting both puts their queues back in step.
+ */
+static void camd_pair(struct camd *camd, unsigned int side,
+		      const struct v4l2_dev_frame *f)
+{
+	const struct v4l2_dev_frame *left, *right;
+	struct stereopair_result res;
+
+	stereopair_push(&camd->pair, side, f);
+
+	while (stereopair_next(&camd->pair, &res)) {
+		left = &res.frame[STEREOPAIR_LEFT];
+		right = &res.frame[STEREOPAIR_RIGHT];
+
+		if (camd->stereo == CAMD_STEREO_SBS &&
+		    (res.event == STEREOPAIR_DROP ||
+		     left->index != right->index)) {
+			camd->pair_resync = 1;
+			continue;
+		}
+
+		if (res.event == STEREOPAIR_DROP) {
+			camd_queue(camd, res.side == STEREOPAIR_RIGHT ?
+				   camd->right_base + right->index :
+				   left->index);
+			continue;
+		}
+
+		streammon_stage_ns(&camd->mon, camd->stage_skew,
+				   res.skew_ns < 0 ? -res.skew_ns :
+						     res.skew_ns);
+		camd_process(camd, left, &res, camd_now_ns());
+	}
+}
+
+static void camd_capture(struct camd *camd)
+{
+	struct v4l2_dev_frame frame;
+	uint64_t start;
+
+	while (v4l2_dev_dequeue(&camd->dev, &frame) == 0) {
+		start = camd_now_ns();
+		streammon_frame(&camd->mon, frame.sequence, frame.timestamp_ns,
+				start, camd->dev.num_queued);
+
+		if (camd->frames && !camd->resync) {
+			if (frame.sequence != camd->last_sequence + 1)
+				camd->lost += frame.sequence -
+					      camd->last_sequence - 1;
+			else if (frame.timestamp_ns > camd->last_ts)
+				camd->interval_ns = frame.timestamp_ns -
+						    camd->last_ts;
+		}
+		camd->last_sequence = frame.sequence;
+		camd->last_ts = frame.timestamp_ns;
+		camd->resync = 0;
+		camd->frames++;
+
+		if (camd->stereo)
+			camd_pair(camd, STEREOPAIR_LEFT, &frame);
+		else
+			camd_process(camd, &frame, NULL, start);
+	}
+}
+
+static void camd_capture_right(struct camd *camd)
+{
+	struct v4l2_dev_frame frame;
+
+	while (v4l2_dev_dequeue(&camd->right, &frame) == 0) {
+		streammon_frame(&camd->mon_right, frame.sequence,
+				frame.timestamp_ns, camd_now_ns(),
+				camd->right.num_queued);
+		camd_pair(camd, STEREOPAIR_RIGHT, &frame);
+	}
+}
+
+/*
+ * The stream stalled (sensor latched up, CSI errors, ...). Restart it
+ * without dropping consumers; buffers they still hold are requeued when
+ * released, as usual.
+ */
+static void camd_recover_sensor(int fd)
+{
+	if (fd >= 0 && v4l2_ctrl_set(fd, CAMSS_CID_SENSOR_RECOVER, 1) < 0 &&
+	    errno != EINVAL)
+		fprintf(stderr, "camd: sensor recovery failed: %s\n",
+			strerror(errno));
+}
+
+/*
+ * The stream stalled (sensor latched up, CSI errors, ...), or with
+ * @recover clear the two halves of an SBS stream went out of step.
+ * Restart it without dropping consumers; buffers they still hold are
+ * requeued when released, as usual.
+ */
+static void camd_restart(struct camd *camd, uint64_t now, int recover)
+{
+	unsigned char held[CAMD_MAX_BUFFERS];
+	unsigned int i;
+
+	camd->last_frame_ns = now;
+	camd->resync = 1;
+	streammon_resync(&camd->mon);
+
+	v4l2_dev_stream_off(&camd->dev);
+	if (camd->stereo) {
+		v4l2_dev_stream_off(&camd->right);
+		streammon_resync(&camd->mon_right);
+		stereopair_flush(&camd->pair);
+		camd->pair_resync = 0;
+	}
+
+	if (recover) {
+		camd_recover_sensor(camd->sensor_fd);
+		camd_recover_sensor(camd->right_sensor_fd);
+	}
+
+	/* Right buffers are held through the left buffer they came with. */
+	memset(held, 0, sizeof(held));
+	for (i = 0; i < camd->num_buffers; i++) {
+		if (camd->refs[i])
+			held[i] = 1;
+		if (camd->refs[i] && camd->partner[i] != CAMD_INDEX_NONE)
+			held[camd->partner[i]] = 1;
+	}
+	for (i = 0; i < camd->num_buffers; i++)
+		if (!held[i])
+			camd_queue(camd, i);
+
+	/* On failure the next watchdog period tries again. */
+	if (v4l2_dev_stream_on(&camd->dev) == 0 && camd->stereo)
+		v4l2_dev_stream_on(&camd->right);
+}
+
+static int camd_run(struct camd *camd)
+{
+	struct pollfd pfd[3 + CAMD_MAX_CONNS];
+	unsigned int i, n;
+
+	camd->stats_ts = camd_now_ns();
+	camd->last_frame_ns = camd->stats_ts;
+
+	while (!camd_stop) {
+		uint64_t now;
+
+		pfd[0].fd = camd->dev.fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = camd->listen_fd;
+		pfd[1].events = POLLIN;
+		pfd[2].fd = camd->stereo ? camd->right.fd : -1;
+		pfd[2].events = POLLIN;
+		for (i = 0; i < camd->num_conns; i++) {
+			pfd[3 + i].fd = camd->conns[i].fd;
+			pfd[3 + i].events = POLLIN;
+		}
+		n = camd->num_conns;
+
+		if (poll(pfd, 3 + n, CAMD_POLL_MS) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		/* Walk consumers backwards, camd_drop_conn() reorders them. */
+		for (i = n; i-- > 0;) {
+			if (pfd[3 + i].revents & (POLLERR | POLLHUP))
+				camd_drop_conn(camd, i);
+			else if (pfd[3 + i].revents & POLLIN)
+				camd_conn_input(camd, i);
+		}
+
+		if (pfd[0].revents & POLLIN)
+			camd_capture(camd);
+		if (pfd[2].revents & POLLIN)
+			camd_capture_right(camd);
+		if (pfd[1].revents & POLLIN)
+			camd_accept(camd);
+
+		now = camd_now_ns();
+		if (camd->stall_ns &&
+		    now - camd->last_frame_ns >= camd->stall_ns) {
+			fprintf(stderr, "camd: no frame for %llu ms, "
+				"restarting the stream\n",
+				(unsigned long long)(now -
+						     camd->last_frame_ns) /
+				1000000);
+			camd->restarts++;
+			camd_restart(camd, now, 1);
+		} else if (camd->pair_resync) {
+			camd->pair_restarts++;
+			camd_restart(camd, now, 0);
+		}
+		if (now - camd->stats_ts >= CAMD_STATS_INTERVAL_NS)
+			camd_stats(camd, now);
+		streammon_tick(&camd->mon, now);
+		if (camd->stereo)
+			streammon_tick(&camd->mon_right, now);
+	}
+
+	return 0;
+}
+
+static uint32_t camd_parse_fourcc(const char *s)
+{
+	char c[4] = { ' ', ' ', ' ', ' ' };
+
+	memcpy(c, s, strnlen(s, 4));
+
+	return v4l2_fourcc(c[0], c[1], c[2], c[3]);
+}
+
+/* The sensor subdev wired to @port, for its recovery and metadata controls. */
+static int camd_open_sensor(int mfd, const struct camss_sensor *sensor,
+			    unsigned int port)
+{
+	struct media_entity_desc entity;
+	char subdev[64];
+
+	if (camss_sensor_entity(mfd, sensor, port, &entity) < 0 ||
+	    media_entity_devnode(&entity, subdev, sizeof(subdev)) < 0)
+		return -1;
+
+	return open(subdev, O_RDWR | O_CLOEXEC);
+}
+
+/*
+ * Side-by-side: one memfd per buffer, the left node writing from its start
+ * and the right node from half a line in, both with the doubled stride,
+ * so every frame is composed as it is captured.
+ */
+static int camd_sbs_alloc(struct camd *camd, unsigned int count)
+{
+	void *left[CAMD_MAX_BUFFERS], *right[CAMD_MAX_BUFFERS];
+	size_t half = camd->dev.bytesperline / 2;
+	unsigned int i;
+
+	/* The right half's last line ends half a line past the frame. */
+	camd->sbs_length = camd->dev.sizeimage + half;
+
+	for (i = 0; i < count; i++) {
+		camd->sbs_fd[i] = syscall(__NR_memfd_create, "camd-sbs",
+					  MFD_CLOEXEC);
+		if (camd->sbs_fd[i] < 0 ||
+		    ftruncate(camd->sbs_fd[i], camd->sbs_length) < 0)
+			goto err;
+
+		camd->sbs_mem[i] = mmap(NULL, camd->sbs_length,
+					PROT_READ | PROT_WRITE, MAP_SHARED,
+					camd->sbs_fd[i], 0);
+		if (camd->sbs_mem[i] == MAP_FAILED) {
+			camd->sbs_mem[i] = NULL;
+			goto err;
+		}
+		left[i] = camd->sbs_mem[i];
+		right[i] = (char *)camd->sbs_mem[i] + half;
+	}
+
+	if (v4l2_dev_use_userptr(&camd->dev, left, camd->dev.sizeimage,
+				 count) < 0 ||
+	    v4l2_dev_use_userptr(&camd->right, right, camd->right.sizeimage,
+				 count) < 0) {
+		fprintf(stderr, "camd: -C needs USERPTR capture on both "
+			"nodes: %s\n", strerror(errno));
+		return -1;
+	}
+
+	camd->num_buffers = count;
+	camd->right_base = count;
+
+	return 0;
+
+err:
+	fprintf(stderr, "camd: side-by-side buffers: %s\n", strerror(errno));
+	return -1;
+}
+
+static void camd_sbs_free(struct camd *camd)
+{
+	unsigned int i;
+
+	for (i = 0; i < CAMD_MAX_BUFFERS; i++) {
+		if (camd->sbs_mem[i])
+			munmap(camd->sbs_mem[i], camd->sbs_length);
+		if (camd->sbs_fd[i] >= 0)
+			close(camd->sbs_fd[i]);
+		camd->sbs_mem[i] = NULL;
+		camd->sbs_fd[i] = -1;
+	}
+}
+
+/*
+ * Set the format on the right node as on the left one, with the doubled
+ * stride side-by-side needs when @compose is set.
+ */
+static int camd_stereo_format(struct camd *camd, int compose)
+{
+	struct v4l2_dev *l = &camd->dev, *r = &camd->right;
+	uint32_t stride = compose ? l->bytesperline * 2 : 0;
+
+	if ((compose && v4l2_dev_set_format_stride(l, l->width, l->height,
+						   l->fourcc, stride) < 0) ||
+	    v4l2_dev_set_format_stride(r, l->width, l->height, l->fourcc,
+				       stride) < 0)
+		return -1;
+
+	if (compose && l->bytesperline != stride) {
+		fprintf(stderr, "%s: no %u byte stride, -C needs it\n",
+			l->path, stride);
+		return -1;
+	}
+
+	if (r->width != l->width || r->height != l->height ||
+	    r->fourcc != l->fourcc || r->bytesperline != l->bytesperline) {
+		fprintf(stderr, "%s and %s formats differ\n", l->path,
+			r->path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int camd_alloc_buffers(struct camd *camd, unsigned int count)
+{
+	switch (camd->stereo) {
+	case CAMD_STEREO_SBS:
+		return camd_sbs_alloc(camd, count);
+	case CAMD_STEREO_PAIR:
+		if (v4l2_dev_alloc_buffers(&camd->dev, count, 0, 1) < 0 ||
+		    v4l2_dev_alloc_buffers(&camd->right, count, 0, 1) < 0)
+			return -1;
+		camd->right_base = camd->dev.num_buffers;
+		camd->num_buffers = camd->dev.num_buffers +
+				    camd->right.num_buffers;
+		return 0;
+	default:
+		if (v4l2_dev_alloc_buffers(&camd->dev, count, 0, 1) < 0)
+			return -1;
+		camd->right_base = camd->dev.num_buffers;
+		camd->num_buffers = camd->dev.num_buffers;
+		return 0;
+	}
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -m, --media DEV      media device, enables CAMSS setup\n"
+		"  -s, --sensor NAME    sensor: ov5645, ov7251, ov9281,\n"
+		"                       imx185\n"
+		"  -p, --port N         CSI port (0 = J3, 1 = J4)\n"
+		"  -d, --device DEV     video node (default: found via media)\n"
+		"  -P, --stereo-port N  CSI port of the right camera, pairs\n"
+		"                       its frames with the first one's\n"
+		"  -D, --stereo-device DEV\n"
+		"                       right video node (default: via media)\n"
+		"  -T, --tolerance US   pair frames at most US apart\n"
+		"                       (default: half the frame interval)\n"
+		"  -C, --compose        pairs side by side in one buffer\n"
+		"  -W, --width N        frame width\n"
+		"  -H, --height N       frame height\n"
+		"  -f, --fourcc FOURCC  pixel format (default: from sensor)\n"
+		"  -n, --buffers N      buffers per camera (default 6)\n"
+		"  -w, --watchdog MS    restart the stream after MS without frames\n"
+		"                       (default 1000, 0 disables)\n"
+		"  -z, --zsl N          keep the last N frames for zero-shutter-lag\n"
+		"                       stills (default 0, off)\n"
+		"  -S, --socket PATH    socket path (default %s)\n"
+		"  -M, --monitor FILE   append streaming statistics as JSON\n"
+		"                       (- for stdout)\n"
+		"  -I, --monitor-ms MS  statistics period (default 1000)\n",
+		argv0, CAMD_DEFAULT_SOCKET);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "media", required_argument, NULL, 'm' },
+		{ "sensor", required_argument, NULL, 's' },
+		{ "port", required_argument, NULL, 'p' },
+		{ "device", required_argument, NULL, 'd' },
+		{ "stereo-port", required_argument, NULL, 'P' },
+		{ "stereo-device", required_argument, NULL, 'D' },
+		{ "tolerance", required_argument, NULL, 'T' },
+		{ "compose", no_argument, NULL, 'C' },
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "fourcc", required_argument, NULL, 'f' },
+		{ "buffers", required_argument, NULL, 'n' },
+		{ "watchdog", required_argument, NULL, 'w' },
+		{ "zsl", required_argument, NULL, 'z' },
+		{ "socket", required_argument, NULL, 'S' },
+		{ "monitor", required_argument, NULL, 'M' },
+		{ "monitor-ms", required_argument, NULL, 'I' },
+		{ "help", no_argument, NULL, 'h' },
+		{ }
+	};
+	const struct camss_sensor *sensor = NULL;
+	const char *media = NULL, *device = NULL, *monitor = NULL;
+	const char *right_device = NULL;
+	unsigned int monitor_ms = 1000;
+	FILE *monitor_out = NULL;
+	uint32_t width = 1920, height = 1080, fourcc = 0;
+	unsigned int port = 0, right_port = 0, nbufs = 6, i;
+	uint64_t tolerance_ns = 0;
+	int stereo_port = 0, compose = 0;
+	char video[64], right_video[64];
+	struct camd camd;
+	int opt, ret;
+
+	memset(&camd, 0, sizeof(camd));
+	camd.listen_fd = -1;
+	camd.sensor_fd = -1;
+	camd.right_sensor_fd = -1;
+	camd.right.fd = -1;
+	camd.socket_path = CAMD_DEFAULT_SOCKET;
+	camd.stall_ns = 1000000000ull;
+	for (i = 0; i < CAMD_MAX_BUFFERS; i++) {
+		camd.partner[i] = CAMD_INDEX_NONE;
+		camd.sbs_fd[i] = -1;
+	}
+
+	while ((opt = getopt_long(argc, argv,
+				  "m:s:p:d:P:D:T:CW:H:f:n:w:z:S:M:I:h",
+				  opts, NULL)) != -1) {
+		switch (opt) {
+		case 'm':
+			media = optarg;
+			break;
+		case 's':
+			sensor = camss_sensor_lookup(optarg);
+			if (!sensor) {
+				fprintf(stderr, "unknown sensor %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 'P':
+			right_port = atoi(optarg);
+			stereo_port = 1;
+			break;
+		case 'D':
+			right_device = optarg;
+			break;
+		case 'T':
+			tolerance_ns = strtoull(optarg, NULL, 0) * 1000ull;
+			break;
+		case 'C':
+			compose = 1;
+			break;
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 'f':
+			fourcc = camd_parse_fourcc(optarg);
+			break;
+		case 'n':
+			nbufs = atoi(optarg);
+			break;
+		case 'w':
+			camd.stall_ns = strtoull(optarg, NULL, 0) * 1000000ull;
+			break;
+		case 'z':
+			camd.zsl_depth = atoi(optarg);
+			break;
+		case 'S':
+			camd.socket_path = optarg;
+			break;
+		case 'M':
+			monitor = optarg;
+			break;
+		case 'I':
+			monitor_ms = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (stereo_port || right_device)
+		camd.stereo = compose ? CAMD_STEREO_SBS : CAMD_STEREO_PAIR;
+
+	if (media) {
+		int mfd;
+
+		if (!sensor) {
+			fprintf(stderr, "--media needs --sensor\n");
+			return 1;
+		}
+		if (!camss_sensor_mode(sensor, width, height))
+			fprintf(stderr, "warning: %ux%u is not a %s mode\n",
+				width, height, sensor->name);
+
+		mfd = media_open(media);
+		if (mfd < 0)
+			return 1;
+		ret = camss_pipeline_setup(mfd, sensor, port, width, height,
+					   video, sizeof(video));
+		if (ret == 0 && stereo_port)
+			ret = camss_pipeline_setup(mfd, sensor, right_port,
+						   width, height, right_video,
+						   sizeof(right_video));
+		/* The watchdog works without them, minus the sensor reset. */
+		if (ret == 0) {
+			camd.sensor_fd = camd_open_sensor(mfd, sensor, port);
+			if (stereo_port)
+				camd.right_sensor_fd =
+					camd_open_sensor(mfd, sensor,
+							 right_port);
+		}
+		close(mfd);
+		if (ret < 0)
+			goto err_sensor;
+		if (!device)
+			device = video;
+		if (!right_device && stereo_port)
+			right_device = right_video;
+	}
+
+	if (!device || (camd.stereo && !right_device)) {
+		fprintf(stderr, "no video device, use --device or --media\n");
+		goto err_sensor;
+	}
+	if (!fourcc)
+		fourcc = sensor ? sensor->fourcc : V4L2_PIX_FMT_UYVY;
+	if (nbufs < CAMD_MIN_QUEUED + 1 || nbufs > CAMD_MAX_BUFFERS ||
+	    (camd.stereo == CAMD_STEREO_PAIR &&
+	     nbufs > CAMD_MAX_BUFFERS / 2)) {
+		fprintf(stderr, "--buffers must be %u..%u\n",
+			CAMD_MIN_QUEUED + 1,
+			camd.stereo == CAMD_STEREO_PAIR ?
+			CAMD_MAX_BUFFERS / 2 : CAMD_MAX_BUFFERS);
+		goto err_sensor;
+	}
+
+	if (monitor) {
+		monitor_out = strcmp(monitor, "-") ? fopen(monitor, "a") :
+						     stdout;
+		if (!monitor_out || !monitor_ms) {
+			fprintf(stderr, "cannot monitor to %s\n", monitor);
+			goto err_sensor;
+		}
+	}
+	streammon_init(&camd.mon, "camd", monitor_out, monitor_ms);
+	camd.stage_meta = streammon_add_stage(&camd.mon, "meta");
+	camd.stage_deliver = streammon_add_stage(&camd.mon, "deliver");
+	camd.stage_skew = -1;
+	if (camd.stereo) {
+		streammon_init(&camd.mon_right, "camd-right", monitor_out,
+			       monitor_ms);
+		camd.stage_skew = streammon_add_stage(&camd.mon, "skew");
+		stereopair_init(&camd.pair, tolerance_ns);
+	}
+
+	if (v4l2_dev_open(&camd.dev, device) < 0 ||
+	    v4l2_dev_set_format(&camd.dev, width, height, fourcc) < 0)
+		goto err_close;
+
+	if (camd.stereo &&
+	    (v4l2_dev_open(&camd.right, right_device) < 0 ||
+	     camd_stereo_format(&camd, compose) < 0))
+		goto err_close;
+
+	if (camd_alloc_buffers(&camd, nbufs) < 0)
+		goto err_close;
+
+	camd.meta = camd.sensor_fd >= 0;
+
+	/*
+	 * Keep enough buffers in the driver that capture never starves, and
+	 * at least one for each consumer besides the ZSL ring and, with two
+	 * cameras, the frame waiting for its partner.
+	 */
+	if (camd.right_base < camd.zsl_depth + CAMD_MIN_QUEUED + 1 +
+			      !!camd.stereo) {
+		fprintf(stderr, "--zsl %u needs at least %u buffers\n",
+			camd.zsl_depth,
+			camd.zsl_depth + CAMD_MIN_QUEUED + 1 + !!camd.stereo);
+		goto err_close;
+	}
+	camd.max_held = camd.right_base - CAMD_MIN_QUEUED - camd.zsl_depth -
+			!!camd.stereo;
+
+	if (camd_listen(&camd) < 0)
+		goto err_close;
+
+	signal(SIGINT, camd_signal);
+	signal(SIGTERM, camd_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Both nodes take the buffers in index order, as SBS needs. */
+	if (v4l2_dev_queue_all(&camd.dev) < 0 ||
+	    (camd.stereo && v4l2_dev_queue_all(&camd.right) < 0) ||
+	    v4l2_dev_stream_on(&camd.dev) < 0 ||
+	    (camd.stereo && v4l2_dev_stream_on(&camd.right) < 0))
+		goto err_unlink;
+
+	fprintf(stderr, "camd: %s %ux%u %.4s, %u buffers (%u ZSL), "
+		"serving %s\n",
+		camd.dev.path, camd.dev.width, camd.dev.height,
+		(const char *)&camd.dev.fourcc, camd.num_buffers,
+		camd.zsl_depth, camd.socket_path);
+	if (camd.stereo)
+		fprintf(stderr, "camd: paired with %s%s\n", camd.right.path,
+			compose ? ", side by side" : "");
+
+	ret = camd_run(&camd);
+
+	v4l2_dev_stream_off(&camd.dev);
+	if (camd.stereo)
+		v4l2_dev_stream_off(&camd.right);
+	while (camd.num_conns)
+		camd_drop_conn(&camd, camd.num_conns - 1);
+	close(camd.listen_fd);
+	unlink(camd.socket_path);
+	v4l2_dev_close(&camd.dev);
+	v4l2_dev_close(&camd.right);
+	camd_sbs_free(&camd);
+	if (camd.sensor_fd >= 0)
+		close(camd.sensor_fd);
+	if (camd.right_sensor_fd >= 0)
+		close(camd.right_sensor_fd);
+	if (monitor_out && monitor_out != stdout)
+		fclose(monitor_out);
+
+	return ret < 0 ? 1 : 0;
+
+err_unlink:
+	close(camd.listen_fd);
+	unlink(camd.socket_path);
+err_close:
+	v4l2_dev_close(&camd.dev);
+	v4l2_dev_close(&camd.right);
+	camd_sbs_free(&camd);
+	if (monitor_out && monitor_out != stdout)
+		fclose(monitor_out);
+err_sensor:
+	if (camd.sensor_fd >= 0)
+		close(camd.sensor_fd);
+	if (camd.right_sensor_fd >= 0)
+		close(camd.right_sensor_fd);
+	return 1;
+}
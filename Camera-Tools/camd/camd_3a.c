@@ -0,0 +1,479 @@
+/*
+ * camd_3a - auto exposure and white balance statistics for raw sensors.
+ *
+ * A camd consumer: every raw frame goes through the SIMD statistics
+ * of pixel/raw_stats, and a simple AE loop turns the centre-weighted zone
+ * mean into new V4L2_CID_EXPOSURE / V4L2_CID_GAIN values written to the
+ * sensor subdev, at most once per frame. After a write the loop waits for
+ * the first frame whose metadata from camd shows the new settings, so it
+ * never reacts to frames that were exposed with the old ones; without
+ * metadata it skips the sensor's control latency instead (-l, else the
+ * driver's control delay property, else 2 frames). For Bayer sensors
+ * grey-world AWB gains are smoothed and reported; they are what
+ * isp_set_params() wants for ISP-lite. The monochrome OV9281 (Y10, Y8)
+ * gets AE only; the OV7251 is monochrome too but reports SRGGB10, so its
+ * AWB gains mean nothing.
+ *
+ *	camd -m /dev/media1 -s imx185 -p 0 -W 1920 -H 1080 &
+ *	camd_3a -m /dev/media1 -s imx185
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "camd_client.h"
+#include "camss.h"
+#include "media.h"
+#include "raw_stats.h"
+#include "v4l2.h"
+
+#define AE_DEADBAND		0.05f	/* relative error left alone */
+#define AE_DAMPING		0.6f	/* exponent applied to each correction */
+#define AE_CLIP_FRACTION	0.02f	/* clipped blocks that cap the target */
+#define AWB_SMOOTHING		0.1f
+#define AE_META_TIMEOUT		8	/* frames to wait for the metadata */
+
+enum ae_gain_model {
+	AE_GAIN_DB,		/* code * step dB */
+	AE_GAIN_LINEAR,		/* code / step */
+};
+
+/*
+ * Units of the sensor drivers' exposure (lines) and gain controls. The
+ * OmniVision gains are 0x10 = 1x, their black level the BLC target 0x40.
+ */
+static const struct ae_sensor {
+	const char *name;
+	enum ae_gain_model model;
+	float step;
+	unsigned int black_level;	/* 10-bit */
+} ae_sensors[] = {
+	{ "imx185", AE_GAIN_DB, 0.3f, 60 },
+	{ "ov7251", AE_GAIN_LINEAR, 16.0f, 64 },
+	{ "ov9281", AE_GAIN_LINEAR, 16.0f, 64 },
+};
+
+/* Monochrome formats; the statistics treat them as RGGB. */
+static const struct {
+	uint32_t fourcc;
+	unsigned int bpp;
+} ae_mono_formats[] = {
+	{ V4L2_PIX_FMT_Y10, 10 },
+	{ V4L2_PIX_FMT_Y10P, 10 },
+	{ V4L2_PIX_FMT_GREY, 8 },
+};
+
+static const uint32_t ae_ctrl_ids[] = { V4L2_CID_EXPOSURE, V4L2_CID_GAIN };
+
+struct ae {
+	const struct ae_sensor *sensor;
+	int fd;
+	int32_t exposure, exposure_min, exposure_max;
+	int32_t gain, gain_min, gain_max;
+	float target;
+	unsigned int latency;
+	unsigned int settle;
+	unsigned int waited;
+	unsigned long updates;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static float ae_gain_linear(const struct ae *ae, int32_t code)
+{
+	if (ae->sensor->model == AE_GAIN_DB)
+		return powf(10.0f, code * ae->sensor->step / 20.0f);
+
+	return code / ae->sensor->step;
+}
+
+static int32_t ae_gain_code(const struct ae *ae, float linear)
+{
+	float code;
+
+	if (ae->sensor->model == AE_GAIN_DB)
+		code = 20.0f * log10f(linear) / ae->sensor->step;
+	else
+		code = linear * ae->sensor->step;
+
+	code = floorf(code + 0.5f);
+	if (code < ae->gain_min)
+		return ae->gain_min;
+	if (code > ae->gain_max)
+		return ae->gain_max;
+
+	return code;
+}
+
+static int ae_open(struct ae *ae, const char *subdev)
+{
+	ae->fd = open(subdev, O_RDWR | O_CLOEXEC);
+	if (ae->fd < 0) {
+		fprintf(stderr, "%s: %s\n", subdev, strerror(errno));
+		return -1;
+	}
+
+	if (v4l2_ctrl_range(ae->fd, V4L2_CID_EXPOSURE, &ae->exposure_min,
+			    &ae->exposure_max) < 0 ||
+	    v4l2_ctrl_range(ae->fd, V4L2_CID_GAIN, &ae->gain_min,
+			    &ae->gain_max) < 0 ||
+	    v4l2_ctrl_get(ae->fd, V4L2_CID_EXPOSURE, &ae->exposure) < 0 ||
+	    v4l2_ctrl_get(ae->fd, V4L2_CID_GAIN, &ae->gain) < 0) {
+		fprintf(stderr, "%s: no exposure/gain controls\n", subdev);
+		close(ae->fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Centre-weighted mean: the middle half of the grid counts four times. */
+static float ae_metering(const struct raw_stats *stats)
+{
+	unsigned int zx, zy, w, nx = stats->zones_x, ny = stats->zones_y;
+	double sum = 0, weight = 0;
+
+	for (zy = 0; zy < ny; zy++) {
+		for (zx = 0; zx < nx; zx++) {
+			unsigned int i = zy * nx + zx;
+
+			if (!stats->zone_blocks[i])
+				continue;
+
+			w = zx >= nx / 4 && zx < nx - nx / 4 &&
+			    zy >= ny / 4 && zy < ny - ny / 4 ? 4 : 1;
+			sum += w * raw_stats_zone_mean(stats, zx, zy);
+			weight += w;
+		}
+	}
+
+	return weight ? sum / weight : 0;
+}
+
+/* Whether @meta (or, without it, the frame count) says a write took effect. */
+static int ae_settled(struct ae *ae, const struct camd_frame_meta *meta)
+{
+	if (meta->valid) {
+		if (ae->waited < AE_META_TIMEOUT &&
+		    (meta->exposure != (uint32_t)ae->exposure ||
+		     meta->gain != (uint32_t)ae->gain)) {
+			ae->waited++;
+			return 0;
+		}
+		return 1;
+	}
+
+	if (ae->settle) {
+		ae->settle--;
+		return 0;
+	}
+
+	return 1;
+}
+
+static void ae_update(struct ae *ae, const struct raw_stats *stats,
+		      const struct camd_frame_meta *meta, uint8_t clip,
+		      float mean)
+{
+	uint32_t clipped = 0;
+	int32_t exposure, gain, values[2];
+	float ratio, total;
+	unsigned int i;
+
+	if (!ae_settled(ae, meta))
+		return;
+
+	for (i = clip; i < RAW_STATS_BINS; i++)
+		clipped += stats->hist[i];
+
+	ratio = ae->target / (mean > 0.5f ? mean : 0.5f);
+	/* Blown highlights: keep going down even if the mean says up. */
+	if (clipped > stats->blocks * AE_CLIP_FRACTION && ratio > 0.8f)
+		ratio = 0.8f;
+	if (fabsf(ratio - 1.0f) < AE_DEADBAND)
+		return;
+
+	ratio = powf(fminf(fmaxf(ratio, 0.25f), 4.0f), AE_DAMPING);
+	total = ae->exposure * ae_gain_linear(ae, ae->gain) * ratio;
+
+	/* Longest exposure first, gain only for what is left. */
+	exposure = total < ae->exposure_min ? ae->exposure_min :
+		   total > ae->exposure_max ? ae->exposure_max : total;
+	gain = ae_gain_code(ae, total / exposure);
+
+	if (exposure == ae->exposure && gain == ae->gain)
+		return;
+
+	/* One call, so the driver writes both under one group hold. */
+	values[0] = exposure;
+	values[1] = gain;
+	if (v4l2_ctrls_set(ae->fd, ae_ctrl_ids, values, 2) < 0) {
+		fprintf(stderr, "camd_3a: control write failed: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	ae->exposure = exposure;
+	ae->gain = gain;
+	ae->settle = ae->latency;
+	ae->waited = 0;
+	ae->updates++;
+}
+
+/* 0 for a Bayer format, 1 for a monochrome one, -1 for anything else. */
+static int ae_format(uint32_t fourcc, enum isp_cfa *cfa, unsigned int *bpp)
+{
+	unsigned int i;
+
+	if (isp_bayer_format(fourcc, cfa, bpp) == 0)
+		return 0;
+
+	for (i = 0; i < sizeof(ae_mono_formats) / sizeof(ae_mono_formats[0]);
+	     i++) {
+		if (ae_mono_formats[i].fourcc == fourcc) {
+			*cfa = ISP_CFA_RGGB;
+			*bpp = ae_mono_formats[i].bpp;
+			return 1;
+		}
+	}
+
+	return -1;
+}
+
+static int find_subdev(const char *media, const char *name, char *path,
+		       size_t len)
+{
+	struct media_entity_desc entity;
+	int fd, ret;
+
+	fd = media_open(media);
+	if (fd < 0)
+		return -1;
+
+	ret = media_find_entity(fd, name, &entity);
+	if (ret == 0)
+		ret = media_entity_devnode(&entity, path, len);
+	if (ret < 0)
+		fprintf(stderr, "%s: no subdev node for %s\n", media, name);
+
+	close(fd);
+
+	return ret;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -S, --socket PATH    camd socket (default %s)\n"
+		"  -m, --media DEV      media device to find the sensor subdev\n"
+		"  -d, --subdev DEV     sensor subdev node (instead of --media)\n"
+		"  -s, --sensor NAME    sensor: imx185, ov7251, ov9281\n"
+		"  -t, --target N       target mean, 8-bit linear (default 46)\n"
+		"  -l, --latency N      frames before a control takes effect, without\n"
+		"                       frame metadata (default: the driver's control\n"
+		"                       delay, else 2)\n"
+		"  -b, --black N        black level override, sensor bits\n"
+		"  -c, --count N        stop after N frames\n",
+		argv0, CAMD_DEFAULT_SOCKET);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "socket", required_argument, NULL, 'S' },
+		{ "media", required_argument, NULL, 'm' },
+		{ "subdev", required_argument, NULL, 'd' },
+		{ "sensor", required_argument, NULL, 's' },
+		{ "target", required_argument, NULL, 't' },
+		{ "latency", required_argument, NULL, 'l' },
+		{ "black", required_argument, NULL, 'b' },
+		{ "count", required_argument, NULL, 'c' },
+		{ "help", no_argument, NULL, 'h' },
+		{ }
+	};
+	const char *path = CAMD_DEFAULT_SOCKET, *media = NULL, *subdev = NULL;
+	const char *sensor = NULL;
+	unsigned long count = 0, n = 0;
+	int32_t latency = -1;
+	struct raw_stats_engine *engine = NULL;
+	struct raw_stats_config cfg;
+	struct raw_stats stats;
+	struct camd_msg_frame frame;
+	struct camd_client client;
+	float awb[3] = { 1.0f, 1.0f, 1.0f };
+	uint64_t stats_ns = 0, stats_max = 0;
+	int black = -1, mono, ret = 1;
+	enum isp_cfa cfa;
+	unsigned int bpp, i;
+	struct ae ae;
+	char node[64];
+	int opt;
+
+	memset(&ae, 0, sizeof(ae));
+	ae.target = 46;
+
+	while ((opt = getopt_long(argc, argv, "S:m:d:s:t:l:b:c:h", opts,
+				  NULL)) != -1) {
+		switch (opt) {
+		case 'S':
+			path = optarg;
+			break;
+		case 'm':
+			media = optarg;
+			break;
+		case 'd':
+			subdev = optarg;
+			break;
+		case 's':
+			sensor = optarg;
+			break;
+		case 't':
+			ae.target = strtof(optarg, NULL);
+			break;
+		case 'l':
+			latency = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			black = strtol(optarg, NULL, 0);
+			break;
+		case 'c':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	for (i = 0; sensor && i < sizeof(ae_sensors) / sizeof(ae_sensors[0]);
+	     i++)
+		if (!strcmp(ae_sensors[i].name, sensor))
+			ae.sensor = &ae_sensors[i];
+	if (!ae.sensor || (!media && !subdev) || ae.target < 1 ||
+	    ae.target > 250) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (!subdev) {
+		if (find_subdev(media, sensor, node, sizeof(node)) < 0)
+			return 1;
+		subdev = node;
+	}
+	if (ae_open(&ae, subdev) < 0)
+		return 1;
+
+	/* The delay measured for this mode, if the driver publishes one. */
+	if (latency < 0 &&
+	    v4l2_ctrl_get(ae.fd, CAMSS_CID_CTRL_DELAY, &latency) < 0)
+		latency = 2;
+	ae.latency = latency;
+
+	if (camd_client_connect(&client, path) < 0)
+		goto err_ae;
+
+	mono = ae_format(client.hello.fourcc, &cfa, &bpp);
+	if (mono < 0) {
+		fprintf(stderr, "%.4s is not a raw Bayer or grey format\n",
+			(const char *)&client.hello.fourcc);
+		goto err_client;
+	}
+
+	raw_stats_config_default(&cfg, client.hello.width, client.hello.height,
+				 raw_packing_from_stride(bpp,
+							 client.hello.width,
+							 client.hello.bytesperline),
+				 bpp, cfa);
+	if (black >= 0)
+		cfg.black_level = black;
+	else if (bpp >= 10)
+		cfg.black_level = ae.sensor->black_level << (bpp - 10);
+	else
+		cfg.black_level = ae.sensor->black_level >> (10 - bpp);
+
+	engine = raw_stats_create(&cfg);
+	if (!engine || camd_client_map(&client) < 0) {
+		fprintf(stderr, "cannot compute statistics on %ux%u %.4s\n",
+			client.hello.width, client.hello.height,
+			(const char *)&client.hello.fourcc);
+		goto err_client;
+	}
+
+	fprintf(stderr, "camd_3a: %s, exposure %d..%d, gain %d..%d, "
+		"stats %s\n", subdev, ae.exposure_min, ae.exposure_max,
+		ae.gain_min, ae.gain_max, raw_stats_ops_best()->name);
+
+	while (!count || n < count) {
+		float gains[3], mean;
+		uint64_t start, t;
+
+		if (camd_client_next(&client, &frame) < 0)
+			break;
+
+		start = now_ns();
+		camd_client_begin_access(&client, frame.index);
+		raw_stats_process(engine, client.map[frame.index],
+				  client.hello.bytesperline, &stats);
+		camd_client_end_access(&client, frame.index);
+		t = now_ns() - start;
+		camd_client_release(&client, frame.index);
+
+		stats_ns += t;
+		if (t > stats_max)
+			stats_max = t;
+
+		mean = ae_metering(&stats);
+		ae_update(&ae, &stats, &frame.meta, cfg.clip, mean);
+
+		if (!mono) {
+			raw_stats_grey_world(&stats, gains);
+			for (i = 0; i < 3; i++)
+				awb[i] += (gains[i] - awb[i]) * AWB_SMOOTHING;
+		}
+
+		if (++n % 30 == 0) {
+			printf("seq %u mean %.1f p99 %u exposure %d gain %d "
+			       "(x%.2f)", frame.sequence, mean,
+			       raw_stats_percentile(&stats, 990), ae.exposure,
+			       ae.gain, ae_gain_linear(&ae, ae.gain));
+			if (!mono)
+				printf(" awb R %.2f B %.2f", awb[0], awb[2]);
+			printf(" stats %.3f/%.3f ms\n", stats_ns / 1e6 / 30,
+			       stats_max / 1e6);
+			fflush(stdout);
+			stats_ns = 0;
+			stats_max = 0;
+		}
+	}
+
+	fprintf(stderr, "camd_3a: %lu frames, %lu control updates\n", n,
+		ae.updates);
+	ret = 0;
+
+err_client:
+	raw_stats_destroy(engine);
+	camd_client_close(&client);
+err_ae:
+	close(ae.fd);
+	return ret;
+}
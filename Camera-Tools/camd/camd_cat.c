@@ -0,0 +1,388 @@
+/*
+ * camd_cat - example camd consumer.
+ *
+ * Imports the daemon's DMABUF buffers, prints per-frame information and
+ * optionally writes the first N frames to a file, e.g.
+ *
+ *	camd_cat -c 10 -o frames.uyvy
+ *
+ * UYVY streams can be converted on the way out with -F, using the SIMD
+ * kernels over -j threads, and raw Bayer streams run through ISP-lite:
+ *
+ *	camd_cat -c 10 -F nv12 -o frames.nv12
+ *	camd_cat -c 10 -F rgb24 -o frames.rgb
+ *
+ * With a stereo camd, each line also shows the right camera's frame and
+ * the pair's skew, and a plain dump (-o without -F) writes the left then
+ * the right frame of every pair. -F disparity turns each pair into a Q4
+ * disparity map (uint16_t per pixel, 0xffff where unmatched) with the
+ * stereo module on luma, rectified with the calibration given by -K; with
+ * a baseline in the calibration, -F depth writes millimetres instead:
+ *
+ *	camd_cat -c 100 -K ov5645.calib -F depth -o depth.u16
+ *
+ * -M FILE appends per-second JSON statistics of the consumer side (see
+ * common/streammon.h): frames missed, buffer timestamp to receipt latency
+ * and the time spent processing and writing each frame.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/videodev2.h>
+
+#include "camd_client.h"
+#include "isp_lite.h"
+#include "stereo.h"
+#include "streammon.h"
+#include "yuv_convert.h"
+
+static const struct {
+	const char *name;
+	enum yuv_conv conv;
+} formats[] = {
+	{ "nv12", YUV_CONV_NV12 },
+	{ "i420", YUV_CONV_I420 },
+	{ "y", YUV_CONV_Y },
+	{ "nv12-half", YUV_CONV_NV12_HALF },
+};
+
+static int parse_format(const char *name, enum yuv_conv *conv)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		if (!strcmp(formats[i].name, name)) {
+			*conv = formats[i].conv;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/* Stereo matching on the luma of both halves of each pair. */
+static struct stereo *pair_stereo_create(const struct camd_msg_hello *hello,
+					 const char *calib_path, int depth,
+					 struct workpool *pool)
+{
+	unsigned int width = hello->width;
+	struct stereo_params params;
+	struct stereo_calib calib;
+
+	if (hello->stereo == CAMD_STEREO_NONE ||
+	    (hello->fourcc != V4L2_PIX_FMT_UYVY &&
+	     hello->fourcc != V4L2_PIX_FMT_GREY))
+		return NULL;
+	if (calib_path && stereo_calib_load(calib_path, &calib) < 0)
+		return NULL;
+	if (depth && (!calib_path || calib.baseline <= 0)) {
+		fprintf(stderr, "-F depth needs a calibration with a baseline\n");
+		return NULL;
+	}
+
+	if (hello->stereo == CAMD_STEREO_SBS)
+		width /= 2;
+	stereo_params_default(&params, width);
+	return stereo_create(calib_path ? &calib : NULL, &params, width,
+			     hello->height, pool);
+}
+
+/* ISP-lite for a Bayer stream, with the packing guessed from the stride. */
+static struct isp *bayer_isp_create(const struct camd_msg_hello *hello,
+				    struct workpool *pool)
+{
+	struct isp_params params;
+	enum isp_cfa cfa;
+	unsigned int bpp;
+
+	if (isp_bayer_format(hello->fourcc, &cfa, &bpp) < 0)
+		return NULL;
+
+	isp_params_default(&params, cfa);
+	return isp_create(&params, hello->width, hello->height,
+			  raw_packing_from_stride(bpp, hello->width,
+						  hello->bytesperline),
+			  bpp, pool);
+}
+
+/* Disparity (or depth) of the pair announced by @frame into @out. */
+static int stereo_pair(struct camd_client *client,
+		       const struct camd_msg_frame *frame, struct stereo *st,
+		       uint16_t *out, int depth)
+{
+	const struct camd_msg_hello *hello = &client->hello;
+	unsigned int width = hello->width, r = frame->right_index;
+	enum stereo_src fmt = hello->fourcc == V4L2_PIX_FMT_UYVY ?
+			      STEREO_SRC_UYVY : STEREO_SRC_Y8;
+	const uint8_t *left = client->map[frame->index], *right;
+
+	if (hello->stereo == CAMD_STEREO_SBS) {
+		width /= 2;
+		r = frame->index;
+		right = left + hello->bytesperline / 2;
+	} else if (r != CAMD_INDEX_NONE) {
+		right = client->map[r];
+	} else {
+		return -1;
+	}
+
+	camd_client_begin_access(client, frame->index);
+	if (r != frame->index)
+		camd_client_begin_access(client, r);
+	stereo_rectify(st, fmt, left, hello->bytesperline, right,
+		       hello->bytesperline);
+	if (r != frame->index)
+		camd_client_end_access(client, r);
+	camd_client_end_access(client, frame->index);
+
+	stereo_disparity(st, out, width);
+	if (depth)
+		stereo_depth(st, out, width, out, width);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = CAMD_DEFAULT_SOCKET, *output = NULL;
+	const char *calib = NULL;
+	struct camd_msg_frame frame;
+	struct camd_client client;
+	unsigned long count = 0, n = 0;
+	struct workpool *pool = NULL;
+	unsigned int threads = 0, conv_size = 0;
+	struct yuv_planes planes;
+	enum yuv_conv conv = YUV_CONV_NV12;
+	uint8_t *conv_buf = NULL;
+	struct isp *isp = NULL;
+	struct stereo *st = NULL;
+	int convert = 0, rgb = 0, disparity = 0, depth = 0;
+	FILE *out = NULL, *monitor = NULL;
+	struct streammon mon;
+	int stage_process, stage_write;
+	uint64_t start;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "S:c:o:F:K:j:M:h")) != -1) {
+		switch (opt) {
+		case 'S':
+			path = optarg;
+			break;
+		case 'c':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'F':
+			if (!strcmp(optarg, "rgb24")) {
+				rgb = 1;
+			} else if (!strcmp(optarg, "disparity")) {
+				disparity = 1;
+			} else if (!strcmp(optarg, "depth")) {
+				disparity = depth = 1;
+			} else if (parse_format(optarg, &conv) < 0) {
+				fprintf(stderr, "unknown format %s\n", optarg);
+				return 1;
+			}
+			convert = 1;
+			break;
+		case 'K':
+			calib = optarg;
+			break;
+		case 'j':
+			threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'M':
+			monitor = strcmp(optarg, "-") ? fopen(optarg, "a") :
+							stdout;
+			if (!monitor) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-S socket] [-c count] [-o file]\n"
+				"       [-F nv12|i420|y|nv12-half|rgb24|disparity|depth]\n"
+				"       [-K stereo.calib] [-j threads] [-M stats.jsonl]\n",
+				argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	streammon_init(&mon, "camd_cat", monitor, 1000);
+	stage_process = streammon_add_stage(&mon, "process");
+	stage_write = streammon_add_stage(&mon, "write");
+
+	if (camd_client_connect(&client, path) < 0)
+		return 1;
+
+	printf("%ux%u %.4s, stride %u, %u buffers%s\n", client.hello.width,
+	       client.hello.height, (const char *)&client.hello.fourcc,
+	       client.hello.bytesperline, client.hello.num_buffers,
+	       client.hello.stereo == CAMD_STEREO_PAIR ? ", stereo pairs" :
+	       client.hello.stereo == CAMD_STEREO_SBS ? ", side by side" :
+	       "");
+
+	if (convert && !rgb && !disparity &&
+	    client.hello.fourcc != V4L2_PIX_FMT_UYVY) {
+		fprintf(stderr, "-F needs a UYVY stream\n");
+		camd_client_close(&client);
+		return 1;
+	}
+
+	if (output) {
+		out = fopen(output, "wb");
+		if (!out || camd_client_map(&client) < 0) {
+			perror(output);
+			camd_client_close(&client);
+			return 1;
+		}
+	}
+
+	if (out && disparity) {
+		pool = workpool_create(threads);
+		st = pool ? pair_stereo_create(&client.hello, calib, depth,
+					       pool) : NULL;
+		if (!st) {
+			fprintf(stderr, "-F %s needs a stereo UYVY or GREY stream\n",
+				depth ? "depth" : "disparity");
+			goto done;
+		}
+		conv_size = client.hello.width * client.hello.height * 2;
+		if (client.hello.stereo == CAMD_STEREO_SBS)
+			conv_size /= 2;
+		conv_buf = malloc(conv_size);
+		if (!conv_buf) {
+			fprintf(stderr, "out of memory\n");
+			goto done;
+		}
+	} else if (out && rgb) {
+		conv_size = client.hello.width * 3 * client.hello.height;
+		conv_buf = malloc(conv_size);
+		pool = workpool_create(threads);
+		isp = pool ? bayer_isp_create(&client.hello, pool) : NULL;
+		if (!conv_buf || !isp) {
+			fprintf(stderr, "cannot process %.4s with ISP-lite\n",
+				(const char *)&client.hello.fourcc);
+			goto done;
+		}
+	} else if (out && convert) {
+		conv_size = yuv_planes_layout(conv, client.hello.width,
+					      client.hello.height, NULL,
+					      &planes);
+		conv_buf = malloc(conv_size);
+		pool = workpool_create(threads);
+		if (!conv_buf || !pool) {
+			fprintf(stderr, "out of memory\n");
+			goto done;
+		}
+		yuv_planes_layout(conv, client.hello.width,
+				  client.hello.height, conv_buf, &planes);
+	}
+
+	while (!count || n < count) {
+		if (camd_client_next(&client, &frame) < 0)
+			break;
+
+		streammon_frame(&mon, frame.sequence, frame.timestamp_ns,
+				streammon_now(), STREAMMON_QUEUED_NONE);
+
+		printf("seq %u buf %u %u bytes ts %llu.%06llu\n",
+		       frame.sequence, frame.index, frame.bytesused,
+		       (unsigned long long)(frame.timestamp_ns / 1000000000ull),
+		       (unsigned long long)(frame.timestamp_ns / 1000 % 1000000));
+		if (client.hello.stereo)
+			printf("    right seq %u buf %d skew %+lld us\n",
+			       frame.right_sequence,
+			       frame.right_index == CAMD_INDEX_NONE ? -1 :
+			       (int)frame.right_index,
+			       (long long)frame.skew_ns / 1000);
+		if (frame.meta.valid)
+			printf("    exposure %u gain %u awb %u/%u/%u\n",
+			       frame.meta.exposure, frame.meta.gain,
+			       frame.meta.awb_gain[0], frame.meta.awb_gain[1],
+			       frame.meta.awb_gain[2]);
+
+		start = streammon_now();
+		if (st) {
+			if (stereo_pair(&client, &frame, st,
+					(uint16_t *)conv_buf, depth) < 0) {
+				fprintf(stderr, "seq %u has no right frame\n",
+					frame.sequence);
+			} else {
+				streammon_stage(&mon, stage_process, start);
+				start = streammon_now();
+				fwrite(conv_buf, 1, conv_size, out);
+				streammon_stage(&mon, stage_write, start);
+			}
+		} else if (isp) {
+			camd_client_begin_access(&client, frame.index);
+			isp_process(isp, client.map[frame.index],
+				    client.hello.bytesperline, conv_buf,
+				    client.hello.width * 3);
+			camd_client_end_access(&client, frame.index);
+			streammon_stage(&mon, stage_process, start);
+			start = streammon_now();
+			fwrite(conv_buf, 1, conv_size, out);
+			streammon_stage(&mon, stage_write, start);
+		} else if (conv_buf) {
+			int ret;
+
+			camd_client_begin_access(&client, frame.index);
+			ret = yuv_convert_frame(pool, conv,
+						client.map[frame.index],
+						client.hello.bytesperline,
+						client.hello.width,
+						client.hello.height, &planes);
+			camd_client_end_access(&client, frame.index);
+			if (ret < 0) {
+				fprintf(stderr, "cannot convert %ux%u\n",
+					client.hello.width, client.hello.height);
+				camd_client_release(&client, frame.index);
+				break;
+			}
+			streammon_stage(&mon, stage_process, start);
+			start = streammon_now();
+			fwrite(conv_buf, 1, conv_size, out);
+			streammon_stage(&mon, stage_write, start);
+		} else if (out) {
+			camd_client_begin_access(&client, frame.index);
+			fwrite(client.map[frame.index], 1, frame.bytesused, out);
+			camd_client_end_access(&client, frame.index);
+			if (frame.right_index != CAMD_INDEX_NONE) {
+				unsigned int r = frame.right_index;
+
+				camd_client_begin_access(&client, r);
+				fwrite(client.map[r], 1, frame.bytesused, out);
+				camd_client_end_access(&client, r);
+			}
+			streammon_stage(&mon, stage_write, start);
+		}
+
+		camd_client_release(&client, frame.index);
+		n++;
+		streammon_tick(&mon, streammon_now());
+	}
+
+done:
+	stereo_destroy(st);
+	isp_destroy(isp);
+	workpool_destroy(pool);
+	free(conv_buf);
+	if (out)
+		fclose(out);
+	if (monitor && monitor != stdout)
+		fclose(monitor);
+	camd_client_close(&client);
+
+	return 0;
+}
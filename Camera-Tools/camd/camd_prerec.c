@@ -0,0 +1,411 @@
+/*
+ * camd_prerec - keep the last seconds of a camd stream, record on trigger.
+ *
+ * Every frame is copied from the shared DMABUF into a fixed, preallocated
+ * ring of -b seconds (common/prering.h). A trigger flushes what the ring
+ * holds to <prefix>-NNN.raw from a writer thread and keeps recording the
+ * frames that follow for -a seconds, so the file covers the event without
+ * a gap while streaming goes on:
+ *
+ *	camd -m /dev/media1 -s imx185 -p 0 -W 1920 -H 1080
+ *	camd_prerec -r 60 -b 10 -a 5 -o /mnt/ssd/event
+ *
+ * Every line on stdin is a trigger, as for camd_still: an empty line means
+ * now, a number is a CLOCK_MONOTONIC time in nanoseconds. SIGUSR1 triggers
+ * too. Nothing is allocated per frame; the ring is sized from -r and -b
+ * up front and locked in memory where the limits allow.
+ *
+ * -C stores frames in a smaller form, so the ring takes less memory and
+ * the disk less bandwidth: unpacked 10-bit Bayer is packed to MIPI RAW10
+ * (lossless, 5/8 of the size) and UYVY becomes NV12 (3/4, chroma halved
+ * vertically).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "camd_client.h"
+#include "prering.h"
+#include "raw_unpack.h"
+#include "yuv_convert.h"
+
+enum prerec_store {
+	STORE_COPY,
+	STORE_PACK10,
+	STORE_NV12,
+};
+
+static const struct {
+	uint32_t unpacked;
+	uint32_t packed;
+} pack10_formats[] = {
+	{ V4L2_PIX_FMT_SRGGB10, V4L2_PIX_FMT_SRGGB10P },
+	{ V4L2_PIX_FMT_SGRBG10, V4L2_PIX_FMT_SGRBG10P },
+	{ V4L2_PIX_FMT_SGBRG10, V4L2_PIX_FMT_SGBRG10P },
+	{ V4L2_PIX_FMT_SBGGR10, V4L2_PIX_FMT_SBGGR10P },
+};
+
+struct prerec_pack {
+	const struct camd_msg_hello *hello;
+	const uint8_t *src;
+	uint8_t *dst;
+	unsigned int dst_stride;
+};
+
+static volatile sig_atomic_t prerec_signal, prerec_stop;
+
+static void prerec_sig(int sig)
+{
+	if (sig == SIGUSR1)
+		prerec_signal = 1;
+	else
+		prerec_stop = 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* 16-bit container to RAW10, the inverse of raw10_to16_c(). */
+static void pack10_row(const uint16_t *src, uint8_t *dst, unsigned int width)
+{
+	unsigned int x, i;
+	uint8_t lo;
+
+	for (x = 0; x + 4 <= width; x += 4, src += 4, dst += 5) {
+		dst[0] = src[0] >> 2;
+		dst[1] = src[1] >> 2;
+		dst[2] = src[2] >> 2;
+		dst[3] = src[3] >> 2;
+		dst[4] = (src[0] & 3) | (src[1] & 3) << 2 |
+			 (src[2] & 3) << 4 | (src[3] & 3) << 6;
+	}
+
+	for (i = 0, lo = 0; x < width; x++, i++) {
+		dst[i] = src[i] >> 2;
+		lo |= (src[i] & 3) << (2 * i);
+	}
+	if (i)
+		dst[4] = lo;
+}
+
+static void pack10_band(void *arg, unsigned int start, unsigned int end)
+{
+	struct prerec_pack *p = arg;
+	unsigned int y;
+
+	for (y = start; y < end; y++)
+		pack10_row((const uint16_t *)(p->src +
+					      y * p->hello->bytesperline),
+			   p->dst + y * p->dst_stride, p->hello->width);
+}
+
+static void prerec_store(enum prerec_store store, struct workpool *pool,
+			 const struct camd_msg_hello *hello,
+			 const struct rawrec_format *fmt, const uint8_t *src,
+			 uint8_t *dst, size_t frame_size)
+{
+	struct yuv_planes planes;
+	struct prerec_pack pack;
+
+	switch (store) {
+	case STORE_PACK10:
+		pack.hello = hello;
+		pack.src = src;
+		pack.dst = dst;
+		pack.dst_stride = fmt->bytesperline;
+		workpool_run(pool, pack10_band, &pack, hello->height);
+		break;
+	case STORE_NV12:
+		/* Only points @planes into the slot, nothing is allocated. */
+		yuv_planes_layout(YUV_CONV_NV12, hello->width, hello->height,
+				  dst, &planes);
+		yuv_convert_frame(pool, YUV_CONV_NV12, src,
+				  hello->bytesperline, hello->width,
+				  hello->height, &planes);
+		break;
+	default:
+		memcpy(dst, src, frame_size);
+		break;
+	}
+}
+
+/* How frames are stored, and their size. Returns -1 if -C cannot apply. */
+static int prerec_format(const struct camd_msg_hello *hello, int compress,
+			 enum prerec_store *store, struct rawrec_format *fmt,
+			 size_t *frame_size)
+{
+	struct yuv_planes planes;
+	unsigned int i;
+
+	fmt->fourcc = hello->fourcc;
+	fmt->width = hello->width;
+	fmt->height = hello->height;
+	fmt->bytesperline = hello->bytesperline;
+	*frame_size = (size_t)hello->bytesperline * hello->height;
+	*store = STORE_COPY;
+
+	if (!compress)
+		return 0;
+
+	if (hello->fourcc == V4L2_PIX_FMT_UYVY) {
+		if (hello->width % 2 || hello->height % 2)
+			return -1;
+		*store = STORE_NV12;
+		fmt->fourcc = V4L2_PIX_FMT_NV12;
+		fmt->bytesperline = hello->width;
+		*frame_size = yuv_planes_layout(YUV_CONV_NV12, hello->width,
+						hello->height, NULL, &planes);
+		return 0;
+	}
+
+	for (i = 0; i < sizeof(pack10_formats) / sizeof(pack10_formats[0]);
+	     i++) {
+		if (pack10_formats[i].unpacked != hello->fourcc)
+			continue;
+		/* CAMSS may already deliver RAW10 under this fourcc. */
+		if (raw_packing_from_stride(10, hello->width,
+					    hello->bytesperline) !=
+		    RAW_UNPACKED16)
+			return 0;
+		*store = STORE_PACK10;
+		fmt->fourcc = pack10_formats[i].packed;
+		fmt->bytesperline = raw_row_bytes(RAW_PACKED10, hello->width);
+		*frame_size = (size_t)fmt->bytesperline * hello->height;
+		return 0;
+	}
+
+	return -1;
+}
+
+/* One line of stdin: empty for now, else a trigger time in ns. */
+static void prerec_trigger(struct prering *ring, const char *line)
+{
+	uint64_t trigger;
+	char *end;
+
+	trigger = strtoull(line, &end, 0);
+	if (end == line)
+		trigger = now_ns();
+
+	prering_trigger(ring, trigger);
+	printf("trigger at %llu.%06llu\n",
+	       (unsigned long long)(trigger / 1000000000ull),
+	       (unsigned long long)(trigger / 1000 % 1000000));
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = CAMD_DEFAULT_SOCKET;
+	struct prering_config cfg = {
+		.prefix = "event",
+		.depth = 8,
+	};
+	unsigned int fps = 30, pre_s = 10, post_s = 5, threads = 0;
+	unsigned int frames = 0;
+	enum prerec_store store;
+	struct prering_stats stats;
+	struct camd_msg_frame frame;
+	struct camd_client client;
+	struct workpool *pool = NULL;
+	struct prering *ring = NULL;
+	uint64_t missed = 0;
+	uint32_t last_sequence = 0;
+	int compress = 0, first = 1;
+	struct pollfd pfd[2];
+	char line[64];
+	size_t line_len = 0;
+	uint8_t *dst;
+	int opt, ret = 1;
+
+	while ((opt = getopt(argc, argv, "S:o:r:b:a:n:CD:j:h")) != -1) {
+		switch (opt) {
+		case 'S':
+			path = optarg;
+			break;
+		case 'o':
+			cfg.prefix = optarg;
+			break;
+		case 'r':
+			fps = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			pre_s = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			post_s = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'C':
+			compress = 1;
+			break;
+		case 'D':
+			cfg.depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			threads = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-S socket] [-o prefix] [-r fps]\n"
+				"       [-b pre-secs] [-a post-secs] [-n frames]\n"
+				"       [-C] [-D depth] [-j threads]\n",
+				argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	/* A trigger up to a second late still finds -b seconds of history. */
+	if (!frames)
+		frames = (pre_s + 1) * fps;
+	cfg.pre_ns = pre_s * 1000000000ull;
+	cfg.post_ns = post_s * 1000000000ull;
+	cfg.frames = frames;
+
+	if (camd_client_connect(&client, path) < 0)
+		return 1;
+
+	if (prerec_format(&client.hello, compress, &store, &cfg.fmt,
+			  &cfg.frame_size) < 0) {
+		fprintf(stderr, "-C needs a UYVY or unpacked 10-bit Bayer "
+			"stream\n");
+		goto done;
+	}
+
+	if (camd_client_map(&client) < 0)
+		goto done;
+
+	if (store != STORE_COPY) {
+		pool = workpool_create(threads);
+		if (!pool) {
+			fprintf(stderr, "out of memory\n");
+			goto done;
+		}
+	}
+
+	ring = prering_create(&cfg);
+	if (!ring) {
+		fprintf(stderr, "cannot allocate %u frames of %zu bytes\n",
+			frames, cfg.frame_size);
+		goto done;
+	}
+	prering_get_stats(ring, &stats);
+
+	printf("%ux%u %.4s stored as %.4s, %u frames (%.1f s at %u fps), "
+	       "%.1f MB%s\n", client.hello.width, client.hello.height,
+	       (const char *)&client.hello.fourcc,
+	       (const char *)&cfg.fmt.fourcc, frames, (double)frames / fps,
+	       fps, (double)frames * RAWREC_ALIGN_UP(cfg.frame_size) / 1e6,
+	       stats.locked ? " locked" : "");
+	if (!stats.locked)
+		fprintf(stderr, "cannot lock the ring, raise RLIMIT_MEMLOCK\n");
+	fflush(stdout);
+
+	signal(SIGUSR1, prerec_sig);
+	signal(SIGINT, prerec_sig);
+	signal(SIGTERM, prerec_sig);
+
+	pfd[0].fd = client.fd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = STDIN_FILENO;
+	pfd[1].events = POLLIN;
+
+	/* poll() ignores the stdin entry once it is set to -1 at EOF. */
+	while (!prerec_stop) {
+		if (prerec_signal) {
+			prerec_signal = 0;
+			prerec_trigger(ring, "");
+		}
+
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[1].revents & (POLLIN | POLLHUP)) {
+			ssize_t len;
+			char *nl;
+
+			len = read(STDIN_FILENO, line + line_len,
+				   sizeof(line) - 1 - line_len);
+			if (len <= 0) {
+				pfd[1].fd = -1;
+			} else {
+				line_len += len;
+				line[line_len] = '\0';
+				while ((nl = strchr(line, '\n'))) {
+					*nl = '\0';
+					prerec_trigger(ring, line);
+					line_len -= nl + 1 - line;
+					memmove(line, nl + 1, line_len + 1);
+				}
+				/* Overlong garbage, drop it. */
+				if (line_len == sizeof(line) - 1)
+					line_len = 0;
+			}
+		}
+
+		if (!(pfd[0].revents & (POLLIN | POLLHUP)))
+			continue;
+		if (camd_client_next(&client, &frame) < 0)
+			break;
+
+		if (!first && frame.sequence != last_sequence + 1)
+			missed += frame.sequence - last_sequence - 1;
+		last_sequence = frame.sequence;
+		first = 0;
+
+		/* NULL: the writer is behind, counted as an overrun. */
+		dst = prering_reserve(ring);
+		if (dst) {
+			camd_client_begin_access(&client, frame.index);
+			prerec_store(store, pool, &client.hello, &cfg.fmt,
+				     client.map[frame.index], dst,
+				     cfg.frame_size);
+			camd_client_end_access(&client, frame.index);
+			prering_commit(ring, frame.sequence,
+				       frame.timestamp_ns);
+		}
+
+		camd_client_release(&client, frame.index);
+	}
+
+	ret = 0;
+
+done:
+	if (ring) {
+		/* Finishes an event in progress first. */
+		prering_destroy(ring, &stats);
+		printf("%llu frames, %llu missed, %llu overruns, %u events "
+		       "(%u failed), %llu frames written\n",
+		       (unsigned long long)stats.frames,
+		       (unsigned long long)missed,
+		       (unsigned long long)stats.overruns, stats.events,
+		       stats.failed, (unsigned long long)stats.written);
+	}
+	workpool_destroy(pool);
+	camd_client_close(&client);
+
+	return ret;
+}
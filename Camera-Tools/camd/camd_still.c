@@ -0,0 +1,285 @@
+/*
+ * camd_still - zero-shutter-lag stills from a camd ZSL ring.
+ *
+ * Switching the OV5645 to 2592x1944 for a still means stopping the stream,
+ * reprogramming the mode and waiting for AE to settle, hundreds of ms
+ * after the shutter was pressed. Instead camd streams at full resolution
+ * and keeps the most recent frames (-z), and camd_still asks for the one
+ * captured closest to the shutter press:
+ *
+ *	camd -m /dev/media1 -s ov5645 -p 0 -W 2592 -H 1944 -n 10 -z 4
+ *	camd_still -P preview.nv12 -o still
+ *
+ * Every line on stdin is a shutter press: an empty line means now, a
+ * number is a CLOCK_MONOTONIC trigger time in nanoseconds (a GPIO edge
+ * timestamp, say). Each still is written to <prefix>NNN.raw straight from
+ * the DMABUF camd already shares. Meanwhile every frame is scaled to half
+ * size NV12 for the preview (-P), so the viewfinder costs a quarter of the
+ * full-resolution bandwidth. camd_still exits once stdin is closed and all
+ * requested stills have arrived.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "camd_client.h"
+#include "yuv_convert.h"
+
+struct still_req {
+	uint32_t cookie;	/* 0: free */
+	uint64_t trigger_ns;
+};
+
+struct still {
+	struct camd_client client;
+	const char *prefix;
+	struct still_req reqs[CAMD_MAX_SHUTTERS];
+	unsigned int pending;
+	uint32_t next_cookie;
+	unsigned int taken;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* One line of stdin: empty for now, else a trigger time in ns. */
+static void still_shutter(struct still *st, const char *line)
+{
+	uint64_t trigger;
+	char *end;
+	unsigned int i;
+
+	trigger = strtoull(line, &end, 0);
+	if (end == line)
+		trigger = now_ns();
+
+	if (st->pending == CAMD_MAX_SHUTTERS) {
+		fprintf(stderr, "shutter busy, press ignored\n");
+		return;
+	}
+
+	for (i = 0; st->reqs[i].cookie; i++)
+		;
+
+	/* Cookie 0 marks a free slot. */
+	if (!++st->next_cookie)
+		st->next_cookie++;
+	st->reqs[i].cookie = st->next_cookie;
+	st->reqs[i].trigger_ns = trigger;
+
+	if (camd_client_shutter(&st->client, trigger, st->reqs[i].cookie) < 0) {
+		st->reqs[i].cookie = 0;
+		return;
+	}
+
+	st->pending++;
+}
+
+static void still_write(struct still *st, const struct camd_msg_frame *frame)
+{
+	uint64_t trigger = 0;
+	char path[256];
+	unsigned int i;
+	FILE *f;
+
+	for (i = 0; i < CAMD_MAX_SHUTTERS; i++) {
+		if (st->reqs[i].cookie == frame->cookie) {
+			trigger = st->reqs[i].trigger_ns;
+			st->reqs[i].cookie = 0;
+			st->pending--;
+			break;
+		}
+	}
+
+	if (frame->index == CAMD_INDEX_NONE) {
+		printf("still %u: no frame available\n", frame->cookie);
+		return;
+	}
+
+	snprintf(path, sizeof(path), "%s%03u.raw", st->prefix, st->taken++);
+	f = fopen(path, "wb");
+	if (f) {
+		camd_client_begin_access(&st->client, frame->index);
+		fwrite(st->client.map[frame->index], 1, frame->bytesused, f);
+		camd_client_end_access(&st->client, frame->index);
+		fclose(f);
+	} else {
+		perror(path);
+	}
+
+	printf("still %u: seq %u, %+.1f ms from the trigger, %s\n",
+	       frame->cookie, frame->sequence,
+	       ((double)frame->timestamp_ns - (double)trigger) / 1e6, path);
+
+	camd_client_release(&st->client, frame->index);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = CAMD_DEFAULT_SOCKET, *preview_path = NULL;
+	struct camd_msg_frame frame;
+	struct workpool *pool = NULL;
+	unsigned int threads = 0, conv_size = 0;
+	struct yuv_planes planes;
+	uint8_t *conv_buf = NULL;
+	FILE *preview = NULL;
+	struct pollfd pfd[2];
+	char line[64];
+	size_t line_len = 0;
+	struct still st;
+	int opt, ret = 1;
+
+	memset(&st, 0, sizeof(st));
+	st.prefix = "still";
+
+	while ((opt = getopt(argc, argv, "S:o:P:j:h")) != -1) {
+		switch (opt) {
+		case 'S':
+			path = optarg;
+			break;
+		case 'o':
+			st.prefix = optarg;
+			break;
+		case 'P':
+			preview_path = optarg;
+			break;
+		case 'j':
+			threads = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-S socket] [-o prefix] [-P preview.nv12]\n"
+				"       [-j threads]\n", argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (camd_client_connect(&st.client, path) < 0)
+		return 1;
+
+	printf("%ux%u %.4s, %u buffers, ZSL depth %u\n", st.client.hello.width,
+	       st.client.hello.height, (const char *)&st.client.hello.fourcc,
+	       st.client.hello.num_buffers, st.client.hello.zsl_depth);
+
+	if (!st.client.hello.zsl_depth)
+		fprintf(stderr, "camd runs without --zsl, stills will fail\n");
+
+	if (camd_client_map(&st.client) < 0)
+		goto done;
+
+	if (preview_path) {
+		if (st.client.hello.fourcc != V4L2_PIX_FMT_UYVY ||
+		    st.client.hello.width % 4 || st.client.hello.height % 4) {
+			fprintf(stderr, "-P needs a UYVY stream with a size "
+				"divisible by 4\n");
+			goto done;
+		}
+
+		preview = fopen(preview_path, "wb");
+		if (!preview) {
+			perror(preview_path);
+			goto done;
+		}
+
+		conv_size = yuv_planes_layout(YUV_CONV_NV12_HALF,
+					      st.client.hello.width,
+					      st.client.hello.height, NULL,
+					      &planes);
+		conv_buf = malloc(conv_size);
+		pool = workpool_create(threads);
+		if (!conv_buf || !pool) {
+			fprintf(stderr, "out of memory\n");
+			goto done;
+		}
+		yuv_planes_layout(YUV_CONV_NV12_HALF, st.client.hello.width,
+				  st.client.hello.height, conv_buf, &planes);
+	}
+
+	pfd[0].fd = st.client.fd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = STDIN_FILENO;
+	pfd[1].events = POLLIN;
+
+	/* poll() ignores the stdin entry once it is set to -1 at EOF. */
+	while (pfd[1].fd >= 0 || st.pending) {
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[1].revents & (POLLIN | POLLHUP)) {
+			ssize_t len;
+			char *nl;
+
+			len = read(STDIN_FILENO, line + line_len,
+				   sizeof(line) - 1 - line_len);
+			if (len <= 0) {
+				pfd[1].fd = -1;
+			} else {
+				line_len += len;
+				line[line_len] = '\0';
+				while ((nl = strchr(line, '\n'))) {
+					*nl = '\0';
+					still_shutter(&st, line);
+					line_len -= nl + 1 - line;
+					memmove(line, nl + 1, line_len + 1);
+				}
+				/* Overlong garbage, drop it. */
+				if (line_len == sizeof(line) - 1)
+					line_len = 0;
+			}
+		}
+
+		if (!(pfd[0].revents & (POLLIN | POLLHUP)))
+			continue;
+		if (camd_client_next(&st.client, &frame) < 0)
+			break;
+
+		if (frame.type == CAMD_MSG_STILL) {
+			still_write(&st, &frame);
+			continue;
+		}
+
+		if (preview) {
+			camd_client_begin_access(&st.client, frame.index);
+			yuv_convert_frame(pool, YUV_CONV_NV12_HALF,
+					  st.client.map[frame.index],
+					  st.client.hello.bytesperline,
+					  st.client.hello.width,
+					  st.client.hello.height, &planes);
+			camd_client_end_access(&st.client, frame.index);
+			fwrite(conv_buf, 1, conv_size, preview);
+		}
+
+		camd_client_release(&st.client, frame.index);
+	}
+
+	ret = 0;
+
+done:
+	workpool_destroy(pool);
+	free(conv_buf);
+	if (preview)
+		fclose(preview);
+	camd_client_close(&st.client);
+
+	return ret;
+}
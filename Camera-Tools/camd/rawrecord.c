@@ -0,0 +1,532 @@
+/*
+ * rawrecord - record raw frames to disk with O_DIRECT and io_uring.
+ *
+ * IMX185 1080p60 RAW10 is about 155 MB/s; through buffered write() that
+ * much data churns the page cache and stalls capture whenever writeback
+ * falls behind. rawrecord instead hands every dequeued MMAP buffer to the
+ * kernel for an O_DIRECT write straight from the capture memory and only
+ * requeues it once the write has completed (common/rawrec.h). The file is
+ * preallocated, so no block allocation happens while streaming, and an
+ * index of frame offsets and timestamps is written next to it:
+ *
+ *	rawrecord -m /dev/media1 -s imx185 -p 0 -W 1920 -H 1080 -t 60 \
+ *		-o /mnt/ssd/imx185.raw
+ *
+ * Frames can also come from any V4L2 capture node (vivid) with -d, or
+ * from a file of raw frames replayed at -r fps with -i, which tests the
+ * writer at sensor rates without a sensor:
+ *
+ *	rawrecord -i frames.raw -W 1920 -H 1080 -f pRAA -r 60 -t 10 -o out.raw
+ *
+ * With a file source, a frame whose slot is still being written when it is
+ * due counts as dropped, like a sensor overrunning its buffer queue.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "camss.h"
+#include "media.h"
+#include "rawrec.h"
+#include "streammon.h"
+#include "v4l2.h"
+
+#define REC_MAX_BUFFERS		V4L2_DEV_MAX_BUFFERS
+#define REC_POLL_MS		1000
+
+struct recorder {
+	struct rawrec *rec;
+	struct streammon mon;
+	int stage_submit;
+	uint64_t max_frames;
+	uint64_t end_ns;
+
+	uint64_t frames;
+	uint64_t dropped;
+	uint32_t last_sequence;
+
+	/* V4L2 source */
+	struct v4l2_dev dev;
+
+	/* File source */
+	int src_fd;
+	uint64_t src_size;
+	uint64_t src_offset;
+	size_t frame_size;
+	uint32_t fps;
+	void *bufs[REC_MAX_BUFFERS];
+	int busy[REC_MAX_BUFFERS];
+	unsigned int num_bufs;
+};
+
+static volatile sig_atomic_t rec_stop;
+
+static void rec_signal(int sig)
+{
+	(void)sig;
+	rec_stop = 1;
+}
+
+static uint32_t parse_fourcc(const char *s)
+{
+	char c[4] = { ' ', ' ', ' ', ' ' };
+
+	memcpy(c, s, strnlen(s, 4));
+
+	return v4l2_fourcc(c[0], c[1], c[2], c[3]);
+}
+
+/* Line length of the formats the sensors produce, for the file source. */
+static uint32_t file_bytesperline(uint32_t fourcc, uint32_t width)
+{
+	switch (fourcc) {
+	case V4L2_PIX_FMT_GREY:
+		return width;
+	case V4L2_PIX_FMT_SRGGB10P:
+	case V4L2_PIX_FMT_SBGGR10P:
+	case V4L2_PIX_FMT_SGBRG10P:
+	case V4L2_PIX_FMT_SGRBG10P:
+		return width * 5 / 4;
+	default:
+		return width * 2;
+	}
+}
+
+static int rec_done(struct recorder *r)
+{
+	return rec_stop || (r->max_frames && r->frames >= r->max_frames) ||
+	       (r->end_ns && streammon_now() >= r->end_ns);
+}
+
+static void rec_account(struct recorder *r, uint32_t sequence)
+{
+	if (r->frames && sequence != r->last_sequence + 1)
+		r->dropped += sequence - r->last_sequence - 1;
+	r->last_sequence = sequence;
+	r->frames++;
+}
+
+/* Completed writes give their buffers back to the source. */
+static int rec_reap(struct recorder *r, int wait)
+{
+	uint64_t cookies[REC_MAX_BUFFERS];
+	int i, n;
+
+	n = rawrec_reap(r->rec, cookies, REC_MAX_BUFFERS, wait);
+	if (n < 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (r->src_fd >= 0)
+			r->busy[cookies[i]] = 0;
+		else if (v4l2_dev_queue(&r->dev, cookies[i]) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int rec_v4l2(struct recorder *r)
+{
+	struct pollfd pfd[2];
+	struct v4l2_dev_frame frame;
+	uint64_t start;
+
+	pfd[0].fd = r->dev.fd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = rawrec_fd(r->rec);
+	pfd[1].events = POLLIN;
+
+	if (v4l2_dev_queue_all(&r->dev) < 0 || v4l2_dev_stream_on(&r->dev) < 0)
+		return -1;
+
+	while (!rec_done(r)) {
+		if (poll(pfd, pfd[1].fd >= 0 ? 2 : 1, REC_POLL_MS) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		while (!rec_done(r) && v4l2_dev_dequeue(&r->dev, &frame) == 0) {
+			start = streammon_now();
+			streammon_frame(&r->mon, frame.sequence,
+					frame.timestamp_ns, start,
+					r->dev.num_queued);
+			rec_account(r, frame.sequence);
+
+			if (rawrec_write(r->rec, r->dev.bufs[frame.index].start,
+					 frame.bytesused, frame.sequence,
+					 frame.timestamp_ns, frame.index) < 0) {
+				fprintf(stderr, "rawrecord: %s\n",
+					strerror(errno));
+				return -1;
+			}
+			streammon_stage(&r->mon, r->stage_submit, start);
+		}
+
+		if (rec_reap(r, 0) < 0)
+			return -1;
+		streammon_tick(&r->mon, streammon_now());
+	}
+
+	return 0;
+}
+
+/* Read the next frame of the source file, wrapping around at its end. */
+static int rec_file_read(struct recorder *r, void *buf)
+{
+	ssize_t ret;
+
+	if (r->src_offset + r->frame_size > r->src_size)
+		r->src_offset = 0;
+
+	ret = pread(r->src_fd, buf, r->frame_size, r->src_offset);
+	if (ret != (ssize_t)r->frame_size) {
+		fprintf(stderr, "rawrecord: short read from the source\n");
+		return -1;
+	}
+	r->src_offset += r->frame_size;
+
+	return 0;
+}
+
+static int rec_file(struct recorder *r)
+{
+	uint64_t period = 1000000000ull / r->fps, due, start;
+	struct timespec ts;
+	uint32_t sequence = 0;
+	unsigned int i;
+
+	due = streammon_now() + period;
+
+	while (!rec_done(r)) {
+		ts.tv_sec = due / 1000000000ull;
+		ts.tv_nsec = due % 1000000000ull;
+		if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+				    NULL) == EINTR)
+			continue;
+
+		if (rec_reap(r, 0) < 0)
+			return -1;
+
+		for (i = 0; i < r->num_bufs && r->busy[i]; i++)
+			;
+
+		if (i < r->num_bufs) {
+			if (rec_file_read(r, r->bufs[i]) < 0)
+				return -1;
+
+			start = streammon_now();
+			streammon_frame(&r->mon, sequence, due, start,
+					STREAMMON_QUEUED_NONE);
+			rec_account(r, sequence);
+
+			if (rawrec_write(r->rec, r->bufs[i], r->frame_size,
+					 sequence, due, i) < 0) {
+				fprintf(stderr, "rawrecord: %s\n",
+					strerror(errno));
+				return -1;
+			}
+			r->busy[i] = 1;
+			streammon_stage(&r->mon, r->stage_submit, start);
+		}
+
+		sequence++;
+		due += period;
+		streammon_tick(&r->mon, streammon_now());
+	}
+
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] -o FILE\n"
+		"  -m, --media DEV      media device, enables CAMSS setup\n"
+		"  -s, --sensor NAME    sensor: ov5645, ov7251, ov9281,\n"
+		"                       imx185\n"
+		"  -p, --port N         CSI port (0 = J3, 1 = J4)\n"
+		"  -d, --device DEV     video node (default: found via media)\n"
+		"  -i, --input FILE     replay raw frames from FILE instead\n"
+		"  -r, --rate FPS       frame rate of --input (default 30)\n"
+		"  -W, --width N        frame width\n"
+		"  -H, --height N       frame height\n"
+		"  -f, --fourcc FOURCC  pixel format (default: from sensor)\n"
+		"  -n, --buffers N      capture buffers (default 8)\n"
+		"  -c, --count N        stop after N frames\n"
+		"  -t, --time S         stop after S seconds\n"
+		"  -P, --prealloc MB    preallocate (default: from -c or -t)\n"
+		"  -M, --monitor FILE   append streaming statistics as JSON\n"
+		"  -o, --output FILE    recording, index in FILE.idx\n",
+		argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "media", required_argument, NULL, 'm' },
+		{ "sensor", required_argument, NULL, 's' },
+		{ "port", required_argument, NULL, 'p' },
+		{ "device", required_argument, NULL, 'd' },
+		{ "input", required_argument, NULL, 'i' },
+		{ "rate", required_argument, NULL, 'r' },
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "fourcc", required_argument, NULL, 'f' },
+		{ "buffers", required_argument, NULL, 'n' },
+		{ "count", required_argument, NULL, 'c' },
+		{ "time", required_argument, NULL, 't' },
+		{ "prealloc", required_argument, NULL, 'P' },
+		{ "monitor", required_argument, NULL, 'M' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ }
+	};
+	const struct camss_sensor *sensor = NULL;
+	const char *media = NULL, *device = NULL, *input = NULL;
+	const char *output = NULL, *monitor = NULL;
+	uint32_t width = 1920, height = 1080, fourcc = 0;
+	unsigned int port = 0, nbufs = 8, seconds = 0, i;
+	uint64_t prealloc = 0, frame_bytes, wall, bytes;
+	struct rawrec_format fmt;
+	FILE *monitor_out = NULL;
+	struct recorder r;
+	struct rusage ru;
+	char video[64];
+	double cpu, secs;
+	int opt, ret;
+
+	memset(&r, 0, sizeof(r));
+	r.src_fd = -1;
+	r.fps = 30;
+
+	while ((opt = getopt_long(argc, argv, "m:s:p:d:i:r:W:H:f:n:c:t:P:M:o:h",
+				  opts, NULL)) != -1) {
+		switch (opt) {
+		case 'm':
+			media = optarg;
+			break;
+		case 's':
+			sensor = camss_sensor_lookup(optarg);
+			if (!sensor) {
+				fprintf(stderr, "unknown sensor %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'r':
+			r.fps = atoi(optarg);
+			break;
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 'f':
+			fourcc = parse_fourcc(optarg);
+			break;
+		case 'n':
+			nbufs = atoi(optarg);
+			break;
+		case 'c':
+			r.max_frames = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'P':
+			prealloc = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 'M':
+			monitor = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!output || !r.fps || nbufs < 2 || nbufs > REC_MAX_BUFFERS ||
+	    (input && (media || device))) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (!fourcc)
+		fourcc = sensor ? sensor->fourcc : V4L2_PIX_FMT_UYVY;
+
+	if (monitor) {
+		monitor_out = strcmp(monitor, "-") ? fopen(monitor, "a") :
+						     stdout;
+		if (!monitor_out) {
+			perror(monitor);
+			return 1;
+		}
+	}
+	streammon_init(&r.mon, "rawrecord", monitor_out, 1000);
+	r.stage_submit = streammon_add_stage(&r.mon, "submit");
+
+	if (media) {
+		int mfd;
+
+		if (!sensor) {
+			fprintf(stderr, "--media needs --sensor\n");
+			return 1;
+		}
+		mfd = media_open(media);
+		if (mfd < 0)
+			return 1;
+		ret = camss_pipeline_setup(mfd, sensor, port, width, height,
+					   video, sizeof(video));
+		close(mfd);
+		if (ret < 0)
+			return 1;
+		if (!device)
+			device = video;
+	}
+
+	if (input) {
+		r.src_fd = open(input, O_RDONLY | O_CLOEXEC);
+		if (r.src_fd < 0) {
+			perror(input);
+			return 1;
+		}
+		fmt.fourcc = fourcc;
+		fmt.width = width;
+		fmt.height = height;
+		fmt.bytesperline = file_bytesperline(fourcc, width);
+		r.frame_size = (size_t)fmt.bytesperline * height;
+		r.src_size = lseek(r.src_fd, 0, SEEK_END);
+		if (r.src_size < r.frame_size) {
+			fprintf(stderr, "%s holds no complete %ux%u frame\n",
+				input, width, height);
+			return 1;
+		}
+
+		/* Aligned for O_DIRECT, like MMAP buffers. */
+		r.num_bufs = nbufs;
+		for (i = 0; i < nbufs; i++) {
+			if (posix_memalign(&r.bufs[i], RAWREC_ALIGN,
+					   RAWREC_ALIGN_UP(r.frame_size))) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			memset(r.bufs[i], 0, RAWREC_ALIGN_UP(r.frame_size));
+		}
+		frame_bytes = RAWREC_ALIGN_UP(r.frame_size);
+	} else {
+		if (!device) {
+			fprintf(stderr, "no source, use --device, --media or "
+				"--input\n");
+			return 1;
+		}
+		if (v4l2_dev_open(&r.dev, device) < 0)
+			return 1;
+		if (v4l2_dev_set_format(&r.dev, width, height, fourcc) < 0 ||
+		    v4l2_dev_alloc_buffers(&r.dev, nbufs, 1, 0) < 0)
+			goto err_dev;
+
+		/* O_DIRECT writes whole blocks, past bytesused if need be. */
+		for (i = 0; i < r.dev.num_buffers; i++) {
+			if (r.dev.bufs[i].length <
+			    RAWREC_ALIGN_UP(r.dev.sizeimage)) {
+				fprintf(stderr, "buffers are not padded to %u "
+					"bytes\n", RAWREC_ALIGN);
+				goto err_dev;
+			}
+		}
+
+		fmt.fourcc = r.dev.fourcc;
+		fmt.width = r.dev.width;
+		fmt.height = r.dev.height;
+		fmt.bytesperline = r.dev.bytesperline;
+		frame_bytes = RAWREC_ALIGN_UP(r.dev.sizeimage);
+		r.fps = sensor && camss_sensor_mode(sensor, width, height) ?
+			camss_sensor_mode(sensor, width, height)->fps : 0;
+	}
+
+	if (!prealloc && r.max_frames)
+		prealloc = r.max_frames * frame_bytes;
+	else if (!prealloc && seconds && r.fps)
+		prealloc = (uint64_t)seconds * r.fps * frame_bytes;
+
+	r.rec = rawrec_open(output, &fmt, prealloc,
+			    input ? nbufs : r.dev.num_buffers);
+	if (!r.rec)
+		goto err_dev;
+
+	signal(SIGINT, rec_signal);
+	signal(SIGTERM, rec_signal);
+
+	fprintf(stderr, "rawrecord: %ux%u %.4s, %zu bytes per frame, %s "
+		"writes, %llu MB preallocated\n", fmt.width, fmt.height,
+		(const char *)&fmt.fourcc, (size_t)frame_bytes,
+		rawrec_async(r.rec) ? "io_uring" : "synchronous",
+		(unsigned long long)(prealloc >> 20));
+
+	wall = streammon_now();
+	if (seconds)
+		r.end_ns = wall + seconds * 1000000000ull;
+
+	ret = input ? rec_file(&r) : rec_v4l2(&r);
+
+	if (!input)
+		v4l2_dev_stream_off(&r.dev);
+	bytes = rawrec_bytes(r.rec);
+	if (rawrec_close(r.rec) < 0)
+		ret = -1;
+
+	secs = (streammon_now() - wall) / 1e9;
+	getrusage(RUSAGE_SELF, &ru);
+	cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+	      (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+
+	fprintf(stderr, "rawrecord: %llu frames, %llu dropped, %.1f MB in "
+		"%.1f s (%.1f MB/s), %.1f%% of a core\n",
+		(unsigned long long)r.frames, (unsigned long long)r.dropped,
+		bytes / 1e6, secs, secs > 0 ? bytes / 1e6 / secs : 0,
+		secs > 0 ? 100 * cpu / secs : 0);
+
+	if (!input)
+		v4l2_dev_close(&r.dev);
+	for (i = 0; i < r.num_bufs; i++)
+		free(r.bufs[i]);
+	if (r.src_fd >= 0)
+		close(r.src_fd);
+	if (monitor_out && monitor_out != stdout)
+		fclose(monitor_out);
+
+	return ret < 0 ? 1 : 0;
+
+err_dev:
+	if (!input)
+		v4l2_dev_close(&r.dev);
+	return 1;
+}
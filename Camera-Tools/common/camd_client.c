@@ -0,0 +1,210 @@
+/*
+ * Consumer side of the camd protocol.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/dma-buf.h>
+
+#include "camd_client.h"
+
+static int camd_client_recv_hello(struct camd_client *client)
+{
+	char cbuf[CMSG_SPACE(sizeof(int) * CAMD_MAX_BUFFERS)];
+	struct iovec iov = {
+		.iov_base = &client->hello,
+		.iov_len = sizeof(client->hello),
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr *cmsg;
+	unsigned int nfds = 0;
+	ssize_t len;
+
+	len = recvmsg(client->fd, &msg, MSG_CMSG_CLOEXEC);
+	if (len != sizeof(client->hello) ||
+	    client->hello.type != CAMD_MSG_HELLO) {
+		fprintf(stderr, "camd: bad hello\n");
+		return -1;
+	}
+
+	if (client->hello.version != CAMD_PROTO_VERSION) {
+		fprintf(stderr, "camd: protocol version %u, expected %u\n",
+			client->hello.version, CAMD_PROTO_VERSION);
+		return -1;
+	}
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		if (nfds > CAMD_MAX_BUFFERS)
+			nfds = CAMD_MAX_BUFFERS;
+		memcpy(client->dmabuf, CMSG_DATA(cmsg), nfds * sizeof(int));
+	}
+
+	if (nfds != client->hello.num_buffers) {
+		fprintf(stderr, "camd: got %u buffer fds, expected %u\n",
+			nfds, client->hello.num_buffers);
+		return -1;
+	}
+
+	return 0;
+}
+
+int camd_client_connect(struct camd_client *client, const char *path)
+{
+	struct sockaddr_un addr;
+	unsigned int i;
+
+	memset(client, 0, sizeof(*client));
+	for (i = 0; i < CAMD_MAX_BUFFERS; i++)
+		client->dmabuf[i] = -1;
+
+	client->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (client->fd < 0)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+	if (connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "%s: connect failed: %s\n", path,
+			strerror(errno));
+		goto err;
+	}
+
+	if (camd_client_recv_hello(client) < 0)
+		goto err;
+
+	return 0;
+
+err:
+	camd_client_close(client);
+	return -1;
+}
+
+void camd_client_close(struct camd_client *client)
+{
+	unsigned int i;
+
+	for (i = 0; i < CAMD_MAX_BUFFERS; i++) {
+		if (client->map[i])
+			munmap(client->map[i], client->hello.buf_length[i]);
+		if (client->dmabuf[i] >= 0)
+			close(client->dmabuf[i]);
+		client->map[i] = NULL;
+		client->dmabuf[i] = -1;
+	}
+
+	if (client->fd >= 0)
+		close(client->fd);
+	client->fd = -1;
+}
+
+int camd_client_map(struct camd_client *client)
+{
+	unsigned int i;
+
+	for (i = 0; i < client->hello.num_buffers; i++) {
+		void *p;
+
+		p = mmap(NULL, client->hello.buf_length[i], PROT_READ,
+			 MAP_SHARED, client->dmabuf[i], 0);
+		if (p == MAP_FAILED) {
+			fprintf(stderr, "camd: mmap of buffer %u failed: %s\n",
+				i, strerror(errno));
+			return -1;
+		}
+		client->map[i] = p;
+	}
+
+	return 0;
+}
+
+int camd_client_next(struct camd_client *client, struct camd_msg_frame *frame)
+{
+	ssize_t len;
+
+	do {
+		len = recv(client->fd, frame, sizeof(*frame), 0);
+	} while (len < 0 && errno == EINTR);
+
+	if (len == 0)
+		return -1;
+	if (len != sizeof(*frame) ||
+	    (frame->type != CAMD_MSG_FRAME && frame->type != CAMD_MSG_STILL) ||
+	    (frame->index >= client->hello.num_buffers &&
+	     !(frame->type == CAMD_MSG_STILL &&
+	       frame->index == CAMD_INDEX_NONE)) ||
+	    (frame->right_index >= client->hello.num_buffers &&
+	     frame->right_index != CAMD_INDEX_NONE)) {
+		fprintf(stderr, "camd: unexpected message\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int camd_client_release(struct camd_client *client, unsigned int index)
+{
+	struct camd_msg_release msg = {
+		.type = CAMD_MSG_RELEASE,
+		.index = index,
+	};
+
+	if (send(client->fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg))
+		return -1;
+
+	return 0;
+}
+
+int camd_client_shutter(struct camd_client *client, uint64_t trigger_ns,
+			uint32_t cookie)
+{
+	struct camd_msg_shutter msg = {
+		.type = CAMD_MSG_SHUTTER,
+		.cookie = cookie,
+		.trigger_ns = trigger_ns,
+	};
+
+	if (send(client->fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg))
+		return -1;
+
+	return 0;
+}
+
+static void camd_client_sync(struct camd_client *client, unsigned int index,
+			     uint64_t flags)
+{
+	struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_READ };
+
+	ioctl(client->dmabuf[index], DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+void camd_client_begin_access(struct camd_client *client, unsigned int index)
+{
+	camd_client_sync(client, index, DMA_BUF_SYNC_START);
+}
+
+void camd_client_end_access(struct camd_client *client, unsigned int index)
+{
+	camd_client_sync(client, index, DMA_BUF_SYNC_END);
+}
@@ -0,0 +1,52 @@
+/*
+ * Consumer side of the camd protocol.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_CAMD_CLIENT_H
+#define CAMERA_TOOLS_CAMD_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camd_proto.h"
+
+struct camd_client {
+	int fd;
+	struct camd_msg_hello hello;
+	int dmabuf[CAMD_MAX_BUFFERS];
+	void *map[CAMD_MAX_BUFFERS];	/* read-only CPU mappings */
+};
+
+/* Connect and receive the stream format and buffer fds. */
+int camd_client_connect(struct camd_client *client, const char *path);
+void camd_client_close(struct camd_client *client);
+
+/* Map every buffer read-only, for consumers that touch pixels on the CPU. */
+int camd_client_map(struct camd_client *client);
+
+/*
+ * Blocks until the next frame. Returns 0, or -1 on error / hangup.
+ * frame->type is CAMD_MSG_STILL for the reply to camd_client_shutter(),
+ * whose index is CAMD_INDEX_NONE (and needs no release) if it failed.
+ */
+int camd_client_next(struct camd_client *client, struct camd_msg_frame *frame);
+/* Releasing a stereo pair's index releases its right buffer too. */
+int camd_client_release(struct camd_client *client, unsigned int index);
+
+/*
+ * Ask for the ZSL frame closest to @trigger_ns (CLOCK_MONOTONIC, 0 for
+ * now). The answer arrives through camd_client_next() with @cookie.
+ */
+int camd_client_shutter(struct camd_client *client, uint64_t trigger_ns,
+			uint32_t cookie);
+
+/* Bracket CPU reads of a mapped buffer (DMA_BUF_IOCTL_SYNC). */
+void camd_client_begin_access(struct camd_client *client, unsigned int index);
+void camd_client_end_access(struct camd_client *client, unsigned int index);
+
+#endif /* CAMERA_TOOLS_CAMD_CLIENT_H */
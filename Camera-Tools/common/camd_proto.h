@@ -0,0 +1,120 @@
+/*
+ * Wire protocol between camd and its consumers.
+ *
+ * camd listens on a SOCK_SEQPACKET Unix socket. On connect it sends one
+ * CAMD_MSG_HELLO carrying the stream format and, as SCM_RIGHTS ancillary
+ * data, one DMABUF fd per capture buffer in index order. Every captured
+ * frame is then announced with CAMD_MSG_FRAME; the consumer reads the
+ * pixels straight from the DMABUF it already holds and hands the buffer
+ * back with CAMD_MSG_RELEASE. A buffer is requeued to the driver once all
+ * consumers have released it, so no pixel data ever crosses the socket.
+ *
+ * When camd runs with a ZSL (zero shutter lag) ring it also keeps its own
+ * reference on the most recent hello.zsl_depth frames. A consumer sends
+ * CAMD_MSG_SHUTTER with the time the shutter was pressed and gets back a
+ * CAMD_MSG_STILL naming the ring buffer captured closest to that time, or
+ * CAMD_INDEX_NONE if there is none to give. A trigger later than the newest
+ * frame is answered once a frame at or after it arrives. The still is held
+ * and released like any other frame; it is the same DMABUF, not a copy.
+ *
+ * Each frame carries the exposure, gain and white balance the sensor used
+ * for it, when the sensor driver records them (CAMSS_CID_FRAME_META, see
+ * common/camss.h). camd estimates the start of frame from the buffer
+ * timestamp (taken at the end of the frame) and the frame interval, and
+ * picks the newest driver record older than that. The estimate is early
+ * by up to the vertical blanking; Sensor-Core/framemeta.h has the bound.
+ *
+ * With a second camera (camd -P/-D, the OV5645 StereoCamera board) camd
+ * pairs the two streams by timestamp (common/stereopair.h) and announces
+ * pairs only, each with the skew between its two timestamps. In
+ * CAMD_STEREO_PAIR mode the hello carries the left camera's buffers and
+ * then the right one's from hello.right_base on; a frame names one of
+ * each and releasing its index releases both. In CAMD_STEREO_SBS mode the
+ * two nodes capture into the left and right halves of the same buffers,
+ * the hello describes the composed double-width frame and a frame is one
+ * buffer as in mono mode. Those buffers are memfds, not DMABUFs: they map
+ * like any other but cannot be imported by a device.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_CAMD_PROTO_H
+#define CAMERA_TOOLS_CAMD_PROTO_H
+
+#include <stdint.h>
+
+#define CAMD_PROTO_VERSION	4
+#define CAMD_MAX_BUFFERS	32
+#define CAMD_MAX_SHUTTERS	4	/* outstanding per consumer */
+#define CAMD_INDEX_NONE		0xffffffffu
+#define CAMD_DEFAULT_SOCKET	"/run/camd.sock"
+
+enum camd_msg_type {
+	CAMD_MSG_HELLO = 1,	/* server -> client, fds attached */
+	CAMD_MSG_FRAME,		/* server -> client */
+	CAMD_MSG_RELEASE,	/* client -> server */
+	CAMD_MSG_SHUTTER,	/* client -> server */
+	CAMD_MSG_STILL,		/* server -> client, a struct camd_msg_frame */
+};
+
+enum camd_stereo {
+	CAMD_STEREO_NONE,
+	CAMD_STEREO_PAIR,	/* left and right buffers, paired per frame */
+	CAMD_STEREO_SBS,	/* side-by-side in one buffer */
+};
+
+struct camd_msg_hello {
+	uint32_t type;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;
+	uint32_t bytesperline;
+	uint32_t sizeimage;
+	uint32_t num_buffers;
+	uint32_t zsl_depth;	/* 0: no ZSL ring, shutter requests fail */
+	uint32_t stereo;	/* enum camd_stereo */
+	uint32_t right_base;	/* first right buffer, or num_buffers */
+	uint32_t buf_length[CAMD_MAX_BUFFERS];
+};
+
+struct camd_frame_meta {
+	uint64_t sof_ns;	/* estimated start of frame, CLOCK_MONOTONIC */
+	uint32_t valid;		/* 0: no metadata, the fields below are 0 */
+	uint32_t exposure;	/* in the units of the sensor's controls */
+	uint32_t gain;
+	uint32_t awb_gain[3];	/* R, G, B, 0x400 = 1.0; 0 if unknown */
+};
+
+struct camd_msg_frame {
+	uint32_t type;
+	uint32_t index;
+	uint32_t sequence;	/* V4L2 buffer sequence number */
+	uint32_t bytesused;
+	uint64_t timestamp_ns;	/* CLOCK_MONOTONIC capture timestamp */
+	uint32_t flags;		/* V4L2_BUF_FLAG_* */
+	uint32_t cookie;	/* of the shutter request, for CAMD_MSG_STILL */
+	struct camd_frame_meta meta;
+
+	/* Stereo: the right camera's frame, from the same buffer in SBS. */
+	uint32_t right_index;	/* CAMD_STEREO_PAIR, else CAMD_INDEX_NONE */
+	uint32_t right_sequence;
+	uint64_t right_timestamp_ns;
+	int64_t skew_ns;	/* right - left timestamp */
+};
+
+struct camd_msg_release {
+	uint32_t type;
+	uint32_t index;
+};
+
+struct camd_msg_shutter {
+	uint32_t type;
+	uint32_t cookie;	/* echoed in the CAMD_MSG_STILL reply */
+	uint64_t trigger_ns;	/* CLOCK_MONOTONIC, 0 for "now" */
+};
+
+#endif /* CAMERA_TOOLS_CAMD_PROTO_H */
@@ -0,0 +1,155 @@
+/*
+ * Sensor presets and CAMSS pipeline setup for the Dragonboard 410c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <linux/media-bus-format.h>
+#include <linux/videodev2.h>
+
+#include "camss.h"
+#include "media.h"
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+/* OV5640 and OV5645; the OV5640 has no 1280x960 mode. */
+static const struct camss_mode ov5645_modes[] = {
+	{ 640, 480, 90 },
+	{ 1280, 720, 60 },
+	{ 1280, 960, 30 },
+	{ 1920, 1080, 30 },
+	{ 2592, 1944, 15 },
+};
+
+static const struct camss_mode ov7251_modes[] = {
+	{ 640, 480, 100 },
+};
+
+static const struct camss_mode ov9281_modes[] = {
+	{ 640, 400, 211 },
+	{ 1280, 800, 120 },
+};
+
+static const struct camss_mode imx185_modes[] = {
+	{ 1920, 1080, 60 },
+};
+
+static const struct camss_sensor camss_sensors[] = {
+	{
+		.name = "ov5645",
+		.code = MEDIA_BUS_FMT_UYVY8_2X8,
+		.fourcc = V4L2_PIX_FMT_UYVY,
+		.modes = ov5645_modes,
+		.num_modes = ARRAY_SIZE(ov5645_modes),
+	},
+	{
+		.name = "ov7251",
+		.code = MEDIA_BUS_FMT_SRGGB10_1X10,
+		.fourcc = V4L2_PIX_FMT_SRGGB10,
+		.modes = ov7251_modes,
+		.num_modes = ARRAY_SIZE(ov7251_modes),
+	},
+	{
+		.name = "ov9281",
+		.code = MEDIA_BUS_FMT_Y10_1X10,
+		.fourcc = V4L2_PIX_FMT_Y10,
+		.modes = ov9281_modes,
+		.num_modes = ARRAY_SIZE(ov9281_modes),
+	},
+	{
+		.name = "imx185",
+		.code = MEDIA_BUS_FMT_SRGGB10_1X10,
+		.fourcc = V4L2_PIX_FMT_SRGGB10,
+		.modes = imx185_modes,
+		.num_modes = ARRAY_SIZE(imx185_modes),
+	},
+};
+
+const struct camss_sensor *camss_sensor_lookup(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(camss_sensors); i++)
+		if (!strcmp(camss_sensors[i].name, name))
+			return &camss_sensors[i];
+
+	return NULL;
+}
+
+const struct camss_mode *camss_sensor_mode(const struct camss_sensor *sensor,
+					   uint32_t width, uint32_t height)
+{
+	unsigned int i;
+
+	for (i = 0; i < sensor->num_modes; i++)
+		if (sensor->modes[i].width == width &&
+		    sensor->modes[i].height == height)
+			return &sensor->modes[i];
+
+	return NULL;
+}
+
+int camss_sensor_entity(int media_fd, const struct camss_sensor *sensor,
+			unsigned int port, struct media_entity_desc *entity)
+{
+	struct media_entity_desc csiphy;
+	char name[32];
+
+	snprintf(name, sizeof(name), "msm_csiphy%u", port);
+
+	if (media_find_entity(media_fd, name, &csiphy) == 0 &&
+	    media_find_source(media_fd, &csiphy, 0, entity) == 0)
+		return 0;
+
+	return media_find_entity(media_fd, sensor->name, entity);
+}
+
+int camss_pipeline_setup(int media_fd, const struct camss_sensor *sensor,
+			 unsigned int port, uint32_t width, uint32_t height,
+			 char *video, size_t len)
+{
+	struct media_entity_desc rdi_entity, sensor_entity;
+	char csiphy[32], csid[32], ispif[32], rdi[32];
+	const char *chain[5];
+	unsigned int i;
+
+	snprintf(csiphy, sizeof(csiphy), "msm_csiphy%u", port);
+	snprintf(csid, sizeof(csid), "msm_csid%u", port);
+	snprintf(ispif, sizeof(ispif), "msm_ispif%u", port);
+	snprintf(rdi, sizeof(rdi), "msm_vfe0_rdi%u", port);
+
+	/* The sensor -> csiphy link comes from DT and is immutable. */
+	if (media_setup_link(media_fd, csiphy, 1, csid, 0, 1) < 0 ||
+	    media_setup_link(media_fd, csid, 1, ispif, 0, 1) < 0 ||
+	    media_setup_link(media_fd, ispif, 1, rdi, 0, 1) < 0)
+		return -1;
+
+	if (camss_sensor_entity(media_fd, sensor, port, &sensor_entity) < 0)
+		return -1;
+
+	chain[0] = sensor_entity.name;
+	chain[1] = csiphy;
+	chain[2] = csid;
+	chain[3] = ispif;
+	chain[4] = rdi;
+
+	for (i = 0; i < ARRAY_SIZE(chain); i++)
+		if (media_set_pad_format(media_fd, chain[i], 0, sensor->code,
+					 width, height) < 0)
+			return -1;
+
+	if (media_find_entity(media_fd, rdi, &rdi_entity) < 0)
+		return -1;
+
+	if (media_find_video_sink(media_fd, &rdi_entity, 1, video, len) < 0) {
+		fprintf(stderr, "no video node behind %s\n", rdi);
+		return -1;
+	}
+
+	return 0;
+}
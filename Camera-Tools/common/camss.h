@@ -0,0 +1,88 @@
+/*
+ * Sensor presets and CAMSS (csiphy -> csid -> ispif -> vfe_rdi) pipeline
+ * setup for the Dragonboard 410c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_CAMSS_H
+#define CAMERA_TOOLS_CAMSS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/media.h>
+#include <linux/videodev2.h>
+
+/*
+ * Private button control of the sensor drivers in this repository
+ * (OV5640-Drivers/ov5645.c): hard-reset the sensor and replay its init
+ * registers and controls. Sensors without it answer -EINVAL.
+ */
+#define CAMSS_CID_SENSOR_RECOVER	(V4L2_CID_USER_BASE | 0x1f00)
+
+/*
+ * Read-only U32 array control of the same drivers with their recent
+ * exposure / gain / white balance records, oldest first (layout in
+ * Sensor-Core/framemeta.h). A record applies to the frames that start
+ * after its timestamp.
+ */
+#define CAMSS_CID_FRAME_META		(V4L2_CID_USER_BASE | 0x1f01)
+#define CAMSS_FRAME_META_DEPTH		16
+#define CAMSS_FRAME_META_WORDS		8
+
+/*
+ * Integer control of the OV5645/OV5640 and IMX185 drivers: frames from a
+ * control write to the first frame showing it, in the current mode.
+ * Writable, so a measured value (bench_stream -L) can be stored for the
+ * mode.
+ */
+#define CAMSS_CID_CTRL_DELAY		(V4L2_CID_USER_BASE | 0x1f02)
+
+struct camss_frame_meta_rec {
+	uint32_t ts_lo;
+	uint32_t ts_hi;
+	uint32_t seq;		/* 0: unused */
+	uint32_t exposure;
+	uint32_t gain;
+	uint32_t awb_gain[3];
+};
+
+struct camss_mode {
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+};
+
+struct camss_sensor {
+	const char *name;	/* driver name, prefix of the media entity */
+	uint32_t code;		/* MEDIA_BUS_FMT_* on every pad */
+	uint32_t fourcc;	/* V4L2_PIX_FMT_* on the video node */
+	const struct camss_mode *modes;
+	unsigned int num_modes;
+};
+
+const struct camss_sensor *camss_sensor_lookup(const char *name);
+const struct camss_mode *camss_sensor_mode(const struct camss_sensor *sensor,
+					   uint32_t width, uint32_t height);
+
+/*
+ * The sensor entity wired to CSI port @port, for boards carrying two of
+ * the same sensor (OV5645/StereoCamera). Falls back to the first entity
+ * named after the sensor when no link leads to msm_csiphyN.
+ */
+int camss_sensor_entity(int media_fd, const struct camss_sensor *sensor,
+			unsigned int port, struct media_entity_desc *entity);
+
+/*
+ * Enable the csiphyN -> csidN -> ispifN -> msm_vfe0_rdiN links for CSI
+ * port @port, propagate the sensor format along them and return the video
+ * node behind the RDI in @video.
+ */
+int camss_pipeline_setup(int media_fd, const struct camss_sensor *sensor,
+			 unsigned int port, uint32_t width, uint32_t height,
+			 char *video, size_t len);
+
+#endif /* CAMERA_TOOLS_CAMSS_H */
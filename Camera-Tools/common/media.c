@@ -0,0 +1,251 @@
+/*
+ * Media controller helpers: entity lookup, links and subdev formats.
+ *
+ * These replace the media-ctl command lines in the Pre-built readmes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/v4l2-subdev.h>
+
+#include "media.h"
+
+int media_open(const char *path)
+{
+	int fd;
+
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		fprintf(stderr, "%s: open failed: %s\n", path, strerror(errno));
+
+	return fd;
+}
+
+static int media_name_matches(const char *entity, const char *name)
+{
+	size_t len = strlen(name);
+
+	if (!strcmp(entity, name))
+		return 1;
+
+	/* Sensors are named "<driver> <bus>-<addr>". */
+	return !strchr(name, ' ') && !strncmp(entity, name, len) &&
+	       entity[len] == ' ';
+}
+
+int media_find_entity(int fd, const char *name,
+		      struct media_entity_desc *entity)
+{
+	struct media_entity_desc desc;
+
+	memset(&desc, 0, sizeof(desc));
+	desc.id = MEDIA_ENT_ID_FLAG_NEXT;
+
+	while (ioctl(fd, MEDIA_IOC_ENUM_ENTITIES, &desc) == 0) {
+		if (media_name_matches(desc.name, name)) {
+			*entity = desc;
+			return 0;
+		}
+		desc.id |= MEDIA_ENT_ID_FLAG_NEXT;
+	}
+
+	fprintf(stderr, "media entity \"%s\" not found\n", name);
+	errno = ENOENT;
+
+	return -1;
+}
+
+int media_setup_link(int fd, const char *source, unsigned int source_pad,
+		     const char *sink, unsigned int sink_pad, int enable)
+{
+	struct media_entity_desc src, snk;
+	struct media_link_desc link;
+
+	if (media_find_entity(fd, source, &src) < 0 ||
+	    media_find_entity(fd, sink, &snk) < 0)
+		return -1;
+
+	memset(&link, 0, sizeof(link));
+	link.source.entity = src.id;
+	link.source.index = source_pad;
+	link.source.flags = MEDIA_PAD_FL_SOURCE;
+	link.sink.entity = snk.id;
+	link.sink.index = sink_pad;
+	link.sink.flags = MEDIA_PAD_FL_SINK;
+	link.flags = enable ? MEDIA_LNK_FL_ENABLED : 0;
+
+	if (ioctl(fd, MEDIA_IOC_SETUP_LINK, &link) < 0) {
+		fprintf(stderr, "link \"%s\":%u -> \"%s\":%u failed: %s\n",
+			src.name, source_pad, snk.name, sink_pad,
+			strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int media_entity_devnode(const struct media_entity_desc *entity,
+			 char *path, size_t len)
+{
+	char sysfs[64], line[128];
+	FILE *f;
+	int ret = -1;
+
+	snprintf(sysfs, sizeof(sysfs), "/sys/dev/char/%u:%u/uevent",
+		 entity->dev.major, entity->dev.minor);
+
+	f = fopen(sysfs, "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, "DEVNAME=", 8))
+			continue;
+		line[strcspn(line, "\n")] = '\0';
+		snprintf(path, len, "/dev/%s", line + 8);
+		ret = 0;
+		break;
+	}
+
+	fclose(f);
+
+	return ret;
+}
+
+int media_find_video_sink(int fd, const struct media_entity_desc *entity,
+			  unsigned int pad, char *path, size_t len)
+{
+	struct media_link_desc *links;
+	struct media_links_enum le;
+	unsigned int i;
+	int ret = -1;
+
+	links = calloc(entity->links ? entity->links : 1, sizeof(*links));
+	if (!links)
+		return -1;
+
+	memset(&le, 0, sizeof(le));
+	le.entity = entity->id;
+	le.links = links;
+
+	if (ioctl(fd, MEDIA_IOC_ENUM_LINKS, &le) < 0)
+		goto out;
+
+	for (i = 0; i < entity->links; i++) {
+		struct media_entity_desc sink;
+
+		if (links[i].source.entity != entity->id ||
+		    links[i].source.index != pad)
+			continue;
+
+		memset(&sink, 0, sizeof(sink));
+		sink.id = links[i].sink.entity;
+		if (ioctl(fd, MEDIA_IOC_ENUM_ENTITIES, &sink) < 0)
+			continue;
+
+		if (sink.type == MEDIA_ENT_T_DEVNODE_V4L) {
+			ret = media_entity_devnode(&sink, path, len);
+			break;
+		}
+	}
+
+out:
+	free(links);
+	return ret;
+}
+
+int media_find_source(int fd, const struct media_entity_desc *entity,
+		      unsigned int pad, struct media_entity_desc *source)
+{
+	struct media_link_desc *links;
+	struct media_links_enum le;
+	struct media_entity_desc desc;
+	unsigned int i;
+
+	memset(&desc, 0, sizeof(desc));
+	desc.id = MEDIA_ENT_ID_FLAG_NEXT;
+
+	while (ioctl(fd, MEDIA_IOC_ENUM_ENTITIES, &desc) == 0) {
+		links = calloc(desc.links ? desc.links : 1, sizeof(*links));
+		if (!links)
+			return -1;
+
+		memset(&le, 0, sizeof(le));
+		le.entity = desc.id;
+		le.links = links;
+
+		if (ioctl(fd, MEDIA_IOC_ENUM_LINKS, &le) == 0) {
+			for (i = 0; i < desc.links; i++) {
+				if (links[i].source.entity != desc.id ||
+				    links[i].sink.entity != entity->id ||
+				    links[i].sink.index != pad)
+					continue;
+				free(links);
+				*source = desc;
+				return 0;
+			}
+		}
+
+		free(links);
+		desc.id |= MEDIA_ENT_ID_FLAG_NEXT;
+	}
+
+	errno = ENOENT;
+
+	return -1;
+}
+
+int media_set_pad_format(int fd, const char *name, unsigned int pad,
+			 uint32_t code, uint32_t width, uint32_t height)
+{
+	struct media_entity_desc entity;
+	struct v4l2_subdev_format fmt;
+	char node[64];
+	int sfd, ret;
+
+	if (media_find_entity(fd, name, &entity) < 0)
+		return -1;
+
+	if (media_entity_devnode(&entity, node, sizeof(node)) < 0) {
+		fprintf(stderr, "no device node for \"%s\"\n", entity.name);
+		return -1;
+	}
+
+	sfd = open(node, O_RDWR | O_CLOEXEC);
+	if (sfd < 0) {
+		fprintf(stderr, "%s: open failed: %s\n", node, strerror(errno));
+		return -1;
+	}
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	fmt.pad = pad;
+	fmt.format.code = code;
+	fmt.format.width = width;
+	fmt.format.height = height;
+	fmt.format.field = V4L2_FIELD_NONE;
+
+	ret = ioctl(sfd, VIDIOC_SUBDEV_S_FMT, &fmt);
+	if (ret < 0)
+		fprintf(stderr, "\"%s\":%u set format failed: %s\n",
+			entity.name, pad, strerror(errno));
+	else if (fmt.format.width != width || fmt.format.height != height ||
+		 fmt.format.code != code)
+		fprintf(stderr, "\"%s\":%u adjusted format to 0x%04x/%ux%u\n",
+			entity.name, pad, fmt.format.code, fmt.format.width,
+			fmt.format.height);
+
+	close(sfd);
+
+	return ret;
+}
@@ -0,0 +1,47 @@
+/*
+ * Media controller helpers: entity lookup, links and subdev formats.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_MEDIA_H
+#define CAMERA_TOOLS_MEDIA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/media.h>
+
+int media_open(const char *path);
+
+/*
+ * Find an entity by name. A name without a space also matches entities
+ * whose name starts with "<name> ", so "ov5645" finds "ov5645 1-0076".
+ */
+int media_find_entity(int fd, const char *name,
+		      struct media_entity_desc *entity);
+
+int media_setup_link(int fd, const char *source, unsigned int source_pad,
+		     const char *sink, unsigned int sink_pad, int enable);
+
+/*
+ * Find the entity whose output feeds sink pad @pad of @entity. Links are
+ * only enumerated from their source, so this walks every entity.
+ */
+int media_find_source(int fd, const struct media_entity_desc *entity,
+		      unsigned int pad, struct media_entity_desc *source);
+
+/* Resolve the /dev node of an entity through sysfs. */
+int media_entity_devnode(const struct media_entity_desc *entity,
+			 char *path, size_t len);
+
+/* Find the video device node fed by @pad of @entity. */
+int media_find_video_sink(int fd, const struct media_entity_desc *entity,
+			  unsigned int pad, char *path, size_t len);
+
+int media_set_pad_format(int fd, const char *entity, unsigned int pad,
+			 uint32_t code, uint32_t width, uint32_t height);
+
+#endif /* CAMERA_TOOLS_MEDIA_H */
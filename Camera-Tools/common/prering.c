@@ -0,0 +1,378 @@
+/*
+ * Pre-event frame ring, see prering.h.
+ *
+ * Frames are numbered in commit order; frame n lives in slot n % frames,
+ * so the ring holds frames [head - count, head) and an event's backlog is
+ * the contiguous run [next, next + queued) of them. The producer and the
+ * writer thread only meet under @lock, for a few instructions per frame;
+ * pixel data is copied into a slot and written from it without the lock.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "prering.h"
+
+#define PRERING_MAX_DEPTH	32
+
+enum prering_state {
+	SLOT_HELD,		/* in memory only */
+	SLOT_QUEUED,		/* waiting for the writer */
+	SLOT_WRITING,		/* submitted to rawrec */
+};
+
+struct prering_slot {
+	enum prering_state state;
+	uint32_t sequence;
+	uint64_t timestamp_ns;
+};
+
+struct prering {
+	struct prering_config cfg;
+	size_t slot_size;
+	uint8_t *arena;
+	struct prering_slot *slots;
+
+	pthread_t writer;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+
+	/* Protected by @lock. */
+	uint64_t head;		/* number of the next frame committed */
+	unsigned int count;	/* frames held */
+	uint64_t next;		/* next frame to submit */
+	unsigned int queued;
+	unsigned int writing;
+	int active;		/* event in progress */
+	int ended;		/* a frame past its end was committed */
+	uint64_t end_ns;
+	int quit;
+	struct prering_stats stats;
+
+	/* Writer thread only. */
+	struct rawrec *rec;
+	char path[256];
+	uint64_t event_frames;
+};
+
+static struct prering_slot *prering_slot(struct prering *ring, uint64_t n)
+{
+	return &ring->slots[n % ring->cfg.frames];
+}
+
+static uint8_t *prering_data(struct prering *ring, uint64_t n)
+{
+	return ring->arena + n % ring->cfg.frames * ring->slot_size;
+}
+
+static int prering_has_work(const struct prering *ring)
+{
+	if (ring->quit)
+		return 1;
+	if (!ring->active)
+		return 0;
+
+	return !ring->rec || ring->writing || ring->ended ||
+	       (ring->queued && ring->writing < ring->cfg.depth);
+}
+
+/* Forget the event's backlog after a failure; called with @lock held. */
+static void prering_abort(struct prering *ring)
+{
+	for (; ring->queued; ring->queued--, ring->next++)
+		prering_slot(ring, ring->next)->state = SLOT_HELD;
+	ring->active = 0;
+}
+
+static int prering_open_event(struct prering *ring)
+{
+	snprintf(ring->path, sizeof(ring->path), "%s-%03u.raw",
+		 ring->cfg.prefix, ring->stats.events + ring->stats.failed);
+	ring->event_frames = 0;
+
+	/* Room for the backlog and the post-event frames at the same rate. */
+	ring->rec = rawrec_open(ring->path, &ring->cfg.fmt,
+				2ull * ring->cfg.frames * ring->slot_size,
+				ring->cfg.depth);
+
+	return ring->rec ? 0 : -1;
+}
+
+/* Close the event file; every frame submitted to it has completed. */
+static void prering_close_event(struct prering *ring, int failed)
+{
+	if (rawrec_close(ring->rec) < 0)
+		failed = 1;
+	ring->rec = NULL;
+
+	fprintf(stderr, "prering: %s: %llu frames%s\n", ring->path,
+		(unsigned long long)ring->event_frames,
+		failed ? ", write error" : "");
+
+	pthread_mutex_lock(&ring->lock);
+	if (failed)
+		ring->stats.failed++;
+	else
+		ring->stats.events++;
+	pthread_mutex_unlock(&ring->lock);
+}
+
+static void *prering_writer(void *arg)
+{
+	struct prering *ring = arg;
+	struct {
+		uint64_t n;
+		uint32_t sequence;
+		uint64_t timestamp_ns;
+	} batch[PRERING_MAX_DEPTH];
+	uint64_t cookies[PRERING_MAX_DEPTH];
+	struct prering_slot *slot;
+	unsigned int i, num;
+	int done, failed, ret;
+
+	pthread_mutex_lock(&ring->lock);
+	for (;;) {
+		while (!prering_has_work(ring))
+			pthread_cond_wait(&ring->wake, &ring->lock);
+		if (!ring->active)
+			break;
+
+		if (!ring->rec) {
+			pthread_mutex_unlock(&ring->lock);
+			ret = prering_open_event(ring);
+			pthread_mutex_lock(&ring->lock);
+			if (ret < 0) {
+				ring->stats.failed++;
+				prering_abort(ring);
+				continue;
+			}
+		}
+
+		for (num = 0; ring->queued && ring->writing < ring->cfg.depth;
+		     num++) {
+			slot = prering_slot(ring, ring->next);
+			slot->state = SLOT_WRITING;
+			batch[num].n = ring->next;
+			batch[num].sequence = slot->sequence;
+			batch[num].timestamp_ns = slot->timestamp_ns;
+			ring->next++;
+			ring->queued--;
+			ring->writing++;
+		}
+
+		/* Over and drained: a later trigger starts a new event. */
+		done = !num && !ring->writing && !ring->queued &&
+		       (ring->ended || ring->quit);
+		if (done)
+			ring->active = 0;
+		pthread_mutex_unlock(&ring->lock);
+
+		if (done) {
+			prering_close_event(ring, 0);
+			pthread_mutex_lock(&ring->lock);
+			continue;
+		}
+
+		failed = 0;
+		for (i = 0; i < num && !failed; i++)
+			failed = rawrec_write(ring->rec,
+					      prering_data(ring, batch[i].n),
+					      ring->cfg.frame_size,
+					      batch[i].sequence,
+					      batch[i].timestamp_ns,
+					      batch[i].n) < 0;
+
+		ret = failed ? -1 : rawrec_reap(ring->rec, cookies,
+						 PRERING_MAX_DEPTH, !num);
+		if (ret < 0) {
+			/*
+			 * Completions are no longer reported once a write has
+			 * failed; closing waits for the rest, after which
+			 * nothing of this event is still being written.
+			 */
+			prering_close_event(ring, 1);
+			pthread_mutex_lock(&ring->lock);
+			for (; ring->writing; ring->writing--) {
+				slot = prering_slot(ring,
+						    ring->next - ring->writing);
+				slot->state = SLOT_HELD;
+			}
+			prering_abort(ring);
+			continue;
+		}
+
+		pthread_mutex_lock(&ring->lock);
+		for (i = 0; i < (unsigned int)ret; i++)
+			prering_slot(ring, cookies[i])->state = SLOT_HELD;
+		ring->writing -= ret;
+		ring->stats.written += ret;
+		ring->event_frames += ret;
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	return NULL;
+}
+
+struct prering *prering_create(const struct prering_config *cfg)
+{
+	struct prering *ring;
+	void *arena;
+
+	if (!cfg->frames || !cfg->depth || cfg->depth > PRERING_MAX_DEPTH) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	ring->cfg = *cfg;
+	ring->slot_size = RAWREC_ALIGN_UP(cfg->frame_size);
+	ring->slots = calloc(cfg->frames, sizeof(*ring->slots));
+	if (!ring->slots ||
+	    posix_memalign(&arena, RAWREC_ALIGN,
+			   (size_t)cfg->frames * ring->slot_size))
+		goto err_free;
+	ring->arena = arena;
+
+	/* Fault every page in now rather than on the first lap. */
+	memset(ring->arena, 0, (size_t)cfg->frames * ring->slot_size);
+	ring->stats.locked = !mlock(ring->arena,
+				    (size_t)cfg->frames * ring->slot_size);
+
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->wake, NULL);
+	if (pthread_create(&ring->writer, NULL, prering_writer, ring))
+		goto err_sync;
+
+	return ring;
+
+err_sync:
+	pthread_cond_destroy(&ring->wake);
+	pthread_mutex_destroy(&ring->lock);
+	if (ring->stats.locked)
+		munlock(ring->arena, (size_t)cfg->frames * ring->slot_size);
+err_free:
+	free(ring->arena);
+	free(ring->slots);
+	free(ring);
+	return NULL;
+}
+
+void prering_destroy(struct prering *ring, struct prering_stats *stats)
+{
+	if (!ring)
+		return;
+
+	pthread_mutex_lock(&ring->lock);
+	ring->quit = 1;
+	pthread_cond_signal(&ring->wake);
+	pthread_mutex_unlock(&ring->lock);
+	pthread_join(ring->writer, NULL);
+	if (stats)
+		*stats = ring->stats;
+
+	pthread_cond_destroy(&ring->wake);
+	pthread_mutex_destroy(&ring->lock);
+	if (ring->stats.locked)
+		munlock(ring->arena,
+			(size_t)ring->cfg.frames * ring->slot_size);
+	free(ring->arena);
+	free(ring->slots);
+	free(ring);
+}
+
+void *prering_reserve(struct prering *ring)
+{
+	void *data = NULL;
+
+	pthread_mutex_lock(&ring->lock);
+	if (ring->count < ring->cfg.frames) {
+		data = prering_data(ring, ring->head);
+	} else if (prering_slot(ring, ring->head)->state == SLOT_HELD) {
+		/* Drop the oldest frame. */
+		ring->count--;
+		data = prering_data(ring, ring->head);
+	} else {
+		ring->stats.overruns++;
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	return data;
+}
+
+void prering_commit(struct prering *ring, uint32_t sequence,
+		    uint64_t timestamp_ns)
+{
+	struct prering_slot *slot;
+
+	pthread_mutex_lock(&ring->lock);
+	slot = prering_slot(ring, ring->head);
+	slot->sequence = sequence;
+	slot->timestamp_ns = timestamp_ns;
+	slot->state = SLOT_HELD;
+
+	if (ring->active && !ring->ended) {
+		if (timestamp_ns <= ring->end_ns) {
+			slot->state = SLOT_QUEUED;
+			ring->queued++;
+		} else {
+			ring->ended = 1;
+		}
+		pthread_cond_signal(&ring->wake);
+	}
+
+	ring->head++;
+	ring->count++;
+	ring->stats.frames++;
+	pthread_mutex_unlock(&ring->lock);
+}
+
+void prering_trigger(struct prering *ring, uint64_t trigger_ns)
+{
+	uint64_t start = trigger_ns > ring->cfg.pre_ns ?
+			 trigger_ns - ring->cfg.pre_ns : 0;
+
+	pthread_mutex_lock(&ring->lock);
+	if (!ring->active) {
+		/* Start at the oldest frame held within @pre_ns. */
+		ring->next = ring->head - ring->count;
+		while (ring->next < ring->head &&
+		       prering_slot(ring, ring->next)->timestamp_ns < start)
+			ring->next++;
+		ring->queued = 0;
+		ring->active = 1;
+		ring->end_ns = trigger_ns + ring->cfg.post_ns;
+	} else if (ring->next < ring->head - ring->count) {
+		/* Nothing pending and the ring lapped the event's end. */
+		ring->next = ring->head - ring->count;
+	}
+
+	/* Frames committed after an earlier end are part of this event too. */
+	for (; ring->next + ring->queued < ring->head; ring->queued++)
+		prering_slot(ring, ring->next + ring->queued)->state =
+			SLOT_QUEUED;
+
+	if (trigger_ns + ring->cfg.post_ns > ring->end_ns)
+		ring->end_ns = trigger_ns + ring->cfg.post_ns;
+	ring->ended = 0;
+	pthread_cond_signal(&ring->wake);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+void prering_get_stats(struct prering *ring, struct prering_stats *stats)
+{
+	pthread_mutex_lock(&ring->lock);
+	*stats = ring->stats;
+	pthread_mutex_unlock(&ring->lock);
+}
@@ -0,0 +1,76 @@
+/*
+ * Pre-event frame ring with asynchronous flush to disk.
+ *
+ * The ring keeps the most recent frames in one arena of fixed size slots,
+ * allocated, faulted in and locked when it is created, so streaming into
+ * it neither allocates nor grows. The producer fills the slot returned by
+ * prering_reserve() and publishes it with prering_commit(); the oldest
+ * frame is overwritten when the ring is full.
+ *
+ * prering_trigger() starts an event: a writer thread opens
+ * <prefix>-NNN.raw (common/rawrec.h), writes every held frame captured
+ * up to @pre_ns before the trigger, then keeps writing frames as they are
+ * committed until one arrives more than @post_ns after it, and closes the
+ * file. A trigger during an event extends it. Frames waiting to be
+ * written cannot be overwritten: if the disk falls so far behind that the
+ * producer catches up with them, prering_reserve() fails and the frame is
+ * counted as an overrun instead of tearing a hole in the recording.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_PRERING_H
+#define CAMERA_TOOLS_PRERING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rawrec.h"
+
+struct prering_config {
+	const char *prefix;		/* events go to <prefix>-NNN.raw */
+	struct rawrec_format fmt;	/* of the frames as stored */
+	size_t frame_size;		/* stored bytes per frame */
+	unsigned int frames;		/* ring slots */
+	uint64_t pre_ns;
+	uint64_t post_ns;
+	unsigned int depth;		/* writes in flight */
+};
+
+struct prering_stats {
+	uint64_t frames;	/* committed */
+	uint64_t overruns;	/* frames lost to a writer behind */
+	uint64_t written;	/* frames on disk */
+	unsigned int events;	/* closed event files */
+	unsigned int failed;	/* events that hit a write error */
+	int locked;		/* arena is mlock()ed */
+};
+
+struct prering;
+
+struct prering *prering_create(const struct prering_config *cfg);
+
+/*
+ * Finish any event in progress, stop the writer and free the ring. The
+ * final counts go to @stats unless it is NULL.
+ */
+void prering_destroy(struct prering *ring, struct prering_stats *stats);
+
+/*
+ * Slot for the next frame, frame_size bytes, RAWREC_ALIGN aligned. NULL
+ * when it still holds a frame waiting for the disk. Only one frame may be
+ * reserved at a time.
+ */
+void *prering_reserve(struct prering *ring);
+void prering_commit(struct prering *ring, uint32_t sequence,
+		    uint64_t timestamp_ns);
+
+/* Record around @trigger_ns (CLOCK_MONOTONIC, like V4L2 timestamps). */
+void prering_trigger(struct prering *ring, uint64_t trigger_ns);
+
+void prering_get_stats(struct prering *ring, struct prering_stats *stats);
+
+#endif /* CAMERA_TOOLS_PRERING_H */
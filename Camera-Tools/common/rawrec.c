@@ -0,0 +1,384 @@
+/*
+ * Raw frame recording with O_DIRECT and io_uring, see rawrec.h.
+ *
+ * io_uring is driven through its system calls directly rather than
+ * liburing, so the tools keep building with nothing but libc; headers
+ * without io_uring build the synchronous path only.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "rawrec.h"
+
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#define RAWREC_URING	1
+#endif
+
+struct rawrec_slot {
+	struct iovec iov;
+	uint64_t cookie;
+	int busy;
+};
+
+struct rawrec {
+	int fd;
+	FILE *index;
+	uint64_t offset;	/* end of the data written so far */
+	unsigned int depth;
+	unsigned int in_flight;
+	int failed;
+
+	struct rawrec_slot *slots;
+
+	/* Synchronous writes: completed cookies not yet reaped. */
+	uint64_t *done;
+	unsigned int num_done;
+
+#ifdef RAWREC_URING
+	int ring_fd;
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+#endif
+};
+
+#ifdef RAWREC_URING
+static void rawrec_uring_exit(struct rawrec *rec)
+{
+	if (rec->sqes)
+		munmap(rec->sqes, rec->sqes_size);
+	if (rec->cq_ptr && rec->cq_ptr != rec->sq_ptr)
+		munmap(rec->cq_ptr, rec->cq_size);
+	if (rec->sq_ptr)
+		munmap(rec->sq_ptr, rec->sq_size);
+	if (rec->ring_fd >= 0)
+		close(rec->ring_fd);
+	rec->ring_fd = -1;
+}
+
+static int rawrec_uring_init(struct rawrec *rec)
+{
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	memset(&p, 0, sizeof(p));
+	rec->ring_fd = syscall(__NR_io_uring_setup, rec->depth, &p);
+	if (rec->ring_fd < 0)
+		return -1;
+
+	rec->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	rec->cq_size = p.cq_off.cqes +
+		       p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (rec->cq_size > rec->sq_size)
+			rec->sq_size = rec->cq_size;
+		rec->cq_size = rec->sq_size;
+	}
+
+	rec->sq_ptr = mmap(NULL, rec->sq_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, rec->ring_fd,
+			   IORING_OFF_SQ_RING);
+	if (rec->sq_ptr == MAP_FAILED) {
+		rec->sq_ptr = NULL;
+		goto err;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		rec->cq_ptr = rec->sq_ptr;
+	} else {
+		rec->cq_ptr = mmap(NULL, rec->cq_size, PROT_READ | PROT_WRITE,
+				   MAP_SHARED | MAP_POPULATE, rec->ring_fd,
+				   IORING_OFF_CQ_RING);
+		if (rec->cq_ptr == MAP_FAILED) {
+			rec->cq_ptr = NULL;
+			goto err;
+		}
+	}
+
+	rec->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	rec->sqes = mmap(NULL, rec->sqes_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, rec->ring_fd,
+			 IORING_OFF_SQES);
+	if (rec->sqes == MAP_FAILED) {
+		rec->sqes = NULL;
+		goto err;
+	}
+
+	sq = rec->sq_ptr;
+	cq = rec->cq_ptr;
+	rec->sq_head = (unsigned int *)(sq + p.sq_off.head);
+	rec->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+	rec->sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+	rec->sq_array = (unsigned int *)(sq + p.sq_off.array);
+	rec->cq_head = (unsigned int *)(cq + p.cq_off.head);
+	rec->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+	rec->cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+	rec->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	return 0;
+
+err:
+	rawrec_uring_exit(rec);
+	return -1;
+}
+
+static int rawrec_uring_submit(struct rawrec *rec, unsigned int slot)
+{
+	unsigned int tail = *rec->sq_tail, idx = tail & *rec->sq_mask;
+	struct io_uring_sqe *sqe = &rec->sqes[idx];
+	int ret;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = rec->fd;
+	sqe->addr = (uintptr_t)&rec->slots[slot].iov;
+	sqe->len = 1;
+	sqe->off = rec->offset;
+	sqe->user_data = slot;
+	rec->sq_array[idx] = idx;
+	__atomic_store_n(rec->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	do {
+		ret = syscall(__NR_io_uring_enter, rec->ring_fd, 1, 0, 0,
+			      NULL, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret == 1 ? 0 : -1;
+}
+
+static void rawrec_uring_complete(struct rawrec *rec, unsigned int wait)
+{
+	unsigned int head, slot;
+	struct io_uring_cqe *cqe;
+
+	if (wait && *rec->cq_head == __atomic_load_n(rec->cq_tail,
+						     __ATOMIC_ACQUIRE))
+		syscall(__NR_io_uring_enter, rec->ring_fd, 0, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0);
+
+	head = *rec->cq_head;
+	while (head != __atomic_load_n(rec->cq_tail, __ATOMIC_ACQUIRE)) {
+		cqe = &rec->cqes[head & *rec->cq_mask];
+		slot = cqe->user_data;
+
+		if (cqe->res != (int)rec->slots[slot].iov.iov_len) {
+			fprintf(stderr, "rawrec: write failed: %s\n",
+				cqe->res < 0 ? strerror(-cqe->res) : "short");
+			rec->failed = 1;
+		}
+
+		rec->slots[slot].busy = 0;
+		rec->done[rec->num_done++] = rec->slots[slot].cookie;
+		rec->in_flight--;
+		head++;
+	}
+	__atomic_store_n(rec->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif /* RAWREC_URING */
+
+struct rawrec *rawrec_open(const char *path, const struct rawrec_format *fmt,
+			   uint64_t prealloc, unsigned int depth)
+{
+	char idx_path[4096];
+	struct rawrec *rec;
+
+	rec = calloc(1, sizeof(*rec));
+	if (!rec)
+		return NULL;
+
+	rec->depth = depth;
+	rec->slots = calloc(depth, sizeof(*rec->slots));
+	rec->done = calloc(depth, sizeof(*rec->done));
+	if (!rec->slots || !rec->done)
+		goto err_free;
+
+	rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT |
+		       O_CLOEXEC, 0644);
+	if (rec->fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		goto err_free;
+	}
+
+	/* Extents allocated up front: no block allocation while writing. */
+	if (prealloc && fallocate(rec->fd, 0, 0, prealloc) < 0)
+		fprintf(stderr, "%s: cannot preallocate: %s\n", path,
+			strerror(errno));
+
+	snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+	rec->index = fopen(idx_path, "w");
+	if (!rec->index) {
+		fprintf(stderr, "%s: %s\n", idx_path, strerror(errno));
+		goto err_close;
+	}
+	fprintf(rec->index, "# rawrec 1 %.4s %ux%u %u\n",
+		(const char *)&fmt->fourcc, fmt->width, fmt->height,
+		fmt->bytesperline);
+
+#ifdef RAWREC_URING
+	if (rawrec_uring_init(rec) < 0)
+		fprintf(stderr, "rawrec: no io_uring (%s), writing "
+			"synchronously\n", strerror(errno));
+#endif
+
+	return rec;
+
+err_close:
+	close(rec->fd);
+err_free:
+	free(rec->slots);
+	free(rec->done);
+	free(rec);
+	return NULL;
+}
+
+int rawrec_async(const struct rawrec *rec)
+{
+#ifdef RAWREC_URING
+	return rec->ring_fd >= 0;
+#else
+	(void)rec;
+	return 0;
+#endif
+}
+
+int rawrec_fd(const struct rawrec *rec)
+{
+#ifdef RAWREC_URING
+	return rec->ring_fd;
+#else
+	(void)rec;
+	return -1;
+#endif
+}
+
+unsigned int rawrec_in_flight(const struct rawrec *rec)
+{
+	return rec->in_flight;
+}
+
+uint64_t rawrec_bytes(const struct rawrec *rec)
+{
+	return rec->offset;
+}
+
+int rawrec_write(struct rawrec *rec, const void *data, size_t len,
+		 uint32_t sequence, uint64_t timestamp_ns, uint64_t cookie)
+{
+	size_t size = RAWREC_ALIGN_UP(len);
+	unsigned int slot;
+	ssize_t ret;
+
+	if ((uintptr_t)data % RAWREC_ALIGN) {
+		errno = EINVAL;
+		return -1;
+	}
+	/* Completed writes not reaped yet also hold a done[] entry. */
+	if (rec->in_flight + rec->num_done >= rec->depth) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	for (slot = 0; rec->slots[slot].busy; slot++)
+		;
+
+	rec->slots[slot].iov.iov_base = (void *)data;
+	rec->slots[slot].iov.iov_len = size;
+	rec->slots[slot].cookie = cookie;
+
+#ifdef RAWREC_URING
+	if (rec->ring_fd >= 0) {
+		if (rawrec_uring_submit(rec, slot) < 0)
+			return -1;
+		rec->slots[slot].busy = 1;
+		rec->in_flight++;
+		goto index;
+	}
+#endif
+
+	ret = pwrite(rec->fd, data, size, rec->offset);
+	if (ret != (ssize_t)size) {
+		if (ret >= 0)
+			errno = EIO;
+		return -1;
+	}
+	rec->done[rec->num_done++] = cookie;
+
+#ifdef RAWREC_URING
+index:
+#endif
+	fprintf(rec->index, "%u %llu %zu %llu\n", sequence,
+		(unsigned long long)rec->offset, len,
+		(unsigned long long)timestamp_ns);
+	rec->offset += size;
+
+	return 0;
+}
+
+int rawrec_reap(struct rawrec *rec, uint64_t *cookies, unsigned int max,
+		int wait)
+{
+	unsigned int n;
+
+#ifdef RAWREC_URING
+	if (rec->ring_fd >= 0 && rec->in_flight)
+		rawrec_uring_complete(rec, wait && !rec->num_done);
+#else
+	(void)wait;
+#endif
+
+	n = rec->num_done < max ? rec->num_done : max;
+	memcpy(cookies, rec->done, n * sizeof(*cookies));
+	rec->num_done -= n;
+	memmove(rec->done, rec->done + n, rec->num_done * sizeof(*cookies));
+
+	return rec->failed ? -1 : (int)n;
+}
+
+int rawrec_close(struct rawrec *rec)
+{
+	uint64_t cookies[16];
+	int ret = 0;
+
+	while (rec->in_flight)
+		if (rawrec_reap(rec, cookies, 16, 1) < 0)
+			ret = -1;
+	if (rec->failed)
+		ret = -1;
+
+#ifdef RAWREC_URING
+	rawrec_uring_exit(rec);
+#endif
+
+	if (ftruncate(rec->fd, rec->offset) < 0 || fsync(rec->fd) < 0)
+		ret = -1;
+	close(rec->fd);
+	if (fclose(rec->index))
+		ret = -1;
+
+	free(rec->slots);
+	free(rec->done);
+	free(rec);
+
+	return ret;
+}
@@ -0,0 +1,87 @@
+/*
+ * Raw frame recording with O_DIRECT and io_uring.
+ *
+ * Frames are written to one preallocated file, bypassing the page cache,
+ * each at a RAWREC_ALIGN aligned offset and padded to a multiple of it, so
+ * the writes can come straight from V4L2 MMAP buffers (page aligned, with
+ * a page rounded length) without a copy. Writes are queued on an io_uring
+ * and complete asynchronously; the caller gets its cookie back from
+ * rawrec_reap() and may reuse the buffer then. Kernels without io_uring
+ * (the board's 4.4) get synchronous O_DIRECT writes instead, completing
+ * inside rawrec_write().
+ *
+ * A text index is written next to the data, <path>.idx:
+ *
+ *	# rawrec 1 <fourcc> <width>x<height> <bytesperline>
+ *	<sequence> <offset> <bytes> <timestamp_ns>
+ *	...
+ *
+ * one line per frame in file order. The data file is truncated to the end
+ * of the last frame when it is closed.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_RAWREC_H
+#define CAMERA_TOOLS_RAWREC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAWREC_ALIGN		4096
+#define RAWREC_ALIGN_UP(x)	(((x) + RAWREC_ALIGN - 1) & \
+				 ~(size_t)(RAWREC_ALIGN - 1))
+
+struct rawrec_format {
+	uint32_t fourcc;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesperline;
+};
+
+struct rawrec;
+
+/*
+ * Create @path and its index, preallocating @prealloc bytes (0: none).
+ * At most @depth writes are in flight at a time.
+ */
+struct rawrec *rawrec_open(const char *path, const struct rawrec_format *fmt,
+			   uint64_t prealloc, unsigned int depth);
+
+/*
+ * Flush pending writes, truncate the file to its contents and close it.
+ * Returns -1 if any write failed.
+ */
+int rawrec_close(struct rawrec *rec);
+
+/* Whether writes go through io_uring. */
+int rawrec_async(const struct rawrec *rec);
+
+/*
+ * fd that polls readable when a completion is waiting, -1 for synchronous
+ * writes (completions are then ready as soon as rawrec_write() returns).
+ */
+int rawrec_fd(const struct rawrec *rec);
+
+/*
+ * Queue @len bytes at @data, which must be RAWREC_ALIGN aligned with at
+ * least RAWREC_ALIGN_UP(@len) readable bytes. Returns -1 with errno set to
+ * EBUSY when @depth writes are already in flight.
+ */
+int rawrec_write(struct rawrec *rec, const void *data, size_t len,
+		 uint32_t sequence, uint64_t timestamp_ns, uint64_t cookie);
+
+/*
+ * Collect up to @max completed writes' cookies, waiting for at least one if
+ * @wait and any are in flight. Returns the count, or -1 on a failed write.
+ */
+int rawrec_reap(struct rawrec *rec, uint64_t *cookies, unsigned int max,
+		int wait);
+
+unsigned int rawrec_in_flight(const struct rawrec *rec);
+uint64_t rawrec_bytes(const struct rawrec *rec);
+
+#endif /* CAMERA_TOOLS_RAWREC_H */
@@ -0,0 +1,115 @@
+/*
+ * Stereo frame pairing, see stereopair.h.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+
+#include "stereopair.h"
+
+void stereopair_init(struct stereopair *sp, uint64_t tolerance_ns)
+{
+	memset(sp, 0, sizeof(*sp));
+	sp->tolerance_ns = tolerance_ns;
+	sp->resync = 1;
+}
+
+uint64_t stereopair_tolerance(const struct stereopair *sp)
+{
+	return sp->tolerance_ns ? sp->tolerance_ns : sp->interval_ns / 2;
+}
+
+int stereopair_push(struct stereopair *sp, unsigned int side,
+		    const struct v4l2_dev_frame *frame)
+{
+	if (sp->num_pending[side] == STEREOPAIR_MAX_PENDING)
+		return -1;
+
+	sp->pending[side][sp->num_pending[side]++] = *frame;
+
+	/* Only consecutive frames of one side give the interval. */
+	if (side != STEREOPAIR_LEFT)
+		return 0;
+	if (!sp->resync && frame->sequence == sp->last_sequence + 1 &&
+	    frame->timestamp_ns > sp->last_ts)
+		sp->interval_ns = frame->timestamp_ns - sp->last_ts;
+	sp->last_sequence = frame->sequence;
+	sp->last_ts = frame->timestamp_ns;
+	sp->resync = 0;
+
+	return 0;
+}
+
+static void stereopair_pop(struct stereopair *sp, unsigned int side,
+			   struct v4l2_dev_frame *frame)
+{
+	*frame = sp->pending[side][0];
+	memmove(&sp->pending[side][0], &sp->pending[side][1],
+		--sp->num_pending[side] * sizeof(sp->pending[side][0]));
+}
+
+static int stereopair_drop(struct stereopair *sp, unsigned int side,
+			   struct stereopair_result *res)
+{
+	res->event = STEREOPAIR_DROP;
+	res->side = side;
+	stereopair_pop(sp, side, &res->frame[side]);
+	sp->stats.unpaired[side]++;
+
+	return 1;
+}
+
+int stereopair_next(struct stereopair *sp, struct stereopair_result *res)
+{
+	uint64_t tolerance = stereopair_tolerance(sp);
+	unsigned int side;
+
+	memset(res, 0, sizeof(*res));
+
+	if (sp->num_pending[STEREOPAIR_LEFT] &&
+	    sp->num_pending[STEREOPAIR_RIGHT] && tolerance) {
+		uint64_t left = sp->pending[STEREOPAIR_LEFT][0].timestamp_ns;
+		uint64_t right = sp->pending[STEREOPAIR_RIGHT][0].timestamp_ns;
+		uint64_t dist = left > right ? left - right : right - left;
+
+		/*
+		 * Each side arrives in order, so the older head will only
+		 * ever see later frames on the other side.
+		 */
+		if (dist > tolerance)
+			return stereopair_drop(sp, left < right ?
+					       STEREOPAIR_LEFT :
+					       STEREOPAIR_RIGHT, res);
+
+		res->event = STEREOPAIR_PAIR;
+		stereopair_pop(sp, STEREOPAIR_LEFT,
+			       &res->frame[STEREOPAIR_LEFT]);
+		stereopair_pop(sp, STEREOPAIR_RIGHT,
+			       &res->frame[STEREOPAIR_RIGHT]);
+		res->skew_ns = (int64_t)(right - left);
+
+		sp->stats.pairs++;
+		sp->stats.skew_sum_ns += res->skew_ns;
+		streammon_hist_add(&sp->stats.skew, dist);
+		return 1;
+	}
+
+	/* Do not sit on the buffers of a side whose partner went quiet. */
+	for (side = 0; side < 2; side++)
+		if (sp->num_pending[side] == STEREOPAIR_MAX_PENDING)
+			return stereopair_drop(sp, side, res);
+
+	return 0;
+}
+
+void stereopair_flush(struct stereopair *sp)
+{
+	sp->num_pending[STEREOPAIR_LEFT] = 0;
+	sp->num_pending[STEREOPAIR_RIGHT] = 0;
+	sp->interval_ns = 0;
+	sp->resync = 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * Stereo frame pairing by capture timestamp.
+ *
+ * The two OV5645s of the StereoCamera board run free on msm_vfe0_rdi0 and
+ * rdi1: each node delivers its own frames, either may lose one the other
+ * still has, and their phase drifts. stereopair_push() takes every frame
+ * dequeued from either side, in capture order per side, and
+ * stereopair_next() hands out what can be decided:
+ *
+ *	STEREOPAIR_PAIR	one frame of each side whose timestamps lie within
+ *			the tolerance of each other
+ *	STEREOPAIR_DROP	a frame that cannot be paired any more: the other
+ *			side has a later frame beyond the tolerance, or its
+ *			side has STEREOPAIR_MAX_PENDING frames waiting (the
+ *			other camera stopped)
+ *
+ * The tolerance defaults to half the frame interval, the largest that
+ * cannot pair one frame with two.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_STEREOPAIR_H
+#define CAMERA_TOOLS_STEREOPAIR_H
+
+#include <stdint.h>
+
+#include "streammon.h"
+#include "v4l2.h"
+
+#define STEREOPAIR_LEFT		0
+#define STEREOPAIR_RIGHT	1
+#define STEREOPAIR_MAX_PENDING	3	/* per side */
+
+enum stereopair_event {
+	STEREOPAIR_NONE,
+	STEREOPAIR_PAIR,
+	STEREOPAIR_DROP,
+};
+
+struct stereopair_result {
+	enum stereopair_event event;
+	unsigned int side;		/* STEREOPAIR_DROP: the frame's side */
+	struct v4l2_dev_frame frame[2];	/* by side; DROP fills frame[side] */
+	int64_t skew_ns;		/* STEREOPAIR_PAIR: right - left */
+};
+
+struct stereopair_stats {
+	uint64_t pairs;
+	uint64_t unpaired[2];
+	int64_t skew_sum_ns;		/* signed, > 0: right frames later */
+	struct streammon_hist skew;	/* absolute */
+};
+
+struct stereopair {
+	uint64_t tolerance_ns;		/* 0: half the frame interval */
+	uint64_t interval_ns;		/* of the left side, 0 until known */
+	uint32_t last_sequence;
+	uint64_t last_ts;
+	int resync;
+
+	struct v4l2_dev_frame pending[2][STEREOPAIR_MAX_PENDING];
+	unsigned int num_pending[2];
+
+	/* Since init; the caller may clear it to start a new period. */
+	struct stereopair_stats stats;
+};
+
+void stereopair_init(struct stereopair *sp, uint64_t tolerance_ns);
+
+/* The tolerance in effect, 0 while the frame interval is unknown. */
+uint64_t stereopair_tolerance(const struct stereopair *sp);
+
+/*
+ * Queue a frame of @side. Returns -1 if that side is full: call
+ * stereopair_next() until it returns 0 after every push.
+ */
+int stereopair_push(struct stereopair *sp, unsigned int side,
+		    const struct v4l2_dev_frame *frame);
+
+/* Returns 1 and fills @res while there is something to hand out. */
+int stereopair_next(struct stereopair *sp, struct stereopair_result *res);
+
+/*
+ * Forget every pending frame, after STREAMOFF has returned them all. The
+ * frame interval is measured again.
+ */
+void stereopair_flush(struct stereopair *sp);
+
+#endif /* CAMERA_TOOLS_STEREOPAIR_H */
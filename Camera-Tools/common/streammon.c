@@ -0,0 +1,192 @@
+/*
+ * Streaming monitor, see streammon.h.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "streammon.h"
+
+uint64_t streammon_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void streammon_init(struct streammon *mon, const char *name, FILE *out,
+		    unsigned int period_ms)
+{
+	memset(mon, 0, sizeof(*mon));
+	mon->name = name;
+	mon->out = out;
+	mon->period_ns = (uint64_t)period_ms * 1000000ull;
+	mon->period_start = streammon_now();
+	mon->resync = 1;
+}
+
+int streammon_add_stage(struct streammon *mon, const char *name)
+{
+	if (mon->num_stages == STREAMMON_MAX_STAGES)
+		return -1;
+
+	mon->stage_name[mon->num_stages] = name;
+
+	return mon->num_stages++;
+}
+
+void streammon_hist_add(struct streammon_hist *h, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int b = 0;
+
+	while (b < STREAMMON_BUCKETS - 1 && us >> b)
+		b++;
+
+	h->bucket[b]++;
+	h->count++;
+	h->sum_us += us;
+	if (us > h->max_us)
+		h->max_us = us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+uint32_t streammon_hist_percentile(const struct streammon_hist *h,
+				   unsigned int permille)
+{
+	uint64_t rank = (h->count * permille + 999) / 1000, seen = 0;
+	unsigned int b;
+
+	for (b = 0; b < STREAMMON_BUCKETS; b++) {
+		seen += h->bucket[b];
+		if (seen >= rank && seen)
+			return 1u << b;
+	}
+
+	return 0;
+}
+
+void streammon_frame(struct streammon *mon, uint32_t sequence,
+		     uint64_t timestamp_ns, uint64_t dequeue_ns,
+		     unsigned int queued)
+{
+	if (!mon->resync) {
+		if (sequence != mon->last_sequence + 1) {
+			mon->dropped += sequence - mon->last_sequence - 1;
+			mon->total_dropped += sequence - mon->last_sequence - 1;
+		} else if (timestamp_ns > mon->last_ts) {
+			streammon_hist_add(&mon->interval,
+					   timestamp_ns - mon->last_ts);
+		}
+	}
+	mon->last_sequence = sequence;
+	mon->last_ts = timestamp_ns;
+	mon->resync = 0;
+	mon->frames++;
+	mon->total_frames++;
+
+	streammon_hist_add(&mon->latency, dequeue_ns > timestamp_ns ?
+					  dequeue_ns - timestamp_ns : 0);
+
+	if (queued != STREAMMON_QUEUED_NONE) {
+		if (queued > STREAMMON_MAX_QUEUED)
+			queued = STREAMMON_MAX_QUEUED;
+		mon->queued[queued]++;
+		if (queued + 1 > mon->max_queued)
+			mon->max_queued = queued + 1;
+	}
+}
+
+void streammon_stage(struct streammon *mon, int stage, uint64_t start_ns)
+{
+	uint64_t now = streammon_now();
+
+	streammon_stage_ns(mon, stage, now > start_ns ? now - start_ns : 0);
+}
+
+void streammon_stage_ns(struct streammon *mon, int stage, uint64_t ns)
+{
+	if (stage < 0 || (unsigned int)stage >= mon->num_stages)
+		return;
+
+	streammon_hist_add(&mon->stage[stage], ns);
+}
+
+static void hist_export(FILE *out, const char *name,
+			const struct streammon_hist *h)
+{
+	unsigned int b, last = 0;
+
+	for (b = 0; b < STREAMMON_BUCKETS; b++)
+		if (h->bucket[b])
+			last = b;
+
+	fprintf(out, "\"%s\":{\"count\":%llu,\"mean\":%llu,\"p50\":%u,"
+		"\"p99\":%u,\"max\":%u,\"hist\":[", name,
+		(unsigned long long)h->count,
+		(unsigned long long)(h->count ? h->sum_us / h->count : 0),
+		streammon_hist_percentile(h, 500),
+		streammon_hist_percentile(h, 990), h->max_us);
+	/* Trailing empty buckets carry no information. */
+	for (b = 0; b <= last; b++)
+		fprintf(out, "%s%u", b ? "," : "", h->bucket[b]);
+	fputs("]}", out);
+}
+
+static void streammon_export(struct streammon *mon, uint64_t now_ns)
+{
+	double secs = (now_ns - mon->period_start) / 1e9;
+	unsigned int i;
+
+	fprintf(mon->out, "{\"stream\":\"%s\",\"time\":%.3f,\"period\":%.3f,"
+		"\"frames\":%llu,\"dropped\":%llu,\"fps\":%.2f,"
+		"\"total_frames\":%llu,\"total_dropped\":%llu,",
+		mon->name, now_ns / 1e9, secs,
+		(unsigned long long)mon->frames,
+		(unsigned long long)mon->dropped,
+		secs > 0 ? mon->frames / secs : 0,
+		(unsigned long long)mon->total_frames,
+		(unsigned long long)mon->total_dropped);
+
+	hist_export(mon->out, "latency_us", &mon->latency);
+	fputc(',', mon->out);
+	hist_export(mon->out, "interval_us", &mon->interval);
+
+	fputs(",\"queued\":[", mon->out);
+	for (i = 0; i < mon->max_queued; i++)
+		fprintf(mon->out, "%s%u", i ? "," : "", mon->queued[i]);
+	fputs("],\"stages\":{", mon->out);
+	for (i = 0; i < mon->num_stages; i++) {
+		if (i)
+			fputc(',', mon->out);
+		hist_export(mon->out, mon->stage_name[i], &mon->stage[i]);
+	}
+	fputs("}}\n", mon->out);
+	fflush(mon->out);
+}
+
+void streammon_tick(struct streammon *mon, uint64_t now_ns)
+{
+	unsigned int i;
+
+	if (!mon->out || now_ns - mon->period_start < mon->period_ns)
+		return;
+
+	streammon_export(mon, now_ns);
+
+	mon->period_start = now_ns;
+	mon->frames = 0;
+	mon->dropped = 0;
+	memset(&mon->latency, 0, sizeof(mon->latency));
+	memset(&mon->interval, 0, sizeof(mon->interval));
+	memset(mon->queued, 0, sizeof(mon->queued));
+	mon->max_queued = 0;
+	for (i = 0; i < mon->num_stages; i++)
+		memset(&mon->stage[i], 0, sizeof(mon->stage[i]));
+}
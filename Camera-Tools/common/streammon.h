@@ -0,0 +1,110 @@
+/*
+ * Streaming monitor: frame drops, delivery latency, queue depth and
+ * per-stage processing time of a capture loop, exported as JSON lines.
+ *
+ * Call streammon_frame() for every dequeued buffer, streammon_stage() with
+ * the duration of each processing step, and streammon_tick() from the main
+ * loop. Once per period the monitor writes one JSON object per line:
+ *
+ *	{"stream":"camd","time":1234.500,"period":1.000,
+ *	 "frames":60,"dropped":0,"fps":60.00,
+ *	 "total_frames":6000,"total_dropped":2,
+ *	 "latency_us":{"count":60,"mean":310,"p50":512,"p99":1024,
+ *		       "max":870,"hist":[0,0,...]},
+ *	 "interval_us":{...},
+ *	 "queued":[0,0,4,56],
+ *	 "stages":{"deliver":{...}}}
+ *
+ * "time" is CLOCK_MONOTONIC in seconds, the clock of the buffer
+ * timestamps. latency_us is the kernel buffer timestamp to dequeue delay,
+ * interval_us the time between consecutive buffer timestamps. Histogram
+ * bucket 0 counts values below 1 us and bucket i values in [2^(i-1), 2^i)
+ * us; p50/p99 are the upper edges of the buckets they fall in. "queued"
+ * counts dequeues by the number of buffers the driver still held. Counts
+ * cover the last period; the totals cover the whole run.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_STREAMMON_H
+#define CAMERA_TOOLS_STREAMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define STREAMMON_BUCKETS	24	/* up to 2^23 us, 8 s */
+#define STREAMMON_MAX_STAGES	8
+#define STREAMMON_MAX_QUEUED	32
+#define STREAMMON_QUEUED_NONE	(~0u)	/* queue depth not known */
+
+struct streammon_hist {
+	uint64_t count;
+	uint64_t sum_us;
+	uint32_t max_us;
+	uint32_t bucket[STREAMMON_BUCKETS];
+};
+
+struct streammon {
+	const char *name;
+	FILE *out;
+	uint64_t period_ns;
+	uint64_t period_start;
+
+	uint64_t total_frames;
+	uint64_t total_dropped;
+	uint64_t frames;
+	uint64_t dropped;
+	uint32_t last_sequence;
+	uint64_t last_ts;
+	int resync;		/* next frame starts a new sequence */
+
+	struct streammon_hist latency;
+	struct streammon_hist interval;
+	uint32_t queued[STREAMMON_MAX_QUEUED + 1];
+	unsigned int max_queued;
+
+	const char *stage_name[STREAMMON_MAX_STAGES];
+	struct streammon_hist stage[STREAMMON_MAX_STAGES];
+	unsigned int num_stages;
+};
+
+uint64_t streammon_now(void);
+
+void streammon_hist_add(struct streammon_hist *h, uint64_t ns);
+/* Upper edge in us of the bucket holding the @permille'th value. */
+uint32_t streammon_hist_percentile(const struct streammon_hist *h,
+				   unsigned int permille);
+
+/* Export to @out every @period_ms. @name identifies the stream. */
+void streammon_init(struct streammon *mon, const char *name, FILE *out,
+		    unsigned int period_ms);
+
+/* Register a processing stage; returns its number, or -1 if full. */
+int streammon_add_stage(struct streammon *mon, const char *name);
+
+/*
+ * A buffer was dequeued at @dequeue_ns with @queued buffers left in the
+ * driver (or STREAMMON_QUEUED_NONE).
+ */
+void streammon_frame(struct streammon *mon, uint32_t sequence,
+		     uint64_t timestamp_ns, uint64_t dequeue_ns,
+		     unsigned int queued);
+
+/* The stream restarted: do not count the sequence jump as drops. */
+static inline void streammon_resync(struct streammon *mon)
+{
+	mon->resync = 1;
+}
+
+/* Stage @stage took the time since @start_ns. */
+void streammon_stage(struct streammon *mon, int stage, uint64_t start_ns);
+/* Record any other per-frame time, e.g. the skew of a stereo pair. */
+void streammon_stage_ns(struct streammon *mon, int stage, uint64_t ns);
+
+/* Export and start a new period if the current one is over. */
+void streammon_tick(struct streammon *mon, uint64_t now_ns);
+
+#endif /* CAMERA_TOOLS_STREAMMON_H */
@@ -0,0 +1,504 @@
+/*
+ * Minimal V4L2 capture node helper shared by the camera tools.
+ *
+ * The CAMSS video nodes only implement the multi-planar API while vivid
+ * and most USB devices default to the single-planar one, so everything in
+ * here handles both, always with a single plane.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "v4l2.h"
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret;
+}
+
+int v4l2_dev_open(struct v4l2_dev *dev, const char *path)
+{
+	struct v4l2_capability cap;
+	uint32_t caps;
+
+	memset(dev, 0, sizeof(*dev));
+	snprintf(dev->path, sizeof(dev->path), "%s", path);
+
+	dev->fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (dev->fd < 0) {
+		fprintf(stderr, "%s: open failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	memset(&cap, 0, sizeof(cap));
+	if (xioctl(dev->fd, VIDIOC_QUERYCAP, &cap) < 0) {
+		fprintf(stderr, "%s: VIDIOC_QUERYCAP: %s\n", path,
+			strerror(errno));
+		goto err_close;
+	}
+
+	caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ?
+	       cap.device_caps : cap.capabilities;
+
+	if (!(caps & V4L2_CAP_STREAMING)) {
+		fprintf(stderr, "%s: no streaming I/O support\n", path);
+		goto err_close;
+	}
+
+	if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+		dev->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	} else if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+		dev->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		dev->mplane = 1;
+	} else {
+		fprintf(stderr, "%s: not a video capture device\n", path);
+		goto err_close;
+	}
+
+	return 0;
+
+err_close:
+	close(dev->fd);
+	dev->fd = -1;
+	return -1;
+}
+
+void v4l2_dev_close(struct v4l2_dev *dev)
+{
+	if (dev->fd < 0)
+		return;
+
+	v4l2_dev_free_buffers(dev);
+	close(dev->fd);
+	dev->fd = -1;
+}
+
+int v4l2_dev_set_format(struct v4l2_dev *dev, uint32_t width, uint32_t height,
+			uint32_t fourcc)
+{
+	return v4l2_dev_set_format_stride(dev, width, height, fourcc, 0);
+}
+
+int v4l2_dev_set_format_stride(struct v4l2_dev *dev, uint32_t width,
+			       uint32_t height, uint32_t fourcc,
+			       uint32_t bytesperline)
+{
+	struct v4l2_format fmt;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = dev->type;
+
+	if (dev->mplane) {
+		fmt.fmt.pix_mp.width = width;
+		fmt.fmt.pix_mp.height = height;
+		fmt.fmt.pix_mp.pixelformat = fourcc;
+		fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+		fmt.fmt.pix_mp.num_planes = 1;
+		fmt.fmt.pix_mp.plane_fmt[0].bytesperline = bytesperline;
+	} else {
+		fmt.fmt.pix.width = width;
+		fmt.fmt.pix.height = height;
+		fmt.fmt.pix.pixelformat = fourcc;
+		fmt.fmt.pix.field = V4L2_FIELD_NONE;
+		fmt.fmt.pix.bytesperline = bytesperline;
+	}
+
+	if (xioctl(dev->fd, VIDIOC_S_FMT, &fmt) < 0) {
+		fprintf(stderr, "%s: VIDIOC_S_FMT: %s\n", dev->path,
+			strerror(errno));
+		return -1;
+	}
+
+	if (dev->mplane) {
+		dev->width = fmt.fmt.pix_mp.width;
+		dev->height = fmt.fmt.pix_mp.height;
+		dev->fourcc = fmt.fmt.pix_mp.pixelformat;
+		dev->bytesperline = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+		dev->sizeimage = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+	} else {
+		dev->width = fmt.fmt.pix.width;
+		dev->height = fmt.fmt.pix.height;
+		dev->fourcc = fmt.fmt.pix.pixelformat;
+		dev->bytesperline = fmt.fmt.pix.bytesperline;
+		dev->sizeimage = fmt.fmt.pix.sizeimage;
+	}
+
+	if (dev->width != width || dev->height != height ||
+	    dev->fourcc != fourcc)
+		fprintf(stderr, "%s: driver adjusted format to %ux%u %.4s\n",
+			dev->path, dev->width, dev->height,
+			(const char *)&dev->fourcc);
+
+	return 0;
+}
+
+static int v4l2_dev_reqbufs(struct v4l2_dev *dev, unsigned int count,
+			    enum v4l2_memory memory)
+{
+	struct v4l2_requestbuffers req;
+
+	memset(&req, 0, sizeof(req));
+	req.count = count;
+	req.type = dev->type;
+	req.memory = memory;
+
+	if (xioctl(dev->fd, VIDIOC_REQBUFS, &req) < 0)
+		return -1;
+
+	return req.count;
+}
+
+int v4l2_dev_alloc_buffers(struct v4l2_dev *dev, unsigned int count,
+			   int map, int export)
+{
+	unsigned int i;
+	int ret;
+
+	if (count > V4L2_DEV_MAX_BUFFERS)
+		count = V4L2_DEV_MAX_BUFFERS;
+
+	ret = v4l2_dev_reqbufs(dev, count, V4L2_MEMORY_MMAP);
+	if (ret < 0) {
+		fprintf(stderr, "%s: VIDIOC_REQBUFS: %s\n", dev->path,
+			strerror(errno));
+		return -1;
+	}
+	if (ret < 2) {
+		fprintf(stderr, "%s: only %d buffers allocated\n", dev->path,
+			ret);
+		return -1;
+	}
+
+	dev->memory = V4L2_MEMORY_MMAP;
+	dev->num_buffers = ret;
+	dev->num_queued = 0;
+
+	for (i = 0; i < dev->num_buffers; i++) {
+		struct v4l2_dev_buf *b = &dev->bufs[i];
+		struct v4l2_plane plane;
+		struct v4l2_buffer buf;
+		uint32_t offset;
+
+		memset(&buf, 0, sizeof(buf));
+		memset(&plane, 0, sizeof(plane));
+		buf.type = dev->type;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (dev->mplane) {
+			buf.m.planes = &plane;
+			buf.length = 1;
+		}
+
+		if (xioctl(dev->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+			fprintf(stderr, "%s: VIDIOC_QUERYBUF: %s\n", dev->path,
+				strerror(errno));
+			goto err_free;
+		}
+
+		b->length = dev->mplane ? plane.length : buf.length;
+		offset = dev->mplane ? plane.m.mem_offset : buf.m.offset;
+		b->start = NULL;
+		b->dmabuf_fd = -1;
+		b->queued = 0;
+
+		if (map) {
+			b->start = mmap(NULL, b->length, PROT_READ | PROT_WRITE,
+					MAP_SHARED, dev->fd, offset);
+			if (b->start == MAP_FAILED) {
+				b->start = NULL;
+				fprintf(stderr, "%s: mmap: %s\n", dev->path,
+					strerror(errno));
+				goto err_free;
+			}
+		}
+
+		if (export) {
+			struct v4l2_exportbuffer exp;
+
+			memset(&exp, 0, sizeof(exp));
+			exp.type = dev->type;
+			exp.index = i;
+			exp.plane = 0;
+			exp.flags = O_RDONLY | O_CLOEXEC;
+
+			if (xioctl(dev->fd, VIDIOC_EXPBUF, &exp) < 0) {
+				fprintf(stderr, "%s: VIDIOC_EXPBUF: %s\n",
+					dev->path, strerror(errno));
+				goto err_free;
+			}
+			b->dmabuf_fd = exp.fd;
+		}
+	}
+
+	return 0;
+
+err_free:
+	v4l2_dev_free_buffers(dev);
+	return -1;
+}
+
+int v4l2_dev_use_userptr(struct v4l2_dev *dev, void **mem, size_t length,
+			 unsigned int count)
+{
+	unsigned int i;
+	int ret;
+
+	if (count > V4L2_DEV_MAX_BUFFERS)
+		count = V4L2_DEV_MAX_BUFFERS;
+
+	ret = v4l2_dev_reqbufs(dev, count, V4L2_MEMORY_USERPTR);
+	if (ret < 0)
+		return -1;
+	if ((unsigned int)ret < count) {
+		v4l2_dev_reqbufs(dev, 0, V4L2_MEMORY_USERPTR);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	dev->memory = V4L2_MEMORY_USERPTR;
+	dev->num_buffers = count;
+	dev->num_queued = 0;
+
+	for (i = 0; i < count; i++) {
+		dev->bufs[i].start = mem[i];
+		dev->bufs[i].length = length;
+		dev->bufs[i].dmabuf_fd = -1;
+		dev->bufs[i].queued = 0;
+	}
+
+	return 0;
+}
+
+void v4l2_dev_free_buffers(struct v4l2_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < dev->num_buffers; i++) {
+		struct v4l2_dev_buf *b = &dev->bufs[i];
+
+		if (dev->memory == V4L2_MEMORY_MMAP && b->start)
+			munmap(b->start, b->length);
+		if (b->dmabuf_fd >= 0)
+			close(b->dmabuf_fd);
+		b->start = NULL;
+		b->dmabuf_fd = -1;
+	}
+
+	if (dev->num_buffers)
+		v4l2_dev_reqbufs(dev, 0, dev->memory);
+
+	dev->num_buffers = 0;
+	dev->num_queued = 0;
+}
+
+int v4l2_dev_queue(struct v4l2_dev *dev, unsigned int index)
+{
+	struct v4l2_dev_buf *b = &dev->bufs[index];
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	memset(&buf, 0, sizeof(buf));
+	memset(&plane, 0, sizeof(plane));
+	buf.type = dev->type;
+	buf.memory = dev->memory;
+	buf.index = index;
+
+	if (dev->mplane) {
+		buf.m.planes = &plane;
+		buf.length = 1;
+		if (dev->memory == V4L2_MEMORY_USERPTR) {
+			plane.m.userptr = (unsigned long)b->start;
+			plane.length = b->length;
+		}
+	} else if (dev->memory == V4L2_MEMORY_USERPTR) {
+		buf.m.userptr = (unsigned long)b->start;
+		buf.length = b->length;
+	}
+
+	if (xioctl(dev->fd, VIDIOC_QBUF, &buf) < 0) {
+		fprintf(stderr, "%s: VIDIOC_QBUF(%u): %s\n", dev->path, index,
+			strerror(errno));
+		return -1;
+	}
+
+	b->queued = 1;
+	dev->num_queued++;
+
+	return 0;
+}
+
+int v4l2_dev_queue_all(struct v4l2_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < dev->num_buffers; i++) {
+		if (dev->bufs[i].queued)
+			continue;
+		if (v4l2_dev_queue(dev, i) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+int v4l2_dev_dequeue(struct v4l2_dev *dev, struct v4l2_dev_frame *frame)
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	memset(&buf, 0, sizeof(buf));
+	memset(&plane, 0, sizeof(plane));
+	buf.type = dev->type;
+	buf.memory = dev->memory;
+	if (dev->mplane) {
+		buf.m.planes = &plane;
+		buf.length = 1;
+	}
+
+	if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) < 0) {
+		if (errno != EAGAIN)
+			fprintf(stderr, "%s: VIDIOC_DQBUF: %s\n", dev->path,
+				strerror(errno));
+		return -1;
+	}
+
+	dev->bufs[buf.index].queued = 0;
+	dev->num_queued--;
+
+	frame->index = buf.index;
+	frame->sequence = buf.sequence;
+	frame->flags = buf.flags;
+	frame->bytesused = dev->mplane ? plane.bytesused : buf.bytesused;
+	frame->timestamp_ns = v4l2_dev_timestamp_ns(&buf.timestamp);
+
+	return 0;
+}
+
+int v4l2_dev_stream_on(struct v4l2_dev *dev)
+{
+	int type = dev->type;
+
+	if (xioctl(dev->fd, VIDIOC_STREAMON, &type) < 0) {
+		fprintf(stderr, "%s: VIDIOC_STREAMON: %s\n", dev->path,
+			strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int v4l2_dev_stream_off(struct v4l2_dev *dev)
+{
+	unsigned int i;
+	int type = dev->type;
+
+	if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) < 0) {
+		fprintf(stderr, "%s: VIDIOC_STREAMOFF: %s\n", dev->path,
+			strerror(errno));
+		return -1;
+	}
+
+	/* STREAMOFF returns every buffer to userspace. */
+	for (i = 0; i < dev->num_buffers; i++)
+		dev->bufs[i].queued = 0;
+	dev->num_queued = 0;
+
+	return 0;
+}
+
+int v4l2_ctrl_set(int fd, uint32_t id, int32_t value)
+{
+	struct v4l2_control ctrl;
+
+	ctrl.id = id;
+	ctrl.value = value;
+
+	return xioctl(fd, VIDIOC_S_CTRL, &ctrl);
+}
+
+int v4l2_ctrls_set(int fd, const uint32_t *ids, const int32_t *values,
+		   unsigned int count)
+{
+	struct v4l2_ext_control ctrl[V4L2_CTRLS_MAX];
+	struct v4l2_ext_controls ctrls;
+	unsigned int i;
+
+	if (count > V4L2_CTRLS_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(&ctrls, 0, sizeof(ctrls));
+	memset(ctrl, 0, sizeof(ctrl));
+	for (i = 0; i < count; i++) {
+		ctrl[i].id = ids[i];
+		ctrl[i].value = values[i];
+	}
+	ctrls.count = count;
+	ctrls.controls = ctrl;
+
+	return xioctl(fd, VIDIOC_S_EXT_CTRLS, &ctrls);
+}
+
+int v4l2_ctrl_get(int fd, uint32_t id, int32_t *value)
+{
+	struct v4l2_control ctrl;
+
+	ctrl.id = id;
+	ctrl.value = 0;
+
+	if (xioctl(fd, VIDIOC_G_CTRL, &ctrl) < 0)
+		return -1;
+
+	*value = ctrl.value;
+
+	return 0;
+}
+
+int v4l2_ctrl_get_array(int fd, uint32_t id, void *data, uint32_t size)
+{
+	struct v4l2_ext_controls ctrls;
+	struct v4l2_ext_control ctrl;
+
+	memset(&ctrls, 0, sizeof(ctrls));
+	memset(&ctrl, 0, sizeof(ctrl));
+	ctrl.id = id;
+	ctrl.size = size;
+	ctrl.ptr = data;
+	ctrls.count = 1;
+	ctrls.controls = &ctrl;
+
+	return xioctl(fd, VIDIOC_G_EXT_CTRLS, &ctrls);
+}
+
+int v4l2_ctrl_range(int fd, uint32_t id, int32_t *min, int32_t *max)
+{
+	struct v4l2_queryctrl query;
+
+	memset(&query, 0, sizeof(query));
+	query.id = id;
+
+	if (xioctl(fd, VIDIOC_QUERYCTRL, &query) < 0)
+		return -1;
+
+	*min = query.minimum;
+	*max = query.maximum;
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Minimal V4L2 capture node helper shared by the camera tools.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_V4L2_H
+#define CAMERA_TOOLS_V4L2_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/videodev2.h>
+
+#define V4L2_DEV_MAX_BUFFERS	32
+#define V4L2_CTRLS_MAX		8	/* per v4l2_ctrls_set() */
+
+struct v4l2_dev_buf {
+	void *start;		/* CPU mapping, NULL when not mapped */
+	size_t length;
+	int dmabuf_fd;		/* exported with VIDIOC_EXPBUF, -1 if not */
+	int queued;		/* owned by the driver */
+};
+
+struct v4l2_dev {
+	int fd;
+	char path[64];
+	int mplane;		/* node only speaks the _MPLANE API */
+	enum v4l2_buf_type type;
+	enum v4l2_memory memory;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;
+	uint32_t bytesperline;
+	uint32_t sizeimage;
+
+	unsigned int num_buffers;
+	unsigned int num_queued;
+	struct v4l2_dev_buf bufs[V4L2_DEV_MAX_BUFFERS];
+};
+
+struct v4l2_dev_frame {
+	unsigned int index;
+	uint32_t sequence;
+	uint32_t bytesused;
+	uint32_t flags;
+	uint64_t timestamp_ns;	/* kernel capture timestamp */
+};
+
+int v4l2_dev_open(struct v4l2_dev *dev, const char *path);
+void v4l2_dev_close(struct v4l2_dev *dev);
+
+int v4l2_dev_set_format(struct v4l2_dev *dev, uint32_t width, uint32_t height,
+			uint32_t fourcc);
+/*
+ * The same asking for lines @bytesperline apart (0: the driver's choice).
+ * Drivers may round it or ignore it; dev->bytesperline has the result.
+ */
+int v4l2_dev_set_format_stride(struct v4l2_dev *dev, uint32_t width,
+			       uint32_t height, uint32_t fourcc,
+			       uint32_t bytesperline);
+
+/*
+ * Allocate @count MMAP buffers. @map selects whether they are mapped in
+ * this process; @export exports every buffer as a DMABUF fd.
+ */
+int v4l2_dev_alloc_buffers(struct v4l2_dev *dev, unsigned int count,
+			   int map, int export);
+/*
+ * Use caller-provided, suitably aligned memory (V4L2_MEMORY_USERPTR).
+ * Returns -1 with errno set to EINVAL when the driver lacks USERPTR.
+ */
+int v4l2_dev_use_userptr(struct v4l2_dev *dev, void **mem, size_t length,
+			 unsigned int count);
+void v4l2_dev_free_buffers(struct v4l2_dev *dev);
+
+int v4l2_dev_queue(struct v4l2_dev *dev, unsigned int index);
+int v4l2_dev_queue_all(struct v4l2_dev *dev);
+/* Returns 0 on success, -1 with errno EAGAIN when no buffer is ready. */
+int v4l2_dev_dequeue(struct v4l2_dev *dev, struct v4l2_dev_frame *frame);
+
+int v4l2_dev_stream_on(struct v4l2_dev *dev);
+int v4l2_dev_stream_off(struct v4l2_dev *dev);
+
+int v4l2_ctrl_set(int fd, uint32_t id, int32_t value);
+/*
+ * Set @count controls in one VIDIOC_S_EXT_CTRLS: a driver applies them
+ * together, e.g. a clustered exposure and gain under one group hold.
+ */
+int v4l2_ctrls_set(int fd, const uint32_t *ids, const int32_t *values,
+		   unsigned int count);
+int v4l2_ctrl_get(int fd, uint32_t id, int32_t *value);
+int v4l2_ctrl_range(int fd, uint32_t id, int32_t *min, int32_t *max);
+/* Read an array control's whole payload of @size bytes. */
+int v4l2_ctrl_get_array(int fd, uint32_t id, void *data, uint32_t size);
+
+static inline uint64_t v4l2_dev_timestamp_ns(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * 1000000000ull +
+	       (uint64_t)tv->tv_usec * 1000ull;
+}
+
+#endif /* CAMERA_TOOLS_V4L2_H */
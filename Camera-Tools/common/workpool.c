@@ -0,0 +1,169 @@
+/*
+ * Minimal fork-join thread pool for splitting a frame into row bands.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "workpool.h"
+
+struct workpool_worker {
+	struct workpool *pool;
+	pthread_t thread;
+	unsigned int id;
+};
+
+struct workpool {
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+
+	unsigned int threads;
+	struct workpool_worker workers[WORKPOOL_MAX_THREADS];
+
+	/* Current job, protected by @lock. */
+	unsigned long generation;
+	unsigned int pending;
+	int quit;
+	workpool_fn fn;
+	void *arg;
+	unsigned int count;
+};
+
+static void workpool_band(unsigned int count, unsigned int threads,
+			  unsigned int id, unsigned int *start,
+			  unsigned int *end)
+{
+	*start = (unsigned long long)count * id / threads;
+	*end = (unsigned long long)count * (id + 1) / threads;
+}
+
+static void *workpool_thread(void *data)
+{
+	struct workpool_worker *worker = data;
+	struct workpool *pool = worker->pool;
+	unsigned long seen = 0;
+	unsigned int start, end;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->quit && pool->generation == seen)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit)
+			break;
+		seen = pool->generation;
+
+		workpool_band(pool->count, pool->threads, worker->id, &start,
+			      &end);
+		pthread_mutex_unlock(&pool->lock);
+
+		if (start < end)
+			pool->fn(pool->arg, start, end);
+
+		pthread_mutex_lock(&pool->lock);
+		if (!--pool->pending)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+struct workpool *workpool_create(unsigned int threads)
+{
+	struct workpool *pool;
+	unsigned int i;
+
+	if (!threads) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = n > 0 ? n : 1;
+	}
+	if (threads > WORKPOOL_MAX_THREADS)
+		threads = WORKPOOL_MAX_THREADS;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->threads = 1;
+
+	/* Worker 0 is the caller of workpool_run(). */
+	for (i = 1; i < threads; i++) {
+		struct workpool_worker *worker = &pool->workers[i];
+
+		worker->pool = pool;
+		worker->id = i;
+		if (pthread_create(&worker->thread, NULL, workpool_thread,
+				   worker))
+			break;
+		pool->threads++;
+	}
+
+	return pool;
+}
+
+void workpool_destroy(struct workpool *pool)
+{
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 1; i < pool->threads; i++)
+		pthread_join(pool->workers[i].thread, NULL);
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+unsigned int workpool_threads(const struct workpool *pool)
+{
+	return pool ? pool->threads : 1;
+}
+
+void workpool_run(struct workpool *pool, workpool_fn fn, void *arg,
+		  unsigned int count)
+{
+	unsigned int start, end;
+
+	if (!pool || pool->threads == 1 || count < 2) {
+		if (count)
+			fn(arg, 0, count);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->count = count;
+	pool->pending = pool->threads - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	workpool_band(count, pool->threads, 0, &start, &end);
+	if (start < end)
+		fn(arg, start, end);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
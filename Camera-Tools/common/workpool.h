@@ -0,0 +1,36 @@
+/*
+ * Minimal fork-join thread pool for splitting a frame into row bands.
+ *
+ * workpool_run() cuts [0, count) into one contiguous band per thread,
+ * runs them in parallel (the caller's thread takes the first band) and
+ * returns when all are done. Units are whatever the caller iterates over,
+ * typically row pairs for 4:2:0 output.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_WORKPOOL_H
+#define CAMERA_TOOLS_WORKPOOL_H
+
+#define WORKPOOL_MAX_THREADS	16
+
+typedef void (*workpool_fn)(void *arg, unsigned int start, unsigned int end);
+
+struct workpool;
+
+/* @threads == 0 uses one thread per online CPU. Returns NULL on error. */
+struct workpool *workpool_create(unsigned int threads);
+void workpool_destroy(struct workpool *pool);
+unsigned int workpool_threads(const struct workpool *pool);
+
+/*
+ * Call @fn over [0, @count) split into bands. A NULL @pool runs
+ * everything on the calling thread. Not reentrant: one run at a time.
+ */
+void workpool_run(struct workpool *pool, workpool_fn fn, void *arg,
+		  unsigned int count);
+
+#endif /* CAMERA_TOOLS_WORKPOOL_H */
@@ -0,0 +1,395 @@
+/*
+ * bench_isp - verify and time the ISP-lite pipeline
+ *
+ * Checks the SIMD row kernels against the scalar ones, then times full
+ * frames with 1, 2, 4, ... threads. The input is a synthetic RAW10 scene
+ * (colour bars over a zone plate) or a raw frame dumped with camd_cat;
+ * -o writes the processed result as a PPM.
+ *
+ *	bench_isp -W 1920 -H 1080 -o synthetic.ppm
+ *	bench_isp -r frame.raw -W 1920 -H 1080 -c rggb -b 60 -o frame.ppm
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isp_lite.h"
+
+static const char * const cfa_names[] = {
+	[ISP_CFA_RGGB] = "rggb",
+	[ISP_CFA_GRBG] = "grbg",
+	[ISP_CFA_GBRG] = "gbrg",
+	[ISP_CFA_BGGR] = "bggr",
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void fill_random(uint16_t *buf, unsigned int len, unsigned int max)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = rand() % (max + 1);
+}
+
+static int compare(uint16_t *a[3], uint16_t *b[3], unsigned int width)
+{
+	unsigned int i;
+
+	for (i = 0; i < 3; i++)
+		if (memcmp(a[i], b[i], width * 2))
+			return 1;
+
+	return 0;
+}
+
+/* Run each row kernel of @ops and of the scalar set on random rows. */
+static int verify(const struct isp_ops *ops, unsigned int width)
+{
+	static const int16_t ccm[9] = {
+		13107, -3277, -1638, -2458, 12288, -1638, -819, -4915, 13926,
+	};
+	static const uint16_t gains[2] = { 7800, 4300 };
+	unsigned int line = width + 2 + ISP_LINE_SLACK;
+	uint16_t *rows[3], *a[3], *b[3], *in;
+	struct isp_row row;
+	unsigned int i, mode;
+	int ret = 0;
+
+	in = calloc(line, 2);
+	fill_random(in, width, 1023);
+	for (i = 0; i < 3; i++) {
+		rows[i] = (uint16_t *)calloc(line, 2) + 1;
+		fill_random(rows[i] - 1, width + 2, ISP_MAX);
+		a[i] = calloc(line, 2);
+		b[i] = calloc(line, 2);
+	}
+
+	isp_ops_c.wb(in, a[0], width, 64, 6, gains);
+	ops->wb(in, b[0], width, 64, 6, gains);
+	if (memcmp(a[0], b[0], width * 2))
+		ret |= 1;
+
+	for (mode = ISP_DEMOSAIC_BILINEAR; mode <= ISP_DEMOSAIC_EDGE; mode++) {
+		for (i = 0; i < 4; i++) {
+			row.red_row = i & 1;
+			row.c_par = i >> 1;
+			isp_ops_c.demosaic(rows[0], rows[1], rows[2], a, width,
+					   &row, mode);
+			ops->demosaic(rows[0], rows[1], rows[2], b, width, &row,
+				      mode);
+			if (compare(a, b, width))
+				ret |= 2;
+		}
+	}
+
+	for (i = 0; i < 3; i++) {
+		memcpy(a[i], rows[i], width * 2);
+		memcpy(b[i], rows[i], width * 2);
+	}
+	isp_ops_c.ccm(a, width, ccm);
+	ops->ccm(b, width, ccm);
+	if (compare(a, b, width))
+		ret |= 4;
+
+	free(in);
+	for (i = 0; i < 3; i++) {
+		free(rows[i] - 1);
+		free(a[i]);
+		free(b[i]);
+	}
+
+	return ret;
+}
+
+/* Colour bars over a zone plate, mosaicked and packed as RAW10. */
+static void synth_raw10(uint8_t *dst, unsigned int stride, unsigned int width,
+			unsigned int height, enum isp_cfa cfa,
+			unsigned int black)
+{
+	static const uint8_t bars[8][3] = {
+		{ 1, 1, 1 }, { 1, 1, 0 }, { 0, 1, 1 }, { 0, 1, 0 },
+		{ 1, 0, 1 }, { 1, 0, 0 }, { 0, 0, 1 }, { 0, 0, 0 },
+	};
+	/* Channel at (y & 1, x & 1) for each CFA. */
+	static const uint8_t site[4][2][2] = {
+		[ISP_CFA_RGGB] = { { 0, 1 }, { 1, 2 } },
+		[ISP_CFA_GRBG] = { { 1, 0 }, { 2, 1 } },
+		[ISP_CFA_GBRG] = { { 1, 2 }, { 0, 1 } },
+		[ISP_CFA_BGGR] = { { 2, 1 }, { 1, 0 } },
+	};
+	unsigned int range = 1023 - black;
+	unsigned int x, y;
+
+	for (y = 0; y < height; y++) {
+		uint8_t *d = dst + (size_t)y * stride;
+
+		memset(d, 0, stride);
+		for (x = 0; x < width; x++) {
+			unsigned int c = site[cfa][y & 1][x & 1];
+			float v;
+			unsigned int p;
+
+			if (y < height / 2) {
+				v = bars[x * 8 / width][c] * 0.75f;
+			} else {
+				float r2 = (float)x * x + (float)y * y;
+
+				v = 0.5f + 0.45f * sinf(r2 * 3.14159f / width /
+							8);
+			}
+
+			p = black + v * range;
+			d[x / 4 * 5 + x % 4] = p >> 2;
+			d[x / 4 * 5 + 4] |= (p & 3) << (x % 4 * 2);
+		}
+	}
+}
+
+static int write_ppm(const char *path, const uint8_t *rgb, unsigned int width,
+		     unsigned int height)
+{
+	FILE *f = fopen(path, "wb");
+	int ret = 0;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	fprintf(f, "P6\n%u %u\n255\n", width, height);
+	if (fwrite(rgb, 3, (size_t)width * height, f) !=
+	    (size_t)width * height)
+		ret = -1;
+	if (fclose(f))
+		ret = -1;
+
+	return ret;
+}
+
+static unsigned int next_threads(unsigned int threads, unsigned int max)
+{
+	if (threads < max && threads * 2 > max)
+		return max;
+
+	return threads * 2;
+}
+
+static void usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+	       "  -W, --width N       frame width (default 1920)\n"
+	       "  -H, --height N      frame height (default 1080)\n"
+	       "  -r, --raw FILE      packed RAW10 input instead of the test scene\n"
+	       "  -s, --stride N      input stride in bytes (default: packed)\n"
+	       "  -c, --cfa PATTERN   rggb, grbg, gbrg or bggr (default rggb)\n"
+	       "  -b, --black N       black level, 10-bit (default 0)\n"
+	       "  -g, --wb R,G,B      white balance gains (default 1,1,1)\n"
+	       "      --bilinear      plain bilinear demosaic\n"
+	       "  -i, --iterations N  frames per measurement (default 30)\n"
+	       "  -j, --threads N     maximum threads (default: online CPUs)\n"
+	       "  -o, --output FILE   write the result as PPM\n",
+	       argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "raw", required_argument, NULL, 'r' },
+		{ "stride", required_argument, NULL, 's' },
+		{ "cfa", required_argument, NULL, 'c' },
+		{ "black", required_argument, NULL, 'b' },
+		{ "wb", required_argument, NULL, 'g' },
+		{ "bilinear", no_argument, NULL, 'B' },
+		{ "iterations", required_argument, NULL, 'i' },
+		{ "threads", required_argument, NULL, 'j' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static const unsigned int widths[] = {
+		2, 3, 8, 9, 15, 16, 17, 33, 640, 1921,
+	};
+	const struct isp_ops * const *list;
+	const char *raw = NULL, *output = NULL;
+	unsigned int width = 1920, height = 1080, stride = 0, iterations = 30;
+	unsigned int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int threads, i, w;
+	struct isp_params params;
+	enum isp_cfa cfa = ISP_CFA_RGGB;
+	uint8_t *src, *rgb;
+	int failed = 0;
+	int c;
+
+	isp_params_default(&params, cfa);
+
+	while ((c = getopt_long(argc, argv, "W:H:r:s:c:b:g:i:j:o:h", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'W':
+			width = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			height = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			raw = optarg;
+			break;
+		case 's':
+			stride = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			for (i = 0; i < 4; i++)
+				if (!strcmp(optarg, cfa_names[i]))
+					break;
+			if (i == 4) {
+				usage(argv[0]);
+				return 1;
+			}
+			cfa = i;
+			break;
+		case 'b':
+			params.black_level = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			if (sscanf(optarg, "%f,%f,%f", &params.wb_gain[0],
+				   &params.wb_gain[1], &params.wb_gain[2]) != 3) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'B':
+			params.demosaic = ISP_DEMOSAIC_BILINEAR;
+			break;
+		case 'i':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	params.cfa = cfa;
+	if (!stride)
+		stride = raw_row_bytes(RAW_PACKED10, width);
+	if (width < 2 || height < 2 || !iterations || !max_threads ||
+	    stride < raw_row_bytes(RAW_PACKED10, width)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	list = isp_ops_list();
+
+	for (i = 0; list[i]; i++) {
+		for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+			int ret = verify(list[i], widths[w]);
+
+			if (ret) {
+				fprintf(stderr, "%s: mismatch at width %u (0x%x)\n",
+					list[i]->name, widths[w], ret);
+				failed = 1;
+			}
+		}
+	}
+	if (failed)
+		return 1;
+
+	src = malloc((size_t)stride * height);
+	rgb = malloc((size_t)width * 3 * height);
+	if (!src || !rgb) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	if (raw) {
+		FILE *f = fopen(raw, "rb");
+
+		if (!f || fread(src, stride, height, f) != height) {
+			fprintf(stderr, "%s: cannot read %ux%u frame\n", raw,
+				width, height);
+			return 1;
+		}
+		fclose(f);
+	} else {
+		synth_raw10(src, stride, width, height, cfa,
+			    params.black_level);
+	}
+
+	printf("%ux%u RAW10 %s, kernels: %s\n", width, height, cfa_names[cfa],
+	       isp_ops_best()->name);
+	printf("%-6s %8s %10s %10s %10s\n", "impl", "threads", "ms/frame",
+	       "fps", "Mpix/s");
+
+	for (threads = 1; threads <= max_threads;
+	     threads = next_threads(threads, max_threads)) {
+		struct workpool *pool = workpool_create(threads);
+		struct isp *isp;
+
+		isp = pool ? isp_create(&params, width, height, RAW_PACKED10,
+					10, pool) : NULL;
+		if (!isp) {
+			fprintf(stderr, "failed to set up the pipeline\n");
+			return 1;
+		}
+
+		for (i = 0; list[i]; i++) {
+			uint64_t start;
+			double t;
+			unsigned int n;
+
+			/* The scalar kernels only as a single-thread baseline. */
+			if (list[i] == &isp_ops_c && threads > 1)
+				continue;
+
+			isp_set_ops(isp, list[i]);
+			start = now_ns();
+			for (n = 0; n < iterations; n++)
+				isp_process(isp, src, stride, rgb, width * 3);
+			t = (now_ns() - start) / 1e9 / iterations;
+
+			printf("%-6s %8u %10.3f %10.1f %10.1f\n", list[i]->name,
+			       workpool_threads(pool), t * 1e3, 1 / t,
+			       (double)width * height / t / 1e6);
+		}
+
+		isp_destroy(isp);
+		workpool_destroy(pool);
+	}
+
+	if (output && write_ppm(output, rgb, width, height) < 0)
+		return 1;
+
+	free(src);
+	free(rgb);
+
+	return 0;
+}
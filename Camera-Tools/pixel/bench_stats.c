@@ -0,0 +1,307 @@
+/*
+ * bench_stats - verify and time the 3A statistics kernels
+ *
+ * Checks the SIMD kernels against the scalar ones on random rows and on
+ * whole frames for every CFA, then times full frames at several row
+ * steps. The input is a synthetic RAW10 scene, a horizontal ramp with a
+ * colour cast of R x0.5 and B x0.7 (so grey world should answer gains of
+ * about 2.0 and 1.43), or a raw frame dumped with camd_cat.
+ *
+ *	bench_stats
+ *	bench_stats -r frame.raw -W 1920 -H 1080 -c rggb -b 60
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raw_stats.h"
+
+static const char * const cfa_names[] = {
+	[ISP_CFA_RGGB] = "rggb",
+	[ISP_CFA_GRBG] = "grbg",
+	[ISP_CFA_GBRG] = "gbrg",
+	[ISP_CFA_BGGR] = "bggr",
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Run both row kernels of @ops and of the scalar set on random rows. */
+static int verify_rows(const struct raw_stats_ops *ops, unsigned int blocks)
+{
+	unsigned int len = 2 * blocks + RAW_STATS_SLACK;
+	struct raw_stats_acc a, b;
+	uint8_t *rg, *gb, *ya, *yb;
+	unsigned int i;
+	int ret = 0;
+
+	rg = malloc(len);
+	gb = malloc(len);
+	ya = calloc(len, 1);
+	yb = calloc(len, 1);
+	for (i = 0; i < len; i++) {
+		rg[i] = rand();
+		gb[i] = rand();
+	}
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	raw_stats_ops_c.bin(rg, gb, ya, blocks, 16, 200, &a);
+	ops->bin(rg, gb, yb, blocks, 16, 200, &b);
+	if (memcmp(ya, yb, blocks) || memcmp(&a, &b, sizeof(a)))
+		ret |= 1;
+
+	if (raw_stats_ops_c.sum(rg, blocks) != ops->sum(rg, blocks))
+		ret |= 2;
+
+	free(rg);
+	free(gb);
+	free(ya);
+	free(yb);
+
+	return ret;
+}
+
+/* Horizontal ramp with a colour cast, mosaicked and packed as RAW10. */
+static void synth_raw10(uint8_t *dst, unsigned int stride, unsigned int width,
+			unsigned int height, enum isp_cfa cfa,
+			unsigned int black)
+{
+	static const float cast[3] = { 0.5f, 1.0f, 0.7f };
+	/* Channel at (y & 1, x & 1) for each CFA. */
+	static const uint8_t site[4][2][2] = {
+		[ISP_CFA_RGGB] = { { 0, 1 }, { 1, 2 } },
+		[ISP_CFA_GRBG] = { { 1, 0 }, { 2, 1 } },
+		[ISP_CFA_GBRG] = { { 1, 2 }, { 0, 1 } },
+		[ISP_CFA_BGGR] = { { 2, 1 }, { 1, 0 } },
+	};
+	unsigned int range = 1023 - black;
+	unsigned int x, y;
+
+	for (y = 0; y < height; y++) {
+		uint8_t *d = dst + (size_t)y * stride;
+
+		memset(d, 0, stride);
+		for (x = 0; x < width; x++) {
+			unsigned int c = site[cfa][y & 1][x & 1];
+			unsigned int p;
+
+			p = black + cast[c] * range * 0.9f * x / width;
+			d[x / 4 * 5 + x % 4] = p >> 2;
+			d[x / 4 * 5 + 4] |= (p & 3) << (x % 4 * 2);
+		}
+	}
+}
+
+static void usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+	       "  -W, --width N       frame width (default 1920)\n"
+	       "  -H, --height N      frame height (default 1080)\n"
+	       "  -r, --raw FILE      packed RAW10 input instead of the test scene\n"
+	       "  -s, --stride N      input stride in bytes (default: packed)\n"
+	       "  -c, --cfa PATTERN   rggb, grbg, gbrg or bggr (default rggb)\n"
+	       "  -b, --black N       black level, 10-bit (default 0)\n"
+	       "  -i, --iterations N  frames per measurement (default 200)\n",
+	       argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "raw", required_argument, NULL, 'r' },
+		{ "stride", required_argument, NULL, 's' },
+		{ "cfa", required_argument, NULL, 'c' },
+		{ "black", required_argument, NULL, 'b' },
+		{ "iterations", required_argument, NULL, 'i' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static const unsigned int blocks[] = {
+		1, 2, 15, 16, 17, 31, 33, 320, 961,
+	};
+	static const unsigned int steps[] = { 1, 2, 4, 8 };
+	const struct raw_stats_ops * const *list;
+	const char *raw = NULL;
+	unsigned int width = 1920, height = 1080, stride = 0, iterations = 200;
+	unsigned int black = 0, i, j;
+	enum isp_cfa cfa = ISP_CFA_RGGB;
+	struct raw_stats_engine *engine;
+	struct raw_stats_config cfg;
+	struct raw_stats ref, stats;
+	float gains[3];
+	uint8_t *src;
+	int failed = 0;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "W:H:r:s:c:b:i:h", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'W':
+			width = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			height = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			raw = optarg;
+			break;
+		case 's':
+			stride = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			for (i = 0; i < 4; i++)
+				if (!strcmp(optarg, cfa_names[i]))
+					break;
+			if (i == 4) {
+				usage(argv[0]);
+				return 1;
+			}
+			cfa = i;
+			break;
+		case 'b':
+			black = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!stride)
+		stride = raw_row_bytes(RAW_PACKED10, width);
+	if (width < 64 || height < 48 || !iterations || black > 1023 ||
+	    stride < raw_row_bytes(RAW_PACKED10, width)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	list = raw_stats_ops_list();
+
+	for (i = 0; list[i]; i++) {
+		for (j = 0; j < sizeof(blocks) / sizeof(blocks[0]); j++) {
+			int ret = verify_rows(list[i], blocks[j]);
+
+			if (ret) {
+				fprintf(stderr, "%s: mismatch at %u blocks (0x%x)\n",
+					list[i]->name, blocks[j], ret);
+				failed = 1;
+			}
+		}
+	}
+
+	src = malloc((size_t)stride * height);
+	if (!src) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	/* Whole frames, odd width, every CFA: the frame driver's offsets. */
+	for (j = 0; j < 4; j++) {
+		raw_stats_config_default(&cfg, width - 1, height, RAW_PACKED10,
+					 10, j);
+		cfg.black_level = 64;
+		synth_raw10(src, stride, width - 1, height, j, 64);
+		engine = raw_stats_create(&cfg);
+		if (!engine) {
+			fprintf(stderr, "failed to set up the engine\n");
+			return 1;
+		}
+
+		raw_stats_set_ops(engine, &raw_stats_ops_c);
+		raw_stats_process(engine, src, stride, &ref);
+		for (i = 0; list[i]; i++) {
+			raw_stats_set_ops(engine, list[i]);
+			raw_stats_process(engine, src, stride, &stats);
+			if (memcmp(&ref, &stats, sizeof(ref))) {
+				fprintf(stderr, "%s: frame mismatch for %s\n",
+					list[i]->name, cfa_names[j]);
+				failed = 1;
+			}
+		}
+		raw_stats_destroy(engine);
+	}
+	if (failed)
+		return 1;
+
+	if (raw) {
+		FILE *f = fopen(raw, "rb");
+
+		if (!f || fread(src, stride, height, f) != height) {
+			fprintf(stderr, "%s: cannot read %ux%u frame\n", raw,
+				width, height);
+			return 1;
+		}
+		fclose(f);
+	} else {
+		synth_raw10(src, stride, width, height, cfa, black);
+	}
+
+	raw_stats_config_default(&cfg, width, height, RAW_PACKED10, 10, cfa);
+	cfg.black_level = black;
+
+	printf("%ux%u RAW10 %s, kernels: %s\n", width, height, cfa_names[cfa],
+	       raw_stats_ops_best()->name);
+	printf("%-6s %6s %10s %10s\n", "impl", "step", "ms/frame", "fps");
+
+	for (j = 0; j < sizeof(steps) / sizeof(steps[0]); j++) {
+		cfg.row_step = steps[j];
+		engine = raw_stats_create(&cfg);
+		if (!engine) {
+			fprintf(stderr, "failed to set up the engine\n");
+			return 1;
+		}
+
+		for (i = 0; list[i]; i++) {
+			uint64_t start;
+			double t;
+			unsigned int n;
+
+			raw_stats_set_ops(engine, list[i]);
+			start = now_ns();
+			for (n = 0; n < iterations; n++)
+				raw_stats_process(engine, src, stride, &stats);
+			t = (now_ns() - start) / 1e9 / iterations;
+
+			printf("%-6s %6u %10.3f %10.0f\n", list[i]->name,
+			       steps[j], t * 1e3, 1 / t);
+		}
+
+		raw_stats_destroy(engine);
+	}
+
+	raw_stats_grey_world(&stats, gains);
+	printf("mean %.1f, p50 %u, p99 %u, centre zone %.1f, "
+	       "grey world R %.2f B %.2f\n", raw_stats_mean(&stats),
+	       raw_stats_percentile(&stats, 500),
+	       raw_stats_percentile(&stats, 990),
+	       raw_stats_zone_mean(&stats, stats.zones_x / 2,
+				   stats.zones_y / 2),
+	       gains[0], gains[2]);
+
+	free(src);
+
+	return 0;
+}
@@ -0,0 +1,486 @@
+/*
+ * bench_stereo - verify and time stereo rectification and disparity
+ *
+ * Checks the SIMD row kernels against the scalar ones, then times
+ * rectification and disparity at 640x480 and 1280x960 (the OV5645
+ * StereoCamera binned and full modes) with 1, 2, 4, ... threads, checking
+ * each implementation's disparity map against the scalar one. The input
+ * is a synthetic pair with known disparity, a box in front of a tilted
+ * plane, whose error is reported; or a pair dumped with camd_cat from a
+ * stereo camd (UYVY, left then right). Without -K the remap LUTs are the
+ * identity, which must reproduce the input exactly; -o writes the last
+ * disparity map as a PGM.
+ *
+ *	bench_stereo -j 4 -o disp.pgm
+ *	bench_stereo -r pair.uyvy -W 1280 -H 960 -K ov5645.calib -o disp.pgm
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stereo.h"
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = rand();
+}
+
+/* Column sums below @max, in coarse steps when @ties to force equal costs. */
+static void fill_sums(uint16_t *buf, size_t len, unsigned int max, int ties)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = ties ? rand() % 4 * (max / 4) : rand() % (max + 1);
+}
+
+/* Run both kernels of @ops and of the scalar set on random rows and sums. */
+static int verify(const struct stereo_ops *ops, unsigned int count,
+		  unsigned int ndisp, unsigned int half)
+{
+	const struct stereo_ops *ref = &stereo_ops_c;
+	unsigned int ncol = count + 2 * half, len = ncol + ndisp;
+	unsigned int max = (2 * half + 1) * 255;
+	size_t sums = (size_t)ncol * ndisp;
+	uint8_t *rows = malloc(len * 4);
+	uint16_t *a = malloc(sums * 2), *b = malloc(sums * 2);
+	uint16_t *cost = malloc(ndisp * 2);
+	uint16_t *da = malloc(count * 2), *db = malloc(count * 2);
+	const uint8_t *l = rows, *ls = rows + len;
+	const uint8_t *r = rows + 2 * len + ncol - 1;
+	const uint8_t *rs = rows + 3 * len + ncol - 1;
+	int ret = 0, ties;
+
+	fill_random(rows, len * 4);
+
+	fill_sums(a, sums, max, 0);
+	memcpy(b, a, sums * 2);
+	ref->sad_row(a, l, r, NULL, NULL, ncol, ndisp);
+	ops->sad_row(b, l, r, NULL, NULL, ncol, ndisp);
+	if (memcmp(a, b, sums * 2))
+		ret |= 1;
+
+	ref->sad_row(a, l, r, ls, rs, ncol, ndisp);
+	ops->sad_row(b, l, r, ls, rs, ncol, ndisp);
+	if (memcmp(a, b, sums * 2))
+		ret |= 2;
+
+	for (ties = 0; ties < 2; ties++) {
+		fill_sums(a, sums, max, ties);
+		ref->match_row(a, cost, da, count, ndisp, half, 10);
+		ops->match_row(a, cost, db, count, ndisp, half, 10);
+		if (memcmp(da, db, count * 2))
+			ret |= 4;
+	}
+
+	free(rows);
+	free(a);
+	free(b);
+	free(cost);
+	free(da);
+	free(db);
+
+	return ret;
+}
+
+/* A box in front of a plane tilting towards the camera at the bottom. */
+static float scene_fg(unsigned int ndisp)
+{
+	return ndisp * 0.7f;
+}
+
+static float scene_bg(unsigned int y, unsigned int height, unsigned int ndisp)
+{
+	return ndisp * (0.15f + 0.4f * y / height);
+}
+
+static int scene_in_box(float x, unsigned int y, unsigned int width,
+			unsigned int height)
+{
+	return x >= width / 4 && x < width / 2 && y >= height / 4 &&
+	       y < height * 3 / 4;
+}
+
+/*
+ * Rectified Y8 pair. Each row is a random texture, linear between
+ * integer positions so that the sub-pixel shifts of the plane are exact.
+ * @truth is the left view's disparity, Q4.
+ */
+static void synth_pair(uint8_t *left, uint8_t *right, uint16_t *truth,
+		       unsigned int width, unsigned int height,
+		       unsigned int ndisp)
+{
+	unsigned int len = width + ndisp + 2;
+	uint8_t *tex = malloc(len);
+	unsigned int x, y;
+
+	for (y = 0; y < height; y++) {
+		uint8_t *l = left + (size_t)y * width;
+		uint8_t *r = right + (size_t)y * width;
+		uint16_t *t = truth + (size_t)y * width;
+		float bg = scene_bg(y, height, ndisp), fg = scene_fg(ndisp);
+
+		fill_random(tex, len);
+
+		for (x = 0; x < width; x++) {
+			float d = scene_in_box(x, y, width, height) ? fg : bg;
+			float pos;
+			unsigned int i;
+
+			l[x] = tex[x];
+			t[x] = lrintf(d * 16);
+
+			/* The box hides the plane in the right view too. */
+			d = scene_in_box(x + fg, y, width, height) ? fg : bg;
+			pos = x + d;
+			i = pos;
+			r[x] = lrintf(tex[i] + (tex[i + 1] - tex[i]) *
+				      (pos - i));
+		}
+	}
+
+	free(tex);
+}
+
+/* Valid share and, of the valid ones, the share within a pixel. */
+static void accuracy(const uint16_t *disp, const uint16_t *truth,
+		     unsigned int width, unsigned int height,
+		     const struct stereo_params *params)
+{
+	unsigned int half = params->block / 2;
+	unsigned long total = 0, valid = 0, good = 0;
+	unsigned int x, y;
+
+	for (y = half; y < height - half; y++) {
+		for (x = params->num_disparities - 1 + half; x < width - half;
+		     x++) {
+			size_t i = (size_t)y * width + x;
+
+			total++;
+			if (disp[i] == STEREO_INVALID)
+				continue;
+			valid++;
+			if (abs((int)disp[i] - truth[i]) <= 16)
+				good++;
+		}
+	}
+
+	printf("valid %.1f%%, within 1 px %.1f%% of those\n",
+	       100.0 * valid / total, valid ? 100.0 * good / valid : 0);
+}
+
+static int write_pgm(const char *path, const uint16_t *disp,
+		     unsigned int width, unsigned int height,
+		     unsigned int ndisp)
+{
+	FILE *f = fopen(path, "wb");
+	size_t i, size = (size_t)width * height;
+	int ret = 0;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	fprintf(f, "P5\n%u %u\n255\n", width, height);
+	for (i = 0; i < size; i++)
+		fputc(disp[i] == STEREO_INVALID ? 0 :
+		      disp[i] * 255 / (ndisp * 16), f);
+	if (fclose(f))
+		ret = -1;
+
+	return ret;
+}
+
+/* Identity remap: K = P, no distortion, no rotation. */
+static void identity_calib(struct stereo_calib *calib, unsigned int width,
+			   unsigned int height)
+{
+	unsigned int side;
+
+	memset(calib, 0, sizeof(*calib));
+	calib->width = width;
+	calib->height = height;
+	for (side = 0; side < 2; side++) {
+		struct stereo_camera *cam = &calib->cam[side];
+
+		cam->K[0] = cam->K[1] = width;
+		cam->K[2] = (width - 1) / 2.0;
+		cam->K[3] = (height - 1) / 2.0;
+		memcpy(cam->P, cam->K, sizeof(cam->P));
+		cam->R[0] = cam->R[4] = cam->R[8] = 1;
+	}
+}
+
+static unsigned int next_threads(unsigned int threads, unsigned int max)
+{
+	if (threads < max && threads * 2 > max)
+		return max;
+
+	return threads * 2;
+}
+
+static void usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+	       "  -W, --width N         frame width (default: 640 and 1280)\n"
+	       "  -H, --height N        frame height (default: 480 and 960)\n"
+	       "  -r, --raw FILE        UYVY pair from camd_cat instead of the test scene\n"
+	       "  -K, --calib FILE      calibration (default: identity remap)\n"
+	       "  -d, --disparities N   search range (default: a tenth of the width)\n"
+	       "  -b, --block N         window size, odd, 3 to 11 (default 9)\n"
+	       "  -u, --uniqueness N    uniqueness margin in percent (default 10)\n"
+	       "  -i, --iterations N    frames per measurement (default 10)\n"
+	       "  -j, --threads N       maximum threads (default: online CPUs)\n"
+	       "  -o, --output FILE     write the last disparity map as PGM\n",
+	       argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "raw", required_argument, NULL, 'r' },
+		{ "calib", required_argument, NULL, 'K' },
+		{ "disparities", required_argument, NULL, 'd' },
+		{ "block", required_argument, NULL, 'b' },
+		{ "uniqueness", required_argument, NULL, 'u' },
+		{ "iterations", required_argument, NULL, 'i' },
+		{ "threads", required_argument, NULL, 'j' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static const unsigned int counts[] = { 1, 2, 15, 64, 97 };
+	static const unsigned int ndisps[] = { 16, 48, 64, 128, 256 };
+	static unsigned int sizes[][2] = { { 640, 480 }, { 1280, 960 } };
+	const struct stereo_ops * const *list;
+	const char *raw = NULL, *calib_path = NULL, *output = NULL;
+	unsigned int width = 0, height = 0, iterations = 10;
+	unsigned int ndisp = 0, block = 9, uniqueness = 10;
+	unsigned int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int num_sizes = 2, threads, i, j, k, s;
+	struct stereo_calib calib;
+	int failed = 0;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "W:H:r:K:d:b:u:i:j:o:h", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'W':
+			width = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			height = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			raw = optarg;
+			break;
+		case 'K':
+			calib_path = optarg;
+			break;
+		case 'd':
+			ndisp = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			block = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			uniqueness = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (width || height || raw) {
+		sizes[0][0] = width;
+		sizes[0][1] = height;
+		num_sizes = 1;
+	}
+	if (!iterations || !max_threads || (num_sizes == 1 &&
+					    (!width || !height))) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (calib_path && stereo_calib_load(calib_path, &calib) < 0)
+		return 1;
+
+	list = stereo_ops_list();
+
+	for (i = 0; list[i]; i++)
+		for (j = 0; j < sizeof(counts) / sizeof(counts[0]); j++)
+			for (k = 0; k < sizeof(ndisps) / sizeof(ndisps[0]); k++)
+				for (s = 1; s <= STEREO_MAX_BLOCK / 2; s++) {
+					int ret = verify(list[i], counts[j],
+							 ndisps[k], s);
+
+					if (ret) {
+						fprintf(stderr, "%s: mismatch at %u columns, %u disparities, block %u (0x%x)\n",
+							list[i]->name,
+							counts[j], ndisps[k],
+							2 * s + 1, ret);
+						failed = 1;
+					}
+				}
+	if (failed)
+		return 1;
+
+	for (s = 0; s < num_sizes; s++) {
+		unsigned int w = sizes[s][0], h = sizes[s][1];
+		size_t size = (size_t)w * h;
+		enum stereo_src fmt = raw ? STEREO_SRC_UYVY : STEREO_SRC_Y8;
+		unsigned int stride = raw ? w * 2 : w;
+		struct stereo_params params;
+		uint8_t *left, *right;
+		uint16_t *truth, *disp, *ref;
+
+		stereo_params_default(&params, w);
+		if (ndisp)
+			params.num_disparities = ndisp;
+		params.block = block;
+		params.uniqueness = uniqueness;
+
+		left = malloc(size * 2);
+		right = malloc(size * 2);
+		truth = malloc(size * 2);
+		disp = malloc(size * 2);
+		ref = malloc(size * 2);
+		if (!left || !right || !truth || !disp || !ref) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+
+		if (raw) {
+			FILE *f = fopen(raw, "rb");
+
+			if (!f || fread(left, stride, h, f) != h ||
+			    fread(right, stride, h, f) != h) {
+				fprintf(stderr, "%s: cannot read %ux%u pair\n",
+					raw, w, h);
+				return 1;
+			}
+			fclose(f);
+		} else {
+			synth_pair(left, right, truth, w, h,
+				   params.num_disparities);
+		}
+		if (!calib_path)
+			identity_calib(&calib, w, h);
+
+		printf("%ux%u %s, %u disparities, block %u, kernels: %s\n",
+		       w, h, raw ? "UYVY" : "Y8", params.num_disparities,
+		       params.block, stereo_ops_best()->name);
+		printf("%-6s %8s %10s %10s %10s %10s\n", "impl", "threads",
+		       "rectify", "disparity", "fps", "Mpix/s");
+
+		for (threads = 1; threads <= max_threads;
+		     threads = next_threads(threads, max_threads)) {
+			struct workpool *pool = workpool_create(threads);
+			struct stereo *st;
+
+			st = pool ? stereo_create(&calib, &params, w, h,
+						  pool) : NULL;
+			if (!st) {
+				fprintf(stderr, "cannot set up %ux%u with %u disparities and block %u\n",
+					w, h, params.num_disparities,
+					params.block);
+				return 1;
+			}
+
+			for (i = 0; list[i]; i++) {
+				uint64_t start, mid;
+				double tr, td;
+				unsigned int n;
+
+				/* The scalar kernels only as the reference. */
+				if (list[i] == &stereo_ops_c && threads > 1)
+					continue;
+
+				stereo_set_ops(st, list[i]);
+				start = now_ns();
+				for (n = 0; n < iterations; n++)
+					stereo_rectify(st, fmt, left, stride,
+						       right, stride);
+				mid = now_ns();
+				for (n = 0; n < iterations; n++)
+					stereo_disparity(st, disp, w);
+				tr = (mid - start) / 1e9 / iterations;
+				td = (now_ns() - mid) / 1e9 / iterations;
+
+				printf("%-6s %8u %10.3f %10.3f %10.1f %10.1f\n",
+				       list[i]->name, workpool_threads(pool),
+				       tr * 1e3, td * 1e3, 1 / (tr + td),
+				       (double)size / (tr + td) / 1e6);
+
+				if (list[i] == &stereo_ops_c) {
+					memcpy(ref, disp, size * 2);
+				} else if (memcmp(ref, disp, size * 2)) {
+					fprintf(stderr, "%s: disparity differs from the scalar one\n",
+						list[i]->name);
+					failed = 1;
+				}
+			}
+
+			if (!calib_path && !raw &&
+			    memcmp(stereo_rectified(st, STEREO_LEFT), left,
+				   size)) {
+				fprintf(stderr, "identity remap changed the image\n");
+				failed = 1;
+			}
+
+			stereo_destroy(st);
+			workpool_destroy(pool);
+		}
+
+		if (!raw && !calib_path)
+			accuracy(disp, truth, w, h, &params);
+		if (output && s == num_sizes - 1 &&
+		    write_pgm(output, disp, w, h, params.num_disparities) < 0)
+			failed = 1;
+
+		free(left);
+		free(right);
+		free(truth);
+		free(disp);
+		free(ref);
+	}
+
+	return failed;
+}
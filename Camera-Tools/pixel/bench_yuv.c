@@ -0,0 +1,253 @@
+/*
+ * bench_yuv - verify and time the UYVY conversion kernels
+ *
+ * Checks every implementation against the scalar kernels, then times each
+ * conversion on a full frame (2592x1944 by default, the OV5645 full
+ * resolution) with 1, 2, 4, ... threads up to -j.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "yuv_convert.h"
+
+static const char * const conv_names[] = {
+	[YUV_CONV_NV12] = "nv12",
+	[YUV_CONV_I420] = "i420",
+	[YUV_CONV_Y] = "y",
+	[YUV_CONV_NV12_HALF] = "nv12-half",
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = rand();
+}
+
+/* Run every kernel of @ops and of the scalar set on 4 rows of @width. */
+static int verify(const struct yuv_convert_ops *ops, unsigned int width)
+{
+	const struct yuv_convert_ops *ref = &yuv_convert_c;
+	size_t len = width * 2;
+	uint8_t *src = malloc(len * 4);
+	uint8_t *out[2][4];
+	const uint8_t *rows[4];
+	unsigned int i;
+	int ret = 0;
+
+	fill_random(src, len * 4);
+	for (i = 0; i < 4; i++)
+		rows[i] = src + i * len;
+	for (i = 0; i < 4; i++) {
+		out[0][i] = calloc(1, width);
+		out[1][i] = calloc(1, width);
+	}
+
+	for (i = 0; i < 2; i++) {
+		const struct yuv_convert_ops *o = i ? ops : ref;
+		uint8_t **d = out[i];
+
+		o->y(rows[0], d[0], width);
+	}
+	if (memcmp(out[0][0], out[1][0], width))
+		ret |= 1;
+
+	for (i = 0; i < 2; i++) {
+		const struct yuv_convert_ops *o = i ? ops : ref;
+		uint8_t **d = out[i];
+
+		o->nv12(rows[0], rows[1], d[0], d[1], d[2], width);
+	}
+	if (memcmp(out[0][0], out[1][0], width) ||
+	    memcmp(out[0][1], out[1][1], width) ||
+	    memcmp(out[0][2], out[1][2], width))
+		ret |= 2;
+
+	for (i = 0; i < 2; i++) {
+		const struct yuv_convert_ops *o = i ? ops : ref;
+		uint8_t **d = out[i];
+
+		o->i420(rows[0], rows[1], d[0], d[1], d[2], d[3], width);
+	}
+	if (memcmp(out[0][0], out[1][0], width) ||
+	    memcmp(out[0][1], out[1][1], width) ||
+	    memcmp(out[0][2], out[1][2], width / 2) ||
+	    memcmp(out[0][3], out[1][3], width / 2))
+		ret |= 4;
+
+	if (width % 4 == 0) {
+		for (i = 0; i < 2; i++) {
+			const struct yuv_convert_ops *o = i ? ops : ref;
+			uint8_t **d = out[i];
+
+			o->nv12_half(rows, d[0], d[1], d[2], width);
+		}
+		if (memcmp(out[0][0], out[1][0], width / 2) ||
+		    memcmp(out[0][1], out[1][1], width / 2) ||
+		    memcmp(out[0][2], out[1][2], width / 2))
+			ret |= 8;
+	}
+
+	for (i = 0; i < 4; i++) {
+		free(out[0][i]);
+		free(out[1][i]);
+	}
+	free(src);
+
+	return ret;
+}
+
+/* 1, 2, 4, ... and always the exact maximum as the last step. */
+static unsigned int next_threads(unsigned int threads, unsigned int max)
+{
+	if (threads < max && threads * 2 > max)
+		return max;
+
+	return threads * 2;
+}
+
+static void usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+	       "  -W, --width N       frame width (default 2592)\n"
+	       "  -H, --height N      frame height (default 1944)\n"
+	       "  -i, --iterations N  frames per measurement (default 30)\n"
+	       "  -j, --threads N     maximum threads (default: online CPUs)\n",
+	       argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "iterations", required_argument, NULL, 'i' },
+		{ "threads", required_argument, NULL, 'j' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static const unsigned int widths[] = {
+		2, 4, 14, 16, 30, 36, 62, 68, 640, 1278, 1920, 2592,
+	};
+	const struct yuv_convert_ops * const *list;
+	unsigned int width = 2592, height = 1944, iterations = 30;
+	unsigned int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int threads, i, w, conv;
+	struct yuv_planes planes;
+	uint8_t *src, *dst;
+	int failed = 0;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "W:H:i:j:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'W':
+			width = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			height = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!width || !height || width % 4 || height % 4 || !iterations ||
+	    !max_threads) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	list = yuv_convert_list();
+
+	for (i = 0; list[i]; i++) {
+		for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+			int ret = verify(list[i], widths[w]);
+
+			if (ret) {
+				fprintf(stderr, "%s: mismatch at width %u (0x%x)\n",
+					list[i]->name, widths[w], ret);
+				failed = 1;
+			}
+		}
+	}
+	if (failed)
+		return 1;
+
+	src = malloc((size_t)width * 2 * height);
+	dst = malloc(yuv_planes_layout(YUV_CONV_NV12, width, height, NULL,
+				       &planes) * 2);
+	if (!src || !dst) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	fill_random(src, (size_t)width * 2 * height);
+
+	printf("%ux%u UYVY, kernels: %s\n", width, height,
+	       yuv_convert_best()->name);
+	printf("%-10s %8s %10s %10s %10s\n", "output", "threads", "ms/frame",
+	       "fps", "Mpix/s");
+
+	for (threads = 1; threads <= max_threads;
+	     threads = next_threads(threads, max_threads)) {
+		struct workpool *pool = workpool_create(threads);
+
+		if (!pool) {
+			fprintf(stderr, "failed to create %u threads\n", threads);
+			return 1;
+		}
+
+		for (conv = 0; conv <= YUV_CONV_NV12_HALF; conv++) {
+			uint64_t start;
+			double t;
+
+			yuv_planes_layout(conv, width, height, dst, &planes);
+
+			start = now_ns();
+			for (i = 0; i < iterations; i++)
+				yuv_convert_frame(pool, conv, src, width * 2,
+						  width, height, &planes);
+			t = (now_ns() - start) / 1e9 / iterations;
+
+			printf("%-10s %8u %10.3f %10.1f %10.1f\n",
+			       conv_names[conv], workpool_threads(pool),
+			       t * 1e3, 1 / t, (double)width * height / t / 1e6);
+		}
+
+		workpool_destroy(pool);
+	}
+
+	free(src);
+	free(dst);
+
+	return 0;
+}
@@ -0,0 +1,511 @@
+/*
+ * ISP-lite: scalar kernels, dispatch and the banded frame driver.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/videodev2.h>
+
+#include "isp_lite.h"
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+static inline uint16_t avg(uint16_t a, uint16_t b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static inline uint16_t absdiff(uint16_t a, uint16_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+void isp_wb_c(const uint16_t *in, uint16_t *out, unsigned int x,
+	      unsigned int width, uint16_t black, unsigned int shift,
+	      const uint16_t gains[2])
+{
+	for (; x < width; x++) {
+		uint16_t v = in[x] > black ? in[x] - black : 0;
+		uint32_t r;
+
+		v <<= shift;
+		r = (uint32_t)v * gains[x & 1] >> 16;
+		out[x] = r > ISP_MAX ? ISP_MAX : r;
+	}
+}
+
+void isp_demosaic_c(const uint16_t *r0, const uint16_t *r1,
+		    const uint16_t *r2, uint16_t *rgb[3], unsigned int x,
+		    unsigned int width, const struct isp_row *row,
+		    enum isp_demosaic mode)
+{
+	uint16_t *own = rgb[row->red_row ? 0 : 2];
+	uint16_t *other = rgb[row->red_row ? 2 : 0];
+	uint16_t *green = rgb[1];
+
+	for (; x < width; x++) {
+		const uint16_t *up = r0 + x, *mid = r1 + x, *down = r2 + x;
+		uint16_t h = avg(mid[-1], mid[1]);
+		uint16_t v = avg(up[0], down[0]);
+
+		if ((x & 1) == row->c_par) {
+			uint16_t dh = absdiff(mid[-1], mid[1]);
+			uint16_t dv = absdiff(up[0], down[0]);
+			uint16_t g = avg(h, v);
+
+			if (mode == ISP_DEMOSAIC_EDGE) {
+				if (dh < dv)
+					g = h;
+				else if (dv < dh)
+					g = v;
+			}
+
+			own[x] = mid[0];
+			green[x] = g;
+			other[x] = avg(avg(up[-1], up[1]),
+				       avg(down[-1], down[1]));
+		} else {
+			own[x] = h;
+			green[x] = mid[0];
+			other[x] = v;
+		}
+	}
+}
+
+void isp_ccm_c(uint16_t *rgb[3], unsigned int x, unsigned int width,
+	       const int16_t m[9])
+{
+	unsigned int c;
+
+	for (; x < width; x++) {
+		int in[3] = { rgb[0][x] << 3, rgb[1][x] << 3, rgb[2][x] << 3 };
+		int out[3];
+
+		/* Matches PMULHW: floor((a * b) / 65536). */
+		for (c = 0; c < 3; c++) {
+			int s = ((in[0] * m[c * 3 + 0]) >> 16) +
+				((in[1] * m[c * 3 + 1]) >> 16) +
+				((in[2] * m[c * 3 + 2]) >> 16);
+
+			out[c] = s < 0 ? 0 : s > ISP_MAX ? ISP_MAX : s;
+		}
+
+		rgb[0][x] = out[0];
+		rgb[1][x] = out[1];
+		rgb[2][x] = out[2];
+	}
+}
+
+static void isp_wb_row_c(const uint16_t *in, uint16_t *out,
+			 unsigned int width, uint16_t black,
+			 unsigned int shift, const uint16_t gains[2])
+{
+	isp_wb_c(in, out, 0, width, black, shift, gains);
+}
+
+static void isp_demosaic_row_c(const uint16_t *r0, const uint16_t *r1,
+			       const uint16_t *r2, uint16_t *rgb[3],
+			       unsigned int width, const struct isp_row *row,
+			       enum isp_demosaic mode)
+{
+	isp_demosaic_c(r0, r1, r2, rgb, 0, width, row, mode);
+}
+
+static void isp_ccm_row_c(uint16_t *rgb[3], unsigned int width,
+			  const int16_t m[9])
+{
+	isp_ccm_c(rgb, 0, width, m);
+}
+
+const struct isp_ops isp_ops_c = {
+	.name = "c",
+	.wb = isp_wb_row_c,
+	.demosaic = isp_demosaic_row_c,
+	.ccm = isp_ccm_row_c,
+};
+
+static const struct isp_ops *isp_impls[3];
+
+static void isp_ops_probe(void)
+{
+	unsigned int n = 0;
+
+	if (isp_impls[0])
+		return;
+
+	isp_impls[n++] = &isp_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		isp_impls[n++] = &isp_ops_sse2;
+#endif
+#if defined(__aarch64__)
+	isp_impls[n++] = &isp_ops_neon;
+#endif
+	isp_impls[n] = NULL;
+}
+
+const struct isp_ops * const *isp_ops_list(void)
+{
+	isp_ops_probe();
+
+	return isp_impls;
+}
+
+const struct isp_ops *isp_ops_best(void)
+{
+	static const struct isp_ops *best;
+	unsigned int i;
+
+	if (best)
+		return best;
+
+	isp_ops_probe();
+	for (i = 0; isp_impls[i]; i++)
+		best = isp_impls[i];
+
+	return best;
+}
+
+const struct isp_ops *isp_ops_find(const char *name)
+{
+	unsigned int i;
+
+	isp_ops_probe();
+	for (i = 0; isp_impls[i]; i++)
+		if (!strcmp(isp_impls[i]->name, name))
+			return isp_impls[i];
+
+	return NULL;
+}
+
+void isp_params_default(struct isp_params *params, enum isp_cfa cfa)
+{
+	unsigned int i;
+
+	memset(params, 0, sizeof(*params));
+	params->cfa = cfa;
+	params->demosaic = ISP_DEMOSAIC_EDGE;
+	for (i = 0; i < 3; i++) {
+		params->wb_gain[i] = 1.0f;
+		params->ccm[i][i] = 1.0f;
+	}
+}
+
+static const struct {
+	uint32_t fourcc;
+	enum isp_cfa cfa;
+	unsigned int bpp;
+} isp_bayer_formats[] = {
+	{ V4L2_PIX_FMT_SRGGB10, ISP_CFA_RGGB, 10 },
+	{ V4L2_PIX_FMT_SGRBG10, ISP_CFA_GRBG, 10 },
+	{ V4L2_PIX_FMT_SGBRG10, ISP_CFA_GBRG, 10 },
+	{ V4L2_PIX_FMT_SBGGR10, ISP_CFA_BGGR, 10 },
+	{ V4L2_PIX_FMT_SRGGB10P, ISP_CFA_RGGB, 10 },
+	{ V4L2_PIX_FMT_SGRBG10P, ISP_CFA_GRBG, 10 },
+	{ V4L2_PIX_FMT_SGBRG10P, ISP_CFA_GBRG, 10 },
+	{ V4L2_PIX_FMT_SBGGR10P, ISP_CFA_BGGR, 10 },
+	{ V4L2_PIX_FMT_SRGGB12, ISP_CFA_RGGB, 12 },
+	{ V4L2_PIX_FMT_SGRBG12, ISP_CFA_GRBG, 12 },
+	{ V4L2_PIX_FMT_SGBRG12, ISP_CFA_GBRG, 12 },
+	{ V4L2_PIX_FMT_SBGGR12, ISP_CFA_BGGR, 12 },
+};
+
+int isp_bayer_format(uint32_t fourcc, enum isp_cfa *cfa, unsigned int *bpp)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(isp_bayer_formats); i++) {
+		if (isp_bayer_formats[i].fourcc == fourcc) {
+			*cfa = isp_bayer_formats[i].cfa;
+			*bpp = isp_bayer_formats[i].bpp;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* Non-green colour and its column parity for even/odd rows. */
+static const struct isp_row isp_cfa_rows[4][2] = {
+	[ISP_CFA_RGGB] = { { 1, 0 }, { 0, 1 } },
+	[ISP_CFA_GRBG] = { { 1, 1 }, { 0, 0 } },
+	[ISP_CFA_GBRG] = { { 0, 1 }, { 1, 0 } },
+	[ISP_CFA_BGGR] = { { 0, 0 }, { 1, 1 } },
+};
+
+struct isp_band {
+	uint16_t *raw;			/* unpacked input row */
+	uint16_t *lines[3];		/* padded, element -1 valid */
+	uint16_t *rgb[3];
+};
+
+struct isp {
+	unsigned int width;
+	unsigned int height;
+	enum raw_packing packing;
+	unsigned int bpp;
+	struct workpool *pool;
+	const struct isp_ops *ops;
+	const struct raw_unpack_ops *unpack;
+
+	struct isp_params params;
+	uint16_t black;
+	uint16_t gains[3];		/* Q12 */
+	int16_t ccm[9];			/* Q13 */
+	uint8_t gamma[ISP_MAX + 1];
+
+	/* Current frame. */
+	const uint8_t *src;
+	unsigned int src_stride;
+	uint8_t *dst;
+	unsigned int dst_stride;
+
+	unsigned int num_bands;
+	struct isp_band bands[];
+};
+
+static uint16_t isp_q(float v, float one, float max)
+{
+	v = v * one + 0.5f;
+
+	return v < 0 ? 0 : v > max ? max : v;
+}
+
+static float isp_srgb(float v)
+{
+	return v <= 0.0031308f ? v * 12.92f :
+				 1.055f * powf(v, 1 / 2.4f) - 0.055f;
+}
+
+int isp_set_params(struct isp *isp, const struct isp_params *params)
+{
+	unsigned int max = (1 << isp->bpp) - 1;
+	float norm;
+	unsigned int i, j;
+
+	if (params->cfa > ISP_CFA_BGGR || params->black_level >= max ||
+	    params->gamma < 0)
+		return -EINVAL;
+
+	isp->params = *params;
+	isp->black = params->black_level;
+
+	/*
+	 * With a shift of 16 - bpp, wb() scales to 12 bits at unity Q12 gain.
+	 * Fold the stretch of [black, max] to the full range into the gains.
+	 */
+	norm = (float)max / (max - params->black_level);
+	for (i = 0; i < 3; i++)
+		isp->gains[i] = isp_q(params->wb_gain[i] * norm, 4096, 65535);
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			float v = params->ccm[i][j] * 8192;
+
+			v = v < -32767 ? -32767 : v > 32767 ? 32767 : v;
+			isp->ccm[i * 3 + j] = v < 0 ? v - 0.5f : v + 0.5f;
+		}
+	}
+
+	for (i = 0; i <= ISP_MAX; i++) {
+		float v = (float)i / ISP_MAX;
+
+		v = params->gamma ? powf(v, 1 / params->gamma) : isp_srgb(v);
+		isp->gamma[i] = isp_q(v, 255, 255);
+	}
+
+	return 0;
+}
+
+void isp_set_ops(struct isp *isp, const struct isp_ops *ops)
+{
+	isp->ops = ops ? ops : isp_ops_best();
+}
+
+struct isp *isp_create(const struct isp_params *params, unsigned int width,
+		       unsigned int height, enum raw_packing packing,
+		       unsigned int bpp, struct workpool *pool)
+{
+	unsigned int line = width + 2 + ISP_LINE_SLACK;
+	unsigned int i, j, num_bands;
+	struct isp *isp;
+
+	if (width < 2 || height < 2 || (bpp != 10 && bpp != 12) ||
+	    (packing == RAW_PACKED10 && bpp != 10) ||
+	    (packing == RAW_PACKED12 && bpp != 12))
+		return NULL;
+
+	num_bands = workpool_threads(pool);
+	if (num_bands > height / 2)
+		num_bands = height / 2;
+
+	isp = calloc(1, sizeof(*isp) + num_bands * sizeof(isp->bands[0]));
+	if (!isp)
+		return NULL;
+
+	isp->width = width;
+	isp->height = height;
+	isp->packing = packing;
+	isp->bpp = bpp;
+	isp->pool = pool;
+	isp->ops = isp_ops_best();
+	isp->unpack = raw_unpack_best();
+	isp->num_bands = num_bands;
+
+	if (isp_set_params(isp, params) < 0)
+		goto error;
+
+	for (i = 0; i < num_bands; i++) {
+		struct isp_band *band = &isp->bands[i];
+
+		band->raw = calloc(line, sizeof(uint16_t));
+		if (!band->raw)
+			goto error;
+
+		for (j = 0; j < 3; j++) {
+			band->lines[j] = calloc(line, sizeof(uint16_t));
+			band->rgb[j] = calloc(line, sizeof(uint16_t));
+			if (!band->lines[j] || !band->rgb[j])
+				goto error;
+			band->lines[j]++;
+		}
+	}
+
+	return isp;
+
+error:
+	isp_destroy(isp);
+	return NULL;
+}
+
+void isp_destroy(struct isp *isp)
+{
+	unsigned int i, j;
+
+	if (!isp)
+		return;
+
+	for (i = 0; i < isp->num_bands; i++) {
+		struct isp_band *band = &isp->bands[i];
+
+		free(band->raw);
+		for (j = 0; j < 3; j++) {
+			if (band->lines[j])
+				free(band->lines[j] - 1);
+			free(band->rgb[j]);
+		}
+	}
+
+	free(isp);
+}
+
+/* Unpack, black level and white balance row @y (mirrored at the edges). */
+static void isp_load_row(struct isp *isp, struct isp_band *band, int y,
+			 uint16_t *line)
+{
+	const struct isp_row *row;
+	unsigned int w = isp->width;
+	const uint16_t *in;
+	const uint8_t *src;
+	uint16_t gains[2];
+
+	/* Mirroring by two rows/columns keeps the CFA phase. */
+	if (y < 0)
+		y = -y;
+	else if (y >= (int)isp->height)
+		y = 2 * isp->height - 2 - y;
+
+	src = isp->src + (size_t)y * isp->src_stride;
+	switch (isp->packing) {
+	case RAW_PACKED10:
+		isp->unpack->raw10_to16(src, band->raw, w);
+		in = band->raw;
+		break;
+	case RAW_PACKED12:
+		isp->unpack->raw12_to16(src, band->raw, w);
+		in = band->raw;
+		break;
+	default:
+		in = (const uint16_t *)src;
+		break;
+	}
+
+	row = &isp_cfa_rows[isp->params.cfa][y & 1];
+	gains[row->c_par] = isp->gains[row->red_row ? 0 : 2];
+	gains[!row->c_par] = isp->gains[1];
+
+	isp->ops->wb(in, line, w, isp->black, 16 - isp->bpp, gains);
+
+	line[-1] = line[1];
+	line[w] = line[w - 2];
+}
+
+static void isp_output_row(struct isp *isp, struct isp_band *band,
+			   unsigned int y)
+{
+	uint8_t *d = isp->dst + (size_t)y * isp->dst_stride;
+	const uint8_t *lut = isp->gamma;
+	unsigned int x;
+
+	for (x = 0; x < isp->width; x++) {
+		d[x * 3 + 0] = lut[band->rgb[0][x]];
+		d[x * 3 + 1] = lut[band->rgb[1][x]];
+		d[x * 3 + 2] = lut[band->rgb[2][x]];
+	}
+}
+
+static void isp_band(void *arg, unsigned int start, unsigned int end)
+{
+	struct isp *isp = arg;
+	unsigned int b;
+
+	for (b = start; b < end; b++) {
+		struct isp_band *band = &isp->bands[b];
+		unsigned int y0 = (unsigned long long)isp->height * b /
+				  isp->num_bands;
+		unsigned int y1 = (unsigned long long)isp->height * (b + 1) /
+				  isp->num_bands;
+		unsigned int y, i;
+
+		/* Ring of three rows: y - 1, y, y + 1. */
+		for (i = 0; i < 3; i++)
+			isp_load_row(isp, band, (int)y0 - 1 + i, band->lines[i]);
+
+		for (y = y0; y < y1; y++) {
+			unsigned int k = y - y0;
+			const struct isp_row *row =
+				&isp_cfa_rows[isp->params.cfa][y & 1];
+
+			isp->ops->demosaic(band->lines[k % 3],
+					   band->lines[(k + 1) % 3],
+					   band->lines[(k + 2) % 3], band->rgb,
+					   isp->width, row,
+					   isp->params.demosaic);
+			isp->ops->ccm(band->rgb, isp->width, isp->ccm);
+			isp_output_row(isp, band, y);
+
+			if (y + 1 < y1)
+				isp_load_row(isp, band, y + 2,
+					     band->lines[k % 3]);
+		}
+	}
+}
+
+void isp_process(struct isp *isp, const uint8_t *src, unsigned int src_stride,
+		 uint8_t *rgb, unsigned int rgb_stride)
+{
+	isp->src = src;
+	isp->src_stride = src_stride;
+	isp->dst = rgb;
+	isp->dst_stride = rgb_stride;
+
+	workpool_run(isp->pool, isp_band, isp, isp->num_bands);
+}
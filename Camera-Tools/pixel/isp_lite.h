@@ -0,0 +1,131 @@
+/*
+ * ISP-lite: a small software ISP for the raw Bayer sensors (IMX185,
+ * OV7251, ...) whose CAMSS RDI path delivers unprocessed data.
+ *
+ * Per row: unpack -> black level and white balance -> demosaic (bilinear
+ * or edge-aware green) -> 3x3 colour correction -> gamma LUT -> RGB24.
+ * Intermediate values are 12-bit in uint16_t. A frame is cut into one row
+ * band per thread; each band streams through three padded line buffers
+ * plus one RGB line, so the working set stays in L1/L2 regardless of the
+ * frame size, and only the halo row above and below a band is read twice.
+ *
+ * The per-row kernels are bit-exact between the scalar, SSE2 and NEON
+ * versions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_ISP_LITE_H
+#define CAMERA_TOOLS_ISP_LITE_H
+
+#include <stdint.h>
+
+#include "raw_unpack.h"
+#include "workpool.h"
+
+#define ISP_BITS		12
+#define ISP_MAX			((1 << ISP_BITS) - 1)
+
+/* Colour of the top-left 2x2 block, as in the V4L2 Bayer fourccs. */
+enum isp_cfa {
+	ISP_CFA_RGGB,
+	ISP_CFA_GRBG,
+	ISP_CFA_GBRG,
+	ISP_CFA_BGGR,
+};
+
+enum isp_demosaic {
+	ISP_DEMOSAIC_BILINEAR,
+	/* Interpolate green along the smaller gradient at R/B sites. */
+	ISP_DEMOSAIC_EDGE,
+};
+
+struct isp_params {
+	enum isp_cfa cfa;
+	enum isp_demosaic demosaic;
+	unsigned int black_level;	/* in sensor bits */
+	float wb_gain[3];		/* R, G, B; at most 15.9 */
+	float ccm[3][3];		/* rows: output R, G, B */
+	float gamma;			/* 0 selects the sRGB curve */
+};
+
+/* Row geometry for the demosaic kernel. */
+struct isp_row {
+	int red_row;			/* non-green sites are R (else B) */
+	unsigned int c_par;		/* column parity of non-green sites */
+};
+
+/*
+ * Row kernels. Line buffers hold 12-bit samples and are padded: index -1
+ * and @width are valid (mirrored), and SIMD kernels may read up to
+ * ISP_LINE_SLACK elements past the end.
+ */
+#define ISP_LINE_SLACK		16
+
+struct isp_ops {
+	const char *name;
+	/* max(in - black, 0) << shift, times gains[x & 1] (Q12), clipped. */
+	void (*wb)(const uint16_t *in, uint16_t *out, unsigned int width,
+		   uint16_t black, unsigned int shift, const uint16_t gains[2]);
+	void (*demosaic)(const uint16_t *r0, const uint16_t *r1,
+			 const uint16_t *r2, uint16_t *rgb[3],
+			 unsigned int width, const struct isp_row *row,
+			 enum isp_demosaic mode);
+	/* In place; @m is Q13, row-major. */
+	void (*ccm)(uint16_t *rgb[3], unsigned int width, const int16_t m[9]);
+};
+
+extern const struct isp_ops isp_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct isp_ops isp_ops_sse2;
+#endif
+#if defined(__aarch64__)
+extern const struct isp_ops isp_ops_neon;
+#endif
+
+const struct isp_ops *isp_ops_best(void);
+const struct isp_ops *isp_ops_find(const char *name);
+const struct isp_ops * const *isp_ops_list(void);
+
+/* Scalar kernels from column @x on, for the SIMD tails. */
+void isp_wb_c(const uint16_t *in, uint16_t *out, unsigned int x,
+	      unsigned int width, uint16_t black, unsigned int shift,
+	      const uint16_t gains[2]);
+void isp_demosaic_c(const uint16_t *r0, const uint16_t *r1,
+		    const uint16_t *r2, uint16_t *rgb[3], unsigned int x,
+		    unsigned int width, const struct isp_row *row,
+		    enum isp_demosaic mode);
+void isp_ccm_c(uint16_t *rgb[3], unsigned int x, unsigned int width,
+	       const int16_t m[9]);
+
+void isp_params_default(struct isp_params *params, enum isp_cfa cfa);
+
+/* CFA and bit depth of a V4L2 Bayer fourcc. Returns 0 or -EINVAL. */
+int isp_bayer_format(uint32_t fourcc, enum isp_cfa *cfa, unsigned int *bpp);
+
+struct isp;
+
+/*
+ * @bpp is the sensor bit depth, 10 or 12. @width and @height must be at
+ * least 2. @pool may be NULL; the context keeps one set of line buffers
+ * per pool thread. Returns NULL on invalid arguments or allocation failure.
+ */
+struct isp *isp_create(const struct isp_params *params, unsigned int width,
+		       unsigned int height, enum raw_packing packing,
+		       unsigned int bpp, struct workpool *pool);
+void isp_destroy(struct isp *isp);
+
+/* Takes effect on the next isp_process(). Returns 0 or -EINVAL. */
+int isp_set_params(struct isp *isp, const struct isp_params *params);
+
+/* Force a kernel set (for benchmarking). NULL restores the best one. */
+void isp_set_ops(struct isp *isp, const struct isp_ops *ops);
+
+/* Raw frame to packed RGB24. */
+void isp_process(struct isp *isp, const uint8_t *src, unsigned int src_stride,
+		 uint8_t *rgb, unsigned int rgb_stride);
+
+#endif /* CAMERA_TOOLS_ISP_LITE_H */
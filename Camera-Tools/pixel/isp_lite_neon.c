@@ -0,0 +1,132 @@
+/*
+ * ISP-lite: AArch64 Advanced SIMD row kernels, lane for lane the same
+ * arithmetic as the SSE2 version.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include "isp_lite.h"
+
+static void isp_wb_neon(const uint16_t *in, uint16_t *out,
+			unsigned int width, uint16_t black,
+			unsigned int shift, const uint16_t gains[2])
+{
+	const uint16_t gv[8] = {
+		gains[0], gains[1], gains[0], gains[1],
+		gains[0], gains[1], gains[0], gains[1],
+	};
+	const uint16x8_t b = vdupq_n_u16(black);
+	const uint16x8_t g = vld1q_u16(gv);
+	const uint16x8_t max = vdupq_n_u16(ISP_MAX);
+	const int16x8_t count = vdupq_n_s16(shift);
+	unsigned int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		uint16x8_t v = vshlq_u16(vqsubq_u16(vld1q_u16(in + x), b),
+					 count);
+		uint32x4_t lo = vmull_u16(vget_low_u16(v), vget_low_u16(g));
+		uint32x4_t hi = vmull_high_u16(v, g);
+
+		v = vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+		vst1q_u16(out + x, vminq_u16(v, max));
+	}
+
+	isp_wb_c(in, out, x, width, black, shift, gains);
+}
+
+static void isp_demosaic_neon(const uint16_t *r0, const uint16_t *r1,
+			      const uint16_t *r2, uint16_t *rgb[3],
+			      unsigned int width, const struct isp_row *row,
+			      enum isp_demosaic mode)
+{
+	const uint32x4_t site32 = vdupq_n_u32(row->c_par ? 0xffff0000 : 0xffff);
+	const uint16x8_t site = vreinterpretq_u16_u32(site32);
+	const uint16x8_t edge = vdupq_n_u16(mode == ISP_DEMOSAIC_EDGE ?
+					    0xffff : 0);
+	uint16_t *own = rgb[row->red_row ? 0 : 2];
+	uint16_t *other = rgb[row->red_row ? 2 : 0];
+	uint16_t *green = rgb[1];
+	unsigned int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		uint16x8_t c = vld1q_u16(r1 + x);
+		uint16x8_t l = vld1q_u16(r1 + x - 1), r = vld1q_u16(r1 + x + 1);
+		uint16x8_t u = vld1q_u16(r0 + x), d = vld1q_u16(r2 + x);
+		uint16x8_t h = vrhaddq_u16(l, r);
+		uint16x8_t v = vrhaddq_u16(u, d);
+		uint16x8_t g = vrhaddq_u16(h, v);
+		uint16x8_t dh = vabdq_u16(l, r), dv = vabdq_u16(u, d);
+		uint16x8_t lt_h = vandq_u16(vcltq_u16(dh, dv), edge);
+		uint16x8_t lt_v = vandq_u16(vcltq_u16(dv, dh), edge);
+		uint16x8_t diag;
+
+		g = vbslq_u16(lt_h, h, vbslq_u16(lt_v, v, g));
+		diag = vrhaddq_u16(vrhaddq_u16(vld1q_u16(r0 + x - 1),
+					       vld1q_u16(r0 + x + 1)),
+				   vrhaddq_u16(vld1q_u16(r2 + x - 1),
+					       vld1q_u16(r2 + x + 1)));
+
+		vst1q_u16(own + x, vbslq_u16(site, c, h));
+		vst1q_u16(green + x, vbslq_u16(site, g, c));
+		vst1q_u16(other + x, vbslq_u16(site, diag, v));
+	}
+
+	isp_demosaic_c(r0, r1, r2, rgb, x, width, row, mode);
+}
+
+/* floor(a * b / 65536) per lane, as PMULHW. */
+static inline int16x8_t mulhi(int16x8_t a, int16x8_t b)
+{
+	int32x4_t lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+	int32x4_t hi = vmull_high_s16(a, b);
+
+	return vcombine_s16(vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16));
+}
+
+static void isp_ccm_neon(uint16_t *rgb[3], unsigned int width,
+			 const int16_t m[9])
+{
+	const int16x8_t zero = vdupq_n_s16(0);
+	const int16x8_t max = vdupq_n_s16(ISP_MAX);
+	int16x8_t k[9];
+	unsigned int x, i;
+
+	for (i = 0; i < 9; i++)
+		k[i] = vdupq_n_s16(m[i]);
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		int16x8_t in[3];
+
+		for (i = 0; i < 3; i++)
+			in[i] = vshlq_n_s16(vreinterpretq_s16_u16(
+					vld1q_u16(rgb[i] + x)), 3);
+
+		for (i = 0; i < 3; i++) {
+			int16x8_t s;
+
+			s = vqaddq_s16(mulhi(in[0], k[i * 3 + 0]),
+				       mulhi(in[1], k[i * 3 + 1]));
+			s = vqaddq_s16(s, mulhi(in[2], k[i * 3 + 2]));
+			s = vminq_s16(vmaxq_s16(s, zero), max);
+			vst1q_u16(rgb[i] + x, vreinterpretq_u16_s16(s));
+		}
+	}
+
+	isp_ccm_c(rgb, x, width, m);
+}
+
+const struct isp_ops isp_ops_neon = {
+	.name = "neon",
+	.wb = isp_wb_neon,
+	.demosaic = isp_demosaic_neon,
+	.ccm = isp_ccm_neon,
+};
+
+#endif /* __aarch64__ */
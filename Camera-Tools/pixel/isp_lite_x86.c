@@ -0,0 +1,145 @@
+/*
+ * ISP-lite: SSE2 row kernels.
+ *
+ * The demosaic computes every candidate average (horizontal, vertical,
+ * cross, diagonal) for all eight lanes and picks per lane with masks for
+ * the column parity, which keeps the loop free of branches. Samples are
+ * 12-bit, so signed 16-bit compares and PMULHW are safe.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+#include "isp_lite.h"
+
+#define SSE2	__attribute__((target("sse2")))
+
+static inline __m128i SSE2 load(const uint16_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void SSE2 store(uint16_t *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i SSE2 blend(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i SSE2 absdiff(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+}
+
+static void SSE2 isp_wb_sse2(const uint16_t *in, uint16_t *out,
+			     unsigned int width, uint16_t black,
+			     unsigned int shift, const uint16_t gains[2])
+{
+	const __m128i b = _mm_set1_epi16(black);
+	const __m128i g = _mm_set1_epi32(gains[0] | (uint32_t)gains[1] << 16);
+	const __m128i max = _mm_set1_epi16(ISP_MAX);
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	unsigned int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i v = _mm_sll_epi16(_mm_subs_epu16(load(in + x), b),
+					  count);
+
+		v = _mm_mulhi_epu16(v, g);
+		/* min(v, max) without SSE4.1's PMINUW */
+		store(out + x, _mm_sub_epi16(v, _mm_subs_epu16(v, max)));
+	}
+
+	isp_wb_c(in, out, x, width, black, shift, gains);
+}
+
+static void SSE2 isp_demosaic_sse2(const uint16_t *r0, const uint16_t *r1,
+				   const uint16_t *r2, uint16_t *rgb[3],
+				   unsigned int width,
+				   const struct isp_row *row,
+				   enum isp_demosaic mode)
+{
+	const __m128i site = _mm_set1_epi32(row->c_par ? 0xffff0000 : 0xffff);
+	const __m128i edge = _mm_set1_epi16(mode == ISP_DEMOSAIC_EDGE ? -1 : 0);
+	uint16_t *own = rgb[row->red_row ? 0 : 2];
+	uint16_t *other = rgb[row->red_row ? 2 : 0];
+	uint16_t *green = rgb[1];
+	unsigned int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i c = load(r1 + x);
+		__m128i l = load(r1 + x - 1), r = load(r1 + x + 1);
+		__m128i u = load(r0 + x), d = load(r2 + x);
+		__m128i h = _mm_avg_epu16(l, r);
+		__m128i v = _mm_avg_epu16(u, d);
+		__m128i g = _mm_avg_epu16(h, v);
+		__m128i diag, dh, dv, lt_h, lt_v;
+
+		dh = absdiff(l, r);
+		dv = absdiff(u, d);
+		lt_h = _mm_and_si128(_mm_cmplt_epi16(dh, dv), edge);
+		lt_v = _mm_and_si128(_mm_cmplt_epi16(dv, dh), edge);
+		g = blend(lt_h, h, blend(lt_v, v, g));
+
+		diag = _mm_avg_epu16(_mm_avg_epu16(load(r0 + x - 1),
+						   load(r0 + x + 1)),
+				     _mm_avg_epu16(load(r2 + x - 1),
+						   load(r2 + x + 1)));
+
+		store(own + x, blend(site, c, h));
+		store(green + x, blend(site, g, c));
+		store(other + x, blend(site, diag, v));
+	}
+
+	isp_demosaic_c(r0, r1, r2, rgb, x, width, row, mode);
+}
+
+static void SSE2 isp_ccm_sse2(uint16_t *rgb[3], unsigned int width,
+			      const int16_t m[9])
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi16(ISP_MAX);
+	__m128i k[9];
+	unsigned int x, i;
+
+	for (i = 0; i < 9; i++)
+		k[i] = _mm_set1_epi16(m[i]);
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i in[3];
+
+		for (i = 0; i < 3; i++)
+			in[i] = _mm_slli_epi16(load(rgb[i] + x), 3);
+
+		for (i = 0; i < 3; i++) {
+			__m128i s;
+
+			s = _mm_adds_epi16(_mm_mulhi_epi16(in[0], k[i * 3 + 0]),
+					   _mm_mulhi_epi16(in[1], k[i * 3 + 1]));
+			s = _mm_adds_epi16(s, _mm_mulhi_epi16(in[2],
+							      k[i * 3 + 2]));
+			s = _mm_min_epi16(_mm_max_epi16(s, zero), max);
+			store(rgb[i] + x, s);
+		}
+	}
+
+	isp_ccm_c(rgb, x, width, m);
+}
+
+const struct isp_ops isp_ops_sse2 = {
+	.name = "sse2",
+	.wb = isp_wb_sse2,
+	.demosaic = isp_demosaic_sse2,
+	.ccm = isp_ccm_sse2,
+};
+
+#endif /* __x86_64__ || __i386__ */
@@ -0,0 +1,372 @@
+/*
+ * 3A statistics: scalar kernels, dispatch and the frame driver.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "raw_stats.h"
+
+static inline uint8_t avg(uint8_t a, uint8_t b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static inline uint8_t sub_black(uint8_t v, uint8_t black)
+{
+	return v > black ? v - black : 0;
+}
+
+void raw_stats_bin_c(const uint8_t *rg, const uint8_t *gb, uint8_t *y,
+		     unsigned int x, unsigned int blocks, uint8_t black,
+		     uint8_t clip, struct raw_stats_acc *acc)
+{
+	for (; x < blocks; x++) {
+		uint8_t r0 = rg[2 * x], g1 = rg[2 * x + 1];
+		uint8_t g2 = gb[2 * x], b0 = gb[2 * x + 1];
+		uint8_t r = sub_black(r0, black), b = sub_black(b0, black);
+		uint8_t g = avg(sub_black(g1, black), sub_black(g2, black));
+
+		y[x] = avg(avg(r, b), g);
+
+		if (r0 > clip || g1 > clip || g2 > clip || b0 > clip)
+			continue;
+
+		acc->sum[0] += r;
+		acc->sum[1] += g;
+		acc->sum[2] += b;
+		acc->count++;
+	}
+}
+
+uint32_t raw_stats_sum_c(const uint8_t *p, unsigned int x, unsigned int n)
+{
+	uint32_t sum = 0;
+
+	for (; x < n; x++)
+		sum += p[x];
+
+	return sum;
+}
+
+static void raw_stats_bin_row_c(const uint8_t *rg, const uint8_t *gb,
+				uint8_t *y, unsigned int blocks, uint8_t black,
+				uint8_t clip, struct raw_stats_acc *acc)
+{
+	raw_stats_bin_c(rg, gb, y, 0, blocks, black, clip, acc);
+}
+
+static uint32_t raw_stats_sum_row_c(const uint8_t *p, unsigned int n)
+{
+	return raw_stats_sum_c(p, 0, n);
+}
+
+const struct raw_stats_ops raw_stats_ops_c = {
+	.name = "c",
+	.bin = raw_stats_bin_row_c,
+	.sum = raw_stats_sum_row_c,
+};
+
+static const struct raw_stats_ops *raw_stats_impls[3];
+
+static void raw_stats_ops_probe(void)
+{
+	unsigned int n = 0;
+
+	if (raw_stats_impls[0])
+		return;
+
+	raw_stats_impls[n++] = &raw_stats_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		raw_stats_impls[n++] = &raw_stats_ops_sse2;
+#endif
+#if defined(__aarch64__)
+	raw_stats_impls[n++] = &raw_stats_ops_neon;
+#endif
+	raw_stats_impls[n] = NULL;
+}
+
+const struct raw_stats_ops * const *raw_stats_ops_list(void)
+{
+	raw_stats_ops_probe();
+
+	return raw_stats_impls;
+}
+
+const struct raw_stats_ops *raw_stats_ops_best(void)
+{
+	static const struct raw_stats_ops *best;
+	unsigned int i;
+
+	if (best)
+		return best;
+
+	raw_stats_ops_probe();
+	for (i = 0; raw_stats_impls[i]; i++)
+		best = raw_stats_impls[i];
+
+	return best;
+}
+
+const struct raw_stats_ops *raw_stats_ops_find(const char *name)
+{
+	unsigned int i;
+
+	raw_stats_ops_probe();
+	for (i = 0; raw_stats_impls[i]; i++)
+		if (!strcmp(raw_stats_impls[i]->name, name))
+			return raw_stats_impls[i];
+
+	return NULL;
+}
+
+void raw_stats_config_default(struct raw_stats_config *cfg,
+			      unsigned int width, unsigned int height,
+			      enum raw_packing packing, unsigned int bpp,
+			      enum isp_cfa cfa)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->width = width;
+	cfg->height = height;
+	cfg->packing = packing;
+	cfg->bpp = bpp;
+	cfg->cfa = cfa;
+	cfg->row_step = 4;
+	cfg->zones_x = 16;
+	cfg->zones_y = 12;
+	cfg->clip = 250;
+}
+
+struct raw_stats_engine {
+	struct raw_stats_config cfg;
+	const struct raw_stats_ops *ops;
+	const struct raw_unpack_ops *unpack;
+
+	unsigned int blocks_x;
+	unsigned int blocks_y;
+	unsigned int col;		/* first column of an R/G pair */
+	unsigned int rg_row;		/* row of the pair holding R */
+	uint8_t black;
+
+	uint8_t *rows[2];		/* 8-bit samples of one row pair */
+	uint8_t *luma;			/* one byte per block */
+	unsigned int zone_x[RAW_STATS_MAX_ZONES + 1];
+	uint32_t hist[4][RAW_STATS_BINS];
+};
+
+void raw_stats_set_ops(struct raw_stats_engine *engine,
+		       const struct raw_stats_ops *ops)
+{
+	engine->ops = ops ? ops : raw_stats_ops_best();
+}
+
+struct raw_stats_engine *raw_stats_create(const struct raw_stats_config *cfg)
+{
+	struct raw_stats_engine *engine;
+	unsigned int i;
+
+	if (cfg->width < 3 || cfg->height < 2 || cfg->cfa > ISP_CFA_BGGR ||
+	    (cfg->bpp != 8 && cfg->bpp != 10 && cfg->bpp != 12) ||
+	    (cfg->packing == RAW_PACKED10 && cfg->bpp != 10) ||
+	    (cfg->packing == RAW_PACKED12 && cfg->bpp != 12) ||
+	    ((cfg->packing == RAW_UNPACKED8) != (cfg->bpp == 8)) ||
+	    !cfg->row_step || !cfg->zones_x || !cfg->zones_y ||
+	    cfg->zones_x > RAW_STATS_MAX_ZONES ||
+	    cfg->zones_y > RAW_STATS_MAX_ZONES)
+		return NULL;
+
+	engine = calloc(1, sizeof(*engine));
+	if (!engine)
+		return NULL;
+
+	engine->cfg = *cfg;
+	engine->ops = raw_stats_ops_best();
+	engine->unpack = raw_unpack_best();
+
+	/*
+	 * GRBG and BGGR start with a green column; skipping it loses one
+	 * block per row but lets the kernels assume R/B at even columns.
+	 */
+	engine->col = cfg->cfa == ISP_CFA_GRBG || cfg->cfa == ISP_CFA_BGGR;
+	engine->rg_row = cfg->cfa == ISP_CFA_GBRG || cfg->cfa == ISP_CFA_BGGR;
+	engine->blocks_x = (cfg->width - engine->col) / 2;
+	engine->blocks_y = cfg->height / 2;
+	engine->black = cfg->black_level >> (cfg->bpp - 8);
+
+	if (cfg->zones_x > engine->blocks_x ||
+	    cfg->zones_y > engine->blocks_y)
+		goto error;
+
+	for (i = 0; i <= cfg->zones_x; i++)
+		engine->zone_x[i] = i * engine->blocks_x / cfg->zones_x;
+
+	for (i = 0; i < 2; i++) {
+		engine->rows[i] = calloc(cfg->width + RAW_STATS_SLACK, 1);
+		if (!engine->rows[i])
+			goto error;
+	}
+	engine->luma = calloc(engine->blocks_x + RAW_STATS_SLACK, 1);
+	if (!engine->luma)
+		goto error;
+
+	return engine;
+
+error:
+	raw_stats_destroy(engine);
+	return NULL;
+}
+
+void raw_stats_destroy(struct raw_stats_engine *engine)
+{
+	if (!engine)
+		return;
+
+	free(engine->rows[0]);
+	free(engine->rows[1]);
+	free(engine->luma);
+	free(engine);
+}
+
+static void raw_stats_load_row(struct raw_stats_engine *engine,
+			       const uint8_t *src, uint8_t *dst)
+{
+	const uint16_t *s = (const uint16_t *)src;
+	unsigned int shift = engine->cfg.bpp - 8;
+	unsigned int x, w = engine->cfg.width;
+
+	switch (engine->cfg.packing) {
+	case RAW_PACKED10:
+		engine->unpack->raw10_to8(src, dst, w);
+		break;
+	case RAW_PACKED12:
+		engine->unpack->raw12_to8(src, dst, w);
+		break;
+	case RAW_UNPACKED8:
+		memcpy(dst, src, w);
+		break;
+	default:
+		for (x = 0; x < w; x++)
+			dst[x] = s[x] >> shift;
+		break;
+	}
+}
+
+void raw_stats_process(struct raw_stats_engine *engine, const uint8_t *src,
+		       unsigned int src_stride, struct raw_stats *stats)
+{
+	const struct raw_stats_config *cfg = &engine->cfg;
+	const struct raw_stats_ops *ops = engine->ops;
+	unsigned int bx = engine->blocks_x, by = engine->blocks_y;
+	const uint8_t *rg = engine->rows[engine->rg_row] + engine->col;
+	const uint8_t *gb = engine->rows[!engine->rg_row] + engine->col;
+	uint8_t *luma = engine->luma;
+	unsigned int x, y, i;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(engine->hist, 0, sizeof(engine->hist));
+	stats->zones_x = cfg->zones_x;
+	stats->zones_y = cfg->zones_y;
+
+	/* Centre the sampled rows in each group of row_step. */
+	for (y = cfg->row_step / 2; y < by; y += cfg->row_step) {
+		const uint8_t *s = src + (size_t)y * 2 * src_stride;
+		unsigned int zy = y * cfg->zones_y / by;
+		uint32_t *zsum = &stats->zone_sum[zy * cfg->zones_x];
+		uint32_t *zblocks = &stats->zone_blocks[zy * cfg->zones_x];
+
+		raw_stats_load_row(engine, s, engine->rows[0]);
+		raw_stats_load_row(engine, s + src_stride, engine->rows[1]);
+
+		ops->bin(rg, gb, luma, bx, engine->black, cfg->clip,
+			 &stats->awb);
+
+		/*
+		 * Four sub-histograms so consecutive equal values do not
+		 * serialise on one counter.
+		 */
+		for (x = 0; x + 4 <= bx; x += 4) {
+			engine->hist[0][luma[x + 0]]++;
+			engine->hist[1][luma[x + 1]]++;
+			engine->hist[2][luma[x + 2]]++;
+			engine->hist[3][luma[x + 3]]++;
+		}
+		for (; x < bx; x++)
+			engine->hist[0][luma[x]]++;
+
+		for (i = 0; i < cfg->zones_x; i++) {
+			unsigned int x0 = engine->zone_x[i];
+			unsigned int n = engine->zone_x[i + 1] - x0;
+
+			zsum[i] += ops->sum(luma + x0, n);
+			zblocks[i] += n;
+		}
+
+		stats->blocks += bx;
+	}
+
+	for (i = 0; i < RAW_STATS_BINS; i++)
+		stats->hist[i] = engine->hist[0][i] + engine->hist[1][i] +
+				 engine->hist[2][i] + engine->hist[3][i];
+}
+
+double raw_stats_mean(const struct raw_stats *stats)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (!stats->blocks)
+		return 0;
+
+	for (i = 0; i < RAW_STATS_BINS; i++)
+		sum += (uint64_t)stats->hist[i] * i;
+
+	return (double)sum / stats->blocks;
+}
+
+unsigned int raw_stats_percentile(const struct raw_stats *stats,
+				  unsigned int permille)
+{
+	uint64_t target = ((uint64_t)stats->blocks * permille + 999) / 1000;
+	uint64_t n = 0;
+	unsigned int i;
+
+	for (i = 0; i < RAW_STATS_BINS - 1; i++) {
+		n += stats->hist[i];
+		if (n >= target)
+			break;
+	}
+
+	return i;
+}
+
+double raw_stats_zone_mean(const struct raw_stats *stats, unsigned int zx,
+			   unsigned int zy)
+{
+	unsigned int i = zy * stats->zones_x + zx;
+
+	if (!stats->zone_blocks[i])
+		return 0;
+
+	return (double)stats->zone_sum[i] / stats->zone_blocks[i];
+}
+
+void raw_stats_grey_world(const struct raw_stats *stats, float gains[3])
+{
+	const uint64_t *sum = stats->awb.sum;
+
+	gains[0] = gains[1] = gains[2] = 1.0f;
+
+	/* Too dark or too few blocks to say anything. */
+	if (stats->awb.count < 64 || !sum[0] || !sum[2])
+		return;
+
+	gains[0] = (float)sum[1] / sum[0];
+	gains[2] = (float)sum[1] / sum[2];
+}
@@ -0,0 +1,135 @@
+/*
+ * 3A statistics on raw Bayer frames.
+ *
+ * Works on the 8 MSBs of every sample and on 2x2 CFA blocks: for each
+ * block the kernels compute black-subtracted R, G (mean of both greens)
+ * and B, and a luma value avg(avg(R, B), G). From a subsample of block
+ * rows they produce
+ *
+ *  - a 256-bin luma histogram,
+ *  - per-zone luma sums on a zones_x x zones_y grid (AE metering),
+ *  - grey-world R/G/B sums over blocks with no clipped sample (AWB).
+ *
+ * Monochrome frames (Y8, Y10) go through the same kernels with any CFA:
+ * the luma of a block is then simply its mean, and the AWB sums are
+ * meaningless.
+ *
+ * Only one block row in row_step is read, but each of those rows is
+ * processed in full with SIMD; at the default step of 4 a 1080p RAW10
+ * frame costs about 0.25 ms on one x86 core, so there is room for the
+ * Cortex-A53 within a frame's budget. The row kernels are bit-exact
+ * between the scalar, SSE2 and NEON versions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_RAW_STATS_H
+#define CAMERA_TOOLS_RAW_STATS_H
+
+#include <stdint.h>
+
+#include "isp_lite.h"
+#include "raw_unpack.h"
+
+#define RAW_STATS_BINS		256
+#define RAW_STATS_MAX_ZONES	32	/* per axis */
+#define RAW_STATS_SLACK		32	/* bytes SIMD kernels may over-read */
+
+struct raw_stats_config {
+	unsigned int width;
+	unsigned int height;
+	enum raw_packing packing;
+	unsigned int bpp;		/* 8 (RAW_UNPACKED8), 10 or 12 */
+	enum isp_cfa cfa;
+	unsigned int black_level;	/* in sensor bits */
+	unsigned int row_step;		/* read one block row in row_step */
+	unsigned int zones_x;
+	unsigned int zones_y;
+	uint8_t clip;			/* 8-bit level counted as clipped */
+};
+
+/* Grey-world accumulator: R, G, B sums and count of unclipped blocks. */
+struct raw_stats_acc {
+	uint64_t sum[3];
+	uint32_t count;
+};
+
+struct raw_stats {
+	uint32_t hist[RAW_STATS_BINS];
+	uint32_t blocks;		/* total of hist[] */
+	unsigned int zones_x;
+	unsigned int zones_y;
+	uint32_t zone_sum[RAW_STATS_MAX_ZONES * RAW_STATS_MAX_ZONES];
+	uint32_t zone_blocks[RAW_STATS_MAX_ZONES * RAW_STATS_MAX_ZONES];
+	struct raw_stats_acc awb;
+};
+
+/*
+ * Row kernels. @rg holds R at even and G at odd columns, @gb G at even and
+ * B at odd columns (the frame driver offsets and swaps rows to get there
+ * from any CFA). Both may be read up to RAW_STATS_SLACK bytes past the
+ * 2 * @blocks used.
+ */
+struct raw_stats_ops {
+	const char *name;
+	/*
+	 * Write one luma byte per block to @y and add the blocks whose four
+	 * samples are all <= @clip to @acc.
+	 */
+	void (*bin)(const uint8_t *rg, const uint8_t *gb, uint8_t *y,
+		    unsigned int blocks, uint8_t black, uint8_t clip,
+		    struct raw_stats_acc *acc);
+	uint32_t (*sum)(const uint8_t *p, unsigned int n);
+};
+
+extern const struct raw_stats_ops raw_stats_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct raw_stats_ops raw_stats_ops_sse2;
+#endif
+#if defined(__aarch64__)
+extern const struct raw_stats_ops raw_stats_ops_neon;
+#endif
+
+const struct raw_stats_ops *raw_stats_ops_best(void);
+const struct raw_stats_ops *raw_stats_ops_find(const char *name);
+const struct raw_stats_ops * const *raw_stats_ops_list(void);
+
+/* Scalar kernels from block/byte @x on, for the SIMD tails. */
+void raw_stats_bin_c(const uint8_t *rg, const uint8_t *gb, uint8_t *y,
+		     unsigned int x, unsigned int blocks, uint8_t black,
+		     uint8_t clip, struct raw_stats_acc *acc);
+uint32_t raw_stats_sum_c(const uint8_t *p, unsigned int x, unsigned int n);
+
+/* 16x12 zones, every 4th block row, clip at 250. */
+void raw_stats_config_default(struct raw_stats_config *cfg,
+			      unsigned int width, unsigned int height,
+			      enum raw_packing packing, unsigned int bpp,
+			      enum isp_cfa cfa);
+
+struct raw_stats_engine;
+
+/* Returns NULL on invalid configuration or allocation failure. */
+struct raw_stats_engine *raw_stats_create(const struct raw_stats_config *cfg);
+void raw_stats_destroy(struct raw_stats_engine *engine);
+
+/* Force a kernel set (for benchmarking). NULL restores the best one. */
+void raw_stats_set_ops(struct raw_stats_engine *engine,
+		       const struct raw_stats_ops *ops);
+
+void raw_stats_process(struct raw_stats_engine *engine, const uint8_t *src,
+		       unsigned int src_stride, struct raw_stats *stats);
+
+/* Derived values. */
+double raw_stats_mean(const struct raw_stats *stats);
+/* Smallest bin with at least @permille of the blocks at or below it. */
+unsigned int raw_stats_percentile(const struct raw_stats *stats,
+				  unsigned int permille);
+double raw_stats_zone_mean(const struct raw_stats *stats, unsigned int zx,
+			   unsigned int zy);
+/* R, G, B gains (G = 1) that make the scene average grey. */
+void raw_stats_grey_world(const struct raw_stats *stats, float gains[3]);
+
+#endif /* CAMERA_TOOLS_RAW_STATS_H */
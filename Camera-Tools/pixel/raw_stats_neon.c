@@ -0,0 +1,71 @@
+/*
+ * 3A statistics: AArch64 Advanced SIMD row kernels. VLD2 does the R/G and
+ * G/B split that SSE2 needs masks and packs for.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include "raw_stats.h"
+
+static void raw_stats_bin_neon(const uint8_t *rg, const uint8_t *gb,
+			       uint8_t *y, unsigned int blocks, uint8_t black,
+			       uint8_t clip, struct raw_stats_acc *acc)
+{
+	const uint8x16_t vblack = vdupq_n_u8(black);
+	const uint8x16_t vclip = vdupq_n_u8(clip);
+	const uint8x16_t one = vdupq_n_u8(1);
+	uint32x4_t sr = vdupq_n_u32(0), sg = sr, sb = sr, n = sr;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= blocks; x += 16) {
+		uint8x16x2_t a = vld2q_u8(rg + 2 * x);
+		uint8x16x2_t c = vld2q_u8(gb + 2 * x);
+		uint8x16_t mx = vmaxq_u8(vmaxq_u8(a.val[0], a.val[1]),
+					 vmaxq_u8(c.val[0], c.val[1]));
+		uint8x16_t ok = vcleq_u8(mx, vclip);
+		uint8x16_t r = vqsubq_u8(a.val[0], vblack);
+		uint8x16_t b = vqsubq_u8(c.val[1], vblack);
+		uint8x16_t g = vrhaddq_u8(vqsubq_u8(a.val[1], vblack),
+					  vqsubq_u8(c.val[0], vblack));
+
+		vst1q_u8(y + x, vrhaddq_u8(vrhaddq_u8(r, b), g));
+
+		sr = vpadalq_u16(sr, vpaddlq_u8(vandq_u8(r, ok)));
+		sg = vpadalq_u16(sg, vpaddlq_u8(vandq_u8(g, ok)));
+		sb = vpadalq_u16(sb, vpaddlq_u8(vandq_u8(b, ok)));
+		n = vpadalq_u16(n, vpaddlq_u8(vandq_u8(ok, one)));
+	}
+
+	acc->sum[0] += vaddvq_u32(sr);
+	acc->sum[1] += vaddvq_u32(sg);
+	acc->sum[2] += vaddvq_u32(sb);
+	acc->count += vaddvq_u32(n);
+
+	raw_stats_bin_c(rg, gb, y, x, blocks, black, clip, acc);
+}
+
+static uint32_t raw_stats_sum_neon(const uint8_t *p, unsigned int n)
+{
+	uint32x4_t s = vdupq_n_u32(0);
+	unsigned int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+		s = vpadalq_u16(s, vpaddlq_u8(vld1q_u8(p + x)));
+
+	return vaddvq_u32(s) + raw_stats_sum_c(p, x, n);
+}
+
+const struct raw_stats_ops raw_stats_ops_neon = {
+	.name = "neon",
+	.bin = raw_stats_bin_neon,
+	.sum = raw_stats_sum_neon,
+};
+
+#endif /* __aarch64__ */
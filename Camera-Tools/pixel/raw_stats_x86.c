@@ -0,0 +1,104 @@
+/*
+ * 3A statistics: SSE2 row kernels.
+ *
+ * Sixteen blocks per iteration: the byte pairs of both rows are split
+ * into R, G, G, B vectors with a mask and a shift plus PACKUSWB, averaged
+ * with PAVGB and summed with PSADBW, which adds eight bytes into a 64-bit
+ * lane in one instruction.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+#include "raw_stats.h"
+
+#define SSE2	__attribute__((target("sse2")))
+
+static inline __m128i SSE2 load(const uint8_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline uint64_t SSE2 hsum64(__m128i v)
+{
+	return (uint64_t)_mm_cvtsi128_si32(v) +
+	       (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+static void SSE2 raw_stats_bin_sse2(const uint8_t *rg, const uint8_t *gb,
+				    uint8_t *y, unsigned int blocks,
+				    uint8_t black, uint8_t clip,
+				    struct raw_stats_acc *acc)
+{
+	const __m128i lo = _mm_set1_epi16(0x00ff);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vblack = _mm_set1_epi8(black);
+	const __m128i vclip = _mm_set1_epi8(clip);
+	__m128i sr = zero, sg = zero, sb = zero;
+	uint32_t count = 0;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= blocks; x += 16) {
+		__m128i a0 = load(rg + 2 * x), a1 = load(rg + 2 * x + 16);
+		__m128i b0 = load(gb + 2 * x), b1 = load(gb + 2 * x + 16);
+		__m128i r = _mm_packus_epi16(_mm_and_si128(a0, lo),
+					     _mm_and_si128(a1, lo));
+		__m128i g1 = _mm_packus_epi16(_mm_srli_epi16(a0, 8),
+					      _mm_srli_epi16(a1, 8));
+		__m128i g2 = _mm_packus_epi16(_mm_and_si128(b0, lo),
+					      _mm_and_si128(b1, lo));
+		__m128i b = _mm_packus_epi16(_mm_srli_epi16(b0, 8),
+					     _mm_srli_epi16(b1, 8));
+		__m128i mx = _mm_max_epu8(_mm_max_epu8(r, g1),
+					  _mm_max_epu8(g2, b));
+		/* mx <= clip */
+		__m128i ok = _mm_cmpeq_epi8(_mm_max_epu8(mx, vclip), vclip);
+		__m128i g;
+
+		r = _mm_subs_epu8(r, vblack);
+		b = _mm_subs_epu8(b, vblack);
+		g = _mm_avg_epu8(_mm_subs_epu8(g1, vblack),
+				 _mm_subs_epu8(g2, vblack));
+
+		_mm_storeu_si128((__m128i *)(y + x),
+				 _mm_avg_epu8(_mm_avg_epu8(r, b), g));
+
+		sr = _mm_add_epi64(sr, _mm_sad_epu8(_mm_and_si128(r, ok), zero));
+		sg = _mm_add_epi64(sg, _mm_sad_epu8(_mm_and_si128(g, ok), zero));
+		sb = _mm_add_epi64(sb, _mm_sad_epu8(_mm_and_si128(b, ok), zero));
+		count += __builtin_popcount(_mm_movemask_epi8(ok));
+	}
+
+	acc->sum[0] += hsum64(sr);
+	acc->sum[1] += hsum64(sg);
+	acc->sum[2] += hsum64(sb);
+	acc->count += count;
+
+	raw_stats_bin_c(rg, gb, y, x, blocks, black, clip, acc);
+}
+
+static uint32_t SSE2 raw_stats_sum_sse2(const uint8_t *p, unsigned int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i s = zero;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+		s = _mm_add_epi64(s, _mm_sad_epu8(load(p + x), zero));
+
+	return hsum64(s) + raw_stats_sum_c(p, x, n);
+}
+
+const struct raw_stats_ops raw_stats_ops_sse2 = {
+	.name = "sse2",
+	.bin = raw_stats_bin_sse2,
+	.sum = raw_stats_sum_sse2,
+};
+
+#endif /* __x86_64__ || __i386__ */
@@ -0,0 +1,167 @@
+/*
+ * MIPI CSI-2 RAW10/RAW12 unpacking: scalar kernels and runtime dispatch.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+
+#include "raw_unpack.h"
+
+void raw10_to16_c(const uint8_t *src, uint16_t *dst, unsigned int x,
+		  unsigned int width)
+{
+	const uint8_t *s = src + x / 4 * 5;
+	unsigned int i;
+
+	for (; x + 4 <= width; x += 4, s += 5) {
+		uint8_t lo = s[4];
+
+		dst[x + 0] = (s[0] << 2) | (lo & 3);
+		dst[x + 1] = (s[1] << 2) | ((lo >> 2) & 3);
+		dst[x + 2] = (s[2] << 2) | ((lo >> 4) & 3);
+		dst[x + 3] = (s[3] << 2) | (lo >> 6);
+	}
+
+	/* A partial group still carries its LSB byte after the MSBs. */
+	for (i = 0; x < width; x++, i++)
+		dst[x] = (s[i] << 2) | ((s[4] >> (2 * i)) & 3);
+}
+
+void raw10_to8_c(const uint8_t *src, uint8_t *dst, unsigned int x,
+		 unsigned int width)
+{
+	const uint8_t *s = src + x / 4 * 5;
+	unsigned int i;
+
+	for (; x + 4 <= width; x += 4, s += 5) {
+		dst[x + 0] = s[0];
+		dst[x + 1] = s[1];
+		dst[x + 2] = s[2];
+		dst[x + 3] = s[3];
+	}
+
+	for (i = 0; x < width; x++, i++)
+		dst[x] = s[i];
+}
+
+void raw12_to16_c(const uint8_t *src, uint16_t *dst, unsigned int x,
+		  unsigned int width)
+{
+	const uint8_t *s = src + x / 2 * 3;
+
+	for (; x + 2 <= width; x += 2, s += 3) {
+		dst[x + 0] = (s[0] << 4) | (s[2] & 0xf);
+		dst[x + 1] = (s[1] << 4) | (s[2] >> 4);
+	}
+
+	if (x < width)
+		dst[x] = (s[0] << 4) | (s[2] & 0xf);
+}
+
+void raw12_to8_c(const uint8_t *src, uint8_t *dst, unsigned int x,
+		 unsigned int width)
+{
+	const uint8_t *s = src + x / 2 * 3;
+
+	for (; x + 2 <= width; x += 2, s += 3) {
+		dst[x + 0] = s[0];
+		dst[x + 1] = s[1];
+	}
+
+	if (x < width)
+		dst[x] = s[0];
+}
+
+static void raw10_to16_row_c(const uint8_t *src, uint16_t *dst,
+			     unsigned int width)
+{
+	raw10_to16_c(src, dst, 0, width);
+}
+
+static void raw10_to8_row_c(const uint8_t *src, uint8_t *dst,
+			    unsigned int width)
+{
+	raw10_to8_c(src, dst, 0, width);
+}
+
+static void raw12_to16_row_c(const uint8_t *src, uint16_t *dst,
+			     unsigned int width)
+{
+	raw12_to16_c(src, dst, 0, width);
+}
+
+static void raw12_to8_row_c(const uint8_t *src, uint8_t *dst,
+			    unsigned int width)
+{
+	raw12_to8_c(src, dst, 0, width);
+}
+
+const struct raw_unpack_ops raw_unpack_c = {
+	.name = "c",
+	.raw10_to16 = raw10_to16_row_c,
+	.raw10_to8 = raw10_to8_row_c,
+	.raw12_to16 = raw12_to16_row_c,
+	.raw12_to8 = raw12_to8_row_c,
+};
+
+static const struct raw_unpack_ops *raw_unpack_impls[5];
+
+static void raw_unpack_probe(void)
+{
+	unsigned int n = 0;
+
+	if (raw_unpack_impls[0])
+		return;
+
+	raw_unpack_impls[n++] = &raw_unpack_c;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3"))
+		raw_unpack_impls[n++] = &raw_unpack_ssse3;
+	if (__builtin_cpu_supports("avx2"))
+		raw_unpack_impls[n++] = &raw_unpack_avx2;
+#endif
+#if defined(__aarch64__)
+	/* Advanced SIMD is mandatory on ARMv8-A, the A53 included. */
+	raw_unpack_impls[n++] = &raw_unpack_neon;
+#endif
+	raw_unpack_impls[n] = NULL;
+}
+
+const struct raw_unpack_ops * const *raw_unpack_list(void)
+{
+	raw_unpack_probe();
+
+	return raw_unpack_impls;
+}
+
+const struct raw_unpack_ops *raw_unpack_best(void)
+{
+	static const struct raw_unpack_ops *best;
+	unsigned int i;
+
+	if (best)
+		return best;
+
+	raw_unpack_probe();
+	for (i = 0; raw_unpack_impls[i]; i++)
+		best = raw_unpack_impls[i];
+
+	return best;
+}
+
+const struct raw_unpack_ops *raw_unpack_find(const char *name)
+{
+	unsigned int i;
+
+	raw_unpack_probe();
+	for (i = 0; raw_unpack_impls[i]; i++)
+		if (!strcmp(raw_unpack_impls[i]->name, name))
+			return raw_unpack_impls[i];
+
+	return NULL;
+}
@@ -0,0 +1,99 @@
+/*
+ * MIPI CSI-2 RAW10/RAW12 unpacking.
+ *
+ * RAW10 packs 4 pixels into 5 bytes: the 8 MSBs of each pixel followed by
+ * one byte holding the 2 LSBs of all four (pixel 0 in bits 1:0). RAW12
+ * packs 2 pixels into 3 bytes: two MSB bytes, then the 4 LSBs of pixel 0
+ * in bits 3:0 and of pixel 1 in bits 7:4. This is what the CAMSS RDI path
+ * delivers for the OV7251 and IMX185 (SRGGB10_1X10).
+ *
+ * Every implementation provides the same row kernels; raw_unpack_best()
+ * picks the fastest one the CPU supports at runtime.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_RAW_UNPACK_H
+#define CAMERA_TOOLS_RAW_UNPACK_H
+
+#include <stdint.h>
+
+enum raw_packing {
+	RAW_PACKED10,
+	RAW_PACKED12,
+	RAW_UNPACKED16,		/* already one pixel per uint16_t */
+	RAW_UNPACKED8,		/* one 8-bit pixel per byte (Y8) */
+};
+
+/* Bytes occupied by @width pixels of a packed row, without padding. */
+static inline unsigned int raw_row_bytes(enum raw_packing packing,
+					 unsigned int width)
+{
+	switch (packing) {
+	case RAW_PACKED10:
+		return (width + 3) / 4 * 5;
+	case RAW_PACKED12:
+		return (width + 1) / 2 * 3;
+	case RAW_UNPACKED8:
+		return width;
+	default:
+		return width * 2;
+	}
+}
+
+/*
+ * Guess the packing from the stride the driver reports. CAMSS calls its
+ * packed RDI output RG10, so the fourcc alone cannot be trusted.
+ */
+static inline enum raw_packing raw_packing_from_stride(unsigned int bpp,
+						       unsigned int width,
+						       unsigned int stride)
+{
+	if (bpp == 8)
+		return RAW_UNPACKED8;
+	if (stride >= width * 2)
+		return RAW_UNPACKED16;
+
+	return bpp == 12 ? RAW_PACKED12 : RAW_PACKED10;
+}
+
+/* Row kernels: convert @width pixels from @src to @dst. */
+struct raw_unpack_ops {
+	const char *name;
+	void (*raw10_to16)(const uint8_t *src, uint16_t *dst,
+			   unsigned int width);
+	void (*raw10_to8)(const uint8_t *src, uint8_t *dst, unsigned int width);
+	void (*raw12_to16)(const uint8_t *src, uint16_t *dst,
+			   unsigned int width);
+	void (*raw12_to8)(const uint8_t *src, uint8_t *dst, unsigned int width);
+};
+
+extern const struct raw_unpack_ops raw_unpack_c;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct raw_unpack_ops raw_unpack_ssse3;
+extern const struct raw_unpack_ops raw_unpack_avx2;
+#endif
+#if defined(__aarch64__)
+extern const struct raw_unpack_ops raw_unpack_neon;
+#endif
+
+const struct raw_unpack_ops *raw_unpack_best(void);
+/* Look up an implementation by name, NULL if absent or unsupported. */
+const struct raw_unpack_ops *raw_unpack_find(const char *name);
+/* All implementations usable on this CPU, scalar first, NULL terminated. */
+const struct raw_unpack_ops * const *raw_unpack_list(void);
+
+/* Scalar tails, shared with the SIMD kernels. @x is a pixel offset. */
+void raw10_to16_c(const uint8_t *src, uint16_t *dst, unsigned int x,
+		  unsigned int width);
+void raw10_to8_c(const uint8_t *src, uint8_t *dst, unsigned int x,
+		 unsigned int width);
+void raw12_to16_c(const uint8_t *src, uint16_t *dst, unsigned int x,
+		  unsigned int width);
+void raw12_to8_c(const uint8_t *src, uint8_t *dst, unsigned int x,
+		 unsigned int width);
+
+#endif /* CAMERA_TOOLS_RAW_UNPACK_H */
@@ -0,0 +1,132 @@
+/*
+ * MIPI CSI-2 RAW10/RAW12 unpacking: AArch64 Advanced SIMD kernels.
+ *
+ * Same scheme as the x86 kernels: TBL gathers MSB and LSB bytes into
+ * 16-bit lanes, USHL applies a per-lane shift to line up each pixel's LSB
+ * field. Loads are 16 bytes, so the vector loops leave enough pixels for
+ * the scalar tail to avoid reading past the packed row.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include "raw_unpack.h"
+
+#define Z	0xff	/* TBL: out of range index yields zero */
+
+static const uint8_t raw10_msb_idx[16] = {
+	0, Z, 1, Z, 2, Z, 3, Z, 5, Z, 6, Z, 7, Z, 8, Z
+};
+static const uint8_t raw10_lsb_idx[16] = {
+	4, Z, 4, Z, 4, Z, 4, Z, 9, Z, 9, Z, 9, Z, 9, Z
+};
+/* negative USHL counts shift right: pixel i's LSBs sit at bits 2i+1:2i */
+static const int16_t raw10_lsb_shift[8] = { 0, -2, -4, -6, 0, -2, -4, -6 };
+static const uint8_t raw10_msb8_idx[16] = {
+	0, 1, 2, 3, 5, 6, 7, 8, Z, Z, Z, Z, Z, Z, Z, Z
+};
+
+static const uint8_t raw12_msb_idx[16] = {
+	0, Z, 1, Z, 3, Z, 4, Z, 6, Z, 7, Z, 9, Z, 10, Z
+};
+static const uint8_t raw12_lsb_idx[16] = {
+	2, Z, 2, Z, 5, Z, 5, Z, 8, Z, 8, Z, 11, Z, 11, Z
+};
+static const int16_t raw12_lsb_shift[8] = { 0, -4, 0, -4, 0, -4, 0, -4 };
+static const uint8_t raw12_msb8_idx[16] = {
+	0, 1, 3, 4, 6, 7, 9, 10, Z, Z, Z, Z, Z, Z, Z, Z
+};
+
+static inline uint16x8_t unpack_8px(uint8x16_t v, uint8x16_t msb,
+				    uint8x16_t lsb, int16x8_t shift,
+				    int hi_shift, uint16x8_t lo_mask)
+{
+	uint16x8_t hi = vreinterpretq_u16_u8(vqtbl1q_u8(v, msb));
+	uint16x8_t lo = vreinterpretq_u16_u8(vqtbl1q_u8(v, lsb));
+
+	hi = vshlq_u16(hi, vdupq_n_s16(hi_shift));
+	lo = vandq_u16(vshlq_u16(lo, shift), lo_mask);
+
+	return vorrq_u16(hi, lo);
+}
+
+static void raw10_to16_neon(const uint8_t *src, uint16_t *dst,
+			    unsigned int width)
+{
+	const uint8x16_t msb = vld1q_u8(raw10_msb_idx);
+	const uint8x16_t lsb = vld1q_u8(raw10_lsb_idx);
+	const int16x8_t shift = vld1q_s16(raw10_lsb_shift);
+	const uint16x8_t mask = vdupq_n_u16(3);
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 8, src += 10)
+		vst1q_u16(dst + x, unpack_8px(vld1q_u8(src), msb, lsb, shift,
+					      2, mask));
+
+	raw10_to16_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void raw10_to8_neon(const uint8_t *src, uint8_t *dst,
+			   unsigned int width)
+{
+	const uint8x16_t msb = vld1q_u8(raw10_msb8_idx);
+	unsigned int x;
+
+	/* Two overlapping 16-byte loads cover 16 pixels (20 bytes). */
+	for (x = 0; x + 24 <= width; x += 16, src += 20) {
+		uint8x8_t a = vget_low_u8(vqtbl1q_u8(vld1q_u8(src), msb));
+		uint8x8_t b = vget_low_u8(vqtbl1q_u8(vld1q_u8(src + 10), msb));
+
+		vst1q_u8(dst + x, vcombine_u8(a, b));
+	}
+
+	raw10_to8_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void raw12_to16_neon(const uint8_t *src, uint16_t *dst,
+			    unsigned int width)
+{
+	const uint8x16_t msb = vld1q_u8(raw12_msb_idx);
+	const uint8x16_t lsb = vld1q_u8(raw12_lsb_idx);
+	const int16x8_t shift = vld1q_s16(raw12_lsb_shift);
+	const uint16x8_t mask = vdupq_n_u16(0xf);
+	unsigned int x;
+
+	for (x = 0; x + 12 <= width; x += 8, src += 12)
+		vst1q_u16(dst + x, unpack_8px(vld1q_u8(src), msb, lsb, shift,
+					      4, mask));
+
+	raw12_to16_c(src - x / 2 * 3, dst, x, width);
+}
+
+static void raw12_to8_neon(const uint8_t *src, uint8_t *dst,
+			   unsigned int width)
+{
+	unsigned int x;
+
+	/* LD3 de-interleaves MSB0/MSB1/LSB across 16 groups. */
+	for (x = 0; x + 32 <= width; x += 32, src += 48) {
+		uint8x16x3_t v = vld3q_u8(src);
+		uint8x16x2_t o = { { v.val[0], v.val[1] } };
+
+		vst2q_u8(dst + x, o);
+	}
+
+	raw12_to8_c(src - x / 2 * 3, dst, x, width);
+}
+
+const struct raw_unpack_ops raw_unpack_neon = {
+	.name = "neon",
+	.raw10_to16 = raw10_to16_neon,
+	.raw10_to8 = raw10_to8_neon,
+	.raw12_to16 = raw12_to16_neon,
+	.raw12_to8 = raw12_to8_neon,
+};
+
+#endif /* __aarch64__ */
@@ -0,0 +1,240 @@
+/*
+ * MIPI CSI-2 RAW10/RAW12 unpacking: SSSE3 and AVX2 kernels.
+ *
+ * Each kernel gathers the MSB byte and the shared LSB byte of every pixel
+ * into 16-bit lanes with PSHUFB, then moves each pixel's LSB field into
+ * place with a per-lane multiply (a variable left shift) and a mask. The
+ * vector loops stop early enough that the 16-byte loads never read past
+ * the packed row; the scalar kernels finish the tail.
+ *
+ * The functions carry target attributes, so the file builds with plain
+ * -O2 and the dispatcher only calls what cpuid reports.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "raw_unpack.h"
+
+#define SSSE3	__attribute__((target("ssse3")))
+#define AVX2	__attribute__((target("avx2")))
+
+#define Z	-1	/* PSHUFB: zero the lane byte */
+
+/* RAW10: 8 pixels from 10 bytes. */
+#define RAW10_MSB_MASK	0, Z, 1, Z, 2, Z, 3, Z, 5, Z, 6, Z, 7, Z, 8, Z
+#define RAW10_LSB_MASK	4, Z, 4, Z, 4, Z, 4, Z, 9, Z, 9, Z, 9, Z, 9, Z
+/* lsb << (6 - 2 * i) puts pixel i's bits at 7:6 */
+#define RAW10_LSB_MUL	64, 16, 4, 1, 64, 16, 4, 1
+#define RAW10_MSB8_MASK	0, 1, 2, 3, 5, 6, 7, 8, Z, Z, Z, Z, Z, Z, Z, Z
+
+/* RAW12: 8 pixels from 12 bytes. */
+#define RAW12_MSB_MASK	0, Z, 1, Z, 3, Z, 4, Z, 6, Z, 7, Z, 9, Z, 10, Z
+#define RAW12_LSB_MASK	2, Z, 2, Z, 5, Z, 5, Z, 8, Z, 8, Z, 11, Z, 11, Z
+#define RAW12_LSB_MUL	16, 1, 16, 1, 16, 1, 16, 1
+#define RAW12_MSB8_MASK	0, 1, 3, 4, 6, 7, 9, 10, Z, Z, Z, Z, Z, Z, Z, Z
+
+static inline __m128i SSSE3 load16(const uint8_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline __m128i SSSE3 unpack_8px(__m128i v, __m128i msb, __m128i lsb,
+				       __m128i mul, int hi_shift, int lo_shift,
+				       __m128i lo_mask)
+{
+	__m128i hi = _mm_slli_epi16(_mm_shuffle_epi8(v, msb), hi_shift);
+	__m128i lo = _mm_mullo_epi16(_mm_shuffle_epi8(v, lsb), mul);
+
+	lo = _mm_and_si128(_mm_srli_epi16(lo, lo_shift), lo_mask);
+
+	return _mm_or_si128(hi, lo);
+}
+
+static void SSSE3 raw10_to16_ssse3(const uint8_t *src, uint16_t *dst,
+				   unsigned int width)
+{
+	const __m128i msb = _mm_setr_epi8(RAW10_MSB_MASK);
+	const __m128i lsb = _mm_setr_epi8(RAW10_LSB_MASK);
+	const __m128i mul = _mm_setr_epi16(RAW10_LSB_MUL);
+	const __m128i mask = _mm_set1_epi16(3);
+	unsigned int x;
+
+	/* 10 bytes consumed, 16 loaded: keep 13 pixels of slack. */
+	for (x = 0; x + 16 <= width; x += 8, src += 10)
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 unpack_8px(load16(src), msb, lsb, mul, 2, 6,
+					    mask));
+
+	raw10_to16_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void SSSE3 raw10_to8_ssse3(const uint8_t *src, uint8_t *dst,
+				  unsigned int width)
+{
+	const __m128i msb = _mm_setr_epi8(RAW10_MSB8_MASK);
+	unsigned int x;
+
+	for (x = 0; x + 24 <= width; x += 16, src += 20) {
+		__m128i a = _mm_shuffle_epi8(load16(src), msb);
+		__m128i b = _mm_shuffle_epi8(load16(src + 10), msb);
+
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 _mm_unpacklo_epi64(a, b));
+	}
+
+	raw10_to8_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void SSSE3 raw12_to16_ssse3(const uint8_t *src, uint16_t *dst,
+				   unsigned int width)
+{
+	const __m128i msb = _mm_setr_epi8(RAW12_MSB_MASK);
+	const __m128i lsb = _mm_setr_epi8(RAW12_LSB_MASK);
+	const __m128i mul = _mm_setr_epi16(RAW12_LSB_MUL);
+	const __m128i mask = _mm_set1_epi16(0xf);
+	unsigned int x;
+
+	for (x = 0; x + 12 <= width; x += 8, src += 12)
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 unpack_8px(load16(src), msb, lsb, mul, 4, 4,
+					    mask));
+
+	raw12_to16_c(src - x / 2 * 3, dst, x, width);
+}
+
+static void SSSE3 raw12_to8_ssse3(const uint8_t *src, uint8_t *dst,
+				  unsigned int width)
+{
+	const __m128i msb = _mm_setr_epi8(RAW12_MSB8_MASK);
+	unsigned int x;
+
+	for (x = 0; x + 20 <= width; x += 16, src += 24) {
+		__m128i a = _mm_shuffle_epi8(load16(src), msb);
+		__m128i b = _mm_shuffle_epi8(load16(src + 12), msb);
+
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 _mm_unpacklo_epi64(a, b));
+	}
+
+	raw12_to8_c(src - x / 2 * 3, dst, x, width);
+}
+
+const struct raw_unpack_ops raw_unpack_ssse3 = {
+	.name = "ssse3",
+	.raw10_to16 = raw10_to16_ssse3,
+	.raw10_to8 = raw10_to8_ssse3,
+	.raw12_to16 = raw12_to16_ssse3,
+	.raw12_to8 = raw12_to8_ssse3,
+};
+
+/*
+ * AVX2: VPSHUFB shuffles within 128-bit lanes, so each lane is loaded
+ * from its own source offset and reuses the SSSE3 masks.
+ */
+static inline __m256i AVX2 load2x16(const uint8_t *lo, const uint8_t *hi)
+{
+	__m256i v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+
+	return _mm256_inserti128_si256(v, _mm_loadu_si128((const __m128i *)hi),
+				       1);
+}
+
+static inline __m256i AVX2 unpack_16px(__m256i v, __m256i msb, __m256i lsb,
+				       __m256i mul, int hi_shift, int lo_shift,
+				       __m256i lo_mask)
+{
+	__m256i hi = _mm256_slli_epi16(_mm256_shuffle_epi8(v, msb), hi_shift);
+	__m256i lo = _mm256_mullo_epi16(_mm256_shuffle_epi8(v, lsb), mul);
+
+	lo = _mm256_and_si256(_mm256_srli_epi16(lo, lo_shift), lo_mask);
+
+	return _mm256_or_si256(hi, lo);
+}
+
+static void AVX2 raw10_to16_avx2(const uint8_t *src, uint16_t *dst,
+				 unsigned int width)
+{
+	const __m256i msb = _mm256_setr_epi8(RAW10_MSB_MASK, RAW10_MSB_MASK);
+	const __m256i lsb = _mm256_setr_epi8(RAW10_LSB_MASK, RAW10_LSB_MASK);
+	const __m256i mul = _mm256_setr_epi16(RAW10_LSB_MUL, RAW10_LSB_MUL);
+	const __m256i mask = _mm256_set1_epi16(3);
+	unsigned int x;
+
+	for (x = 0; x + 24 <= width; x += 16, src += 20)
+		_mm256_storeu_si256((__m256i *)(dst + x),
+				    unpack_16px(load2x16(src, src + 10), msb,
+						lsb, mul, 2, 6, mask));
+
+	raw10_to16_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void AVX2 raw10_to8_avx2(const uint8_t *src, uint8_t *dst,
+				unsigned int width)
+{
+	const __m256i msb = _mm256_setr_epi8(RAW10_MSB8_MASK, RAW10_MSB8_MASK);
+	unsigned int x;
+
+	for (x = 0; x + 40 <= width; x += 32, src += 40) {
+		/* lanes: pixels 0-7 | 16-23 and 8-15 | 24-31 */
+		__m256i a = _mm256_shuffle_epi8(load2x16(src, src + 20), msb);
+		__m256i b = _mm256_shuffle_epi8(load2x16(src + 10, src + 30),
+						msb);
+
+		_mm256_storeu_si256((__m256i *)(dst + x),
+				    _mm256_unpacklo_epi64(a, b));
+	}
+
+	raw10_to8_c(src - x / 4 * 5, dst, x, width);
+}
+
+static void AVX2 raw12_to16_avx2(const uint8_t *src, uint16_t *dst,
+				 unsigned int width)
+{
+	const __m256i msb = _mm256_setr_epi8(RAW12_MSB_MASK, RAW12_MSB_MASK);
+	const __m256i lsb = _mm256_setr_epi8(RAW12_LSB_MASK, RAW12_LSB_MASK);
+	const __m256i mul = _mm256_setr_epi16(RAW12_LSB_MUL, RAW12_LSB_MUL);
+	const __m256i mask = _mm256_set1_epi16(0xf);
+	unsigned int x;
+
+	for (x = 0; x + 20 <= width; x += 16, src += 24)
+		_mm256_storeu_si256((__m256i *)(dst + x),
+				    unpack_16px(load2x16(src, src + 12), msb,
+						lsb, mul, 4, 4, mask));
+
+	raw12_to16_c(src - x / 2 * 3, dst, x, width);
+}
+
+static void AVX2 raw12_to8_avx2(const uint8_t *src, uint8_t *dst,
+				unsigned int width)
+{
+	const __m256i msb = _mm256_setr_epi8(RAW12_MSB8_MASK, RAW12_MSB8_MASK);
+	unsigned int x;
+
+	for (x = 0; x + 36 <= width; x += 32, src += 48) {
+		__m256i a = _mm256_shuffle_epi8(load2x16(src, src + 24), msb);
+		__m256i b = _mm256_shuffle_epi8(load2x16(src + 12, src + 36),
+						msb);
+
+		_mm256_storeu_si256((__m256i *)(dst + x),
+				    _mm256_unpacklo_epi64(a, b));
+	}
+
+	raw12_to8_c(src - x / 2 * 3, dst, x, width);
+}
+
+const struct raw_unpack_ops raw_unpack_avx2 = {
+	.name = "avx2",
+	.raw10_to16 = raw10_to16_avx2,
+	.raw10_to8 = raw10_to8_avx2,
+	.raw12_to16 = raw12_to16_avx2,
+	.raw12_to8 = raw12_to8_avx2,
+};
+
+#endif /* __x86_64__ || __i386__ */
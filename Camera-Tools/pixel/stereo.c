@@ -0,0 +1,704 @@
+/*
+ * Stereo depth: scalar kernels, dispatch, calibration, the remap LUTs and
+ * the banded frame drivers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stereo.h"
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+/* Column sums of one tile, per band; sized to stay in L1. */
+#define STEREO_TILE_BYTES	16384
+
+/* Remap LUT entry: Q4 x in the low half, Q4 y in the high half. */
+#define STEREO_MAP_NONE		0xffffffffu
+
+static inline uint8_t absdiff(uint8_t a, uint8_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static void stereo_sad_row_c(uint16_t *col, const uint8_t *l,
+			     const uint8_t *r, const uint8_t *ls,
+			     const uint8_t *rs, unsigned int count,
+			     unsigned int ndisp)
+{
+	unsigned int i, d;
+
+	for (i = 0; i < count; i++) {
+		uint16_t *c = col + i * ndisp;
+		const uint8_t *ra = r - i;
+
+		for (d = 0; d < ndisp; d++)
+			c[d] += absdiff(l[i], ra[d]);
+
+		if (ls) {
+			const uint8_t *rsa = rs - i;
+
+			for (d = 0; d < ndisp; d++)
+				c[d] -= absdiff(ls[i], rsa[d]);
+		}
+	}
+}
+
+static void stereo_match_row_c(const uint16_t *col, uint16_t *cost,
+			       uint16_t *disp, unsigned int count,
+			       unsigned int ndisp, unsigned int half,
+			       unsigned int uniqueness)
+{
+	unsigned int i, k, d;
+
+	memset(cost, 0, ndisp * sizeof(*cost));
+	for (k = 0; k <= 2 * half; k++)
+		for (d = 0; d < ndisp; d++)
+			cost[d] += col[k * ndisp + d];
+
+	for (i = 0; i < count; i++) {
+		unsigned int best = 0, min = STEREO_COST_MAX;
+		unsigned int second = STEREO_COST_MAX;
+
+		if (i) {
+			const uint16_t *in = col + (i + 2 * half) * ndisp;
+			const uint16_t *out = col + (i - 1) * ndisp;
+
+			for (d = 0; d < ndisp; d++)
+				cost[d] += in[d] - out[d];
+		}
+
+		for (d = 0; d < ndisp; d++) {
+			if (cost[d] < min) {
+				min = cost[d];
+				best = d;
+			}
+		}
+		for (d = 0; d < ndisp; d++)
+			if ((d + 1 < best || d > best + 1) && cost[d] < second)
+				second = cost[d];
+
+		disp[i] = stereo_pick(cost, ndisp, best, min, second,
+				      uniqueness);
+	}
+}
+
+const struct stereo_ops stereo_ops_c = {
+	.name = "c",
+	.sad_row = stereo_sad_row_c,
+	.match_row = stereo_match_row_c,
+};
+
+static const struct stereo_ops *stereo_impls[3];
+
+static void stereo_ops_probe(void)
+{
+	unsigned int n = 0;
+
+	if (stereo_impls[0])
+		return;
+
+	stereo_impls[n++] = &stereo_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		stereo_impls[n++] = &stereo_ops_sse2;
+#endif
+#if defined(__aarch64__)
+	stereo_impls[n++] = &stereo_ops_neon;
+#endif
+	stereo_impls[n] = NULL;
+}
+
+const struct stereo_ops * const *stereo_ops_list(void)
+{
+	stereo_ops_probe();
+
+	return stereo_impls;
+}
+
+const struct stereo_ops *stereo_ops_best(void)
+{
+	static const struct stereo_ops *best;
+	unsigned int i;
+
+	if (best)
+		return best;
+
+	stereo_ops_probe();
+	for (i = 0; stereo_impls[i]; i++)
+		best = stereo_impls[i];
+
+	return best;
+}
+
+const struct stereo_ops *stereo_ops_find(const char *name)
+{
+	unsigned int i;
+
+	stereo_ops_probe();
+	for (i = 0; stereo_impls[i]; i++)
+		if (!strcmp(stereo_impls[i]->name, name))
+			return stereo_impls[i];
+
+	return NULL;
+}
+
+void stereo_params_default(struct stereo_params *params, unsigned int width)
+{
+	unsigned int ndisp = (width / 10 + 8) & ~15u;
+
+	memset(params, 0, sizeof(*params));
+	params->num_disparities = ndisp < 16 ? 16 :
+				  ndisp > STEREO_MAX_DISP ? STEREO_MAX_DISP :
+				  ndisp;
+	params->block = 9;
+	params->uniqueness = 10;
+}
+
+/* Calibration file: bits of the lines seen. */
+#define CALIB_SIZE	(1 << 0)
+#define CALIB_K(side)	(1 << (1 + (side)))
+#define CALIB_P(side)	(1 << (3 + (side)))
+
+static int stereo_calib_line(struct stereo_calib *calib, char *line,
+			     unsigned int *seen)
+{
+	struct stereo_camera *cam;
+	char *key, *field, *tok;
+	unsigned int side, n = 0;
+	double v[10];
+
+	key = strtok(line, " \t");
+	if (!key)
+		return 0;
+
+	while ((tok = strtok(NULL, " \t"))) {
+		char *end;
+
+		if (n == ARRAY_SIZE(v))
+			return -EINVAL;
+		v[n++] = strtod(tok, &end);
+		if (end == tok || *end)
+			return -EINVAL;
+	}
+
+	if (!strcmp(key, "size") && n == 2) {
+		if (v[0] < 1 || v[1] < 1)
+			return -EINVAL;
+		calib->width = v[0];
+		calib->height = v[1];
+		*seen |= CALIB_SIZE;
+		return 0;
+	}
+	if (!strcmp(key, "baseline") && n == 1) {
+		calib->baseline = fabs(v[0]);
+		return 0;
+	}
+
+	if (!strncmp(key, "left.", 5)) {
+		side = STEREO_LEFT;
+		field = key + 5;
+	} else if (!strncmp(key, "right.", 6)) {
+		side = STEREO_RIGHT;
+		field = key + 6;
+	} else {
+		return -EINVAL;
+	}
+	cam = &calib->cam[side];
+
+	if (!strcmp(field, "K") && n == 4) {
+		if (v[0] <= 0 || v[1] <= 0)
+			return -EINVAL;
+		memcpy(cam->K, v, sizeof(cam->K));
+		*seen |= CALIB_K(side);
+	} else if (!strcmp(field, "D") && (n == 4 || n == 5)) {
+		memset(cam->D, 0, sizeof(cam->D));
+		memcpy(cam->D, v, n * sizeof(v[0]));
+	} else if (!strcmp(field, "R") && n == 9) {
+		memcpy(cam->R, v, sizeof(cam->R));
+	} else if (!strcmp(field, "P") && n == 4) {
+		if (v[0] <= 0 || v[1] <= 0)
+			return -EINVAL;
+		memcpy(cam->P, v, sizeof(cam->P));
+		*seen |= CALIB_P(side);
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int stereo_calib_load(const char *path, struct stereo_calib *calib)
+{
+	unsigned int lineno = 0, seen = 0, side;
+	char line[512];
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(path, "r");
+	if (!f) {
+		ret = -errno;
+		fprintf(stderr, "%s: open failed: %s\n", path, strerror(errno));
+		return ret;
+	}
+
+	memset(calib, 0, sizeof(*calib));
+	for (side = 0; side < 2; side++) {
+		calib->cam[side].R[0] = 1;
+		calib->cam[side].R[4] = 1;
+		calib->cam[side].R[8] = 1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		line[strcspn(line, "#\r\n")] = '\0';
+		ret = stereo_calib_line(calib, line, &seen);
+		if (ret < 0) {
+			fprintf(stderr, "%s:%u: invalid line\n", path, lineno);
+			goto out;
+		}
+	}
+
+	if ((seen & (CALIB_SIZE | CALIB_K(0) | CALIB_K(1))) !=
+	    (CALIB_SIZE | CALIB_K(0) | CALIB_K(1))) {
+		fprintf(stderr, "%s: needs size, left.K and right.K\n", path);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (side = 0; side < 2; side++)
+		if (!(seen & CALIB_P(side)))
+			memcpy(calib->cam[side].P, calib->cam[side].K,
+			       sizeof(calib->cam[side].P));
+
+out:
+	fclose(f);
+	return ret;
+}
+
+struct stereo_band {
+	uint16_t *col;			/* tile + block - 1 columns of sums */
+	uint16_t *cost;
+};
+
+struct stereo {
+	unsigned int width;
+	unsigned int height;
+	struct stereo_params params;
+	unsigned int tile;		/* columns per tile */
+	struct workpool *pool;
+	const struct stereo_ops *ops;
+
+	uint32_t *map[2];		/* NULL: rectified already */
+	uint8_t *rect[2];
+	uint8_t *rrev;			/* rect[STEREO_RIGHT], rows mirrored */
+	uint16_t *depth;		/* by Q4 disparity, NULL: no baseline */
+
+	/* Current frame. */
+	enum stereo_src fmt;
+	const uint8_t *src[2];
+	unsigned int src_stride[2];
+	uint16_t *disp;
+	unsigned int disp_stride;
+
+	unsigned int num_bands;
+	struct stereo_band bands[];
+};
+
+/* Intrinsics at another resolution, pixel centres kept in place. */
+static void stereo_scale(const double in[4], double s, double out[4])
+{
+	out[0] = in[0] * s;
+	out[1] = in[1] * s;
+	out[2] = (in[2] + 0.5) * s - 0.5;
+	out[3] = (in[3] + 0.5) * s - 0.5;
+}
+
+/*
+ * For every rectified pixel: back through the rectified projection and
+ * the inverse (transposed) rotation to a ray, then through the distortion
+ * model and the camera matrix to the source pixel.
+ */
+static void stereo_build_map(uint32_t *map, const struct stereo_camera *cam,
+			     double s, unsigned int width, unsigned int height)
+{
+	const double *R = cam->R, *D = cam->D;
+	double K[4], P[4];
+	unsigned int u, v;
+
+	stereo_scale(cam->K, s, K);
+	stereo_scale(cam->P, s, P);
+
+	for (v = 0; v < height; v++) {
+		for (u = 0; u < width; u++) {
+			double xp = (u - P[2]) / P[0], yp = (v - P[3]) / P[1];
+			double X = R[0] * xp + R[3] * yp + R[6];
+			double Y = R[1] * xp + R[4] * yp + R[7];
+			double W = R[2] * xp + R[5] * yp + R[8];
+			double x, y, r2, radial, xd, yd;
+			long qu, qv;
+
+			*map = STEREO_MAP_NONE;
+			if (W <= 0) {
+				map++;
+				continue;
+			}
+
+			x = X / W;
+			y = Y / W;
+			r2 = x * x + y * y;
+			radial = 1 + r2 * (D[0] + r2 * (D[1] + r2 * D[4]));
+			xd = x * radial + 2 * D[2] * x * y +
+			     D[3] * (r2 + 2 * x * x);
+			yd = y * radial + D[2] * (r2 + 2 * y * y) +
+			     2 * D[3] * x * y;
+
+			qu = lrint((K[0] * xd + K[2]) * 16);
+			qv = lrint((K[1] * yd + K[3]) * 16);
+			if (qu >= 0 && qu <= (long)(width - 1) * 16 &&
+			    qv >= 0 && qv <= (long)(height - 1) * 16)
+				*map = qu | qv << 16;
+			map++;
+		}
+	}
+}
+
+/* Bilinear in Q4, 0 outside the source. */
+static void stereo_remap_row(const struct stereo *st, const uint32_t *map,
+			     const uint8_t *src, unsigned int stride,
+			     uint8_t *dst)
+{
+	unsigned int step = st->fmt == STEREO_SRC_UYVY ? 2 : 1;
+	unsigned int x;
+
+	if (st->fmt == STEREO_SRC_UYVY)
+		src++;
+
+	for (x = 0; x < st->width; x++) {
+		uint32_t m = map[x];
+		unsigned int sx, sy, fx, fy, dx, dy;
+		const uint8_t *p;
+
+		if (m == STEREO_MAP_NONE) {
+			dst[x] = 0;
+			continue;
+		}
+
+		sx = (m & 0xffff) >> 4;
+		fx = m & 15;
+		sy = m >> 20;
+		fy = (m >> 16) & 15;
+		dx = sx + 1 < st->width ? step : 0;
+		dy = sy + 1 < st->height ? stride : 0;
+		p = src + (size_t)sy * stride + sx * step;
+
+		dst[x] = (((p[0] * (16 - fx) + p[dx] * fx) * (16 - fy) +
+			   (p[dy] * (16 - fx) + p[dy + dx] * fx) * fy) +
+			  128) >> 8;
+	}
+}
+
+static void stereo_luma_row(const struct stereo *st, const uint8_t *src,
+			    uint8_t *dst)
+{
+	unsigned int x;
+
+	if (st->fmt == STEREO_SRC_Y8) {
+		memcpy(dst, src, st->width);
+		return;
+	}
+
+	for (x = 0; x < st->width; x++)
+		dst[x] = src[x * 2 + 1];
+}
+
+static void stereo_rectify_band(void *arg, unsigned int start,
+				unsigned int end)
+{
+	struct stereo *st = arg;
+	unsigned int w = st->width;
+	unsigned int b, y, x, side;
+
+	for (b = start; b < end; b++) {
+		unsigned int y0 = (unsigned long long)st->height * b /
+				  st->num_bands;
+		unsigned int y1 = (unsigned long long)st->height * (b + 1) /
+				  st->num_bands;
+
+		for (y = y0; y < y1; y++) {
+			for (side = 0; side < 2; side++) {
+				uint8_t *d = st->rect[side] + (size_t)y * w;
+
+				if (st->map[side])
+					stereo_remap_row(st, st->map[side] +
+							 (size_t)y * w,
+							 st->src[side],
+							 st->src_stride[side],
+							 d);
+				else
+					stereo_luma_row(st, st->src[side] +
+							(size_t)y *
+							st->src_stride[side],
+							d);
+			}
+
+			for (x = 0; x < w; x++)
+				st->rrev[(size_t)y * w + x] =
+					st->rect[STEREO_RIGHT][(size_t)y * w +
+							       w - 1 - x];
+		}
+	}
+}
+
+void stereo_rectify(struct stereo *st, enum stereo_src fmt,
+		    const uint8_t *left, unsigned int left_stride,
+		    const uint8_t *right, unsigned int right_stride)
+{
+	st->fmt = fmt;
+	st->src[STEREO_LEFT] = left;
+	st->src[STEREO_RIGHT] = right;
+	st->src_stride[STEREO_LEFT] = left_stride;
+	st->src_stride[STEREO_RIGHT] = right_stride;
+
+	workpool_run(st->pool, stereo_rectify_band, st, st->num_bands);
+}
+
+const uint8_t *stereo_rectified(const struct stereo *st, unsigned int side)
+{
+	return st->rect[side];
+}
+
+static void stereo_fill(uint16_t *disp, unsigned int count)
+{
+	while (count--)
+		*disp++ = STEREO_INVALID;
+}
+
+/*
+ * Rows [y0, y1) one tile of columns at a time: the tile's column sums
+ * start from the full window at its first row, then slide down by adding
+ * the row entering the window and subtracting the one leaving it.
+ */
+static void stereo_disparity_band(void *arg, unsigned int start,
+				  unsigned int end)
+{
+	struct stereo *st = arg;
+	const struct stereo_params *p = &st->params;
+	unsigned int w = st->width, ndisp = p->num_disparities;
+	unsigned int half = p->block / 2;
+	unsigned int xa = ndisp - 1 + half, xb = w - half;
+	const uint8_t *left = st->rect[STEREO_LEFT];
+	unsigned int b, y, k, tx;
+
+	for (b = start; b < end; b++) {
+		struct stereo_band *band = &st->bands[b];
+		unsigned int y0 = (unsigned long long)st->height * b /
+				  st->num_bands;
+		unsigned int y1 = (unsigned long long)st->height * (b + 1) /
+				  st->num_bands;
+		unsigned int ya = y0 > half ? y0 : half;
+		unsigned int yb = y1 < st->height - half ? y1 :
+			st->height - half;
+
+		for (y = y0; y < y1; y++) {
+			uint16_t *d = st->disp + (size_t)y * st->disp_stride;
+
+			if (y < ya || y >= yb) {
+				stereo_fill(d, w);
+				continue;
+			}
+			stereo_fill(d, xa);
+			stereo_fill(d + xb, w - xb);
+		}
+
+		for (tx = xa; tx < xb; tx += st->tile) {
+			unsigned int n = xb - tx < st->tile ? xb - tx :
+							      st->tile;
+			unsigned int cx = tx - half, ncol = n + 2 * half;
+			const uint8_t *l = left + cx;
+			const uint8_t *r = st->rrev + w - 1 - cx;
+
+			for (y = ya; y < yb; y++) {
+				if (y == ya) {
+					memset(band->col, 0, (size_t)ncol *
+					       ndisp * sizeof(uint16_t));
+					for (k = y - half; k <= y + half; k++)
+						st->ops->sad_row(band->col,
+							l + (size_t)k * w,
+							r + (size_t)k * w,
+							NULL, NULL, ncol,
+							ndisp);
+				} else {
+					size_t in = (size_t)(y + half) * w;
+					size_t out = (size_t)(y - half - 1) *
+						     w;
+
+					st->ops->sad_row(band->col, l + in,
+							 r + in, l + out,
+							 r + out, ncol, ndisp);
+				}
+
+				st->ops->match_row(band->col, band->cost,
+						   st->disp + (size_t)y *
+						   st->disp_stride + tx, n,
+						   ndisp, half,
+						   p->uniqueness);
+			}
+		}
+	}
+}
+
+void stereo_disparity(struct stereo *st, uint16_t *disp,
+		      unsigned int disp_stride)
+{
+	st->disp = disp;
+	st->disp_stride = disp_stride;
+
+	workpool_run(st->pool, stereo_disparity_band, st, st->num_bands);
+}
+
+int stereo_depth(const struct stereo *st, const uint16_t *disp,
+		 unsigned int disp_stride, uint16_t *depth,
+		 unsigned int depth_stride)
+{
+	unsigned int x, y;
+
+	if (!st->depth)
+		return -EINVAL;
+
+	for (y = 0; y < st->height; y++) {
+		const uint16_t *s = disp + (size_t)y * disp_stride;
+		uint16_t *d = depth + (size_t)y * depth_stride;
+
+		for (x = 0; x < st->width; x++)
+			d[x] = s[x] < STEREO_MAX_DISP * 16 ? st->depth[s[x]] :
+							    0;
+	}
+
+	return 0;
+}
+
+void stereo_set_ops(struct stereo *st, const struct stereo_ops *ops)
+{
+	st->ops = ops ? ops : stereo_ops_best();
+}
+
+struct stereo *stereo_create(const struct stereo_calib *calib,
+			     const struct stereo_params *params,
+			     unsigned int width, unsigned int height,
+			     struct workpool *pool)
+{
+	unsigned int ndisp = params->num_disparities;
+	unsigned int i, num_bands, tile;
+	size_t size = (size_t)width * height;
+	struct stereo *st;
+
+	if (ndisp < 16 || ndisp > STEREO_MAX_DISP || ndisp % 16 ||
+	    params->block < 3 || params->block > STEREO_MAX_BLOCK ||
+	    !(params->block & 1) || params->uniqueness >= 100 ||
+	    width < ndisp + params->block || width >= 4096 ||
+	    height < params->block)
+		return NULL;
+	if (calib && ((unsigned long long)width * calib->height !=
+		      (unsigned long long)height * calib->width))
+		return NULL;
+
+	num_bands = workpool_threads(pool);
+	if (num_bands > height)
+		num_bands = height;
+
+	tile = STEREO_TILE_BYTES / (ndisp * sizeof(uint16_t)) & ~15u;
+	if (tile < 32)
+		tile = 32;
+
+	st = calloc(1, sizeof(*st) + num_bands * sizeof(st->bands[0]));
+	if (!st)
+		return NULL;
+
+	st->width = width;
+	st->height = height;
+	st->params = *params;
+	st->tile = tile;
+	st->pool = pool;
+	st->ops = stereo_ops_best();
+	st->num_bands = num_bands;
+
+	for (i = 0; i < 2; i++) {
+		st->rect[i] = malloc(size);
+		if (!st->rect[i])
+			goto error;
+	}
+	st->rrev = malloc(size);
+	if (!st->rrev)
+		goto error;
+
+	for (i = 0; i < num_bands; i++) {
+		struct stereo_band *band = &st->bands[i];
+
+		band->col = malloc((size_t)(tile + params->block - 1) *
+				   ndisp * sizeof(uint16_t));
+		band->cost = malloc(ndisp * sizeof(uint16_t));
+		if (!band->col || !band->cost)
+			goto error;
+	}
+
+	if (!calib)
+		return st;
+
+	for (i = 0; i < 2; i++) {
+		st->map[i] = malloc(size * sizeof(uint32_t));
+		if (!st->map[i])
+			goto error;
+		stereo_build_map(st->map[i], &calib->cam[i],
+				 (double)width / calib->width, width, height);
+	}
+
+	if (calib->baseline > 0) {
+		double f = calib->cam[STEREO_LEFT].P[0] * width / calib->width;
+
+		st->depth = malloc(STEREO_MAX_DISP * 16 * sizeof(uint16_t));
+		if (!st->depth)
+			goto error;
+
+		st->depth[0] = 0;
+		for (i = 1; i < STEREO_MAX_DISP * 16; i++) {
+			double mm = f * calib->baseline * 16 / i + 0.5;
+
+			st->depth[i] = mm > 65535 ? 0 : mm;
+		}
+	}
+
+	return st;
+
+error:
+	stereo_destroy(st);
+	return NULL;
+}
+
+void stereo_destroy(struct stereo *st)
+{
+	unsigned int i;
+
+	if (!st)
+		return;
+
+	for (i = 0; i < st->num_bands; i++) {
+		free(st->bands[i].col);
+		free(st->bands[i].cost);
+	}
+	for (i = 0; i < 2; i++) {
+		free(st->map[i]);
+		free(st->rect[i]);
+	}
+	free(st->rrev);
+	free(st->depth);
+	free(st);
+}
@@ -0,0 +1,196 @@
+/*
+ * Stereo depth on the CPU for the OV5645 StereoCamera pair: rectification
+ * through precomputed remap LUTs and block-matching disparity on luma.
+ *
+ * Rectification maps each output pixel to a Q4 source position, computed
+ * once from a calibration file (intrinsics, distortion and the rectifying
+ * rotation and projection of each camera, as produced by OpenCV's
+ * stereoCalibrate and stereoRectify), and interpolates bilinearly. The
+ * sources are Y8 or UYVY frames; only luma is read.
+ *
+ * Disparity is block matching on the rectified pair with the left view as
+ * reference: the sum of absolute differences over a block x block window
+ * for each of num_disparities shifts, winner takes all, a uniqueness test
+ * against the best shift more than one pixel away and a sub-pixel offset
+ * fitted to the two neighbouring costs. The window sums are kept per
+ * column and updated by one row in and one row out, so a pixel costs the
+ * same at any block size. Results are Q4 pixels, STEREO_INVALID where no
+ * match was accepted and on the borders the window or the search range
+ * does not cover.
+ *
+ * Each thread handles a band of rows, in column tiles sized so that a
+ * tile's column sums stay in cache. The row kernels are bit-exact between
+ * the scalar, SSE2 and NEON versions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_STEREO_H
+#define CAMERA_TOOLS_STEREO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "workpool.h"
+
+#define STEREO_LEFT		0
+#define STEREO_RIGHT		1
+
+#define STEREO_INVALID		0xffff
+#define STEREO_MAX_DISP		256
+/* Window costs stay below 32768, as SSE2 only has signed 16-bit min. */
+#define STEREO_MAX_BLOCK	11
+#define STEREO_COST_MAX		0x7fff
+
+struct stereo_camera {
+	double K[4];			/* fx, fy, cx, cy */
+	double D[5];			/* k1, k2, p1, p2, k3 */
+	double R[9];			/* rectifying rotation, row-major */
+	double P[4];			/* fx, fy, cx, cy after rectification */
+};
+
+struct stereo_calib {
+	unsigned int width;		/* image size at calibration */
+	unsigned int height;
+	double baseline;		/* mm, 0 if unknown */
+	struct stereo_camera cam[2];	/* STEREO_LEFT, STEREO_RIGHT */
+};
+
+struct stereo_params {
+	unsigned int num_disparities;	/* multiple of 16, 16 to 256 */
+	unsigned int block;		/* odd, 3 to STEREO_MAX_BLOCK */
+	unsigned int uniqueness;	/* margin in percent, 0 disables */
+};
+
+enum stereo_src {
+	STEREO_SRC_Y8,
+	STEREO_SRC_UYVY,
+};
+
+/*
+ * Row kernels. Costs are uint16_t and @ndisp is a multiple of 16. The
+ * right row is passed mirrored, rrev[i] = right[width - 1 - i], so that
+ * the pixels compared with one left pixel are contiguous: @r points at
+ * the mirrored pixel of the first column, and right[x - d] of column i
+ * is r[d - i].
+ */
+struct stereo_ops {
+	const char *name;
+	/*
+	 * col[i * ndisp + d] += |l[i] - r[d - i]| for the row pair (@l, @r)
+	 * and -= the same for (@ls, @rs) unless @ls is NULL, for i < count.
+	 */
+	void (*sad_row)(uint16_t *col, const uint8_t *l, const uint8_t *r,
+			const uint8_t *ls, const uint8_t *rs,
+			unsigned int count, unsigned int ndisp);
+	/*
+	 * Disparity of @count columns: the window cost of column i and
+	 * shift d is the sum of col[(i + k) * ndisp + d], k = 0 .. 2 * half.
+	 * @cost is scratch for @ndisp costs.
+	 */
+	void (*match_row)(const uint16_t *col, uint16_t *cost, uint16_t *disp,
+			  unsigned int count, unsigned int ndisp,
+			  unsigned int half, unsigned int uniqueness);
+};
+
+extern const struct stereo_ops stereo_ops_c;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct stereo_ops stereo_ops_sse2;
+#endif
+#if defined(__aarch64__)
+extern const struct stereo_ops stereo_ops_neon;
+#endif
+
+const struct stereo_ops *stereo_ops_best(void);
+const struct stereo_ops *stereo_ops_find(const char *name);
+const struct stereo_ops * const *stereo_ops_list(void);
+
+/*
+ * The disparity of one column from its window costs, shared by every
+ * match_row(): @best is the first shift of minimum cost @min and @second
+ * the minimum cost of the shifts more than one away from it.
+ */
+static inline uint16_t stereo_pick(const uint16_t *cost, unsigned int ndisp,
+				   unsigned int best, unsigned int min,
+				   unsigned int second,
+				   unsigned int uniqueness)
+{
+	int p, n, num, denom, off;
+
+	if (second * (100 - uniqueness) < min * 100)
+		return STEREO_INVALID;
+	if (best == 0 || best == ndisp - 1)
+		return best * 16;
+
+	/* Vertex of the V through the minimum and its steeper neighbour. */
+	p = cost[best - 1];
+	n = cost[best + 1];
+	denom = p + n - 2 * (int)min + abs(p - n);
+	if (!denom)
+		return best * 16;
+	num = 16 * (p - n);
+	off = (2 * abs(num) + denom) / (2 * denom);
+
+	return best * 16 + (num < 0 ? -off : off);
+}
+
+/* Block 9, 10% uniqueness, num_disparities a tenth of @width. */
+void stereo_params_default(struct stereo_params *params, unsigned int width);
+
+/*
+ * Read a calibration file of "key values..." lines, '#' comments:
+ *
+ *	size 1280 960
+ *	baseline 60.2			(mm, optional)
+ *	left.K fx fy cx cy
+ *	left.D k1 k2 p1 p2 [k3]		(optional, default 0)
+ *	left.R r11 r12 r13 ... r33	(optional, default identity)
+ *	left.P fx fy cx cy		(optional, default K)
+ *	right.K ...
+ *
+ * Returns 0, or -errno / -EINVAL after printing the offending line.
+ */
+int stereo_calib_load(const char *path, struct stereo_calib *calib);
+
+struct stereo;
+
+/*
+ * @calib may be NULL for a pair that is rectified already; else its size
+ * must have the aspect ratio of @width x @height, and the intrinsics are
+ * scaled to it (binned modes). @width must be at least num_disparities +
+ * block and below 4096. @pool may be NULL. Returns NULL on invalid
+ * arguments or allocation failure.
+ */
+struct stereo *stereo_create(const struct stereo_calib *calib,
+			     const struct stereo_params *params,
+			     unsigned int width, unsigned int height,
+			     struct workpool *pool);
+void stereo_destroy(struct stereo *st);
+
+/* Force a kernel set (for benchmarking). NULL restores the best one. */
+void stereo_set_ops(struct stereo *st, const struct stereo_ops *ops);
+
+/* Rectify both views into the context's luma planes. */
+void stereo_rectify(struct stereo *st, enum stereo_src fmt,
+		    const uint8_t *left, unsigned int left_stride,
+		    const uint8_t *right, unsigned int right_stride);
+
+/* The rectified luma of @side, @width bytes per row. */
+const uint8_t *stereo_rectified(const struct stereo *st, unsigned int side);
+
+/* Disparity of the last rectified pair, Q4 or STEREO_INVALID. */
+void stereo_disparity(struct stereo *st, uint16_t *disp,
+		      unsigned int disp_stride);
+
+/*
+ * Disparity to depth in mm, 0 where unknown. Needs a calibration with a
+ * baseline; returns -EINVAL otherwise. Strides are in elements.
+ */
+int stereo_depth(const struct stereo *st, const uint16_t *disp,
+		 unsigned int disp_stride, uint16_t *depth,
+		 unsigned int depth_stride);
+
+#endif /* CAMERA_TOOLS_STEREO_H */
@@ -0,0 +1,124 @@
+/*
+ * Stereo depth: AArch64 Advanced SIMD row kernels, with the lane layout
+ * of the SSE2 version. UABAL folds the absolute difference into the
+ * widening add, and UMINV replaces the shuffle reductions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include "stereo.h"
+
+static void stereo_sad_row_neon(uint16_t *col, const uint8_t *l,
+				const uint8_t *r, const uint8_t *ls,
+				const uint8_t *rs, unsigned int count,
+				unsigned int ndisp)
+{
+	unsigned int i, d;
+
+	for (i = 0; i < count; i++) {
+		uint16_t *c = col + i * ndisp;
+		uint8x16_t lv = vdupq_n_u8(l[i]);
+		uint8x16_t sv = vdupq_n_u8(ls ? ls[i] : 0);
+
+		for (d = 0; d < ndisp; d += 16) {
+			uint8x16_t rv = vld1q_u8(r - i + d);
+			uint16x8_t lo = vld1q_u16(c + d);
+			uint16x8_t hi = vld1q_u16(c + d + 8);
+
+			lo = vabal_u8(lo, vget_low_u8(lv), vget_low_u8(rv));
+			hi = vabal_high_u8(hi, lv, rv);
+			if (ls) {
+				uint8x16_t s = vabdq_u8(sv,
+							vld1q_u8(rs - i + d));
+
+				lo = vsubw_u8(lo, vget_low_u8(s));
+				hi = vsubw_high_u8(hi, s);
+			}
+			vst1q_u16(c + d, lo);
+			vst1q_u16(c + d + 8, hi);
+		}
+	}
+}
+
+static void stereo_match_row_neon(const uint16_t *col, uint16_t *cost,
+				  uint16_t *disp, unsigned int count,
+				  unsigned int ndisp, unsigned int half,
+				  unsigned int uniqueness)
+{
+	static const uint16_t lane_init[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	const uint16x8_t max = vdupq_n_u16(STEREO_COST_MAX);
+	const uint16x8_t one = vdupq_n_u16(1);
+	const uint16x8_t eight = vdupq_n_u16(8);
+	const uint16x8_t lanes = vld1q_u16(lane_init);
+	unsigned int i, k, d;
+
+	for (d = 0; d < ndisp; d += 8) {
+		uint16x8_t s = vdupq_n_u16(0);
+
+		for (k = 0; k <= 2 * half; k++)
+			s = vaddq_u16(s, vld1q_u16(col + k * ndisp + d));
+		vst1q_u16(cost + d, s);
+	}
+
+	for (i = 0; i < count; i++) {
+		uint16x8_t vmin = max, vbest = max, vsec = max, idx, bv;
+		unsigned int min, best;
+
+		if (i) {
+			const uint16_t *in = col + (i + 2 * half) * ndisp;
+			const uint16_t *out = col + (i - 1) * ndisp;
+
+			for (d = 0; d < ndisp; d += 8) {
+				uint16x8_t c = vsubq_u16(vld1q_u16(in + d),
+							 vld1q_u16(out + d));
+
+				c = vaddq_u16(vld1q_u16(cost + d), c);
+				vst1q_u16(cost + d, c);
+				vmin = vminq_u16(vmin, c);
+			}
+		} else {
+			for (d = 0; d < ndisp; d += 8)
+				vmin = vminq_u16(vmin, vld1q_u16(cost + d));
+		}
+		min = vminvq_u16(vmin);
+
+		vmin = vdupq_n_u16(min);
+		idx = lanes;
+		for (d = 0; d < ndisp; d += 8) {
+			uint16x8_t eq = vceqq_u16(vld1q_u16(cost + d), vmin);
+
+			vbest = vminq_u16(vbest, vbslq_u16(eq, idx, max));
+			idx = vaddq_u16(idx, eight);
+		}
+		best = vminvq_u16(vbest);
+
+		bv = vdupq_n_u16(best);
+		idx = lanes;
+		for (d = 0; d < ndisp; d += 8) {
+			uint16x8_t far = vcgtq_u16(vabdq_u16(idx, bv), one);
+
+			vsec = vminq_u16(vsec, vbslq_u16(far,
+							 vld1q_u16(cost + d),
+							 max));
+			idx = vaddq_u16(idx, eight);
+		}
+
+		disp[i] = stereo_pick(cost, ndisp, best, min, vminvq_u16(vsec),
+				      uniqueness);
+	}
+}
+
+const struct stereo_ops stereo_ops_neon = {
+	.name = "neon",
+	.sad_row = stereo_sad_row_neon,
+	.match_row = stereo_match_row_neon,
+};
+
+#endif /* __aarch64__ */
@@ -0,0 +1,159 @@
+/*
+ * Stereo depth: SSE2 row kernels.
+ *
+ * Shifts run along the vector lanes: against the mirrored right row the
+ * 16 candidates of one left pixel are a single unaligned load, so the
+ * absolute differences are one PSUBUSB pair and the window costs update
+ * eight shifts per instruction. The minimum, its first shift and the
+ * runner-up are found with PMINSW over masked costs and shift indices,
+ * which is why costs are kept below 32768.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+#include "stereo.h"
+
+#define SSE2	__attribute__((target("sse2")))
+
+static inline __m128i SSE2 load(const void *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void SSE2 store(void *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i SSE2 blend(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i SSE2 absdiff8(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+/* Smallest of eight values in [0, 0x7fff]. */
+static inline unsigned int SSE2 hmin(__m128i v)
+{
+	v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_min_epi16(v, _mm_srli_epi32(v, 16));
+
+	return _mm_cvtsi128_si32(v) & 0xffff;
+}
+
+static void SSE2 stereo_sad_row_sse2(uint16_t *col, const uint8_t *l,
+				     const uint8_t *r, const uint8_t *ls,
+				     const uint8_t *rs, unsigned int count,
+				     unsigned int ndisp)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i, d;
+
+	for (i = 0; i < count; i++) {
+		uint16_t *c = col + i * ndisp;
+		__m128i lv = _mm_set1_epi8(l[i]);
+		__m128i sv = _mm_set1_epi8(ls ? ls[i] : 0);
+
+		for (d = 0; d < ndisp; d += 16) {
+			__m128i a = absdiff8(lv, load(r - i + d));
+			__m128i s = ls ? absdiff8(sv, load(rs - i + d)) : zero;
+			__m128i lo = load(c + d), hi = load(c + d + 8);
+
+			lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero));
+			hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero));
+			lo = _mm_sub_epi16(lo, _mm_unpacklo_epi8(s, zero));
+			hi = _mm_sub_epi16(hi, _mm_unpackhi_epi8(s, zero));
+			store(c + d, lo);
+			store(c + d + 8, hi);
+		}
+	}
+}
+
+static void SSE2 stereo_match_row_sse2(const uint16_t *col, uint16_t *cost,
+				       uint16_t *disp, unsigned int count,
+				       unsigned int ndisp, unsigned int half,
+				       unsigned int uniqueness)
+{
+	const __m128i max = _mm_set1_epi16(STEREO_COST_MAX);
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i eight = _mm_set1_epi16(8);
+	const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i, k, d;
+
+	for (d = 0; d < ndisp; d += 8) {
+		__m128i s = zero;
+
+		for (k = 0; k <= 2 * half; k++)
+			s = _mm_add_epi16(s, load(col + k * ndisp + d));
+		store(cost + d, s);
+	}
+
+	for (i = 0; i < count; i++) {
+		__m128i vmin = max, vbest = max, vsec = max, idx, bv;
+		unsigned int min, best;
+
+		if (i) {
+			const uint16_t *in = col + (i + 2 * half) * ndisp;
+			const uint16_t *out = col + (i - 1) * ndisp;
+
+			for (d = 0; d < ndisp; d += 8) {
+				__m128i c = _mm_sub_epi16(load(in + d),
+							  load(out + d));
+
+				c = _mm_add_epi16(load(cost + d), c);
+				store(cost + d, c);
+				vmin = _mm_min_epi16(vmin, c);
+			}
+		} else {
+			for (d = 0; d < ndisp; d += 8)
+				vmin = _mm_min_epi16(vmin, load(cost + d));
+		}
+		min = hmin(vmin);
+
+		vmin = _mm_set1_epi16(min);
+		idx = lanes;
+		for (d = 0; d < ndisp; d += 8) {
+			__m128i eq = _mm_cmpeq_epi16(load(cost + d), vmin);
+
+			vbest = _mm_min_epi16(vbest, blend(eq, idx, max));
+			idx = _mm_add_epi16(idx, eight);
+		}
+		best = hmin(vbest);
+
+		bv = _mm_set1_epi16(best);
+		idx = lanes;
+		for (d = 0; d < ndisp; d += 8) {
+			__m128i diff = _mm_sub_epi16(idx, bv);
+			__m128i far;
+
+			diff = _mm_max_epi16(diff, _mm_sub_epi16(zero, diff));
+			far = _mm_cmpgt_epi16(diff, one);
+			vsec = _mm_min_epi16(vsec, blend(far, load(cost + d),
+							 max));
+			idx = _mm_add_epi16(idx, eight);
+		}
+
+		disp[i] = stereo_pick(cost, ndisp, best, min, hmin(vsec),
+				      uniqueness);
+	}
+}
+
+const struct stereo_ops stereo_ops_sse2 = {
+	.name = "sse2",
+	.sad_row = stereo_sad_row_sse2,
+	.match_row = stereo_match_row_sse2,
+};
+
+#endif /* __x86_64__ || __i386__ */
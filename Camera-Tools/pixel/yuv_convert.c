@@ -0,0 +1,296 @@
+/*
+ * UYVY to NV12/I420/Y conversion: scalar kernels, dispatch and the
+ * banded frame driver.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "yuv_convert.h"
+
+static inline uint8_t avg(uint8_t a, uint8_t b)
+{
+	return (a + b + 1) >> 1;
+}
+
+void yuv_y_c(const uint8_t *src, uint8_t *y, unsigned int x,
+	     unsigned int width)
+{
+	for (; x < width; x += 2) {
+		y[x + 0] = src[x * 2 + 1];
+		y[x + 1] = src[x * 2 + 3];
+	}
+}
+
+void yuv_nv12_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		uint8_t *y1, uint8_t *uv, unsigned int x, unsigned int width)
+{
+	for (; x < width; x += 2) {
+		const uint8_t *a = s0 + x * 2, *b = s1 + x * 2;
+
+		y0[x + 0] = a[1];
+		y0[x + 1] = a[3];
+		y1[x + 0] = b[1];
+		y1[x + 1] = b[3];
+		uv[x + 0] = avg(a[0], b[0]);
+		uv[x + 1] = avg(a[2], b[2]);
+	}
+}
+
+void yuv_i420_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		uint8_t *y1, uint8_t *u, uint8_t *v, unsigned int x,
+		unsigned int width)
+{
+	for (; x < width; x += 2) {
+		const uint8_t *a = s0 + x * 2, *b = s1 + x * 2;
+
+		y0[x + 0] = a[1];
+		y0[x + 1] = a[3];
+		y1[x + 0] = b[1];
+		y1[x + 1] = b[3];
+		u[x / 2] = avg(a[0], b[0]);
+		v[x / 2] = avg(a[2], b[2]);
+	}
+}
+
+void yuv_nv12_half_c(const uint8_t *const s[4], uint8_t *y0, uint8_t *y1,
+		     uint8_t *uv, unsigned int x, unsigned int width)
+{
+	uint8_t a[8], b[8], c[8];
+	unsigned int k;
+
+	/* Two UYVY macropixels (4 pixels) in, 2x1 luma and one UV pair out. */
+	for (; x < width; x += 4) {
+		for (k = 0; k < 8; k++) {
+			a[k] = avg(s[0][x * 2 + k], s[1][x * 2 + k]);
+			b[k] = avg(s[2][x * 2 + k], s[3][x * 2 + k]);
+			c[k] = avg(a[k], b[k]);
+		}
+
+		y0[x / 2 + 0] = avg(a[1], a[3]);
+		y0[x / 2 + 1] = avg(a[5], a[7]);
+		y1[x / 2 + 0] = avg(b[1], b[3]);
+		y1[x / 2 + 1] = avg(b[5], b[7]);
+		uv[x / 2 + 0] = avg(c[0], c[4]);
+		uv[x / 2 + 1] = avg(c[2], c[6]);
+	}
+}
+
+static void yuv_y_row_c(const uint8_t *src, uint8_t *y, unsigned int width)
+{
+	yuv_y_c(src, y, 0, width);
+}
+
+static void yuv_nv12_row_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+			   uint8_t *y1, uint8_t *uv, unsigned int width)
+{
+	yuv_nv12_c(s0, s1, y0, y1, uv, 0, width);
+}
+
+static void yuv_i420_row_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+			   uint8_t *y1, uint8_t *u, uint8_t *v,
+			   unsigned int width)
+{
+	yuv_i420_c(s0, s1, y0, y1, u, v, 0, width);
+}
+
+static void yuv_nv12_half_row_c(const uint8_t *const s[4], uint8_t *y0,
+				uint8_t *y1, uint8_t *uv, unsigned int width)
+{
+	yuv_nv12_half_c(s, y0, y1, uv, 0, width);
+}
+
+const struct yuv_convert_ops yuv_convert_c = {
+	.name = "c",
+	.y = yuv_y_row_c,
+	.nv12 = yuv_nv12_row_c,
+	.i420 = yuv_i420_row_c,
+	.nv12_half = yuv_nv12_half_row_c,
+};
+
+static const struct yuv_convert_ops *yuv_convert_impls[3];
+
+static void yuv_convert_probe(void)
+{
+	unsigned int n = 0;
+
+	if (yuv_convert_impls[0])
+		return;
+
+	yuv_convert_impls[n++] = &yuv_convert_c;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		yuv_convert_impls[n++] = &yuv_convert_sse2;
+#endif
+#if defined(__aarch64__)
+	yuv_convert_impls[n++] = &yuv_convert_neon;
+#endif
+	yuv_convert_impls[n] = NULL;
+}
+
+const struct yuv_convert_ops * const *yuv_convert_list(void)
+{
+	yuv_convert_probe();
+
+	return yuv_convert_impls;
+}
+
+const struct yuv_convert_ops *yuv_convert_best(void)
+{
+	static const struct yuv_convert_ops *best;
+	unsigned int i;
+
+	if (best)
+		return best;
+
+	yuv_convert_probe();
+	for (i = 0; yuv_convert_impls[i]; i++)
+		best = yuv_convert_impls[i];
+
+	return best;
+}
+
+const struct yuv_convert_ops *yuv_convert_find(const char *name)
+{
+	unsigned int i;
+
+	yuv_convert_probe();
+	for (i = 0; yuv_convert_impls[i]; i++)
+		if (!strcmp(yuv_convert_impls[i]->name, name))
+			return yuv_convert_impls[i];
+
+	return NULL;
+}
+
+unsigned int yuv_planes_layout(enum yuv_conv conv, unsigned int width,
+			       unsigned int height, uint8_t *buf,
+			       struct yuv_planes *dst)
+{
+	unsigned int size;
+
+	memset(dst, 0, sizeof(*dst));
+
+	if (conv == YUV_CONV_NV12_HALF) {
+		width /= 2;
+		height /= 2;
+	}
+
+	dst->data[0] = buf;
+	dst->stride[0] = width;
+	size = width * height;
+
+	switch (conv) {
+	case YUV_CONV_NV12:
+	case YUV_CONV_NV12_HALF:
+		dst->data[1] = buf ? buf + size : NULL;
+		dst->stride[1] = width;
+		size += width * height / 2;
+		break;
+	case YUV_CONV_I420:
+		dst->data[1] = buf ? buf + size : NULL;
+		dst->stride[1] = width / 2;
+		size += width / 2 * height / 2;
+		dst->data[2] = buf ? buf + size : NULL;
+		dst->stride[2] = width / 2;
+		size += width / 2 * height / 2;
+		break;
+	default:
+		break;
+	}
+
+	return size;
+}
+
+struct yuv_job {
+	const struct yuv_convert_ops *ops;
+	enum yuv_conv conv;
+	const uint8_t *src;
+	unsigned int src_stride;
+	unsigned int width;
+	const struct yuv_planes *dst;
+};
+
+/* One unit is a row pair, or a row quad for the half-scale output. */
+static void yuv_convert_band(void *arg, unsigned int start, unsigned int end)
+{
+	const struct yuv_job *job = arg;
+	const struct yuv_planes *d = job->dst;
+	unsigned int stride = job->src_stride;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		const uint8_t *s;
+
+		switch (job->conv) {
+		case YUV_CONV_Y:
+			s = job->src + i * 2 * stride;
+			job->ops->y(s, d->data[0] + i * 2 * d->stride[0],
+				    job->width);
+			job->ops->y(s + stride,
+				    d->data[0] + (i * 2 + 1) * d->stride[0],
+				    job->width);
+			break;
+		case YUV_CONV_NV12:
+			s = job->src + i * 2 * stride;
+			job->ops->nv12(s, s + stride,
+				       d->data[0] + i * 2 * d->stride[0],
+				       d->data[0] + (i * 2 + 1) * d->stride[0],
+				       d->data[1] + i * d->stride[1],
+				       job->width);
+			break;
+		case YUV_CONV_I420:
+			s = job->src + i * 2 * stride;
+			job->ops->i420(s, s + stride,
+				       d->data[0] + i * 2 * d->stride[0],
+				       d->data[0] + (i * 2 + 1) * d->stride[0],
+				       d->data[1] + i * d->stride[1],
+				       d->data[2] + i * d->stride[2],
+				       job->width);
+			break;
+		case YUV_CONV_NV12_HALF: {
+			const uint8_t *rows[4];
+
+			s = job->src + i * 4 * stride;
+			rows[0] = s;
+			rows[1] = s + stride;
+			rows[2] = s + 2 * stride;
+			rows[3] = s + 3 * stride;
+			job->ops->nv12_half(rows,
+					    d->data[0] + i * 2 * d->stride[0],
+					    d->data[0] + (i * 2 + 1) * d->stride[0],
+					    d->data[1] + i * d->stride[1],
+					    job->width);
+			break;
+		}
+		}
+	}
+}
+
+int yuv_convert_frame(struct workpool *pool, enum yuv_conv conv,
+		      const uint8_t *src, unsigned int src_stride,
+		      unsigned int width, unsigned int height,
+		      const struct yuv_planes *dst)
+{
+	unsigned int align = conv == YUV_CONV_NV12_HALF ? 4 : 2;
+	struct yuv_job job = {
+		.ops = yuv_convert_best(),
+		.conv = conv,
+		.src = src,
+		.src_stride = src_stride,
+		.width = width,
+		.dst = dst,
+	};
+
+	if (!width || !height || width % align || height % align)
+		return -EINVAL;
+
+	workpool_run(pool, yuv_convert_band, &job, height / align);
+
+	return 0;
+}
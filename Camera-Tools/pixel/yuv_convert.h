@@ -0,0 +1,97 @@
+/*
+ * UYVY (MEDIA_BUS_FMT_UYVY8_2X8, as output by the OV5645) to NV12, I420
+ * and Y-only conversion, plus a fused 2x downscale to NV12.
+ *
+ * Chroma is subsampled vertically by averaging each row pair, rounding
+ * up ((a + b + 1) >> 1, the PAVGB/URHADD semantics), so every
+ * implementation produces bit-identical output. The half-scale variant
+ * averages 2x2 blocks for luma and 4x4 blocks for chroma in one pass over
+ * four source rows.
+ *
+ * yuv_convert_frame() splits the frame into row bands over a workpool.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef CAMERA_TOOLS_YUV_CONVERT_H
+#define CAMERA_TOOLS_YUV_CONVERT_H
+
+#include <stdint.h>
+
+#include "workpool.h"
+
+enum yuv_conv {
+	YUV_CONV_NV12,
+	YUV_CONV_I420,
+	YUV_CONV_Y,
+	YUV_CONV_NV12_HALF,	/* width / 2 x height / 2 NV12 */
+};
+
+/*
+ * Row kernels. @width counts source pixels; it must be even, and a
+ * multiple of 4 for nv12_half.
+ */
+struct yuv_convert_ops {
+	const char *name;
+	void (*y)(const uint8_t *src, uint8_t *y, unsigned int width);
+	/* Two source rows to two luma rows and one chroma row. */
+	void (*nv12)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		     uint8_t *y1, uint8_t *uv, unsigned int width);
+	void (*i420)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		     uint8_t *y1, uint8_t *u, uint8_t *v, unsigned int width);
+	/* Four source rows to two half-width luma rows and one chroma row. */
+	void (*nv12_half)(const uint8_t *const s[4], uint8_t *y0, uint8_t *y1,
+			  uint8_t *uv, unsigned int width);
+};
+
+extern const struct yuv_convert_ops yuv_convert_c;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct yuv_convert_ops yuv_convert_sse2;
+#endif
+#if defined(__aarch64__)
+extern const struct yuv_convert_ops yuv_convert_neon;
+#endif
+
+const struct yuv_convert_ops *yuv_convert_best(void);
+const struct yuv_convert_ops *yuv_convert_find(const char *name);
+const struct yuv_convert_ops * const *yuv_convert_list(void);
+
+/*
+ * Scalar kernels starting at source pixel @x, used by the SIMD versions
+ * for the row tails. @x must be a multiple of 2 (4 for nv12_half).
+ */
+void yuv_y_c(const uint8_t *src, uint8_t *y, unsigned int x,
+	     unsigned int width);
+void yuv_nv12_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		uint8_t *y1, uint8_t *uv, unsigned int x, unsigned int width);
+void yuv_i420_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+		uint8_t *y1, uint8_t *u, uint8_t *v, unsigned int x,
+		unsigned int width);
+void yuv_nv12_half_c(const uint8_t *const s[4], uint8_t *y0, uint8_t *y1,
+		     uint8_t *uv, unsigned int x, unsigned int width);
+
+/* Destination planes: Y, then UV (NV12) or U and V (I420). */
+struct yuv_planes {
+	uint8_t *data[3];
+	unsigned int stride[3];
+};
+
+/*
+ * Convert a whole UYVY frame with yuv_convert_best(). @width and @height
+ * are the source size; they must be even (multiples of 4 for
+ * YUV_CONV_NV12_HALF). @pool may be NULL. Returns 0 or -EINVAL.
+ */
+int yuv_convert_frame(struct workpool *pool, enum yuv_conv conv,
+		      const uint8_t *src, unsigned int src_stride,
+		      unsigned int width, unsigned int height,
+		      const struct yuv_planes *dst);
+
+/* Fill @dst's strides and plane pointers for a tightly packed buffer. */
+unsigned int yuv_planes_layout(enum yuv_conv conv, unsigned int width,
+			       unsigned int height, uint8_t *buf,
+			       struct yuv_planes *dst);
+
+#endif /* CAMERA_TOOLS_YUV_CONVERT_H */
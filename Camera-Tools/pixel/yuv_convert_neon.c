@@ -0,0 +1,114 @@
+/*
+ * UYVY to NV12/I420/Y conversion: AArch64 Advanced SIMD kernels.
+ *
+ * LD2/LD4 de-interleave UYVY into chroma and luma vectors for free;
+ * URHADD provides the rounding average used for chroma subsampling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include "yuv_convert.h"
+
+static void yuv_y_neon(const uint8_t *src, uint8_t *y, unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+		vst1q_u8(y + x, vld2q_u8(src + x * 2).val[1]);
+
+	yuv_y_c(src, y, x, width);
+}
+
+static void yuv_nv12_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+			  uint8_t *y1, uint8_t *uv, unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		uint8x16x2_t a = vld2q_u8(s0 + x * 2);
+		uint8x16x2_t b = vld2q_u8(s1 + x * 2);
+
+		vst1q_u8(y0 + x, a.val[1]);
+		vst1q_u8(y1 + x, b.val[1]);
+		vst1q_u8(uv + x, vrhaddq_u8(a.val[0], b.val[0]));
+	}
+
+	yuv_nv12_c(s0, s1, y0, y1, uv, x, width);
+}
+
+static void yuv_i420_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0,
+			  uint8_t *y1, uint8_t *u, uint8_t *v,
+			  unsigned int width)
+{
+	unsigned int x;
+
+	/* val[0] = U, val[1] = Y0, val[2] = V, val[3] = Y1 */
+	for (x = 0; x + 32 <= width; x += 32) {
+		uint8x16x4_t a = vld4q_u8(s0 + x * 2);
+		uint8x16x4_t b = vld4q_u8(s1 + x * 2);
+		uint8x16x2_t ya = { { a.val[1], a.val[3] } };
+		uint8x16x2_t yb = { { b.val[1], b.val[3] } };
+
+		vst2q_u8(y0 + x, ya);
+		vst2q_u8(y1 + x, yb);
+		vst1q_u8(u + x / 2, vrhaddq_u8(a.val[0], b.val[0]));
+		vst1q_u8(v + x / 2, vrhaddq_u8(a.val[2], b.val[2]));
+	}
+
+	yuv_i420_c(s0, s1, y0, y1, u, v, x, width);
+}
+
+/* Rounding average of neighbouring lanes: 16 in, 8 out. */
+static inline uint8x8_t pair_avg(uint8x16_t v)
+{
+	uint8x16x2_t p = vuzpq_u8(v, v);
+
+	return vrhadd_u8(vget_low_u8(p.val[0]), vget_low_u8(p.val[1]));
+}
+
+static void yuv_nv12_half_neon(const uint8_t *const s[4], uint8_t *y0,
+			       uint8_t *y1, uint8_t *uv, unsigned int width)
+{
+	unsigned int x, k;
+
+	/* 32 source pixels per row: 16 luma and 8 UV pairs out. */
+	for (x = 0; x + 32 <= width; x += 32) {
+		uint8x16x4_t r0 = vld4q_u8(s[0] + x * 2);
+		uint8x16x4_t r1 = vld4q_u8(s[1] + x * 2);
+		uint8x16x4_t r2 = vld4q_u8(s[2] + x * 2);
+		uint8x16x4_t r3 = vld4q_u8(s[3] + x * 2);
+		uint8x16_t a[4], b[4];
+		uint8x8x2_t c;
+
+		for (k = 0; k < 4; k++) {
+			a[k] = vrhaddq_u8(r0.val[k], r1.val[k]);
+			b[k] = vrhaddq_u8(r2.val[k], r3.val[k]);
+		}
+
+		vst1q_u8(y0 + x / 2, vrhaddq_u8(a[1], a[3]));
+		vst1q_u8(y1 + x / 2, vrhaddq_u8(b[1], b[3]));
+
+		c.val[0] = pair_avg(vrhaddq_u8(a[0], b[0]));
+		c.val[1] = pair_avg(vrhaddq_u8(a[2], b[2]));
+		vst2_u8(uv + x / 2, c);
+	}
+
+	yuv_nv12_half_c(s, y0, y1, uv, x, width);
+}
+
+const struct yuv_convert_ops yuv_convert_neon = {
+	.name = "neon",
+	.y = yuv_y_neon,
+	.nv12 = yuv_nv12_neon,
+	.i420 = yuv_i420_neon,
+	.nv12_half = yuv_nv12_half_neon,
+};
+
+#endif /* __aarch64__ */
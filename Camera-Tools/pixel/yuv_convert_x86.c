@@ -0,0 +1,168 @@
+/*
+ * UYVY to NV12/I420/Y conversion: SSE2 kernels.
+ *
+ * Luma is the odd bytes of a UYVY row (shift right by 8 in 16-bit lanes,
+ * then PACKUSWB), chroma the even bytes. Vertical chroma averaging is done
+ * on the raw UYVY vectors with PAVGB before the bytes are separated.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+#include "yuv_convert.h"
+
+#define SSE2	__attribute__((target("sse2")))
+
+static inline __m128i SSE2 load(const uint8_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void SSE2 store(uint8_t *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i SSE2 odd_bytes(__m128i a, __m128i b)
+{
+	return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+static inline __m128i SSE2 even_bytes(__m128i a, __m128i b)
+{
+	const __m128i lo = _mm_set1_epi16(0xff);
+
+	return _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo));
+}
+
+static void SSE2 yuv_y_sse2(const uint8_t *src, uint8_t *y,
+			    unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+		store(y + x, odd_bytes(load(src + x * 2),
+				       load(src + x * 2 + 16)));
+
+	yuv_y_c(src, y, x, width);
+}
+
+static void SSE2 yuv_nv12_sse2(const uint8_t *s0, const uint8_t *s1,
+			       uint8_t *y0, uint8_t *y1, uint8_t *uv,
+			       unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i a0 = load(s0 + x * 2), a1 = load(s0 + x * 2 + 16);
+		__m128i b0 = load(s1 + x * 2), b1 = load(s1 + x * 2 + 16);
+
+		store(y0 + x, odd_bytes(a0, a1));
+		store(y1 + x, odd_bytes(b0, b1));
+		/* U V U V ... for 16 pixels is exactly 16 bytes. */
+		store(uv + x, even_bytes(_mm_avg_epu8(a0, b0),
+					 _mm_avg_epu8(a1, b1)));
+	}
+
+	yuv_nv12_c(s0, s1, y0, y1, uv, x, width);
+}
+
+static void SSE2 yuv_i420_sse2(const uint8_t *s0, const uint8_t *s1,
+			       uint8_t *y0, uint8_t *y1, uint8_t *u,
+			       uint8_t *v, unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + 32 <= width; x += 32) {
+		const uint8_t *a = s0 + x * 2, *b = s1 + x * 2;
+		__m128i a0 = load(a), a1 = load(a + 16);
+		__m128i a2 = load(a + 32), a3 = load(a + 48);
+		__m128i b0 = load(b), b1 = load(b + 16);
+		__m128i b2 = load(b + 32), b3 = load(b + 48);
+		__m128i uv0, uv1;
+
+		store(y0 + x, odd_bytes(a0, a1));
+		store(y0 + x + 16, odd_bytes(a2, a3));
+		store(y1 + x, odd_bytes(b0, b1));
+		store(y1 + x + 16, odd_bytes(b2, b3));
+
+		uv0 = even_bytes(_mm_avg_epu8(a0, b0), _mm_avg_epu8(a1, b1));
+		uv1 = even_bytes(_mm_avg_epu8(a2, b2), _mm_avg_epu8(a3, b3));
+		store(u + x / 2, even_bytes(uv0, uv1));
+		store(v + x / 2, odd_bytes(uv0, uv1));
+	}
+
+	yuv_i420_c(s0, s1, y0, y1, u, v, x, width);
+}
+
+/* Average adjacent byte pairs of @a and @b: 32 bytes in, 16 out. */
+static inline __m128i SSE2 hpair_avg(__m128i a, __m128i b)
+{
+	const __m128i lo = _mm_set1_epi16(0xff);
+	__m128i ra = _mm_avg_epu16(_mm_and_si128(a, lo), _mm_srli_epi16(a, 8));
+	__m128i rb = _mm_avg_epu16(_mm_and_si128(b, lo), _mm_srli_epi16(b, 8));
+
+	return _mm_packus_epi16(ra, rb);
+}
+
+/*
+ * Average byte pairs two bytes apart (U with the next U, V with the next
+ * V in an interleaved UV vector) and keep the low 16 bits of every dword.
+ */
+static inline __m128i SSE2 uv_pair_avg(__m128i a, __m128i b)
+{
+	__m128i ra = _mm_avg_epu8(a, _mm_srli_epi32(a, 16));
+	__m128i rb = _mm_avg_epu8(b, _mm_srli_epi32(b, 16));
+
+	/* Sign-extend the low words so PACKSSDW passes them through. */
+	ra = _mm_srai_epi32(_mm_slli_epi32(ra, 16), 16);
+	rb = _mm_srai_epi32(_mm_slli_epi32(rb, 16), 16);
+
+	return _mm_packs_epi32(ra, rb);
+}
+
+static void SSE2 yuv_nv12_half_sse2(const uint8_t *const s[4], uint8_t *y0,
+				    uint8_t *y1, uint8_t *uv,
+				    unsigned int width)
+{
+	__m128i a[4], b[4];
+	unsigned int x, i;
+
+	/* 32 source pixels per row: 16 luma and 8 UV pairs out. */
+	for (x = 0; x + 32 <= width; x += 32) {
+		for (i = 0; i < 4; i++) {
+			unsigned int off = x * 2 + i * 16;
+
+			a[i] = _mm_avg_epu8(load(s[0] + off), load(s[1] + off));
+			b[i] = _mm_avg_epu8(load(s[2] + off), load(s[3] + off));
+		}
+
+		store(y0 + x / 2, hpair_avg(odd_bytes(a[0], a[1]),
+					    odd_bytes(a[2], a[3])));
+		store(y1 + x / 2, hpair_avg(odd_bytes(b[0], b[1]),
+					    odd_bytes(b[2], b[3])));
+		store(uv + x / 2,
+		      uv_pair_avg(even_bytes(_mm_avg_epu8(a[0], b[0]),
+					     _mm_avg_epu8(a[1], b[1])),
+				  even_bytes(_mm_avg_epu8(a[2], b[2]),
+					     _mm_avg_epu8(a[3], b[3]))));
+	}
+
+	yuv_nv12_half_c(s, y0, y1, uv, x, width);
+}
+
+const struct yuv_convert_ops yuv_convert_sse2 = {
+	.name = "sse2",
+	.y = yuv_y_sse2,
+	.nv12 = yuv_nv12_sse2,
+	.i420 = yuv_i420_sse2,
+	.nv12_half = yuv_nv12_half_sse2,
+};
+
+#endif /* __x86_64__ || __i386__ */
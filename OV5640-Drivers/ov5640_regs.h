@@ -0,0 +1,174 @@
+/*
+ * Generated by Sensor-Core/regc.py from ov5640.regs, do not edit.
+ * Blob format: see regblob.h.
+ */
+
+#ifndef OV5640_REGS_H
+#define OV5640_REGS_H
+
+/* 252 writes, 252 after removing redundant ones, in 80 transfers; 493 bytes */
+static const u8 ov5640_global_init_setting[] = {
+	0x01, 0x31, 0x03, 0x11,	/* 0x3103 */
+	0x01, 0x30, 0x08, 0x82,	/* 0x3008 */
+	0x01, 0x30, 0x08, 0x42,	/* 0x3008 */
+	0x01, 0x31, 0x03, 0x03,	/* 0x3103 */
+	0x02, 0x30, 0x17, 0x00, 0x00,	/* 0x3017-0x3018 */
+	0x04, 0x30, 0x34, 0x18, 0x11, 0x54, 0x13,	/* 0x3034-0x3037 */
+	0x01, 0x31, 0x08, 0x01,	/* 0x3108 */
+	0x04, 0x36, 0x30, 0x36, 0x0e, 0xe2, 0x12,	/* 0x3630-0x3633 */
+	0x01, 0x36, 0x21, 0xe0,	/* 0x3621 */
+	0x01, 0x37, 0x04, 0xa0,	/* 0x3704 */
+	0x01, 0x37, 0x03, 0x5a,	/* 0x3703 */
+	0x01, 0x37, 0x15, 0x78,	/* 0x3715 */
+	0x01, 0x37, 0x17, 0x01,	/* 0x3717 */
+	0x01, 0x37, 0x0b, 0x60,	/* 0x370b */
+	0x01, 0x37, 0x05, 0x1a,	/* 0x3705 */
+	0x02, 0x39, 0x05, 0x02, 0x10,	/* 0x3905-0x3906 */
+	0x01, 0x39, 0x01, 0x0a,	/* 0x3901 */
+	0x01, 0x37, 0x31, 0x12,	/* 0x3731 */
+	0x02, 0x36, 0x00, 0x08, 0x33,	/* 0x3600-0x3601 */
+	0x01, 0x30, 0x2d, 0x60,	/* 0x302d */
+	0x01, 0x36, 0x20, 0x52,	/* 0x3620 */
+	0x01, 0x37, 0x1b, 0x20,	/* 0x371b */
+	0x01, 0x47, 0x1c, 0x50,	/* 0x471c */
+	0x01, 0x3a, 0x13, 0x43,	/* 0x3a13 */
+	0x02, 0x3a, 0x18, 0x00, 0xf8,	/* 0x3a18-0x3a19 */
+	0x02, 0x36, 0x35, 0x13, 0x03,	/* 0x3635-0x3636 */
+	0x01, 0x36, 0x34, 0x40,	/* 0x3634 */
+	0x01, 0x36, 0x22, 0x01,	/* 0x3622 */
+	0x01, 0x3c, 0x01, 0x34,	/* 0x3c01 */
+	0x08, 0x3c, 0x04, 0x28, 0x98, 0x00, 0x07, 0x00, 0x1c, 0x9c, 0x40,	/* 0x3c04-0x3c0b */
+	0x02, 0x38, 0x20, 0x40, 0x06,	/* 0x3820-0x3821 */
+	0x02, 0x38, 0x14, 0x11, 0x11,	/* 0x3814-0x3815 */
+	0x10, 0x38, 0x00, 0x01, 0x50, 0x01, 0xb2, 0x08, 0xef, 0x05, 0xf1, 0x07, 0x80, 0x04, 0x38, 0x09, 0xc4, 0x04, 0x60,	/* 0x3800-0x380f */
+	0x04, 0x38, 0x10, 0x00, 0x10, 0x00, 0x04,	/* 0x3810-0x3813 */
+	0x01, 0x36, 0x18, 0x04,	/* 0x3618 */
+	0x01, 0x36, 0x12, 0x2b,	/* 0x3612 */
+	0x02, 0x37, 0x08, 0x64, 0x12,	/* 0x3708-0x3709 */
+	0x01, 0x37, 0x0c, 0x00,	/* 0x370c */
+	0x02, 0x3a, 0x02, 0x04, 0x60,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0x50, 0x01, 0x18,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x03,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x04,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x04, 0x60,	/* 0x3a14-0x3a15 */
+	0x01, 0x40, 0x01, 0x02,	/* 0x4001 */
+	0x01, 0x40, 0x04, 0x06,	/* 0x4004 */
+	0x01, 0x30, 0x00, 0x00,	/* 0x3000 */
+	0x01, 0x30, 0x02, 0x1c,	/* 0x3002 */
+	0x01, 0x30, 0x04, 0xff,	/* 0x3004 */
+	0x01, 0x30, 0x06, 0xc3,	/* 0x3006 */
+	0x01, 0x30, 0x0e, 0x45,	/* 0x300e */
+	0x01, 0x30, 0x2e, 0x08,	/* 0x302e */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x50, 0x1f, 0x00,	/* 0x501f */
+	0x01, 0x47, 0x13, 0x02,	/* 0x4713 */
+	0x01, 0x44, 0x07, 0x04,	/* 0x4407 */
+	0x01, 0x44, 0x0e, 0x00,	/* 0x440e */
+	0x02, 0x46, 0x0b, 0x37, 0x20,	/* 0x460b-0x460c */
+	0x01, 0x48, 0x37, 0x0a,	/* 0x4837 */
+	0x01, 0x38, 0x24, 0x04,	/* 0x3824 */
+	0x02, 0x50, 0x00, 0xa7, 0x83,	/* 0x5000-0x5001 */
+	0x10, 0x51, 0x80, 0xff, 0xf2, 0x00, 0x14, 0x25, 0x24, 0x09, 0x09, 0x09, 0x75, 0x54, 0xe0, 0xb2, 0x42, 0x3d, 0x56,	/* 0x5180-0x518f */
+	0x0f, 0x51, 0x90, 0x46, 0xf8, 0x04, 0x70, 0xf0, 0xf0, 0x03, 0x01, 0x04, 0x12, 0x04, 0x00, 0x06, 0x82, 0x38,	/* 0x5190-0x519e */
+	0x0b, 0x53, 0x81, 0x1e, 0x5b, 0x08, 0x0a, 0x7e, 0x88, 0x7c, 0x6c, 0x10, 0x01, 0x98,	/* 0x5381-0x538b */
+	0x08, 0x53, 0x00, 0x08, 0x30, 0x10, 0x00, 0x08, 0x30, 0x08, 0x16,	/* 0x5300-0x5307 */
+	0x04, 0x53, 0x09, 0x08, 0x30, 0x04, 0x06,	/* 0x5309-0x530c */
+	0x10, 0x54, 0x80, 0x01, 0x08, 0x14, 0x28, 0x51, 0x65, 0x71, 0x7d, 0x87, 0x91, 0x9a, 0xaa, 0xb8, 0xcd, 0xdd, 0xea,	/* 0x5480-0x548f */
+	0x01, 0x54, 0x90, 0x1d,	/* 0x5490 */
+	0x01, 0x55, 0x80, 0x02,	/* 0x5580 */
+	0x02, 0x55, 0x83, 0x40, 0x10,	/* 0x5583-0x5584 */
+	0x03, 0x55, 0x89, 0x10, 0x00, 0xf8,	/* 0x5589-0x558b */
+	0x10, 0x58, 0x00, 0x23, 0x14, 0x0f, 0x0f, 0x12, 0x26, 0x0c, 0x08, 0x05, 0x05, 0x08, 0x0d, 0x08, 0x03, 0x00, 0x00,	/* 0x5800-0x580f */
+	0x10, 0x58, 0x10, 0x03, 0x09, 0x07, 0x03, 0x00, 0x01, 0x03, 0x08, 0x0d, 0x08, 0x05, 0x06, 0x08, 0x0e, 0x29, 0x17,	/* 0x5810-0x581f */
+	0x10, 0x58, 0x20, 0x11, 0x11, 0x15, 0x28, 0x46, 0x26, 0x08, 0x26, 0x64, 0x26, 0x24, 0x22, 0x24, 0x24, 0x06, 0x22,	/* 0x5820-0x582f */
+	0x0e, 0x58, 0x30, 0x40, 0x42, 0x24, 0x26, 0x24, 0x22, 0x22, 0x26, 0x44, 0x24, 0x26, 0x28, 0x42, 0xce,	/* 0x5830-0x583d */
+	0x01, 0x50, 0x25, 0x00,	/* 0x5025 */
+	0x02, 0x3a, 0x0f, 0x30, 0x28,	/* 0x3a0f-0x3a10 */
+	0x01, 0x3a, 0x1b, 0x30,	/* 0x3a1b */
+	0x01, 0x3a, 0x1e, 0x26,	/* 0x3a1e */
+	0x01, 0x3a, 0x11, 0x60,	/* 0x3a11 */
+	0x01, 0x3a, 0x1f, 0x14,	/* 0x3a1f */
+	0x00,	/* end */
+};
+
+/* 43 writes, 43 after removing redundant ones, in 15 transfers; 89 bytes */
+static const u8 ov5640_setting_vga[] = {
+	0x02, 0x30, 0x35, 0x11, 0x57,	/* 0x3035-0x3036 */
+	0x01, 0x36, 0x18, 0x00,	/* 0x3618 */
+	0x01, 0x36, 0x12, 0x29,	/* 0x3612 */
+	0x02, 0x37, 0x08, 0x64, 0x52,	/* 0x3708-0x3709 */
+	0x01, 0x37, 0x0c, 0x03,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x02, 0x80, 0x01, 0xea, 0x07, 0xbf, 0x05, 0xb9, 0x02, 0x80, 0x01, 0xe0, 0x07, 0x68, 0x01, 0xfc,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x10, 0x00, 0x04, 0x31, 0x31,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x41, 0x07,	/* 0x3820-0x3821 */
+	0x02, 0x3a, 0x02, 0x01, 0xfc,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0xcb, 0x01, 0x7e,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x01,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x01,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x01, 0xfc,	/* 0x3a14-0x3a15 */
+	0x01, 0x40, 0x04, 0x02,	/* 0x4004 */
+	0x01, 0x48, 0x37, 0x0a,	/* 0x4837 */
+	0x00,	/* end */
+};
+
+/* 43 writes, 43 after removing redundant ones, in 15 transfers; 89 bytes */
+static const u8 ov5640_setting_720p[] = {
+	0x02, 0x30, 0x35, 0x11, 0x54,	/* 0x3035-0x3036 */
+	0x01, 0x36, 0x18, 0x00,	/* 0x3618 */
+	0x01, 0x36, 0x12, 0x29,	/* 0x3612 */
+	0x02, 0x37, 0x08, 0x64, 0x52,	/* 0x3708-0x3709 */
+	0x01, 0x37, 0x0c, 0x03,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0xfa, 0x0a, 0x3f, 0x06, 0xa9, 0x05, 0x00, 0x02, 0xd0, 0x07, 0x64, 0x02, 0xe4,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x10, 0x00, 0x04, 0x31, 0x31,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x41, 0x07,	/* 0x3820-0x3821 */
+	0x02, 0x3a, 0x02, 0x02, 0xe4,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0xbc, 0x01, 0x72,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x01,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x02,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x02, 0xe4,	/* 0x3a14-0x3a15 */
+	0x01, 0x40, 0x04, 0x02,	/* 0x4004 */
+	0x01, 0x48, 0x37, 0x0a,	/* 0x4837 */
+	0x00,	/* end */
+};
+
+/* 43 writes, 43 after removing redundant ones, in 15 transfers; 89 bytes */
+static const u8 ov5640_setting_1080p[] = {
+	0x02, 0x30, 0x35, 0x11, 0x54,	/* 0x3035-0x3036 */
+	0x01, 0x36, 0x18, 0x04,	/* 0x3618 */
+	0x01, 0x36, 0x12, 0x2b,	/* 0x3612 */
+	0x02, 0x37, 0x08, 0x64, 0x12,	/* 0x3708-0x3709 */
+	0x01, 0x37, 0x0c, 0x00,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x01, 0x50, 0x01, 0xb2, 0x08, 0xef, 0x05, 0xf1, 0x07, 0x80, 0x04, 0x38, 0x09, 0xc4, 0x04, 0x60,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x10, 0x00, 0x04, 0x11, 0x11,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x40, 0x06,	/* 0x3820-0x3821 */
+	0x02, 0x3a, 0x02, 0x04, 0x60,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0x50, 0x01, 0x18,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x03,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x04,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x04, 0x60,	/* 0x3a14-0x3a15 */
+	0x01, 0x40, 0x04, 0x06,	/* 0x4004 */
+	0x01, 0x48, 0x37, 0x0a,	/* 0x4837 */
+	0x00,	/* end */
+};
+
+/* 43 writes, 43 after removing redundant ones, in 15 transfers; 89 bytes */
+static const u8 ov5640_setting_qsxga[] = {
+	0x02, 0x30, 0x35, 0x11, 0x54,	/* 0x3035-0x3036 */
+	0x01, 0x36, 0x18, 0x04,	/* 0x3618 */
+	0x01, 0x36, 0x12, 0x2b,	/* 0x3612 */
+	0x02, 0x37, 0x08, 0x64, 0x12,	/* 0x3708-0x3709 */
+	0x01, 0x37, 0x0c, 0x00,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x3f, 0x07, 0x9f, 0x0a, 0x20, 0x07, 0x98, 0x0b, 0x1c, 0x07, 0xb0,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x10, 0x00, 0x04, 0x11, 0x11,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x40, 0x06,	/* 0x3820-0x3821 */
+	0x02, 0x3a, 0x02, 0x07, 0xb0,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0x27, 0x00, 0xf6,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x06,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x08,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x07, 0xb0,	/* 0x3a14-0x3a15 */
+	0x01, 0x40, 0x04, 0x06,	/* 0x4004 */
+	0x01, 0x48, 0x37, 0x0a,	/* 0x4837 */
+	0x00,	/* end */
+};
+
+#endif /* OV5640_REGS_H */
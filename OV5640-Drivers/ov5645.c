@@ -26,36 +26,26 @@
  */
 
 #include <linux/bitops.h>
-#include <linux/clk.h>
 #include <linux/delay.h>
-#include <linux/device.h>
-#include <linux/gpio/consumer.h>
+#include <linux/firmware.h>
 #include <linux/i2c.h>
 #include <linux/init.h>
+#include <linux/jiffies.h>
 #include <linux/module.h>
-#include <linux/of.h>
-#include <linux/of_graph.h>
-#include <linux/regulator/consumer.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <media/v4l2-ctrls.h>
-#include <media/v4l2-of.h>
 #include <media/v4l2-subdev.h>
 
-/* HACKs here! */
-
-#include <../drivers/media/platform/msm/cci/msm_cci.h>
-
-#ifdef dev_dbg
-	#undef dev_dbg
-	#define dev_dbg dev_err
-#endif
+#include "framemeta.h"
+#include "sensor_core.h"
 
 #define OV5645_VOLTAGE_ANALOG               2800000
 #define OV5645_VOLTAGE_DIGITAL_CORE         1500000
 #define OV5645_VOLTAGE_DIGITAL_IO           1800000
 
-#define OV5645_XCLK	23880000
+#define OV5645_XCLK	23880000	/* what the tables are written for */
 
 #define OV5645_SYSTEM_CTRL0		0x3008
 #define		OV5645_SYSTEM_CTRL0_START	0x02
@@ -63,9 +53,13 @@
 #define OV5645_CHIP_ID_HIGH_REG		0x300A
 #define		OV5645_CHIP_ID_HIGH		0x56
 #define OV5645_CHIP_ID_LOW_REG		0x300B
-#define		OV5645_CHIP_ID_LOW		0x40
+#define		OV5640_CHIP_ID_LOW		0x40
+#define		OV5645_CHIP_ID_LOW		0x45
+#define OV5645_AWB_GAIN			0x3400	/* R, G, B: 0x3400-0x3405 */
 #define OV5645_AWB_MANUAL_CONTROL	0x3406
 #define		OV5645_AWB_MANUAL_ENABLE	BIT(0)
+#define OV5645_AEC_EXPOSURE		0x3500	/* 0x3500-0x3502, 1/16 lines */
+#define OV5645_AEC_GAIN			0x350a	/* 0x350a-0x350b, 0x10 = 1x */
 #define OV5645_AEC_PK_MANUAL		0x3503
 #define		OV5645_AEC_MANUAL_ENABLE	BIT(0)
 #define		OV5645_AGC_MANUAL_ENABLE	BIT(1)
@@ -80,1528 +74,887 @@
 #define		OV5645_TEST_PATTERN_ENABLE	BIT(7)
 #define OV5645_SDE_SAT_U		0x5583
 #define OV5645_SDE_SAT_V		0x5584
+#define OV5645_FORMAT_CTRL00		0x4300
+#define		OV5645_FORMAT_UYVY		0x32
 
-enum ov5645_mode {
-	OV5645_MODE_MIN = 0,
-	OV5645_MODE_SXGA = 0,
-	OV5645_MODE_1080P = 1,
-	OV5645_MODE_FULL = 2,
-	OV5645_MODE_MAX = 2
-};
+/*
+ * PLL. With the rest of the clock tree as the tables leave it, each of
+ * the two lanes runs at XCLK / prediv * multiplier / sysdiv and carries
+ * 8 bits per pixel clock. A slower pixel clock moves the AEC banding
+ * steps (rate / HTS / 100 and / 120, the bands per frame VTS / step) and
+ * the MIPI PCLK period, the pclk2x period in 0.5 ns units, which is the
+ * pixel clock period in ns.
+ */
+#define OV5645_SC_PLL_CTRL1		0x3035
+#define		OV5645_PLL_SYSDIV(x)		((x) << 4)
+#define		OV5645_PLL_MIPI_DIV_MASK	0x0f
+#define OV5645_SC_PLL_CTRL2		0x3036	/* multiplier */
+#define OV5645_SC_PLL_CTRL3		0x3037
+#define		OV5645_PLL_PREDIV_MASK		0x0f
+#define OV5645_AEC_B50_STEP		0x3a08	/* 0x3a08-0x3a09 */
+#define OV5645_AEC_B60_STEP		0x3a0a	/* 0x3a0a-0x3a0b */
+#define OV5645_AEC_CTRL0D		0x3a0d	/* 60 Hz bands per frame */
+#define OV5645_AEC_CTRL0E		0x3a0e	/* 50 Hz bands per frame */
+#define OV5645_PCLK_PERIOD		0x4837
 
-struct reg_value {
-	u16 reg;
-	u8 val;
-};
+/*
+ * OV5640 autofocus. The VCM is driven by the sensor's embedded 8051, whose
+ * ~4 KB program (OmniVision's, not redistributable here) is requested from
+ * OV5645_AF_FIRMWARE at probe and kept in memory. It is downloaded to the
+ * MCU's RAM in OV5645_AF_BURST byte transfers the first time AF is used
+ * after each power-up or reset, so opening the camera costs nothing when
+ * AF is not used. Without the file the focus controls are not created.
+ */
+#define OV5645_AF_FIRMWARE		"ov5640_af.bin"
+#define OV5645_AF_FW_BASE		0x8000
+#define OV5645_AF_FW_MAX		0x2000
+#define OV5645_MAX_REGISTER		0x9fff	/* end of the AF program RAM */
+#define OV5645_AF_BURST			128
+#define OV5645_SYSTEM_RESET00		0x3000
+#define		OV5645_MCU_RESET		BIT(5)
+#define OV5645_AF_CMD_MAIN		0x3022	/* 0x3022-0x3029 */
+#define		OV5645_AF_TRIG_SINGLE		0x03
+#define		OV5645_AF_CONTINUOUS		0x04
+#define		OV5645_AF_PAUSE			0x06
+#define OV5645_AF_CMD_ACK		0x3023
+#define OV5645_AF_FW_STATUS		0x3029
+#define		OV5645_AF_STATUS_FOCUSING	0x00
+#define		OV5645_AF_STATUS_FOCUSED	0x10
+#define		OV5645_AF_STATUS_IDLE		0x70
+#define		OV5645_AF_STATUS_DOWNLOADED	0x7f
+#define OV5645_AF_BOOT_MS		500
+#define OV5645_AF_ACK_MS		200
 
-struct ov5645_mode_info {
-	enum ov5645_mode mode;
-	u32 width;
-	u32 height;
-	struct reg_value *data;
-	u32 data_size;
-};
+/*
+ * While streaming, the watchdog reads back a register the tables set
+ * (FORMAT_CTRL00) once per period. A CCI failure or a value back at its
+ * reset default means the sensor browned out or latched up: it is then
+ * hard-reset through rst_gpio and reprogrammed. Failed recoveries are
+ * retried with the period doubling up to the maximum.
+ */
+#define OV5645_WATCHDOG_MS		1000
+#define OV5645_WATCHDOG_MAX_MS		16000
+
+/*
+ * Button that forces the same recovery from userspace, for stalls the
+ * register check cannot see (camd uses it when frames stop arriving).
+ */
+#define V4L2_CID_OV5645_RECOVER		(V4L2_CID_USER_BASE | 0x1f00)
+
+/*
+ * Frames from a control write to the first frame that shows it, for the
+ * current mode. Writing it stores a measured value for the current mode
+ * (Camera-Tools bench_stream -L measures it); AE loops read it to know how
+ * long to wait for an exposure change. Until measured each mode reports
+ * OV5645_CTRL_DELAY_DEFAULT.
+ */
+#define V4L2_CID_OV5645_CTRL_DELAY	(V4L2_CID_USER_BASE | 0x1f02)
+#define OV5645_CTRL_DELAY_DEFAULT	2
+#define OV5645_CTRL_DELAY_MAX		15
+
+/*
+ * AEC and AWB run on the chip and change exposure, gain and colour gains
+ * by themselves, so while streaming the driver reads back what the sensor
+ * uses once per frame period and records it in the frame metadata ring
+ * (Sensor-Core/framemeta.h, FRAMEMETA_CID). Exposure is recorded in lines,
+ * gain in 1/16 steps.
+ */
+
+/* Modes of the largest variant. */
+#define OV5645_MAX_MODES	5
+
+/* sensor_variant.driver_data */
+#define OV5645_HAS_AF		BIT(0)	/* AF MCU, see OV5645_AF_FIRMWARE */
+/*
+ * OV5645_PCLK_PERIOD as the mode tables set it, per variant, at each
+ * mode's own pixel rate HTS x VTS x fps; set_pll scales that value.
+ */
+#define OV5645_PCLK_PERIOD_VAL(x)	((x) << 8)
+#define OV5645_GET_PCLK_PERIOD(d)	(((d) >> 8) & 0xff)
 
 struct ov5645 {
-	struct i2c_client *i2c_client;
-	struct device *dev;
-	struct v4l2_subdev sd;
-	struct media_pad pad;
-	struct v4l2_of_endpoint ep;
-	struct v4l2_mbus_framefmt fmt;
-	struct v4l2_rect crop;
-	struct clk *xclk;
-
-	struct regulator *io_regulator;
-	struct regulator *core_regulator;
-	struct regulator *analog_regulator;
-
-	enum ov5645_mode current_mode;
-
-	/* Cached control values */
-	struct v4l2_ctrl_handler ctrls;
-	struct v4l2_ctrl *saturation;
-	struct v4l2_ctrl *hflip;
-	struct v4l2_ctrl *vflip;
-	struct v4l2_ctrl *autogain;
-	struct v4l2_ctrl *autoexposure;
-	struct v4l2_ctrl *awb;
-	struct v4l2_ctrl *pattern;
-
-	struct mutex power_lock; /* lock to protect power state */
-	bool power;
-
-	struct gpio_desc *enable_gpio;
-	struct gpio_desc *rst_gpio;
-
-	struct v4l2_subdev *cci;
-};
+	struct sensor s;
 
-static inline struct ov5645 *to_ov5645(struct v4l2_subdev *sd)
-{
-	return container_of(sd, struct ov5645, sd);
-}
-static struct reg_value OV5640_REG_1080P[] =
-{
-	{ 0x3103, 0x11},
-	{ 0x3008, 0x82},
-	{ 0x3008, 0x42},
-	{ 0x3103, 0x03},
-	{ 0x3017, 0x00},
-	{ 0x3018, 0x00},
-	{ 0x3034, 0x18},
-	{ 0x3035, 0x11},
-	{ 0x3036, 0x54},
-	{ 0x3037, 0x13},
-	{ 0x3108, 0x01},
-	{ 0x3630, 0x36},
-	{ 0x3631, 0x0e},
-	{ 0x3632, 0xe2},
-	{ 0x3633, 0x12},
-	{ 0x3621, 0xe0},
-	{ 0x3704, 0xa0},
-	{ 0x3703, 0x5a},
-	{ 0x3715, 0x78},
-	{ 0x3717, 0x01},
-	{ 0x370b, 0x60},
-	{ 0x3705, 0x1a},
-	{ 0x3905, 0x02},
-	{ 0x3906, 0x10},
-	{ 0x3901, 0x0a},
-	{ 0x3731, 0x12},
-	{ 0x3600, 0x08},
-	{ 0x3601, 0x33},
-	{ 0x302d, 0x60},
-	{ 0x3620, 0x52},
-	{ 0x371b, 0x20},
-	{ 0x471c, 0x50},
-
-        //{0x4800, 0x34},/////////////////////////free running
-
-	{ 0x3a13, 0x43},
-	{ 0x3a18, 0x00},
-	{ 0x3a19, 0xf8},
-	{ 0x3635, 0x13},
-	{ 0x3636, 0x03},
-	{ 0x3634, 0x40},
-	{ 0x3622, 0x01},
-	{ 0x3c01, 0x34},
-	{ 0x3c04, 0x28},
-	{ 0x3c05, 0x98},
-	{ 0x3c06, 0x00},
-	{ 0x3c07, 0x07},
-	{ 0x3c08, 0x00},
-	{ 0x3c09, 0x1c},
-	{ 0x3c0a, 0x9c},
-	{ 0x3c0b, 0x40},
-	{ 0x3820, 0x40},
-	{ 0x3821, 0x06},
-	{ 0x3814, 0x11},
-	{ 0x3815, 0x11},
-	{ 0x3800, 0x01},
-	{ 0x3801, 0x50},
-	{ 0x3802, 0x01},
-	{ 0x3803, 0xb2},
-	{ 0x3804, 0x08},
-	{ 0x3805, 0xef},
-	{ 0x3806, 0x05},
-	{ 0x3807, 0xf1},
-	{ 0x3808, 0x07},
-	{ 0x3809, 0x80},
-	{ 0x380a, 0x04},
-	{ 0x380b, 0x38},
-	{ 0x380c, 0x09},//
-	{ 0x380d, 0xc4},//
-	{ 0x380e, 0x04},
-	{ 0x380f, 0x60},
-	{ 0x3810, 0x00},
-	{ 0x3811, 0x10},
-	{ 0x3812, 0x00},
-	{ 0x3813, 0x04},
-	{ 0x3618, 0x04},
-	{ 0x3612, 0x2b},
-	{ 0x3708, 0x64},
-	{ 0x3709, 0x12},
-	{ 0x370c, 0x00},
-	{ 0x3a02, 0x04},
-	{ 0x3a03, 0x60},
-	{ 0x3a08, 0x01},
-	{ 0x3a09, 0x50},
-	{ 0x3a0a, 0x01},
-	{ 0x3a0b, 0x18},
-	{ 0x3a0e, 0x03},
-	{ 0x3a0d, 0x04},
-	{ 0x3a14, 0x04},
-	{ 0x3a15, 0x60},
-	{ 0x4001, 0x02},
-	{ 0x4004, 0x06},
-	{ 0x3000, 0x00},
-	{ 0x3002, 0x1c},
-	{ 0x3004, 0xff},
-	{ 0x3006, 0xc3},
-	{ 0x300e, 0x45},
-	{ 0x302e, 0x08},
-	//{ 0x4300, 0x30},
-	{ 0x4300, 0x32},	//to match ISP UYVY
-	{ 0x501f, 0x00},
-	{ 0x4713, 0x02},
-	{ 0x4407, 0x04},
-	{ 0x440e, 0x00},
-	{ 0x460b, 0x37},
-	{ 0x460c, 0x20},
-	{ 0x4837, 0x0a},
-	{ 0x3824, 0x04},
-	{ 0x5000, 0xa7},
-	{ 0x5001, 0x83},
-	{ 0x5180, 0xff},
-	{ 0x5181, 0xf2},
-	{ 0x5182, 0x00},
-	{ 0x5183, 0x14},
-	{ 0x5184, 0x25},
-	{ 0x5185, 0x24},
-	{ 0x5186, 0x09},
-	{ 0x5187, 0x09},
-	{ 0x5188, 0x09},
-	{ 0x5189, 0x75},
-	{ 0x518a, 0x54},
-	{ 0x518b, 0xe0},
-	{ 0x518c, 0xb2},
-	{ 0x518d, 0x42},
-	{ 0x518e, 0x3d},
-	{ 0x518f, 0x56},
-	{ 0x5190, 0x46},
-	{ 0x5191, 0xf8},
-	{ 0x5192, 0x04},
-	{ 0x5193, 0x70},
-	{ 0x5194, 0xf0},
-	{ 0x5195, 0xf0},
-	{ 0x5196, 0x03},
-	{ 0x5197, 0x01},
-	{ 0x5198, 0x04},
-	{ 0x5199, 0x12},
-	{ 0x519a, 0x04},
-	{ 0x519b, 0x00},
-	{ 0x519c, 0x06},
-	{ 0x519d, 0x82},
-	{ 0x519e, 0x38},
-	{ 0x5381, 0x1e},
-	{ 0x5382, 0x5b},
-	{ 0x5383, 0x08},
-	{ 0x5384, 0x0a},
-	{ 0x5385, 0x7e},
-	{ 0x5386, 0x88},
-	{ 0x5387, 0x7c},
-	{ 0x5388, 0x6c},
-	{ 0x5389, 0x10},
-	{ 0x538a, 0x01},
-	{ 0x538b, 0x98},
-	{ 0x5300, 0x08},
-	{ 0x5301, 0x30},
-	{ 0x5302, 0x10},
-	{ 0x5303, 0x00},
-	{ 0x5304, 0x08},
-	{ 0x5305, 0x30},
-	{ 0x5306, 0x08},
-	{ 0x5307, 0x16},
-	{ 0x5309, 0x08},
-	{ 0x530a, 0x30},
-	{ 0x530b, 0x04},
-	{ 0x530c, 0x06},
-	{ 0x5480, 0x01},
-	{ 0x5481, 0x08},
-	{ 0x5482, 0x14},
-	{ 0x5483, 0x28},
-	{ 0x5484, 0x51},
-	{ 0x5485, 0x65},
-	{ 0x5486, 0x71},
-	{ 0x5487, 0x7d},
-	{ 0x5488, 0x87},
-	{ 0x5489, 0x91},
-	{ 0x548a, 0x9a},
-	{ 0x548b, 0xaa},
-	{ 0x548c, 0xb8},
-	{ 0x548d, 0xcd},
-	{ 0x548e, 0xdd},
-	{ 0x548f, 0xea},
-	{ 0x5490, 0x1d},
-	{ 0x5580, 0x02},
-	{ 0x5583, 0x40},
-	{ 0x5584, 0x10},
-	{ 0x5589, 0x10},
-	{ 0x558a, 0x00},
-	{ 0x558b, 0xf8},
-	{ 0x5800, 0x23},
-	{ 0x5801, 0x14},
-	{ 0x5802, 0x0f},
-	{ 0x5803, 0x0f},
-	{ 0x5804, 0x12},
-	{ 0x5805, 0x26},
-	{ 0x5806, 0x0c},
-	{ 0x5807, 0x08},
-	{ 0x5808, 0x05},
-	{ 0x5809, 0x05},
-	{ 0x580a, 0x08},
-	{ 0x580b, 0x0d},
-	{ 0x580c, 0x08},
-	{ 0x580d, 0x03},
-	{ 0x580e, 0x00},
-	{ 0x580f, 0x00},
-	{ 0x5810, 0x03},
-	{ 0x5811, 0x09},
-	{ 0x5812, 0x07},
-	{ 0x5813, 0x03},
-	{ 0x5814, 0x00},
-	{ 0x5815, 0x01},
-	{ 0x5816, 0x03},
-	{ 0x5817, 0x08},
-	{ 0x5818, 0x0d},
-	{ 0x5819, 0x08},
-	{ 0x581a, 0x05},
-	{ 0x581b, 0x06},
-	{ 0x581c, 0x08},
-	{ 0x581d, 0x0e},
-	{ 0x581e, 0x29},
-	{ 0x581f, 0x17},
-	{ 0x5820, 0x11},
-	{ 0x5821, 0x11},
-	{ 0x5822, 0x15},
-	{ 0x5823, 0x28},
-	{ 0x5824, 0x46},
-	{ 0x5825, 0x26},
-	{ 0x5826, 0x08},
-	{ 0x5827, 0x26},
-	{ 0x5828, 0x64},
-	{ 0x5829, 0x26},
-	{ 0x582a, 0x24},
-	{ 0x582b, 0x22},
-	{ 0x582c, 0x24},
-	{ 0x582d, 0x24},
-	{ 0x582e, 0x06},
-	{ 0x582f, 0x22},
-	{ 0x5830, 0x40},
-	{ 0x5831, 0x42},
-	{ 0x5832, 0x24},
-	{ 0x5833, 0x26},
-	{ 0x5834, 0x24},
-	{ 0x5835, 0x22},
-	{ 0x5836, 0x22},
-	{ 0x5837, 0x26},
-	{ 0x5838, 0x44},
-	{ 0x5839, 0x24},
-	{ 0x583a, 0x26},
-	{ 0x583b, 0x28},
-	{ 0x583c, 0x42},
-	{ 0x583d, 0xce},
-	{ 0x5025, 0x00},
-	{ 0x3a0f, 0x30},
-	{ 0x3a10, 0x28},
-	{ 0x3a1b, 0x30},
-	{ 0x3a1e, 0x26},
-	{ 0x3a11, 0x60},
-	{ 0x3a1f, 0x14}
+	struct v4l2_ctrl *focus_auto;
+	struct v4l2_ctrl *ctrl_delay;
+	u8 ctrl_delays[OV5645_MAX_MODES];	/* per mode, in frames */
 
-};
+	struct delayed_work watchdog;
+	unsigned int watchdog_ms;
+	unsigned int recoveries;
 
-static struct reg_value ov5645_global_init_setting[] = {
-	{ 0x3103, 0x11 },
-	{ 0x3008, 0x82 },
-	{ 0x3008, 0x42 },
-	{ 0x3103, 0x03 },
-	{ 0x3503, 0x07 },
-	{ 0x3002, 0x1c },
-	{ 0x3006, 0xc3 },
-	{ 0x300e, 0x45 },
-	{ 0x3017, 0x00 },
-	{ 0x3018, 0x00 },
-	{ 0x302e, 0x0b },
-	{ 0x3037, 0x13 },
-	{ 0x3108, 0x01 },
-	{ 0x3611, 0x06 },
-	{ 0x3500, 0x00 },
-	{ 0x3501, 0x01 },
-	{ 0x3502, 0x00 },
-	{ 0x350a, 0x00 },
-	{ 0x350b, 0x3f },
-	{ 0x3620, 0x33 },
-	{ 0x3621, 0xe0 },
-	{ 0x3622, 0x01 },
-	{ 0x3630, 0x2e },
-	{ 0x3631, 0x00 },
-	{ 0x3632, 0x32 },
-	{ 0x3633, 0x52 },
-	{ 0x3634, 0x70 },
-	{ 0x3635, 0x13 },
-	{ 0x3636, 0x03 },
-	{ 0x3703, 0x5a },
-	{ 0x3704, 0xa0 },
-	{ 0x3705, 0x1a },
-	{ 0x3709, 0x12 },
-	{ 0x370b, 0x61 },
-	{ 0x370f, 0x10 },
-	{ 0x3715, 0x78 },
-	{ 0x3717, 0x01 },
-	{ 0x371b, 0x20 },
-	{ 0x3731, 0x12 },
-	{ 0x3901, 0x0a },
-	{ 0x3905, 0x02 },
-	{ 0x3906, 0x10 },
-	{ 0x3719, 0x86 },
-	{ 0x3810, 0x00 },
-	{ 0x3811, 0x10 },
-	{ 0x3812, 0x00 },
-	{ 0x3821, 0x01 },
-	{ 0x3824, 0x01 },
-	{ 0x3826, 0x03 },
-	{ 0x3828, 0x08 },
-	{ 0x3a19, 0xf8 },
-	{ 0x3c01, 0x34 },
-	{ 0x3c04, 0x28 },
-	{ 0x3c05, 0x98 },
-	{ 0x3c07, 0x07 },
-	{ 0x3c09, 0xc2 },
-	{ 0x3c0a, 0x9c },
-	{ 0x3c0b, 0x40 },
-	{ 0x3c01, 0x34 },
-	{ 0x4001, 0x02 },
-	{ 0x4514, 0x00 },
-	{ 0x4520, 0xb0 },
-	{ 0x460b, 0x37 },
-	{ 0x460c, 0x20 },
-	{ 0x4818, 0x01 },
-	{ 0x481d, 0xf0 },
-	{ 0x481f, 0x50 },
-	{ 0x4823, 0x70 },
-	{ 0x4831, 0x14 },
-	{ 0x5000, 0xa7 },
-	{ 0x5001, 0x83 },
-	{ 0x501d, 0x00 },
-	{ 0x501f, 0x00 },
-	{ 0x503d, 0x00 },
-	{ 0x505c, 0x30 },
-	{ 0x5181, 0x59 },
-	{ 0x5183, 0x00 },
-	{ 0x5191, 0xf0 },
-	{ 0x5192, 0x03 },
-	{ 0x5684, 0x10 },
-	{ 0x5685, 0xa0 },
-	{ 0x5686, 0x0c },
-	{ 0x5687, 0x78 },
-	{ 0x5a00, 0x08 },
-	{ 0x5a21, 0x00 },
-	{ 0x5a24, 0x00 },
-	{ 0x3008, 0x02 },
-	{ 0x3503, 0x00 },
-	{ 0x5180, 0xff },
-	{ 0x5181, 0xf2 },
-	{ 0x5182, 0x00 },
-	{ 0x5183, 0x14 },
-	{ 0x5184, 0x25 },
-	{ 0x5185, 0x24 },
-	{ 0x5186, 0x09 },
-	{ 0x5187, 0x09 },
-	{ 0x5188, 0x0a },
-	{ 0x5189, 0x75 },
-	{ 0x518a, 0x52 },
-	{ 0x518b, 0xea },
-	{ 0x518c, 0xa8 },
-	{ 0x518d, 0x42 },
-	{ 0x518e, 0x38 },
-	{ 0x518f, 0x56 },
-	{ 0x5190, 0x42 },
-	{ 0x5191, 0xf8 },
-	{ 0x5192, 0x04 },
-	{ 0x5193, 0x70 },
-	{ 0x5194, 0xf0 },
-	{ 0x5195, 0xf0 },
-	{ 0x5196, 0x03 },
-	{ 0x5197, 0x01 },
-	{ 0x5198, 0x04 },
-	{ 0x5199, 0x12 },
-	{ 0x519a, 0x04 },
-	{ 0x519b, 0x00 },
-	{ 0x519c, 0x06 },
-	{ 0x519d, 0x82 },
-	{ 0x519e, 0x38 },
-	{ 0x5381, 0x1e },
-	{ 0x5382, 0x5b },
-	{ 0x5383, 0x08 },
-	{ 0x5384, 0x0a },
-	{ 0x5385, 0x7e },
-	{ 0x5386, 0x88 },
-	{ 0x5387, 0x7c },
-	{ 0x5388, 0x6c },
-	{ 0x5389, 0x10 },
-	{ 0x538a, 0x01 },
-	{ 0x538b, 0x98 },
-	{ 0x5300, 0x08 },
-	{ 0x5301, 0x30 },
-	{ 0x5302, 0x10 },
-	{ 0x5303, 0x00 },
-	{ 0x5304, 0x08 },
-	{ 0x5305, 0x30 },
-	{ 0x5306, 0x08 },
-	{ 0x5307, 0x16 },
-	{ 0x5309, 0x08 },
-	{ 0x530a, 0x30 },
-	{ 0x530b, 0x04 },
-	{ 0x530c, 0x06 },
-	{ 0x5480, 0x01 },
-	{ 0x5481, 0x08 },
-	{ 0x5482, 0x14 },
-	{ 0x5483, 0x28 },
-	{ 0x5484, 0x51 },
-	{ 0x5485, 0x65 },
-	{ 0x5486, 0x71 },
-	{ 0x5487, 0x7d },
-	{ 0x5488, 0x87 },
-	{ 0x5489, 0x91 },
-	{ 0x548a, 0x9a },
-	{ 0x548b, 0xaa },
-	{ 0x548c, 0xb8 },
-	{ 0x548d, 0xcd },
-	{ 0x548e, 0xdd },
-	{ 0x548f, 0xea },
-	{ 0x5490, 0x1d },
-	{ 0x5580, 0x02 },
-	{ 0x5583, 0x40 },
-	{ 0x5584, 0x10 },
-	{ 0x5589, 0x10 },
-	{ 0x558a, 0x00 },
-	{ 0x558b, 0xf8 },
-	{ 0x5800, 0x3f },
-	{ 0x5801, 0x16 },
-	{ 0x5802, 0x0e },
-	{ 0x5803, 0x0d },
-	{ 0x5804, 0x17 },
-	{ 0x5805, 0x3f },
-	{ 0x5806, 0x0b },
-	{ 0x5807, 0x06 },
-	{ 0x5808, 0x04 },
-	{ 0x5809, 0x04 },
-	{ 0x580a, 0x06 },
-	{ 0x580b, 0x0b },
-	{ 0x580c, 0x09 },
-	{ 0x580d, 0x03 },
-	{ 0x580e, 0x00 },
-	{ 0x580f, 0x00 },
-	{ 0x5810, 0x03 },
-	{ 0x5811, 0x08 },
-	{ 0x5812, 0x0a },
-	{ 0x5813, 0x03 },
-	{ 0x5814, 0x00 },
-	{ 0x5815, 0x00 },
-	{ 0x5816, 0x04 },
-	{ 0x5817, 0x09 },
-	{ 0x5818, 0x0f },
-	{ 0x5819, 0x08 },
-	{ 0x581a, 0x06 },
-	{ 0x581b, 0x06 },
-	{ 0x581c, 0x08 },
-	{ 0x581d, 0x0c },
-	{ 0x581e, 0x3f },
-	{ 0x581f, 0x1e },
-	{ 0x5820, 0x12 },
-	{ 0x5821, 0x13 },
-	{ 0x5822, 0x21 },
-	{ 0x5823, 0x3f },
-	{ 0x5824, 0x68 },
-	{ 0x5825, 0x28 },
-	{ 0x5826, 0x2c },
-	{ 0x5827, 0x28 },
-	{ 0x5828, 0x08 },
-	{ 0x5829, 0x48 },
-	{ 0x582a, 0x64 },
-	{ 0x582b, 0x62 },
-	{ 0x582c, 0x64 },
-	{ 0x582d, 0x28 },
-	{ 0x582e, 0x46 },
-	{ 0x582f, 0x62 },
-	{ 0x5830, 0x60 },
-	{ 0x5831, 0x62 },
-	{ 0x5832, 0x26 },
-	{ 0x5833, 0x48 },
-	{ 0x5834, 0x66 },
-	{ 0x5835, 0x44 },
-	{ 0x5836, 0x64 },
-	{ 0x5837, 0x28 },
-	{ 0x5838, 0x66 },
-	{ 0x5839, 0x48 },
-	{ 0x583a, 0x2c },
-	{ 0x583b, 0x28 },
-	{ 0x583c, 0x26 },
-	{ 0x583d, 0xae },
-	{ 0x5025, 0x00 },
-	{ 0x3a0f, 0x30 },
-	{ 0x3a10, 0x28 },
-	{ 0x3a1b, 0x30 },
-	{ 0x3a1e, 0x26 },
-	{ 0x3a11, 0x60 },
-	{ 0x3a1f, 0x14 },
-	{ 0x0601, 0x02 },
-	{ 0x3008, 0x42 },
-	{ 0x3008, 0x02 }
-};
+	struct delayed_work meta_work;
+	unsigned long meta_period;	/* jiffies, one frame */
+	struct framemeta_ring meta;
 
-static struct reg_value ov5645_setting_sxga[] = {
-	{ 0x3612, 0xa9 },
-	{ 0x3614, 0x50 },
-	{ 0x3618, 0x00 },
-	{ 0x3034, 0x18 },
-	{ 0x3035, 0x21 },
-	{ 0x3036, 0x70 },
-	{ 0x3600, 0x09 },
-	{ 0x3601, 0x43 },
-	{ 0x3708, 0x66 },
-	{ 0x370c, 0xc3 },
-	{ 0x3800, 0x00 },
-	{ 0x3801, 0x00 },
-	{ 0x3802, 0x00 },
-	{ 0x3803, 0x06 },
-	{ 0x3804, 0x0a },
-	{ 0x3805, 0x3f },
-	{ 0x3806, 0x07 },
-	{ 0x3807, 0x9d },
-	{ 0x3808, 0x05 },
-	{ 0x3809, 0x00 },
-	{ 0x380a, 0x03 },
-	{ 0x380b, 0xc0 },
-	{ 0x380c, 0x07 },
-	{ 0x380d, 0x68 },
-	{ 0x380e, 0x03 },
-	{ 0x380f, 0xd8 },
-	{ 0x3813, 0x06 },
-	{ 0x3814, 0x31 },
-	{ 0x3815, 0x31 },
-	{ 0x3820, 0x47 },
-	{ 0x3a02, 0x03 },
-	{ 0x3a03, 0xd8 },
-	{ 0x3a08, 0x01 },
-	{ 0x3a09, 0xf8 },
-	{ 0x3a0a, 0x01 },
-	{ 0x3a0b, 0xa4 },
-	{ 0x3a0e, 0x02 },
-	{ 0x3a0d, 0x02 },
-	{ 0x3a14, 0x03 },
-	{ 0x3a15, 0xd8 },
-	{ 0x3a18, 0x00 },
-	{ 0x4004, 0x02 },
-	{ 0x4005, 0x18 },
-	{ 0x4300, 0x32 },
-	{ 0x4202, 0x00 }
+	const u8 *af_fw;	/* NULL if no AF firmware was found */
+	size_t af_fw_size;
+	bool af_ready;		/* af_fw is running since the last power-up */
 };
 
-static struct reg_value ov5645_setting_1080p[] = {
-	{ 0x3612, 0xab },
-	{ 0x3614, 0x50 },
-	{ 0x3618, 0x04 },
-	{ 0x3034, 0x18 },
-	{ 0x3035, 0x11 },
-	{ 0x3036, 0x54 },
-	{ 0x3600, 0x08 },
-	{ 0x3601, 0x33 },
-	{ 0x3708, 0x63 },
-	{ 0x370c, 0xc0 },
-	{ 0x3800, 0x01 },
-	{ 0x3801, 0x50 },
-	{ 0x3802, 0x01 },
-	{ 0x3803, 0xb2 },
-	{ 0x3804, 0x08 },
-	{ 0x3805, 0xef },
-	{ 0x3806, 0x05 },
-	{ 0x3807, 0xf1 },
-	{ 0x3808, 0x07 },
-	{ 0x3809, 0x80 },
-	{ 0x380a, 0x04 },
-	{ 0x380b, 0x38 },
-	{ 0x380c, 0x09 },
-	{ 0x380d, 0xc4 },
-	{ 0x380e, 0x04 },
-	{ 0x380f, 0x60 },
-	{ 0x3813, 0x04 },
-	{ 0x3814, 0x11 },
-	{ 0x3815, 0x11 },
-	{ 0x3820, 0x47 },
-	{ 0x4514, 0x88 },
-	{ 0x3a02, 0x04 },
-	{ 0x3a03, 0x60 },
-	{ 0x3a08, 0x01 },
-	{ 0x3a09, 0x50 },
-	{ 0x3a0a, 0x01 },
-	{ 0x3a0b, 0x18 },
-	{ 0x3a0e, 0x03 },
-	{ 0x3a0d, 0x04 },
-	{ 0x3a14, 0x04 },
-	{ 0x3a15, 0x60 },
-	{ 0x3a18, 0x00 },
-	{ 0x4004, 0x06 },
-	{ 0x4005, 0x18 },
-	{ 0x4300, 0x32 },
-	{ 0x4202, 0x00 },
-	{ 0x4837, 0x0b }
+static inline struct ov5645 *to_ov5645(struct sensor *s)
+{
+	return container_of(s, struct ov5645, s);
+}
+
+#include "ov5640_regs.h"
+#include "ov5645_regs.h"
+
+/* HTS and VTS as the tables set them (0x380c-0x380f). */
+static const struct sensor_mode ov5640_modes[] = {
+	SENSOR_MODE_TIMED(640, 480, 90, 1896, 508, ov5640_setting_vga),
+	SENSOR_MODE_TIMED(1280, 720, 60, 1892, 740, ov5640_setting_720p),
+	SENSOR_MODE_TIMED(1920, 1080, 30, 2500, 1120, ov5640_setting_1080p),
+	SENSOR_MODE_TIMED(2592, 1944, 15, 2844, 1968, ov5640_setting_qsxga),
 };
 
-static struct reg_value ov5645_setting_full[] = {
-	{ 0x3612, 0xab },
-	{ 0x3614, 0x50 },
-	{ 0x3618, 0x04 },
-	{ 0x3034, 0x18 },
-	{ 0x3035, 0x11 },
-	{ 0x3036, 0x54 },
-	{ 0x3600, 0x08 },
-	{ 0x3601, 0x33 },
-	{ 0x3708, 0x63 },
-	{ 0x370c, 0xc0 },
-	{ 0x3800, 0x00 },
-	{ 0x3801, 0x00 },
-	{ 0x3802, 0x00 },
-	{ 0x3803, 0x00 },
-	{ 0x3804, 0x0a },
-	{ 0x3805, 0x3f },
-	{ 0x3806, 0x07 },
-	{ 0x3807, 0x9f },
-	{ 0x3808, 0x0a },
-	{ 0x3809, 0x20 },
-	{ 0x380a, 0x07 },
-	{ 0x380b, 0x98 },
-	{ 0x380c, 0x0b },
-	{ 0x380d, 0x1c },
-	{ 0x380e, 0x07 },
-	{ 0x380f, 0xb0 },
-	{ 0x3813, 0x06 },
-	{ 0x3814, 0x11 },
-	{ 0x3815, 0x11 },
-	{ 0x3820, 0x47 },
-	{ 0x4514, 0x88 },
-	{ 0x3a02, 0x07 },
-	{ 0x3a03, 0xb0 },
-	{ 0x3a08, 0x01 },
-	{ 0x3a09, 0x27 },
-	{ 0x3a0a, 0x00 },
-	{ 0x3a0b, 0xf6 },
-	{ 0x3a0e, 0x06 },
-	{ 0x3a0d, 0x08 },
-	{ 0x3a14, 0x07 },
-	{ 0x3a15, 0xb0 },
-	{ 0x3a18, 0x01 },
-	{ 0x4004, 0x06 },
-	{ 0x4005, 0x18 },
-	{ 0x4300, 0x32 },
-	{ 0x4837, 0x0b },
-	{ 0x4202, 0x00 }
+static const struct sensor_mode ov5645_modes[] = {
+	SENSOR_MODE_TIMED(640, 480, 90, 1896, 508, ov5645_setting_vga),
+	SENSOR_MODE_TIMED(1280, 720, 60, 1892, 740, ov5645_setting_720p),
+	SENSOR_MODE_TIMED(1280, 960, 30, 1896, 984, ov5645_setting_sxga),
+	SENSOR_MODE_TIMED(1920, 1080, 30, 2500, 1120, ov5645_setting_1080p),
+	SENSOR_MODE_TIMED(2592, 1944, 15, 2844, 1968, ov5645_setting_full),
 };
 
-static struct ov5645_mode_info ov5645_mode_info_data[OV5645_MODE_MAX + 1] = {
-	{
-		.mode = OV5645_MODE_SXGA,
-		.width = 1280,
-		.height = 960,
-		.data = ov5645_setting_sxga,
-		.data_size = ARRAY_SIZE(ov5645_setting_sxga)
-	},
+/*
+ * The OV5640 and OV5645 share this driver but not their tuning: each has
+ * its own init table and mode set, picked from the chip ID at probe.
+ */
+static const struct sensor_variant ov5645_variants[] = {
 	{
-		.mode = OV5645_MODE_1080P,
-		.width = 1920,
-		.height = 1080,
-		.data = ov5645_setting_1080p,
-		.data_size = ARRAY_SIZE(ov5645_setting_1080p)
+		.name = "OV5640",
+		.chip_id = OV5645_CHIP_ID_HIGH << 8 | OV5640_CHIP_ID_LOW,
+		.init = ov5640_global_init_setting,
+		.init_size = sizeof(ov5640_global_init_setting),
+		.modes = ov5640_modes,
+		.num_modes = ARRAY_SIZE(ov5640_modes),
+		.firmware = "ov5640-regs.bin",
+		.driver_data = OV5645_HAS_AF | OV5645_PCLK_PERIOD_VAL(0x0a),
 	},
 	{
-		.mode = OV5645_MODE_FULL,
-		.width = 2592,
-		.height = 1944,
-		.data = ov5645_setting_full,
-		.data_size = ARRAY_SIZE(ov5645_setting_full)
+		.name = "OV5645",
+		.chip_id = OV5645_CHIP_ID_HIGH << 8 | OV5645_CHIP_ID_LOW,
+		.init = ov5645_global_init_setting,
+		.init_size = sizeof(ov5645_global_init_setting),
+		.modes = ov5645_modes,
+		.num_modes = ARRAY_SIZE(ov5645_modes),
+		.firmware = "ov5645-regs.bin",
+		.driver_data = OV5645_PCLK_PERIOD_VAL(0x0b),
 	},
 };
 
-static int ov5645_regulators_enable(struct ov5645 *ov5645)
+/* Reset or powered off: the AF program is gone with the rest. */
+static void ov5645_reset(struct sensor *s)
 {
-	int ret;
-
-	ret = regulator_enable(ov5645->io_regulator);
-	if (ret < 0) {
-		dev_err(ov5645->dev, "set io voltage failed\n");
-		goto exit;
-	}
-
-	ret = regulator_enable(ov5645->core_regulator);
-	if (ret) {
-		dev_err(ov5645->dev, "set core voltage failed\n");
-		goto err_disable_io;
-	}
+	to_ov5645(s)->af_ready = false;
+}
 
-	ret = regulator_enable(ov5645->analog_regulator);
-	if (ret) {
-		dev_err(ov5645->dev, "set analog voltage failed\n");
-		goto err_disable_core;
-	}
+static u32 ov5645_saturation_to_reg(struct sensor *s, s32 value)
+{
+	return value * 0x10 + 0x40;
+}
 
-	return 0;
+static u32 ov5645_test_pattern_to_reg(struct sensor *s, s32 value)
+{
+	if (!value)
+		return 0;
 
-err_disable_core:
-	regulator_disable(ov5645->core_regulator);
-err_disable_io:
-	regulator_disable(ov5645->io_regulator);
-exit:
-	return ret;
+	return OV5645_SET_TEST_PATTERN(value - 1) | OV5645_TEST_PATTERN_ENABLE;
 }
 
-static void ov5645_regulators_disable(struct ov5645 *ov5645)
+static const char * const ov5645_test_pattern_menu[] = {
+	"Disabled",
+	"Vertical Color Bars",
+	"Random Data",
+	"Color Square",
+	"Black Image",
+};
+
+static int ov5645_af_wait(struct ov5645 *ov5645, u16 reg, u8 val,
+			  unsigned int timeout_ms)
 {
+	unsigned long timeout = jiffies + msecs_to_jiffies(timeout_ms);
+	u8 cur;
 	int ret;
 
-	ret = regulator_disable(ov5645->analog_regulator);
-	if (ret < 0)
-		dev_err(ov5645->dev, "analog regulator disable failed\n");
-
-	ret = regulator_disable(ov5645->core_regulator);
-	if (ret < 0)
-		dev_err(ov5645->dev, "core regulator disable failed\n");
-
-	ret = regulator_disable(ov5645->io_regulator);
-	if (ret < 0)
-		dev_err(ov5645->dev, "io regulator disable failed\n");
+	for (;;) {
+		ret = sensor_read_reg(&ov5645->s, reg, &cur);
+		if (ret < 0)
+			return ret;
+		if (cur == val)
+			return 0;
+		if (time_after(jiffies, timeout))
+			return -ETIMEDOUT;
+		usleep_range(5000, 10000);
+	}
 }
 
-static int ov5645_write_reg(struct ov5645 *ov5645, u16 reg, u8 val)
+/* Download and start the AF program unless it already runs. */
+static int ov5645_af_load(struct ov5645 *ov5645)
 {
+	static const u8 cmd_init[] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		OV5645_AF_STATUS_DOWNLOADED,
+	};
+	unsigned int pos, n;
 	int ret;
 
-	ret = msm_cci_ctrl_write(reg, &val, 1);
+	if (ov5645->af_ready)
+		return 0;
+	if (!ov5645->af_fw)
+		return -ENODEV;
+
+	ret = sensor_write_reg(&ov5645->s, OV5645_SYSTEM_RESET00,
+			       OV5645_MCU_RESET);
 	if (ret < 0)
-		dev_err(ov5645->dev, "%s: write reg error %d: reg=%x, val=%x\n",
-			__func__, ret, reg, val);
+		return ret;
 
-	return ret;
-}
+	for (pos = 0; pos < ov5645->af_fw_size; pos += n) {
+		n = min_t(size_t, ov5645->af_fw_size - pos, OV5645_AF_BURST);
+		ret = sensor_write(&ov5645->s, OV5645_AF_FW_BASE + pos,
+					ov5645->af_fw + pos, n);
+		if (ret < 0)
+			return ret;
+	}
 
-static int ov5645_read_reg(struct ov5645 *ov5645, u16 reg, u8 *val)
-{
-	u8 tmpval;
-	int ret;
+	ret = sensor_write(&ov5645->s, OV5645_AF_CMD_MAIN, cmd_init,
+				sizeof(cmd_init));
+	if (ret < 0)
+		return ret;
 
-	ret = msm_cci_ctrl_read(reg, &tmpval, 1);
+	ret = sensor_write_reg(&ov5645->s, OV5645_SYSTEM_RESET00, 0);
+	if (ret < 0)
+		return ret;
+
+	ret = ov5645_af_wait(ov5645, OV5645_AF_FW_STATUS,
+			     OV5645_AF_STATUS_IDLE, OV5645_AF_BOOT_MS);
 	if (ret < 0) {
-		dev_err(ov5645->dev, "%s: read reg error %d: reg=%x\n",
-			__func__, ret, reg);
+		dev_err(ov5645->s.dev, "AF firmware did not start: %d\n", ret);
 		return ret;
 	}
 
-	*val = tmpval;
+	ov5645->af_ready = true;
 
 	return 0;
 }
 
-static int ov5645_set_aec_mode(struct ov5645 *ov5645, u32 mode)
+static int ov5645_af_command(struct ov5645 *ov5645, u8 cmd)
 {
-	u8 val;
 	int ret;
 
-	ret = ov5645_read_reg(ov5645, OV5645_AEC_PK_MANUAL, &val);
+	ret = ov5645_af_load(ov5645);
 	if (ret < 0)
 		return ret;
 
-	if (mode == V4L2_EXPOSURE_AUTO)
-		val &= ~OV5645_AEC_MANUAL_ENABLE;
-	else /* V4L2_EXPOSURE_MANUAL */
-		val |= OV5645_AEC_MANUAL_ENABLE;
-
-	dev_dbg(ov5645->dev, "%s: mode = %d\n", __func__, mode);
-
-	return ov5645_write_reg(ov5645, OV5645_AEC_PK_MANUAL, val);
-}
-
-static int ov5645_set_agc_mode(struct ov5645 *ov5645, u32 enable)
-{
-	u8 val;
-	int ret;
-
-	ret = ov5645_read_reg(ov5645, OV5645_AEC_PK_MANUAL, &val);
+	ret = sensor_write_reg(&ov5645->s, OV5645_AF_CMD_ACK, 1);
 	if (ret < 0)
 		return ret;
 
-	if (enable)
-		val &= ~OV5645_AGC_MANUAL_ENABLE;
-	else
-		val |= OV5645_AGC_MANUAL_ENABLE;
-
-	dev_dbg(ov5645->dev, "%s: enable = %d\n", __func__, enable);
-
-	return ov5645_write_reg(ov5645, OV5645_AEC_PK_MANUAL, val);
-}
-
-static int ov5645_set_register_array(struct ov5645 *ov5645,
-				     struct reg_value *settings,
-				     u32 num_settings)
-{
-	u16 reg;
-	u8 val;
-	u32 i;
-	int ret = 0;
+	ret = sensor_write_reg(&ov5645->s, OV5645_AF_CMD_MAIN, cmd);
+	if (ret < 0)
+		return ret;
 
-	for (i = 0; i < num_settings; ++i, ++settings) {
-		reg = settings->reg;
-		val = settings->val;
+	ret = ov5645_af_wait(ov5645, OV5645_AF_CMD_ACK, 0, OV5645_AF_ACK_MS);
+	if (ret < 0)
+		dev_err(ov5645->s.dev, "AF command 0x%02x not acknowledged\n",
+			cmd);
 
-		ret = ov5645_write_reg(ov5645, reg, val);
-		if (ret < 0)
-			goto err;
-	}
-err:
 	return ret;
 }
 
-static int ov5645_init(struct ov5645 *ov5645)
-{
-	struct reg_value *settings;
-	u32 num_settings;
-
-	settings = OV5640_REG_1080P;
-	num_settings = ARRAY_SIZE(OV5640_REG_1080P);
-
-	return ov5645_set_register_array(ov5645, settings, num_settings);
-}
-
-static int ov5645_change_mode(struct ov5645 *ov5645, enum ov5645_mode mode)
+static int ov5645_set_focus_auto(struct ov5645 *ov5645, s32 enable)
 {
-	struct reg_value *settings;
-	u32 num_settings;
-
-	settings = ov5645_mode_info_data[mode].data;
-	num_settings = ov5645_mode_info_data[mode].data_size;
+	/* Nothing to stop if the MCU was never started. */
+	if (!enable && !ov5645->af_ready)
+		return 0;
 
-	return ov5645_set_register_array(ov5645, settings, num_settings);
+	return ov5645_af_command(ov5645, enable ? OV5645_AF_CONTINUOUS :
+						  OV5645_AF_PAUSE);
 }
 
-static int ov5645_set_power_on(struct ov5645 *ov5645)
+static int ov5645_get_focus_status(struct ov5645 *ov5645, s32 *status)
 {
+	u8 val;
 	int ret;
 
-	dev_dbg(ov5645->dev, "%s: Vistar Enter\n", __func__);
-
-	clk_set_rate(ov5645->xclk, OV5645_XCLK);
-
-	ret = clk_prepare_enable(ov5645->xclk);
-	if (ret < 0) {
-		dev_err(ov5645->dev, "clk prepare enable failed\n");
-		return ret;
+	if (!ov5645->af_ready) {
+		*status = V4L2_AUTO_FOCUS_STATUS_IDLE;
+		return 0;
 	}
 
-	ret = ov5645_regulators_enable(ov5645);
-	if (ret < 0) {
-		clk_disable_unprepare(ov5645->xclk);
+	ret = sensor_read_reg(&ov5645->s, OV5645_AF_FW_STATUS, &val);
+	if (ret < 0)
 		return ret;
-	}
 
-// Not sure the circuit on STM sensor board,the default kernel gpio operation will do :
-//1)Reset:High
-//2)PWDN:Low
-	usleep_range(1000, 2000);
-	gpiod_set_value_cansleep(ov5645->rst_gpio, 0);
-
-	usleep_range(5000, 15000);
-	gpiod_set_value_cansleep(ov5645->enable_gpio, 0);
-	
-	msleep(20);
-
-	return ret;
-}
-
-static void ov5645_set_power_off(struct ov5645 *ov5645)
-{
-	dev_dbg(ov5645->dev, "%s: Vistar Enter\n", __func__);
-
-
-	if (ov5645->rst_gpio)
-		gpiod_set_value_cansleep(ov5645->rst_gpio, 1);
-	if (ov5645->enable_gpio)
-		gpiod_set_value_cansleep(ov5645->enable_gpio, 1);
+	switch (val) {
+	case OV5645_AF_STATUS_FOCUSING:
+		*status = V4L2_AUTO_FOCUS_STATUS_BUSY;
+		break;
+	case OV5645_AF_STATUS_FOCUSED:
+		*status = V4L2_AUTO_FOCUS_STATUS_REACHED;
+		break;
+	case OV5645_AF_STATUS_IDLE:
+		*status = V4L2_AUTO_FOCUS_STATUS_IDLE;
+		break;
+	default:
+		*status = V4L2_AUTO_FOCUS_STATUS_FAILED;
+		break;
+	}
 
-	ov5645_regulators_disable(ov5645);
-	clk_disable_unprepare(ov5645->xclk);
+	return 0;
 }
 
-static int ov5645_s_power(struct v4l2_subdev *sd, int on)
+static int ov5645_s_ctrl(struct sensor *s, struct v4l2_ctrl *ctrl)
 {
-	struct ov5645 *ov5645 = to_ov5645(sd);
-	int ret = 0;
-
-	dev_dbg(ov5645->dev, "%s: on = %d\n", __func__, on);
-
-	mutex_lock(&ov5645->power_lock);
+	struct ov5645 *ov5645 = to_ov5645(s);
+	int ret = -EINVAL;
 
-	if (on) {
-		ret = msm_cci_ctrl_init();
-		if (ret < 0)
-			goto exit;
+	/* A property of the mode, not a register: stored even powered off. */
+	if (ctrl->id == V4L2_CID_OV5645_CTRL_DELAY) {
+		ov5645->ctrl_delays[s->current_mode] = ctrl->val;
+		return 0;
 	}
 
-	if (ov5645->power == !on) {
-		/* Power state changes. */
-		if (on) {
-			ret = ov5645_set_power_on(ov5645);
-			if (ret < 0) {
-				dev_err(ov5645->dev, "could not set power %s\n",
-					on ? "on" : "off");
-				goto exit;
-			}
-
-			ret = ov5645_init(ov5645);
-			if (ret < 0) {
-				dev_err(ov5645->dev,
-					"could not set init registers\n");
-				ov5645_set_power_off(ov5645);
-				goto exit;
-			}
-
-			ret = ov5645_write_reg(ov5645, OV5645_SYSTEM_CTRL0,
-					       OV5645_SYSTEM_CTRL0_STOP);
-			if (ret < 0) {
-				ov5645_set_power_off(ov5645);
-				goto exit;
-			}
-		} else {
-			ov5645_set_power_off(ov5645);
-		}
+	if (!s->power)
+		return 0;
 
-		/* Update the power state. */
-		ov5645->power = on ? true : false;
+	switch (ctrl->id) {
+	case V4L2_CID_FOCUS_AUTO:
+		ret = ov5645_set_focus_auto(ov5645, ctrl->val);
+		break;
+	case V4L2_CID_AUTO_FOCUS_START:
+		if (ov5645->focus_auto->val)
+			ret = -EBUSY;
+		else
+			ret = ov5645_af_command(ov5645,
+						OV5645_AF_TRIG_SINGLE);
+		break;
+	case V4L2_CID_AUTO_FOCUS_STOP:
+		ret = ov5645->af_ready ?
+		      ov5645_af_command(ov5645, OV5645_AF_PAUSE) : 0;
+		break;
+	case V4L2_CID_OV5645_RECOVER:
+		/*
+		 * Recovery replays the controls, which takes the lock held
+		 * around this call: leave it to the watchdog.
+		 */
+		s->fault = true;
+		mod_delayed_work(system_wq, &ov5645->watchdog, 0);
+		ret = 0;
+		break;
 	}
 
-exit:
-	if (!on)
-		msm_cci_ctrl_release();
-
-	mutex_unlock(&ov5645->power_lock);
-
 	return ret;
 }
 
-
-static int ov5645_set_saturation(struct ov5645 *ov5645, s32 value)
+static int ov5645_g_volatile_ctrl(struct sensor *s, struct v4l2_ctrl *ctrl)
 {
-	u32 reg_value = (value * 0x10) + 0x40;
-	int ret = 0;
-
-	ret |= ov5645_write_reg(ov5645, OV5645_SDE_SAT_U, reg_value);
-	ret |= ov5645_write_reg(ov5645, OV5645_SDE_SAT_V, reg_value);
+	struct ov5645 *ov5645 = to_ov5645(s);
+	int ret = -EINVAL;
 
-	dev_dbg(ov5645->dev, "%s: value = %d\n", __func__, value);
+	switch (ctrl->id) {
+	case FRAMEMETA_CID:
+		framemeta_read(&ov5645->meta, ctrl->p_new.p_u32);
+		ret = 0;
+		break;
+	case V4L2_CID_AUTO_FOCUS_STATUS:
+		if (s->power)
+			ret = ov5645_get_focus_status(ov5645, &ctrl->val);
+		else {
+			ctrl->val = V4L2_AUTO_FOCUS_STATUS_IDLE;
+			ret = 0;
+		}
+		break;
+	}
 
 	return ret;
 }
 
-static int ov5645_set_hflip(struct ov5645 *ov5645, s32 value)
+/* Keep the AF program in memory; see OV5645_AF_FIRMWARE. */
+static void ov5645_af_request(struct ov5645 *ov5645)
 {
-	u8 val;
-	int ret;
+	const struct firmware *fw;
 
-	ret = ov5645_read_reg(ov5645, OV5645_TIMING_TC_REG21, &val);
-	if (ret < 0)
-		return ret;
+	if (request_firmware_direct(&fw, OV5645_AF_FIRMWARE, ov5645->s.dev)) {
+		dev_info(ov5645->s.dev, "no %s, autofocus disabled\n",
+			 OV5645_AF_FIRMWARE);
+		return;
+	}
 
-	if (value == 0)
-		val &= ~(OV5645_SENSOR_MIRROR);
+	if (!fw->size || fw->size > OV5645_AF_FW_MAX)
+		dev_err(ov5645->s.dev, "%s: bad size %zu\n", OV5645_AF_FIRMWARE,
+			fw->size);
 	else
-		val |= (OV5645_SENSOR_MIRROR);
+		ov5645->af_fw = kmemdup(fw->data, fw->size, GFP_KERNEL);
 
-	dev_dbg(ov5645->dev, "%s: value = %d\n", __func__, value);
+	if (ov5645->af_fw)
+		ov5645->af_fw_size = fw->size;
 
-	return ov5645_write_reg(ov5645, OV5645_TIMING_TC_REG21, val);
+	release_firmware(fw);
 }
 
-static int ov5645_set_vflip(struct ov5645 *ov5645, s32 value)
+static const struct v4l2_ctrl_config ov5645_recover_ctrl = {
+	.ops = &sensor_ctrl_ops,
+	.id = V4L2_CID_OV5645_RECOVER,
+	.name = "Sensor Recovery",
+	.type = V4L2_CTRL_TYPE_BUTTON,
+};
+
+static const struct v4l2_ctrl_config ov5645_ctrl_delay_ctrl = {
+	.ops = &sensor_ctrl_ops,
+	.id = V4L2_CID_OV5645_CTRL_DELAY,
+	.name = "Control Delay",
+	.type = V4L2_CTRL_TYPE_INTEGER,
+	.min = 0,
+	.max = OV5645_CTRL_DELAY_MAX,
+	.step = 1,
+	.def = OV5645_CTRL_DELAY_DEFAULT,
+};
+
+/*
+ * Hard-reset the sensor and bring it back to where it was: init table,
+ * cached controls and, if it was streaming, streaming again.
+ */
+static int ov5645_recover(struct ov5645 *ov5645)
 {
-	u8 val;
+	struct sensor *s = &ov5645->s;
 	int ret;
 
-	ret = ov5645_read_reg(ov5645, OV5645_TIMING_TC_REG20, &val);
+	mutex_lock(&s->lock);
+	if (!s->power) {
+		mutex_unlock(&s->lock);
+		return 0;
+	}
+
+	dev_warn(s->dev, "resetting sensor (recovery %u)\n",
+		 ++ov5645->recoveries);
+	ret = sensor_reset(s);
+	mutex_unlock(&s->lock);
 	if (ret < 0)
 		return ret;
 
-	if (value == 0)
-		val |= (OV5645_SENSOR_VFLIP | OV5645_ISP_VFLIP);
-	else
-		val &= ~(OV5645_SENSOR_VFLIP | OV5645_ISP_VFLIP);
+	/* The control handler takes the lock itself. */
+	ret = v4l2_ctrl_handler_setup(&s->ctrls);
+	if (ret < 0)
+		return ret;
 
-	dev_dbg(ov5645->dev, "%s: value = %d\n", __func__, value);
+	mutex_lock(&s->lock);
+	if (s->streaming)
+		ret = sensor_write_reg(s, OV5645_SYSTEM_CTRL0,
+				       OV5645_SYSTEM_CTRL0_START);
+	mutex_unlock(&s->lock);
 
-	return ov5645_write_reg(ov5645, OV5645_TIMING_TC_REG20, val);
+	return ret;
 }
 
-static int ov5645_set_test_pattern(struct ov5645 *ov5645, s32 value)
+static void ov5645_watchdog(struct work_struct *work)
 {
+	struct ov5645 *ov5645 = container_of(to_delayed_work(work),
+					     struct ov5645, watchdog);
+	struct sensor *s = &ov5645->s;
+	bool reset, again;
 	u8 val;
-	int ret;
 
-	ret = ov5645_read_reg(ov5645, OV5645_PRE_ISP_TEST_SETTING_1, &val);
-	if (ret < 0)
-		return ret;
-
-	if (value) {
-		val &= ~OV5645_SET_TEST_PATTERN(OV5645_TEST_PATTERN_MASK);
-		val |= OV5645_SET_TEST_PATTERN(value - 1);
-		val |= OV5645_TEST_PATTERN_ENABLE;
-	} else {
-		val &= ~OV5645_TEST_PATTERN_ENABLE;
+	mutex_lock(&s->lock);
+	if (!s->power) {
+		mutex_unlock(&s->lock);
+		return;
+	}
+
+	reset = s->fault;
+	if (!reset && s->streaming)
+		reset = sensor_read_reg(s, OV5645_FORMAT_CTRL00, &val) < 0 ||
+			val != OV5645_FORMAT_UYVY;
+	mutex_unlock(&s->lock);
+
+	if (reset) {
+		if (ov5645_recover(ov5645) < 0) {
+			s->fault = true;
+			ov5645->watchdog_ms = min_t(unsigned int,
+						    ov5645->watchdog_ms * 2,
+						    OV5645_WATCHDOG_MAX_MS);
+			dev_err(s->dev, "recovery failed, retry in %u ms\n",
+				ov5645->watchdog_ms);
+		} else {
+			ov5645->watchdog_ms = OV5645_WATCHDOG_MS;
+		}
 	}
 
-	dev_dbg(ov5645->dev, "%s: value = %d\n", __func__, value);
+	mutex_lock(&s->lock);
+	again = s->power && (s->streaming || s->fault);
+	mutex_unlock(&s->lock);
 
-	return ov5645_write_reg(ov5645, OV5645_PRE_ISP_TEST_SETTING_1, val);
+	if (again)
+		schedule_delayed_work(&ov5645->watchdog,
+				      msecs_to_jiffies(ov5645->watchdog_ms));
 }
 
-static const char * const ov5645_test_pattern_menu[] = {
-	"Disabled",
-	"Vertical Color Bars",
-	"Random Data",
-	"Color Square",
-	"Black Image",
-};
-
-static int ov5645_set_awb(struct ov5645 *ov5645, s32 enable_auto)
+static int ov5645_read_meta(struct ov5645 *ov5645, struct framemeta *m)
 {
-	u8 val;
+	struct sensor *s = &ov5645->s;
+	u8 exp[3], gain[2], awb[6];
+	unsigned int i;
 	int ret;
 
-	ret = ov5645_read_reg(ov5645, OV5645_AWB_MANUAL_CONTROL, &val);
+	/* Three transfers instead of eleven, all volatile registers. */
+	ret = sensor_read(s, OV5645_AEC_EXPOSURE, exp, ARRAY_SIZE(exp));
+	if (ret >= 0)
+		ret = sensor_read(s, OV5645_AEC_GAIN, gain, ARRAY_SIZE(gain));
+	if (ret >= 0)
+		ret = sensor_read(s, OV5645_AWB_GAIN, awb, ARRAY_SIZE(awb));
 	if (ret < 0)
 		return ret;
 
-	if (enable_auto)
-		val &= ~OV5645_AWB_MANUAL_ENABLE;
-	else
-		val |= OV5645_AWB_MANUAL_ENABLE;
+	m->exposure = ((exp[0] & 0x0f) << 16 | exp[1] << 8 | exp[2]) >> 4;
+	m->gain = (gain[0] & 0x03) << 8 | gain[1];
+	for (i = 0; i < 3; i++)
+		m->awb[i] = (awb[2 * i] & 0x0f) << 8 | awb[2 * i + 1];
 
-	dev_dbg(ov5645->dev, "%s: enable_auto = %d\n", __func__, enable_auto);
-
-	return ov5645_write_reg(ov5645, OV5645_AWB_MANUAL_CONTROL, val);
+	return 0;
 }
 
-static int ov5645_s_ctrl(struct v4l2_ctrl *ctrl)
-{
-	struct ov5645 *ov5645 = container_of(ctrl->handler,
-					     struct ov5645, ctrls);
-	int ret = -EINVAL;
-
-	mutex_lock(&ov5645->power_lock);
-	if (ov5645->power == 0) {
-		mutex_unlock(&ov5645->power_lock);
-		return 0;
-	}
-
-	switch (ctrl->id) {
-	case V4L2_CID_SATURATION:
-		ret = ov5645_set_saturation(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_AUTO_WHITE_BALANCE:
-		ret = ov5645_set_awb(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_AUTOGAIN:
-		ret = ov5645_set_agc_mode(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_EXPOSURE_AUTO:
-		ret = ov5645_set_aec_mode(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_TEST_PATTERN:
-		ret = ov5645_set_test_pattern(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_HFLIP:
-		ret = ov5645_set_hflip(ov5645, ctrl->val);
-		break;
-	case V4L2_CID_VFLIP:
-		ret = ov5645_set_vflip(ov5645, ctrl->val);
-		break;
-	}
-
-	mutex_unlock(&ov5645->power_lock);
 
-	return ret;
+static void ov5645_meta_sample(struct work_struct *work)
+{
+	struct ov5645 *ov5645 = container_of(to_delayed_work(work),
+					     struct ov5645, meta_work);
+	struct sensor *s = &ov5645->s;
+	struct framemeta m;
+	bool again;
+
+	mutex_lock(&s->lock);
+	again = s->power && s->streaming;
+	/* Leave a faulty sensor to the watchdog. */
+	if (again && !s->fault && ov5645_read_meta(ov5645, &m) == 0)
+		framemeta_push(&ov5645->meta, &m);
+	mutex_unlock(&s->lock);
+
+	if (again)
+		schedule_delayed_work(&ov5645->meta_work, ov5645->meta_period);
 }
 
-static struct v4l2_ctrl_ops ov5645_ctrl_ops = {
-	.s_ctrl = ov5645_s_ctrl,
+static const struct v4l2_ctrl_config ov5645_meta_ctrl = {
+	.ops = &sensor_ctrl_ops,
+	FRAMEMETA_CTRL_CONFIG,
 };
 
-static int ov5645_enum_mbus_code(struct v4l2_subdev *sd,
-				 struct v4l2_subdev_pad_config *cfg,
-				 struct v4l2_subdev_mbus_code_enum *code)
+static void ov5645_mode_changed(struct sensor *s)
 {
-	struct ov5645 *ov5645 = to_ov5645(sd);
-
-	if (code->index > 0)
-		return -EINVAL;
+	struct ov5645 *ov5645 = to_ov5645(s);
 
-	code->code = ov5645->fmt.code;
-
-	return 0;
+	/* Not yet created while probe picks the default mode. */
+	if (ov5645->ctrl_delay)
+		__v4l2_ctrl_s_ctrl(ov5645->ctrl_delay,
+				 ov5645->ctrl_delays[s->current_mode]);
 }
 
-static int ov5645_enum_frame_size(struct v4l2_subdev *subdev,
-				  struct v4l2_subdev_pad_config *cfg,
-				  struct v4l2_subdev_frame_size_enum *fse)
+/*
+ * Only the registers the solved PLL changes are written: the rest of what
+ * it compares with is what the mode table just left in the cache.
+ */
+static int ov5645_set_pll(struct sensor *s, const struct sensor_pll *pll)
 {
-	if (fse->index >= OV5645_MODE_MAX)
-		return -EINVAL;
+	const struct sensor_mode *mode = &s->variant->modes[s->current_mode];
+	u64 table_rate = (u64)mode->hts * mode->vts * mode->fps;
+	u32 b50, b60, period;
+	u8 val, buf[2];
+	int ret;
 
-	fse->min_width = ov5645_mode_info_data[fse->index].width;
-	fse->max_width = ov5645_mode_info_data[fse->index].width;
-	fse->min_height = ov5645_mode_info_data[fse->index].height;
-	fse->max_height = ov5645_mode_info_data[fse->index].height;
+	ret = sensor_read_reg(s, OV5645_SC_PLL_CTRL3, &val);
+	if (ret < 0)
+		return ret;
+	val = (val & ~OV5645_PLL_PREDIV_MASK) | pll->prediv;
+	ret = sensor_update(s, OV5645_SC_PLL_CTRL3, &val, 1);
+	if (ret < 0)
+		return ret;
 
-	return 0;
-}
+	val = pll->mult;
+	ret = sensor_update(s, OV5645_SC_PLL_CTRL2, &val, 1);
+	if (ret < 0)
+		return ret;
 
-static struct v4l2_mbus_framefmt *
-__ov5645_get_pad_format(struct ov5645 *ov5645,
-			struct v4l2_subdev_pad_config *cfg,
-			unsigned int pad,
-			enum v4l2_subdev_format_whence which)
-{
-	switch (which) {
-	case V4L2_SUBDEV_FORMAT_TRY:
-		return v4l2_subdev_get_try_format(&ov5645->sd, cfg, pad);
-	case V4L2_SUBDEV_FORMAT_ACTIVE:
-		return &ov5645->fmt;
-	default:
-		return NULL;
-	}
-}
+	ret = sensor_read_reg(s, OV5645_SC_PLL_CTRL1, &val);
+	if (ret < 0)
+		return ret;
+	val = OV5645_PLL_SYSDIV(pll->sysdiv) |
+	      (val & OV5645_PLL_MIPI_DIV_MASK);
+	ret = sensor_update(s, OV5645_SC_PLL_CTRL1, &val, 1);
+	if (ret < 0)
+		return ret;
 
-static int ov5645_get_format(struct v4l2_subdev *sd,
-			     struct v4l2_subdev_pad_config *cfg,
-			     struct v4l2_subdev_format *format)
-{
-	struct ov5645 *ov5645 = to_ov5645(sd);
+	b50 = max_t(u32, div_u64(pll->pixel_rate, mode->hts * 100), 1);
+	b60 = max_t(u32, div_u64(pll->pixel_rate, mode->hts * 120), 1);
 
-	format->format = *__ov5645_get_pad_format(ov5645, cfg, format->pad,
-						  format->which);
-	return 0;
-}
+	buf[0] = b50 >> 8;
+	buf[1] = b50;
+	ret = sensor_update(s, OV5645_AEC_B50_STEP, buf, 2);
+	if (ret < 0)
+		return ret;
 
-static struct v4l2_rect *
-__ov5645_get_pad_crop(struct ov5645 *ov5645, struct v4l2_subdev_pad_config *cfg,
-		      unsigned int pad, enum v4l2_subdev_format_whence which)
-{
-	switch (which) {
-	case V4L2_SUBDEV_FORMAT_TRY:
-		return v4l2_subdev_get_try_crop(&ov5645->sd, cfg, pad);
-	case V4L2_SUBDEV_FORMAT_ACTIVE:
-		return &ov5645->crop;
-	default:
-		return NULL;
-	}
-}
+	buf[0] = b60 >> 8;
+	buf[1] = b60;
+	ret = sensor_update(s, OV5645_AEC_B60_STEP, buf, 2);
+	if (ret < 0)
+		return ret;
 
-static enum ov5645_mode ov5645_find_nearest_mode(struct ov5645 *ov5645,
-						 int width, int height)
-{
-	int i;
+	val = min_t(u32, mode->vts / b60, 0x3f);
+	ret = sensor_update(s, OV5645_AEC_CTRL0D, &val, 1);
+	if (ret < 0)
+		return ret;
 
-	for (i = OV5645_MODE_MAX; i >= 0; i--) {
-		if (ov5645_mode_info_data[i].width <= width &&
-		    ov5645_mode_info_data[i].height <= height)
-			break;
-	}
+	val = min_t(u32, mode->vts / b50, 0x3f);
+	ret = sensor_update(s, OV5645_AEC_CTRL0E, &val, 1);
+	if (ret < 0)
+		return ret;
 
-	if (i < 0)
-		i = 0;
+	/* Not 1e9 / rate: the tables round it differently per variant. */
+	period = OV5645_GET_PCLK_PERIOD(s->variant->driver_data);
+	val = min_t(u64, DIV_ROUND_CLOSEST_ULL(period * table_rate,
+					       pll->pixel_rate), 0xff);
 
-	return (enum ov5645_mode)i;
+	return sensor_update(s, OV5645_PCLK_PERIOD, &val, 1);
 }
 
-static int ov5645_set_format(struct v4l2_subdev *sd,
-			     struct v4l2_subdev_pad_config *cfg,
-			     struct v4l2_subdev_format *format)
+static void ov5645_stream_on(struct sensor *s)
 {
-	struct ov5645 *ov5645 = to_ov5645(sd);
-	struct v4l2_mbus_framefmt *__format;
-	struct v4l2_rect *__crop;
-	enum ov5645_mode new_mode;
+	struct ov5645 *ov5645 = to_ov5645(s);
+	struct v4l2_fract interval;
 
-	__crop = __ov5645_get_pad_crop(ov5645, cfg, format->pad,
-			format->which);
+	ov5645->watchdog_ms = OV5645_WATCHDOG_MS;
+	schedule_delayed_work(&ov5645->watchdog,
+			      msecs_to_jiffies(OV5645_WATCHDOG_MS));
 
-	new_mode = ov5645_find_nearest_mode(ov5645,
-			format->format.width, format->format.height);
-	__crop->width = ov5645_mode_info_data[new_mode].width;
-	__crop->height = ov5645_mode_info_data[new_mode].height;
+	mutex_lock(&s->lock);
+	sensor_get_interval(s, &interval);
+	mutex_unlock(&s->lock);
 
-	ov5645->current_mode = new_mode;
-
-	__format = __ov5645_get_pad_format(ov5645, cfg, format->pad,
-			format->which);
-	__format->width = __crop->width;
-	__format->height = __crop->height;
-
-	return 0;
+	ov5645->meta_period = max_t(unsigned long, 1,
+			msecs_to_jiffies(1000 * interval.numerator /
+					 interval.denominator));
+	schedule_delayed_work(&ov5645->meta_work, 0);
 }
 
-static int ov5645_get_selection(struct v4l2_subdev *sd,
-			   struct v4l2_subdev_pad_config *cfg,
-			   struct v4l2_subdev_selection *sel)
+static void ov5645_stream_off(struct sensor *s)
 {
-	struct ov5645 *ov5645 = to_ov5645(sd);
+	struct ov5645 *ov5645 = to_ov5645(s);
 
-	if (sel->target != V4L2_SEL_TGT_CROP)
-		return -EINVAL;
-
-	sel->r = *__ov5645_get_pad_crop(ov5645, cfg, sel->pad,
-					sel->which);
-	return 0;
+	cancel_delayed_work_sync(&ov5645->watchdog);
+	cancel_delayed_work_sync(&ov5645->meta_work);
 }
 
-static int ov5645_s_stream(struct v4l2_subdev *subdev, int enable)
-{
-	struct ov5645 *ov5645 = to_ov5645(subdev);
-	int ret;
-
-	dev_dbg(ov5645->dev, "%s: enable = %d\n", __func__, enable);
-
-	if (enable) {
-		/*
-		ret = ov5645_change_mode(ov5645, ov5645->current_mode);
-		if (ret < 0) {
-			dev_err(ov5645->dev, "could not set mode %d\n",
-				ov5645->current_mode);
-			return ret;
-		}
-		
-		ret = v4l2_ctrl_handler_setup(&ov5645->ctrls);
-		if (ret < 0) {
-			dev_err(ov5645->dev, "could not sync v4l2 controls\n");
-			return ret;
-		}
-		*/
-		ret = ov5645_write_reg(ov5645, OV5645_SYSTEM_CTRL0,
-				       OV5645_SYSTEM_CTRL0_START);
-		if (ret < 0)
-			return ret;
-	} else {
-		ret = ov5645_write_reg(ov5645, OV5645_SYSTEM_CTRL0,
-				       OV5645_SYSTEM_CTRL0_STOP);
-		if (ret < 0)
-			return ret;
-	}
-
-	return 0;
-}
+/*
+ * Read-modify-write fields are served from the core's register cache, so
+ * replaying them at stream start costs no CCI reads.
+ */
+static const struct sensor_ctrl_map ov5645_ctrl_map[] = {
+	{
+		.id = V4L2_CID_SATURATION,
+		.reg = OV5645_SDE_SAT_U,
+		.len = 1,
+		.to_reg = ov5645_saturation_to_reg,
+	},
+	{
+		.id = V4L2_CID_SATURATION,
+		.reg = OV5645_SDE_SAT_V,
+		.len = 1,
+		.to_reg = ov5645_saturation_to_reg,
+	},
+	{
+		.id = V4L2_CID_AUTO_WHITE_BALANCE,
+		.reg = OV5645_AWB_MANUAL_CONTROL,
+		.len = 1,
+		.mask = OV5645_AWB_MANUAL_ENABLE,
+		.flags = SENSOR_CTRL_INVERT,
+	},
+	{
+		.id = V4L2_CID_AUTOGAIN,
+		.reg = OV5645_AEC_PK_MANUAL,
+		.len = 1,
+		.mask = OV5645_AGC_MANUAL_ENABLE,
+		.flags = SENSOR_CTRL_INVERT,
+	},
+	{
+		/* V4L2_EXPOSURE_MANUAL (1) sets the bit. */
+		.id = V4L2_CID_EXPOSURE_AUTO,
+		.reg = OV5645_AEC_PK_MANUAL,
+		.len = 1,
+		.mask = OV5645_AEC_MANUAL_ENABLE,
+	},
+	{
+		.id = V4L2_CID_TEST_PATTERN,
+		.reg = OV5645_PRE_ISP_TEST_SETTING_1,
+		.len = 1,
+		.mask = OV5645_TEST_PATTERN_ENABLE | OV5645_TEST_PATTERN_MASK,
+		.to_reg = ov5645_test_pattern_to_reg,
+	},
+	{
+		.id = V4L2_CID_HFLIP,
+		.reg = OV5645_TIMING_TC_REG21,
+		.len = 1,
+		.mask = OV5645_SENSOR_MIRROR,
+	},
+	{
+		/* Both flip bits are set for the unflipped image. */
+		.id = V4L2_CID_VFLIP,
+		.reg = OV5645_TIMING_TC_REG20,
+		.len = 1,
+		.mask = OV5645_SENSOR_VFLIP | OV5645_ISP_VFLIP,
+		.flags = SENSOR_CTRL_INVERT,
+	},
+};
 
-static struct v4l2_subdev_core_ops ov5645_core_ops = {
-	.s_power = ov5645_s_power,
+static const struct sensor_supply ov5645_supplies[] = {
+	{ "vdddo", OV5645_VOLTAGE_DIGITAL_IO },
+	{ "vddd", OV5645_VOLTAGE_DIGITAL_CORE },
+	{ "vdda", OV5645_VOLTAGE_ANALOG },
 };
 
-static struct v4l2_subdev_video_ops ov5645_video_ops = {
-	.s_stream = ov5645_s_stream,
+/*
+ * Integer pre-dividers only; the VCO and lane limits bracket the tables'
+ * own settings (669 to 892 MHz VCO from 23.88 MHz).
+ */
+static const struct sensor_pll_limits ov5645_pll = {
+	.prediv_min = 1,
+	.prediv_max = 4,
+	.mult_min = 4,
+	.mult_max = 127,
+	.sysdiv_min = 1,
+	.sysdiv_max = 15,
+	.vco_min = 500000000,
+	.vco_max = 1000000000,
+	.lane_max = 1000000000,
 };
 
-static struct v4l2_subdev_pad_ops ov5645_subdev_pad_ops = {
-	.enum_mbus_code = ov5645_enum_mbus_code,
-	.enum_frame_size = ov5645_enum_frame_size,
-	.get_fmt = ov5645_get_format,
-	.set_fmt = ov5645_set_format,
-	.get_selection = ov5645_get_selection,
+/* Compared by ov5645_set_pll() against what the mode table wrote. */
+static const u16 ov5645_cached_regs[] = {
+	OV5645_SC_PLL_CTRL1,
+	OV5645_SC_PLL_CTRL2,
+	OV5645_SC_PLL_CTRL3,
+	OV5645_AEC_B50_STEP,
+	OV5645_AEC_B50_STEP + 1,
+	OV5645_AEC_B60_STEP,
+	OV5645_AEC_B60_STEP + 1,
+	OV5645_AEC_CTRL0D,
+	OV5645_AEC_CTRL0E,
+	OV5645_PCLK_PERIOD,
 };
 
-static struct v4l2_subdev_ops ov5645_subdev_ops = {
-	.core = &ov5645_core_ops,
-	.video = &ov5645_video_ops,
-	.pad = &ov5645_subdev_pad_ops,
+static const struct sensor_ops ov5645_ops = {
+	.reset = ov5645_reset,
+	.s_ctrl = ov5645_s_ctrl,
+	.g_volatile_ctrl = ov5645_g_volatile_ctrl,
+	.set_pll = ov5645_set_pll,
+	.mode_changed = ov5645_mode_changed,
+	.stream_on = ov5645_stream_on,
+	.stream_off = ov5645_stream_off,
 };
 
-static const struct v4l2_subdev_internal_ops ov5645_subdev_internal_ops = {
+static const struct sensor_desc ov5645_desc = {
+	.ops = &ov5645_ops,
+	.variants = ov5645_variants,
+	.num_variants = ARRAY_SIZE(ov5645_variants),
+	.chip_id_reg = OV5645_CHIP_ID_HIGH_REG,
+	.max_register = OV5645_MAX_REGISTER,
+	.code = MEDIA_BUS_FMT_UYVY8_2X8,
+	.xclk_freq = OV5645_XCLK,
+	.supplies = ov5645_supplies,
+	.num_supplies = ARRAY_SIZE(ov5645_supplies),
+	.power = {
+		.reset_first = true,
+		.supply_us = 1000,
+		.gpio_us = 5000,
+		.boot_ms = 20,
+	},
+	.stream_reg = OV5645_SYSTEM_CTRL0,
+	.stream_on = OV5645_SYSTEM_CTRL0_START,
+	.stream_off = OV5645_SYSTEM_CTRL0_STOP,
+	.ctrl_map = ov5645_ctrl_map,
+	.num_ctrl_map = ARRAY_SIZE(ov5645_ctrl_map),
+	.cached_regs = ov5645_cached_regs,
+	.num_cached_regs = ARRAY_SIZE(ov5645_cached_regs),
+	.pll = &ov5645_pll,
+	.bpp = 16,
 };
 
 static int ov5645_probe(struct i2c_client *client,
 			const struct i2c_device_id *id)
 {
 	struct device *dev = &client->dev;
-	struct device_node *endpoint;
 	struct ov5645 *ov5645;
-	u8 chip_id_high, chip_id_low;
+	struct sensor *s;
+	unsigned int i;
 	int ret;
 
 	ov5645 = devm_kzalloc(dev, sizeof(struct ov5645), GFP_KERNEL);
 	if (!ov5645)
 		return -ENOMEM;
+	s = &ov5645->s;
 
-	ov5645->i2c_client = client;
-	ov5645->dev = dev;
-	ov5645->fmt.code = MEDIA_BUS_FMT_UYVY8_2X8;
-	ov5645->fmt.width = 1920;
-	ov5645->fmt.height = 1080;
-	ov5645->fmt.field = V4L2_FIELD_NONE;
-	ov5645->fmt.colorspace = V4L2_COLORSPACE_SRGB;
-	ov5645->current_mode = OV5645_MODE_1080P;
-
-	endpoint = of_graph_get_next_endpoint(dev->of_node, NULL);
-	if (!endpoint) {
-		dev_err(dev, "endpoint node not found\n");
-		return -EINVAL;
-	}
-
-	ret = v4l2_of_parse_endpoint(endpoint, &ov5645->ep);
-	if (ret < 0) {
-		dev_err(dev, "parsing endpoint node failed\n");
-		return ret;
-	}
-	if (ov5645->ep.bus_type != V4L2_MBUS_CSI2) {
-		dev_err(dev, "invalid bus type, must be CSI2\n");
-		of_node_put(endpoint);
-		return -EINVAL;
-	}
-	of_node_put(endpoint);
-
-	/* get system clock (xclk) */
-	ov5645->xclk = devm_clk_get(dev, "xclk");
-	if (IS_ERR(ov5645->xclk)) {
-		dev_err(dev, "could not get xclk");
-		return PTR_ERR(ov5645->xclk);
-	}
-
-	ov5645->io_regulator = devm_regulator_get(dev, "vdddo");
-	if (IS_ERR(ov5645->io_regulator)) {
-		dev_err(dev, "cannot get io regulator\n");
-		return PTR_ERR(ov5645->io_regulator);
-	}
-
-	ret = regulator_set_voltage(ov5645->io_regulator,
-				    OV5645_VOLTAGE_DIGITAL_IO,
-				    OV5645_VOLTAGE_DIGITAL_IO);
-	if (ret < 0) {
-		dev_err(dev, "cannot set io voltage\n");
-		return ret;
-	}
-
-	ov5645->core_regulator = devm_regulator_get(dev, "vddd");
-	if (IS_ERR(ov5645->core_regulator)) {
-		dev_err(dev, "cannot get core regulator\n");
-		return PTR_ERR(ov5645->core_regulator);
-	}
-
-	ret = regulator_set_voltage(ov5645->core_regulator,
-				    OV5645_VOLTAGE_DIGITAL_CORE,
-				    OV5645_VOLTAGE_DIGITAL_CORE);
-	if (ret < 0) {
-		dev_err(dev, "cannot set core voltage\n");
-		return ret;
-	}
-
-	ov5645->analog_regulator = devm_regulator_get(dev, "vdda");
-	if (IS_ERR(ov5645->analog_regulator)) {
-		dev_err(dev, "cannot get analog regulator\n");
-		return PTR_ERR(ov5645->analog_regulator);
-	}
-
-	ret = regulator_set_voltage(ov5645->analog_regulator,
-				    OV5645_VOLTAGE_ANALOG,
-				    OV5645_VOLTAGE_ANALOG);
-	if (ret < 0) {
-		dev_err(dev, "cannot set analog voltage\n");
+	ret = sensor_probe(s, client, &ov5645_desc);
+	if (ret < 0)
 		return ret;
-	}
 
-	ov5645->enable_gpio = devm_gpiod_get(dev, "enable", GPIOD_OUT_HIGH);
-	if (IS_ERR(ov5645->enable_gpio)) {
-		dev_err(dev, "cannot get enable gpio\n");
-		return PTR_ERR(ov5645->enable_gpio);
-	}
+	INIT_DELAYED_WORK(&ov5645->watchdog, ov5645_watchdog);
+	INIT_DELAYED_WORK(&ov5645->meta_work, ov5645_meta_sample);
+	framemeta_init(&ov5645->meta);
 
-	ov5645->rst_gpio = devm_gpiod_get(dev, "reset", GPIOD_OUT_HIGH);
-	if (IS_ERR(ov5645->rst_gpio)) {
-		dev_err(dev, "cannot get reset gpio\n");
-		return PTR_ERR(ov5645->rst_gpio);
-	}
-
-	mutex_init(&ov5645->power_lock);
-
-	v4l2_ctrl_handler_init(&ov5645->ctrls, 7);
-	ov5645->saturation = v4l2_ctrl_new_std(&ov5645->ctrls, &ov5645_ctrl_ops,
-				V4L2_CID_SATURATION, -4, 4, 1, 0);
-	ov5645->hflip = v4l2_ctrl_new_std(&ov5645->ctrls, &ov5645_ctrl_ops,
-				V4L2_CID_HFLIP, 0, 1, 1, 0);
-	ov5645->vflip = v4l2_ctrl_new_std(&ov5645->ctrls, &ov5645_ctrl_ops,
-				V4L2_CID_VFLIP, 0, 1, 1, 0);
-	ov5645->autogain = v4l2_ctrl_new_std(&ov5645->ctrls, &ov5645_ctrl_ops,
-				V4L2_CID_AUTOGAIN, 0, 1, 1, 1);
-	ov5645->autoexposure = v4l2_ctrl_new_std_menu(&ov5645->ctrls,
-				&ov5645_ctrl_ops, V4L2_CID_EXPOSURE_AUTO,
-				V4L2_EXPOSURE_MANUAL, 0, V4L2_EXPOSURE_AUTO);
-	ov5645->awb = v4l2_ctrl_new_std(&ov5645->ctrls, &ov5645_ctrl_ops,
-				V4L2_CID_AUTO_WHITE_BALANCE, 0, 1, 1, 1);
-	ov5645->pattern = v4l2_ctrl_new_std_menu_items(&ov5645->ctrls,
-				&ov5645_ctrl_ops, V4L2_CID_TEST_PATTERN,
-				ARRAY_SIZE(ov5645_test_pattern_menu) - 1, 0, 0,
-				ov5645_test_pattern_menu);
-
-	ov5645->sd.ctrl_handler = &ov5645->ctrls;
-
-	if (ov5645->ctrls.error) {
-		dev_err(dev, "%s: control initialization error %d\n",
-		       __func__, ov5645->ctrls.error);
-		ret = ov5645->ctrls.error;
-		goto free_ctrl;
-	}
-
-	v4l2_i2c_subdev_init(&ov5645->sd, client, &ov5645_subdev_ops);
-	ov5645->sd.flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
-	ov5645->pad.flags = MEDIA_PAD_FL_SOURCE;
-	ov5645->sd.internal_ops = &ov5645_subdev_internal_ops;
-
-	ret = media_entity_init(&ov5645->sd.entity, 1, &ov5645->pad, 0);
-	if (ret < 0) {
-		dev_err(dev, "could not register media entity\n");
-		goto free_ctrl;
-	}
-
-	ov5645->sd.dev = &client->dev;
-	ret = v4l2_async_register_subdev(&ov5645->sd);
-	if (ret < 0) {
-		dev_err(dev, "could not register v4l2 device\n");
-		goto free_entity;
-	}
-
-	ret = ov5645_s_power(&ov5645->sd, true);
-	if (ret < 0) {
-		dev_err(dev, "could not power up OV5645\n");
-		goto unregister_subdev;
-	}
-
-	ret = ov5645_read_reg(ov5645, OV5645_CHIP_ID_HIGH_REG, &chip_id_high);
-	if (ret < 0 || chip_id_high != OV5645_CHIP_ID_HIGH) {
-		dev_err(dev, "could not read ID high\n");
-		ret = -ENODEV;
-		goto power_down;
-	}else
-		{
-		dev_err(dev, "Sensor ID High:0x%x\n",chip_id_high);
-	}
-	
-	ret = ov5645_read_reg(ov5645, OV5645_CHIP_ID_LOW_REG, &chip_id_low);
-	if (ret < 0 || chip_id_low != OV5645_CHIP_ID_LOW) {
-		dev_err(dev, "could not read ID low\n");
-		ret = -ENODEV;
-		goto power_down;
-	}else
-	{
-		dev_err(dev, "Sensor ID Low:0x%x\n",chip_id_low);
-
-	}
-
-	dev_info(dev, "OV5645 detected at address 0x%02x\n", client->addr);
-
-	ov5645_s_power(&ov5645->sd, false);
+	ret = sensor_identify(s, 1920, 1080);
+	if (ret < 0)
+		goto release;
+
+	if (s->variant->driver_data & OV5645_HAS_AF)
+		ov5645_af_request(ov5645);
+
+	for (i = 0; i < s->variant->num_modes; i++)
+		ov5645->ctrl_delays[i] = OV5645_CTRL_DELAY_DEFAULT;
+
+	v4l2_ctrl_handler_init(&s->ctrls, 14);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_SATURATION, -4, 4, 1, 0);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_AUTOGAIN, 0, 1, 1, 1);
+	v4l2_ctrl_new_std_menu(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL, 0,
+			  V4L2_EXPOSURE_AUTO);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_AUTO_WHITE_BALANCE, 0, 1, 1, 1);
+	v4l2_ctrl_new_std_menu_items(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_TEST_PATTERN,
+			  ARRAY_SIZE(ov5645_test_pattern_menu) - 1, 0, 0,
+			  ov5645_test_pattern_menu);
+	v4l2_ctrl_new_custom(&s->ctrls, &ov5645_recover_ctrl, NULL);
+	v4l2_ctrl_new_custom(&s->ctrls, &ov5645_meta_ctrl, NULL);
+	ov5645->ctrl_delay = v4l2_ctrl_new_custom(&s->ctrls,
+				&ov5645_ctrl_delay_ctrl, NULL);
+	if (ov5645->af_fw) {
+		ov5645->focus_auto = v4l2_ctrl_new_std(&s->ctrls,
+				&sensor_ctrl_ops, V4L2_CID_FOCUS_AUTO,
+				0, 1, 1, 0);
+		v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				  V4L2_CID_AUTO_FOCUS_START, 0, 0, 0, 0);
+		v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				  V4L2_CID_AUTO_FOCUS_STOP, 0, 0, 0, 0);
+		v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				  V4L2_CID_AUTO_FOCUS_STATUS, 0,
+				  V4L2_AUTO_FOCUS_STATUS_BUSY |
+				  V4L2_AUTO_FOCUS_STATUS_REACHED |
+				  V4L2_AUTO_FOCUS_STATUS_FAILED, 0,
+				  V4L2_AUTO_FOCUS_STATUS_IDLE);
+	}
+
+	ret = sensor_register(s);
+	if (ret < 0)
+		goto release;
 
 	return 0;
 
-power_down:
-	ov5645_s_power(&ov5645->sd, false);
-unregister_subdev:
-	v4l2_async_unregister_subdev(&ov5645->sd);
-free_entity:
-	media_entity_cleanup(&ov5645->sd.entity);
-free_ctrl:
-	v4l2_ctrl_handler_free(&ov5645->ctrls);
+release:
+	sensor_release(s);
+	kfree(ov5645->af_fw);
 
 	return ret;
 }
@@ -1609,12 +962,14 @@ free_ctrl:
 
 static int ov5645_remove(struct i2c_client *client)
 {
-	struct v4l2_subdev *sd = i2c_get_clientdata(client);
-	struct ov5645 *ov5645 = to_ov5645(sd);
+	struct sensor *s = to_sensor(i2c_get_clientdata(client));
+	struct ov5645 *ov5645 = to_ov5645(s);
 
-	v4l2_async_unregister_subdev(&ov5645->sd);
-	media_entity_cleanup(&ov5645->sd.entity);
-	v4l2_ctrl_handler_free(&ov5645->ctrls);
+	sensor_unregister(s);
+	cancel_delayed_work_sync(&ov5645->watchdog);
+	cancel_delayed_work_sync(&ov5645->meta_work);
+	sensor_release(s);
+	kfree(ov5645->af_fw);
 
 	return 0;
 }
@@ -1636,6 +991,7 @@ static struct i2c_driver ov5645_i2c_driver = {
 	.driver = {
 		.of_match_table = of_match_ptr(ov5645_of_match),
 		.name  = "ov5645",
+		.pm = &sensor_pm_ops,
 	},
 	.probe  = ov5645_probe,
 	.remove = ov5645_remove,
@@ -1644,6 +1000,9 @@ static struct i2c_driver ov5645_i2c_driver = {
 
 module_i2c_driver(ov5645_i2c_driver);
 
+MODULE_FIRMWARE("ov5640-regs.bin");
+MODULE_FIRMWARE("ov5645-regs.bin");
+MODULE_FIRMWARE(OV5645_AF_FIRMWARE);
 MODULE_DESCRIPTION("Omnivision OV5645 Camera Driver");
 MODULE_AUTHOR("Todor Tomov <todor.tomov@linaro.org>");
 MODULE_LICENSE("GPL v2");
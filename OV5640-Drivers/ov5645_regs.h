@@ -0,0 +1,224 @@
+/*
+ * Generated by Sensor-Core/regc.py from ov5645.regs, do not edit.
+ * Blob format: see regblob.h.
+ */
+
+#ifndef OV5645_REGS_H
+#define OV5645_REGS_H
+
+/* 237 writes, 236 after removing redundant ones, in 84 transfers; 489 bytes */
+static const u8 ov5645_global_init_setting[] = {
+	0x01, 0x31, 0x03, 0x11,	/* 0x3103 */
+	0x01, 0x30, 0x08, 0x82,	/* 0x3008 */
+	0x01, 0x30, 0x08, 0x42,	/* 0x3008 */
+	0x01, 0x31, 0x03, 0x03,	/* 0x3103 */
+	0x01, 0x35, 0x03, 0x07,	/* 0x3503 */
+	0x01, 0x30, 0x02, 0x1c,	/* 0x3002 */
+	0x01, 0x30, 0x06, 0xc3,	/* 0x3006 */
+	0x01, 0x30, 0x0e, 0x45,	/* 0x300e */
+	0x02, 0x30, 0x17, 0x00, 0x00,	/* 0x3017-0x3018 */
+	0x01, 0x30, 0x2e, 0x0b,	/* 0x302e */
+	0x01, 0x30, 0x37, 0x13,	/* 0x3037 */
+	0x01, 0x31, 0x08, 0x01,	/* 0x3108 */
+	0x01, 0x36, 0x11, 0x06,	/* 0x3611 */
+	0x03, 0x35, 0x00, 0x00, 0x01, 0x00,	/* 0x3500-0x3502 */
+	0x02, 0x35, 0x0a, 0x00, 0x3f,	/* 0x350a-0x350b */
+	0x03, 0x36, 0x20, 0x33, 0xe0, 0x01,	/* 0x3620-0x3622 */
+	0x07, 0x36, 0x30, 0x2e, 0x00, 0x32, 0x52, 0x70, 0x13, 0x03,	/* 0x3630-0x3636 */
+	0x03, 0x37, 0x03, 0x5a, 0xa0, 0x1a,	/* 0x3703-0x3705 */
+	0x01, 0x37, 0x09, 0x12,	/* 0x3709 */
+	0x01, 0x37, 0x0b, 0x61,	/* 0x370b */
+	0x01, 0x37, 0x0f, 0x10,	/* 0x370f */
+	0x01, 0x37, 0x15, 0x78,	/* 0x3715 */
+	0x01, 0x37, 0x17, 0x01,	/* 0x3717 */
+	0x01, 0x37, 0x1b, 0x20,	/* 0x371b */
+	0x01, 0x37, 0x31, 0x12,	/* 0x3731 */
+	0x01, 0x39, 0x01, 0x0a,	/* 0x3901 */
+	0x02, 0x39, 0x05, 0x02, 0x10,	/* 0x3905-0x3906 */
+	0x01, 0x37, 0x19, 0x86,	/* 0x3719 */
+	0x03, 0x38, 0x10, 0x00, 0x10, 0x00,	/* 0x3810-0x3812 */
+	0x01, 0x38, 0x21, 0x01,	/* 0x3821 */
+	0x01, 0x38, 0x24, 0x01,	/* 0x3824 */
+	0x01, 0x38, 0x26, 0x03,	/* 0x3826 */
+	0x01, 0x38, 0x28, 0x08,	/* 0x3828 */
+	0x01, 0x3a, 0x19, 0xf8,	/* 0x3a19 */
+	0x02, 0x3c, 0x04, 0x28, 0x98,	/* 0x3c04-0x3c05 */
+	0x01, 0x3c, 0x07, 0x07,	/* 0x3c07 */
+	0x03, 0x3c, 0x09, 0xc2, 0x9c, 0x40,	/* 0x3c09-0x3c0b */
+	0x01, 0x3c, 0x01, 0x34,	/* 0x3c01 */
+	0x01, 0x40, 0x01, 0x02,	/* 0x4001 */
+	0x01, 0x45, 0x14, 0x00,	/* 0x4514 */
+	0x01, 0x45, 0x20, 0xb0,	/* 0x4520 */
+	0x02, 0x46, 0x0b, 0x37, 0x20,	/* 0x460b-0x460c */
+	0x01, 0x48, 0x18, 0x01,	/* 0x4818 */
+	0x01, 0x48, 0x1d, 0xf0,	/* 0x481d */
+	0x01, 0x48, 0x1f, 0x50,	/* 0x481f */
+	0x01, 0x48, 0x23, 0x70,	/* 0x4823 */
+	0x01, 0x48, 0x31, 0x14,	/* 0x4831 */
+	0x02, 0x50, 0x00, 0xa7, 0x83,	/* 0x5000-0x5001 */
+	0x01, 0x50, 0x1d, 0x00,	/* 0x501d */
+	0x01, 0x50, 0x1f, 0x00,	/* 0x501f */
+	0x01, 0x50, 0x3d, 0x00,	/* 0x503d */
+	0x01, 0x50, 0x5c, 0x30,	/* 0x505c */
+	0x01, 0x51, 0x81, 0x59,	/* 0x5181 */
+	0x01, 0x51, 0x83, 0x00,	/* 0x5183 */
+	0x02, 0x51, 0x91, 0xf0, 0x03,	/* 0x5191-0x5192 */
+	0x04, 0x56, 0x84, 0x10, 0xa0, 0x0c, 0x78,	/* 0x5684-0x5687 */
+	0x01, 0x5a, 0x00, 0x08,	/* 0x5a00 */
+	0x01, 0x5a, 0x21, 0x00,	/* 0x5a21 */
+	0x01, 0x5a, 0x24, 0x00,	/* 0x5a24 */
+	0x01, 0x30, 0x08, 0x02,	/* 0x3008 */
+	0x01, 0x35, 0x03, 0x00,	/* 0x3503 */
+	0x10, 0x51, 0x80, 0xff, 0xf2, 0x00, 0x14, 0x25, 0x24, 0x09, 0x09, 0x0a, 0x75, 0x52, 0xea, 0xa8, 0x42, 0x38, 0x56,	/* 0x5180-0x518f */
+	0x0f, 0x51, 0x90, 0x42, 0xf8, 0x04, 0x70, 0xf0, 0xf0, 0x03, 0x01, 0x04, 0x12, 0x04, 0x00, 0x06, 0x82, 0x38,	/* 0x5190-0x519e */
+	0x0b, 0x53, 0x81, 0x1e, 0x5b, 0x08, 0x0a, 0x7e, 0x88, 0x7c, 0x6c, 0x10, 0x01, 0x98,	/* 0x5381-0x538b */
+	0x08, 0x53, 0x00, 0x08, 0x30, 0x10, 0x00, 0x08, 0x30, 0x08, 0x16,	/* 0x5300-0x5307 */
+	0x04, 0x53, 0x09, 0x08, 0x30, 0x04, 0x06,	/* 0x5309-0x530c */
+	0x10, 0x54, 0x80, 0x01, 0x08, 0x14, 0x28, 0x51, 0x65, 0x71, 0x7d, 0x87, 0x91, 0x9a, 0xaa, 0xb8, 0xcd, 0xdd, 0xea,	/* 0x5480-0x548f */
+	0x01, 0x54, 0x90, 0x1d,	/* 0x5490 */
+	0x01, 0x55, 0x80, 0x02,	/* 0x5580 */
+	0x02, 0x55, 0x83, 0x40, 0x10,	/* 0x5583-0x5584 */
+	0x03, 0x55, 0x89, 0x10, 0x00, 0xf8,	/* 0x5589-0x558b */
+	0x10, 0x58, 0x00, 0x3f, 0x16, 0x0e, 0x0d, 0x17, 0x3f, 0x0b, 0x06, 0x04, 0x04, 0x06, 0x0b, 0x09, 0x03, 0x00, 0x00,	/* 0x5800-0x580f */
+	0x10, 0x58, 0x10, 0x03, 0x08, 0x0a, 0x03, 0x00, 0x00, 0x04, 0x09, 0x0f, 0x08, 0x06, 0x06, 0x08, 0x0c, 0x3f, 0x1e,	/* 0x5810-0x581f */
+	0x10, 0x58, 0x20, 0x12, 0x13, 0x21, 0x3f, 0x68, 0x28, 0x2c, 0x28, 0x08, 0x48, 0x64, 0x62, 0x64, 0x28, 0x46, 0x62,	/* 0x5820-0x582f */
+	0x0e, 0x58, 0x30, 0x60, 0x62, 0x26, 0x48, 0x66, 0x44, 0x64, 0x28, 0x66, 0x48, 0x2c, 0x28, 0x26, 0xae,	/* 0x5830-0x583d */
+	0x01, 0x50, 0x25, 0x00,	/* 0x5025 */
+	0x02, 0x3a, 0x0f, 0x30, 0x28,	/* 0x3a0f-0x3a10 */
+	0x01, 0x3a, 0x1b, 0x30,	/* 0x3a1b */
+	0x01, 0x3a, 0x1e, 0x26,	/* 0x3a1e */
+	0x01, 0x3a, 0x11, 0x60,	/* 0x3a11 */
+	0x01, 0x3a, 0x1f, 0x14,	/* 0x3a1f */
+	0x01, 0x06, 0x01, 0x02,	/* 0x0601 */
+	0x01, 0x30, 0x08, 0x42,	/* 0x3008 */
+	0x01, 0x30, 0x08, 0x02,	/* 0x3008 */
+	0x00,	/* end */
+};
+
+/* 46 writes, 46 after removing redundant ones, in 20 transfers; 107 bytes */
+static const u8 ov5645_setting_vga[] = {
+	0x01, 0x36, 0x12, 0xa9,	/* 0x3612 */
+	0x01, 0x36, 0x14, 0x50,	/* 0x3614 */
+	0x01, 0x36, 0x18, 0x00,	/* 0x3618 */
+	0x03, 0x30, 0x34, 0x18, 0x11, 0x57,	/* 0x3034-0x3036 */
+	0x02, 0x36, 0x00, 0x09, 0x43,	/* 0x3600-0x3601 */
+	0x01, 0x37, 0x08, 0x66,	/* 0x3708 */
+	0x01, 0x37, 0x0c, 0xc3,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x02, 0x80, 0x01, 0xea, 0x07, 0xbf, 0x05, 0xb9, 0x02, 0x80, 0x01, 0xe0, 0x07, 0x68, 0x01, 0xfc,	/* 0x3800-0x380f */
+	0x03, 0x38, 0x13, 0x04, 0x31, 0x31,	/* 0x3813-0x3815 */
+	0x01, 0x38, 0x20, 0x47,	/* 0x3820 */
+	0x02, 0x3a, 0x02, 0x01, 0xfc,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0xcb, 0x01, 0x7e,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x01,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x01,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x01, 0xfc,	/* 0x3a14-0x3a15 */
+	0x01, 0x3a, 0x18, 0x00,	/* 0x3a18 */
+	0x02, 0x40, 0x04, 0x02, 0x18,	/* 0x4004-0x4005 */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x48, 0x37, 0x0b,	/* 0x4837 */
+	0x01, 0x42, 0x02, 0x00,	/* 0x4202 */
+	0x00,	/* end */
+};
+
+/* 46 writes, 46 after removing redundant ones, in 20 transfers; 107 bytes */
+static const u8 ov5645_setting_720p[] = {
+	0x01, 0x36, 0x12, 0xa9,	/* 0x3612 */
+	0x01, 0x36, 0x14, 0x50,	/* 0x3614 */
+	0x01, 0x36, 0x18, 0x00,	/* 0x3618 */
+	0x03, 0x30, 0x34, 0x18, 0x11, 0x54,	/* 0x3034-0x3036 */
+	0x02, 0x36, 0x00, 0x09, 0x43,	/* 0x3600-0x3601 */
+	0x01, 0x37, 0x08, 0x66,	/* 0x3708 */
+	0x01, 0x37, 0x0c, 0xc3,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0xfa, 0x0a, 0x3f, 0x06, 0xa9, 0x05, 0x00, 0x02, 0xd0, 0x07, 0x64, 0x02, 0xe4,	/* 0x3800-0x380f */
+	0x03, 0x38, 0x13, 0x04, 0x31, 0x31,	/* 0x3813-0x3815 */
+	0x01, 0x38, 0x20, 0x47,	/* 0x3820 */
+	0x02, 0x3a, 0x02, 0x02, 0xe4,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0xbc, 0x01, 0x72,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x01,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x02,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x02, 0xe4,	/* 0x3a14-0x3a15 */
+	0x01, 0x3a, 0x18, 0x00,	/* 0x3a18 */
+	0x02, 0x40, 0x04, 0x02, 0x18,	/* 0x4004-0x4005 */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x48, 0x37, 0x0b,	/* 0x4837 */
+	0x01, 0x42, 0x02, 0x00,	/* 0x4202 */
+	0x00,	/* end */
+};
+
+/* 45 writes, 45 after removing redundant ones, in 19 transfers; 103 bytes */
+static const u8 ov5645_setting_sxga[] = {
+	0x01, 0x36, 0x12, 0xa9,	/* 0x3612 */
+	0x01, 0x36, 0x14, 0x50,	/* 0x3614 */
+	0x01, 0x36, 0x18, 0x00,	/* 0x3618 */
+	0x03, 0x30, 0x34, 0x18, 0x21, 0x70,	/* 0x3034-0x3036 */
+	0x02, 0x36, 0x00, 0x09, 0x43,	/* 0x3600-0x3601 */
+	0x01, 0x37, 0x08, 0x66,	/* 0x3708 */
+	0x01, 0x37, 0x0c, 0xc3,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0x06, 0x0a, 0x3f, 0x07, 0x9d, 0x05, 0x00, 0x03, 0xc0, 0x07, 0x68, 0x03, 0xd8,	/* 0x3800-0x380f */
+	0x03, 0x38, 0x13, 0x06, 0x31, 0x31,	/* 0x3813-0x3815 */
+	0x01, 0x38, 0x20, 0x47,	/* 0x3820 */
+	0x02, 0x3a, 0x02, 0x03, 0xd8,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0xf8, 0x01, 0xa4,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x02,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x02,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x03, 0xd8,	/* 0x3a14-0x3a15 */
+	0x01, 0x3a, 0x18, 0x00,	/* 0x3a18 */
+	0x02, 0x40, 0x04, 0x02, 0x18,	/* 0x4004-0x4005 */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x42, 0x02, 0x00,	/* 0x4202 */
+	0x00,	/* end */
+};
+
+/* 47 writes, 47 after removing redundant ones, in 21 transfers; 111 bytes */
+static const u8 ov5645_setting_1080p[] = {
+	0x01, 0x36, 0x12, 0xab,	/* 0x3612 */
+	0x01, 0x36, 0x14, 0x50,	/* 0x3614 */
+	0x01, 0x36, 0x18, 0x04,	/* 0x3618 */
+	0x03, 0x30, 0x34, 0x18, 0x11, 0x54,	/* 0x3034-0x3036 */
+	0x02, 0x36, 0x00, 0x08, 0x33,	/* 0x3600-0x3601 */
+	0x01, 0x37, 0x08, 0x63,	/* 0x3708 */
+	0x01, 0x37, 0x0c, 0xc0,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x01, 0x50, 0x01, 0xb2, 0x08, 0xef, 0x05, 0xf1, 0x07, 0x80, 0x04, 0x38, 0x09, 0xc4, 0x04, 0x60,	/* 0x3800-0x380f */
+	0x03, 0x38, 0x13, 0x04, 0x11, 0x11,	/* 0x3813-0x3815 */
+	0x01, 0x38, 0x20, 0x47,	/* 0x3820 */
+	0x01, 0x45, 0x14, 0x88,	/* 0x4514 */
+	0x02, 0x3a, 0x02, 0x04, 0x60,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0x50, 0x01, 0x18,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x03,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x04,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x04, 0x60,	/* 0x3a14-0x3a15 */
+	0x01, 0x3a, 0x18, 0x00,	/* 0x3a18 */
+	0x02, 0x40, 0x04, 0x06, 0x18,	/* 0x4004-0x4005 */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x42, 0x02, 0x00,	/* 0x4202 */
+	0x01, 0x48, 0x37, 0x0b,	/* 0x4837 */
+	0x00,	/* end */
+};
+
+/* 47 writes, 47 after removing redundant ones, in 21 transfers; 111 bytes */
+static const u8 ov5645_setting_full[] = {
+	0x01, 0x36, 0x12, 0xab,	/* 0x3612 */
+	0x01, 0x36, 0x14, 0x50,	/* 0x3614 */
+	0x01, 0x36, 0x18, 0x04,	/* 0x3618 */
+	0x03, 0x30, 0x34, 0x18, 0x11, 0x54,	/* 0x3034-0x3036 */
+	0x02, 0x36, 0x00, 0x08, 0x33,	/* 0x3600-0x3601 */
+	0x01, 0x37, 0x08, 0x63,	/* 0x3708 */
+	0x01, 0x37, 0x0c, 0xc0,	/* 0x370c */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x3f, 0x07, 0x9f, 0x0a, 0x20, 0x07, 0x98, 0x0b, 0x1c, 0x07, 0xb0,	/* 0x3800-0x380f */
+	0x03, 0x38, 0x13, 0x06, 0x11, 0x11,	/* 0x3813-0x3815 */
+	0x01, 0x38, 0x20, 0x47,	/* 0x3820 */
+	0x01, 0x45, 0x14, 0x88,	/* 0x4514 */
+	0x02, 0x3a, 0x02, 0x07, 0xb0,	/* 0x3a02-0x3a03 */
+	0x04, 0x3a, 0x08, 0x01, 0x27, 0x00, 0xf6,	/* 0x3a08-0x3a0b */
+	0x01, 0x3a, 0x0e, 0x06,	/* 0x3a0e */
+	0x01, 0x3a, 0x0d, 0x08,	/* 0x3a0d */
+	0x02, 0x3a, 0x14, 0x07, 0xb0,	/* 0x3a14-0x3a15 */
+	0x01, 0x3a, 0x18, 0x01,	/* 0x3a18 */
+	0x02, 0x40, 0x04, 0x06, 0x18,	/* 0x4004-0x4005 */
+	0x01, 0x43, 0x00, 0x32,	/* 0x4300 */
+	0x01, 0x48, 0x37, 0x0b,	/* 0x4837 */
+	0x01, 0x42, 0x02, 0x00,	/* 0x4202 */
+	0x00,	/* end */
+};
+
+#endif /* OV5645_REGS_H */
@@ -0,0 +1,297 @@
+/*
+ * Driver for the OV7251 global shutter camera sensor.
+ *
+ * 640x480 at 100 fps in RAW10 on one CSI-2 lane at 480 Mbit/s, the one
+ * mode the old kernel patch (Pre-built/Debian_16.09/OV7251) ran. The
+ * sensor is monochrome; it keeps reporting SRGGB10 as the patch did,
+ * which is what the CAMSS pipelines and Camera-Tools set up.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/bitops.h>
+#include <linux/i2c.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-subdev.h>
+
+#include "sensor_core.h"
+
+#define OV7251_VOLTAGE_ANALOG		2800000
+#define OV7251_VOLTAGE_DIGITAL_CORE	1500000
+#define OV7251_VOLTAGE_DIGITAL_IO	1800000
+
+#define OV7251_XCLK		24000000	/* what the tables expect */
+#define OV7251_LANE_RATE	480000000ULL	/* bit/s */
+#define OV7251_LANES		1
+
+#define OV7251_SYSTEM_CTRL0		0x0100
+#define		OV7251_SYSTEM_CTRL0_START	0x01
+#define		OV7251_SYSTEM_CTRL0_STOP	0x00
+#define OV7251_CHIP_ID_HIGH_REG		0x300a
+#define		OV7251_CHIP_ID			0x7750
+#define OV7251_GROUP_HOLD		0x3208
+#define		OV7251_GROUP_HOLD_START		0x00
+#define		OV7251_GROUP_HOLD_END		0x10
+#define		OV7251_GROUP_HOLD_LAUNCH	0xa0
+#define OV7251_AEC_EXPOSURE		0x3500	/* 0x3500-0x3502, 1/16 lines */
+#define OV7251_AEC_GAIN			0x350a	/* 0x350a-0x350b, 0x10 = 1x */
+#define		OV7251_GAIN_MIN			0x10
+#define		OV7251_GAIN_MAX			0x3ff
+#define OV7251_TIMING_FORMAT1		0x3820
+#define		OV7251_VFLIP			BIT(2)
+#define OV7251_TIMING_FORMAT2		0x3821
+#define		OV7251_MIRROR			BIT(2)
+#define OV7251_PRE_ISP_00		0x5e00
+#define		OV7251_TEST_PATTERN_ENABLE	BIT(7)
+#define OV7251_MAX_REGISTER		0x5fff
+
+/* Exposure has to end this many lines before the frame does. */
+#define OV7251_EXPOSURE_MARGIN		20
+#define OV7251_EXPOSURE_DEFAULT		0x1f4	/* the init table's */
+
+/* Optional tuned register tables, see Sensor-Core/regfw.h. */
+#define OV7251_FIRMWARE			"ov7251-regs.bin"
+
+struct ov7251 {
+	struct sensor s;
+
+	struct v4l2_ctrl *exposure;	/* cluster with gain */
+	struct v4l2_ctrl *gain;
+	struct v4l2_ctrl *pixel_rate;
+};
+
+#include "ov7251_regs.h"
+
+/*
+ * HTS in pixel clocks and VTS as the table sets them. The patch's init
+ * table was the OV5640's and never replayed; the VGA table's common part
+ * is the init table here.
+ */
+static const struct sensor_mode ov7251_modes[] = {
+	SENSOR_MODE_TIMED(640, 480, 100, 928, 522, ov7251_setting_vga),
+};
+
+static const struct sensor_variant ov7251_variant = {
+	.name = "OV7251",
+	.chip_id = OV7251_CHIP_ID,
+	.init = ov7251_global_init_setting,
+	.init_size = sizeof(ov7251_global_init_setting),
+	.modes = ov7251_modes,
+	.num_modes = ARRAY_SIZE(ov7251_modes),
+	.firmware = OV7251_FIRMWARE,
+};
+
+static u32 ov7251_exposure_to_reg(struct sensor *s, s32 lines)
+{
+	return lines << 4;
+}
+
+static const char * const ov7251_test_pattern_menu[] = {
+	"Disabled",
+	"Vertical Color Bars",
+};
+
+/* The CSI-2 pixel rate, for the CSI receiver. */
+static int ov7251_g_volatile_ctrl(struct sensor *s, struct v4l2_ctrl *ctrl)
+{
+	if (ctrl->id != V4L2_CID_PIXEL_RATE)
+		return -EINVAL;
+
+	*ctrl->p_new.p_s64 = div_u64(OV7251_LANE_RATE * OV7251_LANES,
+				     sensor_bpp(s));
+
+	return 0;
+}
+
+/*
+ * Exposure and gain are one control cluster, so a change of both is
+ * latched together through group hold 0. The other fields share their
+ * registers with the tables, so they are read-modify-write fields served
+ * from the cache.
+ */
+static const struct sensor_ctrl_map ov7251_ctrl_map[] = {
+	{
+		.id = V4L2_CID_EXPOSURE,
+		.reg = OV7251_AEC_EXPOSURE,
+		.len = 3,
+		.flags = SENSOR_CTRL_HOLD,
+		.to_reg = ov7251_exposure_to_reg,
+	},
+	{
+		.id = V4L2_CID_GAIN,
+		.reg = OV7251_AEC_GAIN,
+		.len = 2,
+		.flags = SENSOR_CTRL_HOLD,
+	},
+	{
+		.id = V4L2_CID_HFLIP,
+		.reg = OV7251_TIMING_FORMAT2,
+		.len = 1,
+		.mask = OV7251_MIRROR,
+	},
+	{
+		.id = V4L2_CID_VFLIP,
+		.reg = OV7251_TIMING_FORMAT1,
+		.len = 1,
+		.mask = OV7251_VFLIP,
+	},
+	{
+		.id = V4L2_CID_TEST_PATTERN,
+		.reg = OV7251_PRE_ISP_00,
+		.len = 1,
+		.mask = OV7251_TEST_PATTERN_ENABLE,
+	},
+};
+
+static const struct sensor_supply ov7251_supplies[] = {
+	{ "vdddo", OV7251_VOLTAGE_DIGITAL_IO },
+	{ "vddd", OV7251_VOLTAGE_DIGITAL_CORE },
+	{ "vdda", OV7251_VOLTAGE_ANALOG },
+};
+
+static const struct sensor_ops ov7251_ops = {
+	.g_volatile_ctrl = ov7251_g_volatile_ctrl,
+};
+
+static const struct sensor_desc ov7251_desc = {
+	.ops = &ov7251_ops,
+	.variants = &ov7251_variant,
+	.num_variants = 1,
+	.chip_id_reg = OV7251_CHIP_ID_HIGH_REG,
+	.max_register = OV7251_MAX_REGISTER,
+	.code = MEDIA_BUS_FMT_SRGGB10_1X10,
+	.bpp = 10,
+	.xclk_freq = OV7251_XCLK,
+	.supplies = ov7251_supplies,
+	.num_supplies = ARRAY_SIZE(ov7251_supplies),
+	.power = {
+		.supply_us = 5000,
+		.gpio_us = 1000,
+		.boot_ms = 20,
+	},
+	.stream_reg = OV7251_SYSTEM_CTRL0,
+	.stream_on = OV7251_SYSTEM_CTRL0_START,
+	.stream_off = OV7251_SYSTEM_CTRL0_STOP,
+	.hold_reg = OV7251_GROUP_HOLD,
+	.hold_on = OV7251_GROUP_HOLD_START,
+	.hold_off = OV7251_GROUP_HOLD_END,
+	.hold_launch = OV7251_GROUP_HOLD_LAUNCH,
+	.ctrl_map = ov7251_ctrl_map,
+	.num_ctrl_map = ARRAY_SIZE(ov7251_ctrl_map),
+};
+
+static int ov7251_probe(struct i2c_client *client,
+			const struct i2c_device_id *id)
+{
+	struct device *dev = &client->dev;
+	struct ov7251 *ov7251;
+	struct sensor *s;
+	int ret;
+
+	ov7251 = devm_kzalloc(dev, sizeof(struct ov7251), GFP_KERNEL);
+	if (!ov7251)
+		return -ENOMEM;
+	s = &ov7251->s;
+
+	ret = sensor_probe(s, client, &ov7251_desc);
+	if (ret < 0)
+		return ret;
+
+	if (s->ep.bus.mipi_csi2.num_data_lanes != OV7251_LANES) {
+		dev_err(dev, "the tables need %u data lane\n", OV7251_LANES);
+		ret = -EINVAL;
+		goto release;
+	}
+
+	ret = sensor_identify(s, 640, 480);
+	if (ret < 0)
+		goto release;
+
+	v4l2_ctrl_handler_init(&s->ctrls, 6);
+	/* In lines and 1/16 steps; driven by userspace AE (camd_3a). */
+	ov7251->exposure = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_EXPOSURE, 1,
+				ov7251_modes[0].vts - OV7251_EXPOSURE_MARGIN, 1,
+				OV7251_EXPOSURE_DEFAULT);
+	ov7251->gain = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_GAIN, OV7251_GAIN_MIN,
+				OV7251_GAIN_MAX, 1, OV7251_GAIN_MIN);
+	v4l2_ctrl_cluster(2, &ov7251->exposure);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std_menu_items(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_TEST_PATTERN,
+			  ARRAY_SIZE(ov7251_test_pattern_menu) - 1, 0, 0,
+			  ov7251_test_pattern_menu);
+	ov7251->pixel_rate = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_PIXEL_RATE, 1, INT_MAX, 1, 1);
+	if (ov7251->pixel_rate)
+		ov7251->pixel_rate->flags |= V4L2_CTRL_FLAG_VOLATILE |
+					     V4L2_CTRL_FLAG_READ_ONLY;
+
+	ret = sensor_register(s);
+	if (ret < 0)
+		goto release;
+
+	return 0;
+
+release:
+	sensor_release(s);
+
+	return ret;
+}
+
+
+static int ov7251_remove(struct i2c_client *client)
+{
+	struct sensor *s = to_sensor(i2c_get_clientdata(client));
+
+	sensor_unregister(s);
+	sensor_release(s);
+
+	return 0;
+}
+
+
+static const struct i2c_device_id ov7251_id[] = {
+	{ "ov7251", 0 },
+	{}
+};
+MODULE_DEVICE_TABLE(i2c, ov7251_id);
+
+static const struct of_device_id ov7251_of_match[] = {
+	{ .compatible = "ovti,ov7251" },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, ov7251_of_match);
+
+static struct i2c_driver ov7251_i2c_driver = {
+	.driver = {
+		.of_match_table = of_match_ptr(ov7251_of_match),
+		.name  = "ov7251",
+		.pm = &sensor_pm_ops,
+	},
+	.probe  = ov7251_probe,
+	.remove = ov7251_remove,
+	.id_table = ov7251_id,
+};
+
+module_i2c_driver(ov7251_i2c_driver);
+
+MODULE_FIRMWARE(OV7251_FIRMWARE);
+MODULE_DESCRIPTION("Omnivision OV7251 Camera Driver");
+MODULE_LICENSE("GPL v2");
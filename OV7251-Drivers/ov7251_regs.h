@@ -0,0 +1,79 @@
+/*
+ * Generated by Sensor-Core/regc.py from ov7251.regs, do not edit.
+ * Blob format: see regblob.h.
+ */
+
+#ifndef OV7251_REGS_H
+#define OV7251_REGS_H
+
+/* 116 writes, 116 after removing redundant ones, in 57 transfers; 291 bytes */
+static const u8 ov7251_global_init_setting[] = {
+	0x01, 0x01, 0x03, 0x01,	/* 0x0103 */
+	0x80, 0x00, 0x0a,	/* delay 10 ms */
+	0x01, 0x30, 0x05, 0x00,	/* 0x3005 */
+	0x03, 0x30, 0x12, 0xc0, 0xd2, 0x04,	/* 0x3012-0x3014 */
+	0x03, 0x30, 0x16, 0x10, 0x00, 0x00,	/* 0x3016-0x3018 */
+	0x03, 0x30, 0x1a, 0x00, 0x00, 0x00,	/* 0x301a-0x301c */
+	0x01, 0x30, 0x23, 0x05,	/* 0x3023 */
+	0x01, 0x30, 0x37, 0xf0,	/* 0x3037 */
+	0x04, 0x30, 0x98, 0x04, 0x28, 0x05, 0x04,	/* 0x3098-0x309b */
+	0x02, 0x30, 0xb0, 0x0a, 0x01,	/* 0x30b0-0x30b1 */
+	0x03, 0x30, 0xb3, 0x64, 0x03, 0x05,	/* 0x30b3-0x30b5 */
+	0x01, 0x31, 0x06, 0xda,	/* 0x3106 */
+	0x04, 0x35, 0x00, 0x00, 0x1f, 0x40, 0x07,	/* 0x3500-0x3503 */
+	0x01, 0x35, 0x09, 0x10,	/* 0x3509 */
+	0x01, 0x35, 0x0b, 0x10,	/* 0x350b */
+	0x01, 0x36, 0x00, 0x1c,	/* 0x3600 */
+	0x01, 0x36, 0x02, 0x62,	/* 0x3602 */
+	0x01, 0x36, 0x20, 0xb7,	/* 0x3620 */
+	0x01, 0x36, 0x22, 0x04,	/* 0x3622 */
+	0x02, 0x36, 0x26, 0x21, 0x30,	/* 0x3626-0x3627 */
+	0x02, 0x36, 0x30, 0x44, 0x35,	/* 0x3630-0x3631 */
+	0x01, 0x36, 0x34, 0x60,	/* 0x3634 */
+	0x01, 0x36, 0x36, 0x00,	/* 0x3636 */
+	0x03, 0x36, 0x62, 0x01, 0x70, 0xf0,	/* 0x3662-0x3664 */
+	0x01, 0x36, 0x66, 0x0a,	/* 0x3666 */
+	0x03, 0x36, 0x69, 0x1a, 0x00, 0x50,	/* 0x3669-0x366b */
+	0x03, 0x36, 0x73, 0x01, 0xff, 0x03,	/* 0x3673-0x3675 */
+	0x01, 0x37, 0x05, 0xc1,	/* 0x3705 */
+	0x01, 0x37, 0x09, 0x40,	/* 0x3709 */
+	0x01, 0x37, 0x3c, 0x08,	/* 0x373c */
+	0x01, 0x37, 0x42, 0x00,	/* 0x3742 */
+	0x01, 0x37, 0x57, 0xb3,	/* 0x3757 */
+	0x01, 0x37, 0x88, 0x00,	/* 0x3788 */
+	0x02, 0x37, 0xa8, 0x01, 0xc0,	/* 0x37a8-0x37a9 */
+	0x02, 0x38, 0x20, 0x40, 0x00,	/* 0x3820-0x3821 */
+	0x01, 0x38, 0x2f, 0x0e,	/* 0x382f */
+	0x04, 0x38, 0x32, 0x00, 0x05, 0x00, 0x0c,	/* 0x3832-0x3835 */
+	0x01, 0x38, 0x37, 0x00,	/* 0x3837 */
+	0x10, 0x3b, 0x80, 0x00, 0xa5, 0x10, 0x00, 0x08, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x1a,	/* 0x3b80-0x3b8f */
+	0x03, 0x3b, 0x94, 0x05, 0xf2, 0x40,	/* 0x3b94-0x3b96 */
+	0x08, 0x3c, 0x00, 0x89, 0x63, 0x01, 0x00, 0x00, 0x03, 0x00, 0x06,	/* 0x3c00-0x3c07 */
+	0x04, 0x3c, 0x0c, 0x01, 0xd0, 0x02, 0x0a,	/* 0x3c0c-0x3c0f */
+	0x01, 0x40, 0x01, 0x42,	/* 0x4001 */
+	0x02, 0x40, 0x04, 0x04, 0x00,	/* 0x4004-0x4005 */
+	0x01, 0x40, 0x4e, 0x01,	/* 0x404e */
+	0x02, 0x43, 0x00, 0xff, 0x00,	/* 0x4300-0x4301 */
+	0x01, 0x45, 0x01, 0x48,	/* 0x4501 */
+	0x02, 0x46, 0x00, 0x00, 0x4e,	/* 0x4600-0x4601 */
+	0x01, 0x48, 0x01, 0x0f,	/* 0x4801 */
+	0x01, 0x48, 0x06, 0x0f,	/* 0x4806 */
+	0x01, 0x48, 0x19, 0xaa,	/* 0x4819 */
+	0x01, 0x48, 0x23, 0x3e,	/* 0x4823 */
+	0x01, 0x48, 0x37, 0x19,	/* 0x4837 */
+	0x01, 0x4a, 0x0d, 0x00,	/* 0x4a0d */
+	0x01, 0x4a, 0x47, 0x7f,	/* 0x4a47 */
+	0x01, 0x4a, 0x49, 0xf0,	/* 0x4a49 */
+	0x01, 0x4a, 0x4b, 0x30,	/* 0x4a4b */
+	0x02, 0x50, 0x00, 0x85, 0x80,	/* 0x5000-0x5001 */
+	0x00,	/* end */
+};
+
+/* 22 writes, 22 after removing redundant ones, in 2 transfers; 29 bytes */
+static const u8 ov7251_setting_vga[] = {
+	0x10, 0x38, 0x00, 0x00, 0x04, 0x00, 0x04, 0x02, 0x8b, 0x01, 0xeb, 0x02, 0x80, 0x01, 0xe0, 0x03, 0xa0, 0x02, 0x0a,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x04, 0x00, 0x05, 0x11, 0x11,	/* 0x3810-0x3815 */
+	0x00,	/* end */
+};
+
+#endif /* OV7251_REGS_H */
@@ -0,0 +1,381 @@
+/*
+ * Driver for the OV9281 global shutter camera sensor.
+ *
+ * 1280x800 at 120 fps and 640x400 (2x2 binned) at 211 fps, RAW10 or RAW8,
+ * on two CSI-2 lanes at 800 Mbit/s. Both formats run the same frame
+ * timing; RAW8 only leaves the link idle for longer.
+ *
+ * For rigs that need the exposure tied to something else, the sensor can
+ * wait for a rising edge on FSIN and send one frame per edge (trigger
+ * mode), and drive its STROBE pin for the length of every exposure.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/bitops.h>
+#include <linux/i2c.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-subdev.h>
+
+#include "sensor_core.h"
+
+#define OV9281_VOLTAGE_ANALOG		2800000
+#define OV9281_VOLTAGE_DIGITAL_CORE	1200000
+#define OV9281_VOLTAGE_DIGITAL_IO	1800000
+
+#define OV9281_XCLK		24000000	/* what the tables expect */
+#define OV9281_LANE_RATE	800000000ULL	/* bit/s, both modes */
+#define OV9281_LANES		2
+
+#define OV9281_SYSTEM_CTRL0		0x0100
+#define		OV9281_SYSTEM_CTRL0_START	0x01
+#define		OV9281_SYSTEM_CTRL0_STOP	0x00
+#define OV9281_CHIP_ID_HIGH_REG		0x300a
+#define		OV9281_CHIP_ID			0x9281
+#define OV9281_SC_CTRL06		0x3006
+#define		OV9281_STROBE_OUT_ENABLE	BIT(3)
+#define OV9281_GROUP_HOLD		0x3208
+#define		OV9281_GROUP_HOLD_START		0x00
+#define		OV9281_GROUP_HOLD_END		0x10
+#define		OV9281_GROUP_HOLD_LAUNCH	0xa0
+#define OV9281_AEC_EXPOSURE		0x3500	/* 0x3500-0x3502, 1/16 lines */
+#define OV9281_AEC_GAIN			0x3509	/* 0x10 = 1x */
+#define		OV9281_GAIN_MIN			0x10
+#define		OV9281_GAIN_MAX			0xf8
+#define OV9281_TIMING_FORMAT1		0x3820
+#define		OV9281_VFLIP			BIT(2)
+#define OV9281_TIMING_FORMAT2		0x3821
+#define		OV9281_MIRROR			BIT(2)
+#define OV9281_TIMING_REG23		0x3823
+#define		OV9281_EXT_VSYNC		(BIT(5) | BIT(4))
+#define OV9281_LP_CTRL			0x4f00
+#define		OV9281_LP_TRIGGER		BIT(0)
+#define OV9281_PRE_CTRL00		0x5e00
+#define		OV9281_TEST_PATTERN_ENABLE	BIT(7)
+#define OV9281_MAX_REGISTER		0x5fff
+
+/* Exposure has to end this many lines before the frame does. */
+#define OV9281_EXPOSURE_MARGIN		4
+#define OV9281_EXPOSURE_DEFAULT		0x2a9	/* the init table's */
+
+/*
+ * Trigger mode: streaming only arms the sensor, and each rising edge on
+ * FSIN starts the exposure of one frame (0x303f frames, 1 in the init
+ * table). The strobe pulse covers the exposure of every frame.
+ */
+#define V4L2_CID_OV9281_TRIGGER		(V4L2_CID_USER_BASE | 0x1f10)
+#define V4L2_CID_OV9281_STROBE		(V4L2_CID_USER_BASE | 0x1f11)
+
+/* Optional tuned register tables, see Sensor-Core/regfw.h. */
+#define OV9281_FIRMWARE			"ov9281-regs.bin"
+
+struct ov9281 {
+	struct sensor s;
+
+	struct v4l2_ctrl *exposure;	/* cluster with gain */
+	struct v4l2_ctrl *gain;
+	struct v4l2_ctrl *pixel_rate;
+};
+
+static inline struct ov9281 *to_ov9281(struct sensor *s)
+{
+	return container_of(s, struct ov9281, s);
+}
+
+#include "ov9281_regs.h"
+
+/*
+ * HTS in pixel clocks (0x380c-0x380d counts two) and VTS as the tables
+ * set them.
+ */
+static const struct sensor_mode ov9281_modes[] = {
+	SENSOR_MODE_TIMED(640, 400, 211, 1456, 520, ov9281_setting_640x400),
+	SENSOR_MODE_TIMED(1280, 800, 120, 1456, 910, ov9281_setting_1280x800),
+};
+
+static const struct sensor_format ov9281_formats[] = {
+	SENSOR_FORMAT(MEDIA_BUS_FMT_Y10_1X10, 10, ov9281_format_raw10),
+	SENSOR_FORMAT(MEDIA_BUS_FMT_Y8_1X8, 8, ov9281_format_raw8),
+};
+
+static const struct sensor_variant ov9281_variant = {
+	.name = "OV9281",
+	.chip_id = OV9281_CHIP_ID,
+	.init = ov9281_global_init_setting,
+	.init_size = sizeof(ov9281_global_init_setting),
+	.modes = ov9281_modes,
+	.num_modes = ARRAY_SIZE(ov9281_modes),
+	.firmware = OV9281_FIRMWARE,
+};
+
+static u32 ov9281_exposure_to_reg(struct sensor *s, s32 lines)
+{
+	return lines << 4;
+}
+
+static const char * const ov9281_test_pattern_menu[] = {
+	"Disabled",
+	"Vertical Color Bars",
+};
+
+/* The CSI-2 pixel rate of the current format, for the CSI receiver. */
+static int ov9281_g_volatile_ctrl(struct sensor *s, struct v4l2_ctrl *ctrl)
+{
+	if (ctrl->id != V4L2_CID_PIXEL_RATE)
+		return -EINVAL;
+
+	*ctrl->p_new.p_s64 = div_u64(OV9281_LANE_RATE * OV9281_LANES,
+				     sensor_bpp(s));
+
+	return 0;
+}
+
+/* Longer exposures than the frame would stretch it: keep them out. */
+static void ov9281_mode_changed(struct sensor *s)
+{
+	struct ov9281 *ov9281 = to_ov9281(s);
+	u32 max = s->variant->modes[s->current_mode].vts -
+		  OV9281_EXPOSURE_MARGIN;
+
+	/* Not yet created while probe picks the default mode. */
+	if (ov9281->exposure)
+		__v4l2_ctrl_modify_range(ov9281->exposure, 1, max, 1,
+				min_t(u32, OV9281_EXPOSURE_DEFAULT, max));
+}
+
+static const struct v4l2_ctrl_config ov9281_trigger_ctrl = {
+	.ops = &sensor_ctrl_ops,
+	.id = V4L2_CID_OV9281_TRIGGER,
+	.name = "External Trigger",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
+static const struct v4l2_ctrl_config ov9281_strobe_ctrl = {
+	.ops = &sensor_ctrl_ops,
+	.id = V4L2_CID_OV9281_STROBE,
+	.name = "Strobe Output",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
+/*
+ * Exposure and gain are one control cluster, so a change of both is
+ * latched together through group hold 0. The other fields share their
+ * registers with the tables, so they are read-modify-write fields served
+ * from the cache.
+ */
+static const struct sensor_ctrl_map ov9281_ctrl_map[] = {
+	{
+		.id = V4L2_CID_EXPOSURE,
+		.reg = OV9281_AEC_EXPOSURE,
+		.len = 3,
+		.flags = SENSOR_CTRL_HOLD,
+		.to_reg = ov9281_exposure_to_reg,
+	},
+	{
+		.id = V4L2_CID_GAIN,
+		.reg = OV9281_AEC_GAIN,
+		.len = 1,
+		.flags = SENSOR_CTRL_HOLD,
+	},
+	{
+		.id = V4L2_CID_HFLIP,
+		.reg = OV9281_TIMING_FORMAT2,
+		.len = 1,
+		.mask = OV9281_MIRROR,
+	},
+	{
+		.id = V4L2_CID_VFLIP,
+		.reg = OV9281_TIMING_FORMAT1,
+		.len = 1,
+		.mask = OV9281_VFLIP,
+	},
+	{
+		.id = V4L2_CID_TEST_PATTERN,
+		.reg = OV9281_PRE_CTRL00,
+		.len = 1,
+		.mask = OV9281_TEST_PATTERN_ENABLE,
+	},
+	{
+		.id = V4L2_CID_OV9281_TRIGGER,
+		.reg = OV9281_TIMING_REG23,
+		.len = 1,
+		.mask = OV9281_EXT_VSYNC,
+	},
+	{
+		.id = V4L2_CID_OV9281_TRIGGER,
+		.reg = OV9281_LP_CTRL,
+		.len = 1,
+		.mask = OV9281_LP_TRIGGER,
+	},
+	{
+		.id = V4L2_CID_OV9281_STROBE,
+		.reg = OV9281_SC_CTRL06,
+		.len = 1,
+		.mask = OV9281_STROBE_OUT_ENABLE,
+	},
+};
+
+static const struct sensor_supply ov9281_supplies[] = {
+	{ "vdddo", OV9281_VOLTAGE_DIGITAL_IO },
+	{ "vddd", OV9281_VOLTAGE_DIGITAL_CORE },
+	{ "vdda", OV9281_VOLTAGE_ANALOG },
+};
+
+static const struct sensor_ops ov9281_ops = {
+	.g_volatile_ctrl = ov9281_g_volatile_ctrl,
+	.mode_changed = ov9281_mode_changed,
+};
+
+static const struct sensor_desc ov9281_desc = {
+	.ops = &ov9281_ops,
+	.variants = &ov9281_variant,
+	.num_variants = 1,
+	.chip_id_reg = OV9281_CHIP_ID_HIGH_REG,
+	.max_register = OV9281_MAX_REGISTER,
+	.formats = ov9281_formats,
+	.num_formats = ARRAY_SIZE(ov9281_formats),
+	.xclk_freq = OV9281_XCLK,
+	.supplies = ov9281_supplies,
+	.num_supplies = ARRAY_SIZE(ov9281_supplies),
+	.power = {
+		.supply_us = 1000,
+		.gpio_us = 1000,
+		.boot_ms = 5,
+	},
+	.stream_reg = OV9281_SYSTEM_CTRL0,
+	.stream_on = OV9281_SYSTEM_CTRL0_START,
+	.stream_off = OV9281_SYSTEM_CTRL0_STOP,
+	.hold_reg = OV9281_GROUP_HOLD,
+	.hold_on = OV9281_GROUP_HOLD_START,
+	.hold_off = OV9281_GROUP_HOLD_END,
+	.hold_launch = OV9281_GROUP_HOLD_LAUNCH,
+	.ctrl_map = ov9281_ctrl_map,
+	.num_ctrl_map = ARRAY_SIZE(ov9281_ctrl_map),
+};
+
+static int ov9281_probe(struct i2c_client *client,
+			const struct i2c_device_id *id)
+{
+	struct device *dev = &client->dev;
+	struct ov9281 *ov9281;
+	struct sensor *s;
+	int ret;
+
+	ov9281 = devm_kzalloc(dev, sizeof(struct ov9281), GFP_KERNEL);
+	if (!ov9281)
+		return -ENOMEM;
+	s = &ov9281->s;
+
+	ret = sensor_probe(s, client, &ov9281_desc);
+	if (ret < 0)
+		return ret;
+
+	if (s->ep.bus.mipi_csi2.num_data_lanes != OV9281_LANES) {
+		dev_err(dev, "the tables need %u data lanes\n", OV9281_LANES);
+		ret = -EINVAL;
+		goto release;
+	}
+
+	ret = sensor_identify(s, 1280, 800);
+	if (ret < 0)
+		goto release;
+
+	v4l2_ctrl_handler_init(&s->ctrls, 9);
+	/* In lines and 1/16 steps; driven by userspace AE (camd_3a). */
+	ov9281->exposure = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_EXPOSURE, 1,
+				ov9281_modes[s->current_mode].vts -
+				OV9281_EXPOSURE_MARGIN, 1,
+				OV9281_EXPOSURE_DEFAULT);
+	ov9281->gain = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_GAIN, OV9281_GAIN_MIN,
+				OV9281_GAIN_MAX, 1, OV9281_GAIN_MIN);
+	v4l2_ctrl_cluster(2, &ov9281->exposure);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std_menu_items(&s->ctrls, &sensor_ctrl_ops,
+			  V4L2_CID_TEST_PATTERN,
+			  ARRAY_SIZE(ov9281_test_pattern_menu) - 1, 0, 0,
+			  ov9281_test_pattern_menu);
+	v4l2_ctrl_new_custom(&s->ctrls, &ov9281_trigger_ctrl, NULL);
+	v4l2_ctrl_new_custom(&s->ctrls, &ov9281_strobe_ctrl, NULL);
+	ov9281->pixel_rate = v4l2_ctrl_new_std(&s->ctrls, &sensor_ctrl_ops,
+				V4L2_CID_PIXEL_RATE, 1, INT_MAX, 1, 1);
+	if (ov9281->pixel_rate)
+		ov9281->pixel_rate->flags |= V4L2_CTRL_FLAG_VOLATILE |
+					     V4L2_CTRL_FLAG_READ_ONLY;
+
+	ret = sensor_register(s);
+	if (ret < 0)
+		goto release;
+
+	return 0;
+
+release:
+	sensor_release(s);
+
+	return ret;
+}
+
+
+static int ov9281_remove(struct i2c_client *client)
+{
+	struct sensor *s = to_sensor(i2c_get_clientdata(client));
+
+	sensor_unregister(s);
+	sensor_release(s);
+
+	return 0;
+}
+
+
+static const struct i2c_device_id ov9281_id[] = {
+	{ "ov9281", 0 },
+	{}
+};
+MODULE_DEVICE_TABLE(i2c, ov9281_id);
+
+static const struct of_device_id ov9281_of_match[] = {
+	{ .compatible = "ovti,ov9281" },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, ov9281_of_match);
+
+static struct i2c_driver ov9281_i2c_driver = {
+	.driver = {
+		.of_match_table = of_match_ptr(ov9281_of_match),
+		.name  = "ov9281",
+		.pm = &sensor_pm_ops,
+	},
+	.probe  = ov9281_probe,
+	.remove = ov9281_remove,
+	.id_table = ov9281_id,
+};
+
+module_i2c_driver(ov9281_i2c_driver);
+
+MODULE_FIRMWARE(OV9281_FIRMWARE);
+MODULE_DESCRIPTION("Omnivision OV9281 Camera Driver");
+MODULE_LICENSE("GPL v2");
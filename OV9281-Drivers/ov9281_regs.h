@@ -0,0 +1,107 @@
+/*
+ * Generated by Sensor-Core/regc.py from ov9281.regs, do not edit.
+ * Blob format: see regblob.h.
+ */
+
+#ifndef OV9281_REGS_H
+#define OV9281_REGS_H
+
+/* 83 writes, 83 after removing redundant ones, in 54 transfers; 249 bytes */
+static const u8 ov9281_global_init_setting[] = {
+	0x01, 0x01, 0x03, 0x01,	/* 0x0103 */
+	0x80, 0x00, 0x0a,	/* delay 10 ms */
+	0x01, 0x03, 0x02, 0x32,	/* 0x0302 */
+	0x02, 0x03, 0x0d, 0x50, 0x02,	/* 0x030d-0x030e */
+	0x01, 0x30, 0x01, 0x00,	/* 0x3001 */
+	0x03, 0x30, 0x04, 0x00, 0x00, 0x04,	/* 0x3004-0x3006 */
+	0x01, 0x30, 0x11, 0x0a,	/* 0x3011 */
+	0x01, 0x30, 0x13, 0x18,	/* 0x3013 */
+	0x02, 0x30, 0x22, 0x01, 0x00,	/* 0x3022-0x3023 */
+	0x01, 0x30, 0x2c, 0x00,	/* 0x302c */
+	0x02, 0x30, 0x2f, 0x00, 0x04,	/* 0x302f-0x3030 */
+	0x02, 0x30, 0x39, 0x32, 0x00,	/* 0x3039-0x303a */
+	0x01, 0x30, 0x3f, 0x01,	/* 0x303f */
+	0x04, 0x35, 0x00, 0x00, 0x2a, 0x90, 0x08,	/* 0x3500-0x3503 */
+	0x01, 0x35, 0x05, 0x8c,	/* 0x3505 */
+	0x03, 0x35, 0x07, 0x03, 0x00, 0x10,	/* 0x3507-0x3509 */
+	0x02, 0x36, 0x10, 0x80, 0xa0,	/* 0x3610-0x3611 */
+	0x01, 0x36, 0x20, 0x6e,	/* 0x3620 */
+	0x02, 0x36, 0x32, 0x56, 0x78,	/* 0x3632-0x3633 */
+	0x01, 0x36, 0x62, 0x05,	/* 0x3662 */
+	0x01, 0x36, 0x66, 0x00,	/* 0x3666 */
+	0x01, 0x36, 0x6f, 0x5a,	/* 0x366f */
+	0x01, 0x36, 0x80, 0x84,	/* 0x3680 */
+	0x01, 0x37, 0x12, 0x80,	/* 0x3712 */
+	0x01, 0x37, 0x2d, 0x22,	/* 0x372d */
+	0x02, 0x37, 0x31, 0x80, 0x30,	/* 0x3731-0x3732 */
+	0x01, 0x37, 0x7d, 0x22,	/* 0x377d */
+	0x04, 0x37, 0x88, 0x02, 0xa4, 0x00, 0x4a,	/* 0x3788-0x378b */
+	0x01, 0x37, 0x99, 0x20,	/* 0x3799 */
+	0x02, 0x38, 0x2c, 0x05, 0xb0,	/* 0x382c-0x382d */
+	0x01, 0x38, 0x9d, 0x00,	/* 0x389d */
+	0x03, 0x38, 0x81, 0x42, 0x01, 0x00,	/* 0x3881-0x3883 */
+	0x01, 0x38, 0x85, 0x02,	/* 0x3885 */
+	0x02, 0x38, 0xa8, 0x02, 0x80,	/* 0x38a8-0x38a9 */
+	0x01, 0x38, 0xb1, 0x00,	/* 0x38b1 */
+	0x01, 0x38, 0xb3, 0x02,	/* 0x38b3 */
+	0x04, 0x38, 0xc4, 0x00, 0xc0, 0x04, 0x80,	/* 0x38c4-0x38c7 */
+	0x01, 0x39, 0x20, 0xff,	/* 0x3920 */
+	0x01, 0x38, 0x23, 0x00,	/* 0x3823 */
+	0x01, 0x40, 0x03, 0x40,	/* 0x4003 */
+	0x01, 0x40, 0x10, 0x40,	/* 0x4010 */
+	0x01, 0x40, 0x43, 0x40,	/* 0x4043 */
+	0x01, 0x43, 0x07, 0x30,	/* 0x4307 */
+	0x01, 0x43, 0x17, 0x00,	/* 0x4317 */
+	0x01, 0x45, 0x01, 0x00,	/* 0x4501 */
+	0x01, 0x45, 0x0a, 0x08,	/* 0x450a */
+	0x01, 0x46, 0x01, 0x04,	/* 0x4601 */
+	0x01, 0x47, 0x0f, 0x00,	/* 0x470f */
+	0x01, 0x4f, 0x07, 0x00,	/* 0x4f07 */
+	0x01, 0x48, 0x00, 0x00,	/* 0x4800 */
+	0x02, 0x50, 0x00, 0x9f, 0x00,	/* 0x5000-0x5001 */
+	0x01, 0x5e, 0x00, 0x00,	/* 0x5e00 */
+	0x02, 0x5d, 0x00, 0x07, 0x00,	/* 0x5d00-0x5d01 */
+	0x01, 0x4f, 0x00, 0x04,	/* 0x4f00 */
+	0x04, 0x4f, 0x10, 0x00, 0x98, 0x0f, 0xc4,	/* 0x4f10-0x4f13 */
+	0x00,	/* end */
+};
+
+/* 31 writes, 31 after removing redundant ones, in 8 transfers; 56 bytes */
+static const u8 ov9281_setting_640x400[] = {
+	0x01, 0x37, 0x78, 0x10,	/* 0x3778 */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x0f, 0x03, 0x2f, 0x02, 0x80, 0x01, 0x90, 0x02, 0xd8, 0x02, 0x08,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x04, 0x00, 0x04, 0x31, 0x22,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x60, 0x01,	/* 0x3820-0x3821 */
+	0x02, 0x40, 0x08, 0x02, 0x05,	/* 0x4008-0x4009 */
+	0x02, 0x40, 0x0c, 0x00, 0x03,	/* 0x400c-0x400d */
+	0x01, 0x45, 0x07, 0x03,	/* 0x4507 */
+	0x01, 0x45, 0x09, 0x80,	/* 0x4509 */
+	0x00,	/* end */
+};
+
+/* 31 writes, 31 after removing redundant ones, in 8 transfers; 56 bytes */
+static const u8 ov9281_setting_1280x800[] = {
+	0x01, 0x37, 0x78, 0x00,	/* 0x3778 */
+	0x10, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x0f, 0x03, 0x2f, 0x05, 0x00, 0x03, 0x20, 0x02, 0xd8, 0x03, 0x8e,	/* 0x3800-0x380f */
+	0x06, 0x38, 0x10, 0x00, 0x08, 0x00, 0x08, 0x11, 0x11,	/* 0x3810-0x3815 */
+	0x02, 0x38, 0x20, 0x40, 0x00,	/* 0x3820-0x3821 */
+	0x02, 0x40, 0x08, 0x04, 0x0b,	/* 0x4008-0x4009 */
+	0x02, 0x40, 0x0c, 0x00, 0x07,	/* 0x400c-0x400d */
+	0x01, 0x45, 0x07, 0x00,	/* 0x4507 */
+	0x01, 0x45, 0x09, 0x00,	/* 0x4509 */
+	0x00,	/* end */
+};
+
+/* 1 writes, 1 after removing redundant ones, in 1 transfers; 5 bytes */
+static const u8 ov9281_format_raw10[] = {
+	0x01, 0x36, 0x62, 0x05,	/* 0x3662 */
+	0x00,	/* end */
+};
+
+/* 1 writes, 1 after removing redundant ones, in 1 transfers; 5 bytes */
+static const u8 ov9281_format_raw8[] = {
+	0x01, 0x36, 0x62, 0x07,	/* 0x3662 */
+	0x00,	/* end */
+};
+
+#endif /* OV9281_REGS_H */
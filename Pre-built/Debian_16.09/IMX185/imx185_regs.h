@@ -0,0 +1,82 @@
+/*
+ * Generated by Sensor-Core/regc.py from imx185.regs, do not edit.
+ * Blob format: see regblob.h.
+ */
+
+#ifndef IMX185_REGS_H
+#define IMX185_REGS_H
+
+/* 159 writes, 159 after removing redundant ones, in 68 transfers; 364 bytes */
+static const u8 imx185_setting_1080p[] = {
+	0x01, 0x30, 0x02, 0x01,	/* 0x3002 */
+	0x03, 0x30, 0x05, 0x00, 0x00, 0x50,	/* 0x3005-0x3007 */
+	0x02, 0x30, 0x09, 0x01, 0x3c,	/* 0x3009-0x300a */
+	0x01, 0x30, 0x0f, 0x01,	/* 0x300f */
+	0x02, 0x30, 0x18, 0x65, 0x04,	/* 0x3018-0x3019 */
+	0x04, 0x30, 0x1b, 0x4c, 0x04, 0x08, 0x02,	/* 0x301b-0x301e */
+	0x01, 0x30, 0x36, 0x06,	/* 0x3036 */
+	0x08, 0x30, 0x38, 0x08, 0x00, 0x40, 0x04, 0x0c, 0x00, 0x7c, 0x07,	/* 0x3038-0x303f */
+	0x01, 0x30, 0x44, 0xe1,	/* 0x3044 */
+	0x01, 0x30, 0x48, 0x33,	/* 0x3048 */
+	0x04, 0x30, 0x5c, 0x20, 0x00, 0x18, 0x00,	/* 0x305c-0x305f */
+	0x01, 0x30, 0x63, 0x74,	/* 0x3063 */
+	0x01, 0x30, 0x84, 0x0f,	/* 0x3084 */
+	0x01, 0x30, 0x86, 0x10,	/* 0x3086 */
+	0x01, 0x30, 0xa1, 0x44,	/* 0x30a1 */
+	0x02, 0x30, 0xcf, 0xe1, 0x29,	/* 0x30cf-0x30d0 */
+	0x02, 0x30, 0xd2, 0x9b, 0x01,	/* 0x30d2-0x30d3 */
+	0x01, 0x31, 0x1d, 0x0a,	/* 0x311d */
+	0x01, 0x31, 0x23, 0x0f,	/* 0x3123 */
+	0x01, 0x31, 0x26, 0xdf,	/* 0x3126 */
+	0x01, 0x31, 0x47, 0x87,	/* 0x3147 */
+	0x03, 0x31, 0xe0, 0x01, 0x9e, 0x01,	/* 0x31e0-0x31e2 */
+	0x04, 0x31, 0xe5, 0x05, 0x05, 0x3a, 0x3a,	/* 0x31e5-0x31e8 */
+	0x01, 0x32, 0x03, 0xc8,	/* 0x3203 */
+	0x01, 0x32, 0x07, 0x54,	/* 0x3207 */
+	0x01, 0x32, 0x13, 0x16,	/* 0x3213 */
+	0x01, 0x32, 0x15, 0xf6,	/* 0x3215 */
+	0x02, 0x32, 0x1a, 0x14, 0x51,	/* 0x321a-0x321b */
+	0x03, 0x32, 0x29, 0xe7, 0xf0, 0x10,	/* 0x3229-0x322b */
+	0x03, 0x32, 0x31, 0xe7, 0xf0, 0x10,	/* 0x3231-0x3233 */
+	0x02, 0x32, 0x3c, 0xe8, 0x70,	/* 0x323c-0x323d */
+	0x03, 0x32, 0x43, 0x08, 0xe1, 0x10,	/* 0x3243-0x3245 */
+	0x03, 0x32, 0x47, 0xe7, 0x60, 0x1e,	/* 0x3247-0x3249 */
+	0x02, 0x32, 0x4b, 0x00, 0x41,	/* 0x324b-0x324c */
+	0x06, 0x32, 0x50, 0x30, 0x0a, 0xff, 0xff, 0xff, 0x02,	/* 0x3250-0x3255 */
+	0x01, 0x32, 0x57, 0xf0,	/* 0x3257 */
+	0x01, 0x32, 0x5a, 0xa6,	/* 0x325a */
+	0x02, 0x32, 0x5d, 0x14, 0x51,	/* 0x325d-0x325e */
+	0x02, 0x32, 0x60, 0x00, 0x61,	/* 0x3260-0x3261 */
+	0x02, 0x32, 0x66, 0x30, 0x05,	/* 0x3266-0x3267 */
+	0x01, 0x32, 0x75, 0xe7,	/* 0x3275 */
+	0x02, 0x32, 0x81, 0xea, 0x70,	/* 0x3281-0x3282 */
+	0x01, 0x32, 0x85, 0xff,	/* 0x3285 */
+	0x01, 0x32, 0x8a, 0xf0,	/* 0x328a */
+	0x02, 0x32, 0x8d, 0xb6, 0x40,	/* 0x328d-0x328e */
+	0x03, 0x32, 0x90, 0x42, 0x51, 0x1e,	/* 0x3290-0x3292 */
+	0x02, 0x32, 0x94, 0xc4, 0x20,	/* 0x3294-0x3295 */
+	0x03, 0x32, 0x97, 0x50, 0x31, 0x1f,	/* 0x3297-0x3299 */
+	0x02, 0x32, 0x9b, 0xc0, 0x60,	/* 0x329b-0x329c */
+	0x03, 0x32, 0x9e, 0x4c, 0x71, 0x1f,	/* 0x329e-0x32a0 */
+	0x03, 0x32, 0xa2, 0xb6, 0xc0, 0x0b,	/* 0x32a2-0x32a4 */
+	0x02, 0x32, 0xa9, 0x24, 0x41,	/* 0x32a9-0x32aa */
+	0x02, 0x32, 0xb0, 0x25, 0x51,	/* 0x32b0-0x32b1 */
+	0x03, 0x32, 0xb7, 0x1c, 0xc1, 0x12,	/* 0x32b7-0x32b9 */
+	0x03, 0x32, 0xbe, 0x1d, 0xd1, 0x12,	/* 0x32be-0x32c0 */
+	0x05, 0x32, 0xc2, 0xa8, 0xc0, 0x0a, 0x1e, 0x21,	/* 0x32c2-0x32c6 */
+	0x02, 0x32, 0xc9, 0xb0, 0x40,	/* 0x32c9-0x32ca */
+	0x02, 0x32, 0xcc, 0x26, 0xa1,	/* 0x32cc-0x32cd */
+	0x03, 0x32, 0xd0, 0xb6, 0xc0, 0x0b,	/* 0x32d0-0x32d2 */
+	0x02, 0x32, 0xd4, 0xe2, 0x40,	/* 0x32d4-0x32d5 */
+	0x02, 0x32, 0xd8, 0x4e, 0xa1,	/* 0x32d8-0x32d9 */
+	0x01, 0x32, 0xec, 0xf0,	/* 0x32ec */
+	0x01, 0x33, 0x03, 0x00,	/* 0x3303 */
+	0x01, 0x33, 0x05, 0x03,	/* 0x3305 */
+	0x06, 0x33, 0x14, 0x04, 0x01, 0x04, 0x04, 0x38, 0x04,	/* 0x3314-0x3319 */
+	0x03, 0x33, 0x2c, 0x40, 0x20, 0x03,	/* 0x332c-0x332e */
+	0x0d, 0x33, 0x3e, 0x0a, 0x0a, 0x03, 0x20, 0x25, 0x68, 0x20, 0x40, 0x28, 0x20, 0x18, 0x78, 0x28,	/* 0x333e-0x334a */
+	0x02, 0x33, 0x4e, 0xb4, 0x01,	/* 0x334e-0x334f */
+	0x00,	/* end */
+};
+
+#endif /* IMX185_REGS_H */
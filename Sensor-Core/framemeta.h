@@ -0,0 +1,137 @@
+/*
+ * Per-frame sensor metadata.
+ *
+ * Neither sensor on the adapter sends embedded data lines that the CAMSS
+ * RDI path would hand to userspace, and a sensor driver never sees frame
+ * boundaries. Instead a driver records the exposure, gain and white
+ * balance it applied (or read back from an on-chip AE) in a small ring,
+ * each record stamped with CLOCK_MONOTONIC, the clock of the V4L2 buffer
+ * timestamps. A record describes every frame that starts after it, until
+ * the next record; records that repeat the previous values are dropped, so
+ * the ring reaches back further while nothing changes.
+ *
+ * The ring is exported as a read-only, volatile U32 array control,
+ * FRAMEMETA_CID, of FRAMEMETA_DEPTH records of FRAMEMETA_WORDS each, oldest
+ * first. Unused records are all zero. Per record:
+ *
+ *	0, 1	timestamp in ns, low and high word
+ *	2	record number, counting from 1
+ *	3	exposure, in the driver's exposure unit (lines)
+ *	4	gain, in the driver's gain register unit
+ *	5..7	white balance gains R, G, B, 0x400 = 1.0; 0 when not known
+ *
+ * camd reads the control once per frame and attaches the matching record
+ * to the buffer it delivers (see Camera-Tools/common/camd_proto.h).
+ *
+ * A record's timestamp is when the driver's register access completed,
+ * not a frame boundary. The IMX185 stamps the finished exposure/gain
+ * write, which REGHOLD applies at the next frame start at the earliest.
+ * The OV5640/OV5645 stamps the finished read-back, which trails the
+ * on-chip AEC change it reports by up to one sampling period (a frame)
+ * plus the worker's scheduling latency.
+ *
+ * camd has no frame start time either. CAMSS stamps a buffer when its
+ * last line is written, and camd takes the buffer timestamp minus the
+ * measured frame interval, i.e. the previous buffer's timestamp: the end
+ * of the previous frame plus its interrupt latency L. The frame really
+ * starts one vertical blanking B after that end, so the estimate is
+ * early by B - L, between B - max(L) and B; at IMX185 1080p60 B is about
+ * 45 lines, 0.67 ms. A record stamped within that window before a frame
+ * starts is matched to the frame after it. After a dropped frame the
+ * interval is the last one measured, which only adds the change in frame
+ * period if the rate changed meanwhile.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef SENSOR_CORE_FRAMEMETA_H
+#define SENSOR_CORE_FRAMEMETA_H
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include <media/v4l2-ctrls.h>
+
+#define FRAMEMETA_CID		(V4L2_CID_USER_BASE | 0x1f01)
+#define FRAMEMETA_DEPTH		16
+#define FRAMEMETA_WORDS		8
+
+struct framemeta {
+	u32 exposure;
+	u32 gain;
+	u32 awb[3];		/* R, G, B */
+};
+
+struct framemeta_ring {
+	spinlock_t lock;	/* writers and the control read */
+	u32 rec[FRAMEMETA_DEPTH][FRAMEMETA_WORDS];
+	unsigned int head;	/* next record to write */
+	u32 seq;		/* records written so far */
+	struct framemeta last;
+};
+
+/* For v4l2_ctrl_new_custom(); fill in .ops. */
+#define FRAMEMETA_CTRL_CONFIG					\
+	.id = FRAMEMETA_CID,					\
+	.name = "Frame Metadata",				\
+	.type = V4L2_CTRL_TYPE_U32,				\
+	.max = U32_MAX,						\
+	.step = 1,						\
+	.dims = { FRAMEMETA_DEPTH * FRAMEMETA_WORDS },		\
+	.flags = V4L2_CTRL_FLAG_READ_ONLY | V4L2_CTRL_FLAG_VOLATILE
+
+static inline void framemeta_init(struct framemeta_ring *ring)
+{
+	memset(ring, 0, sizeof(*ring));
+	spin_lock_init(&ring->lock);
+}
+
+/* Record @m as applied now, unless it repeats the last record. */
+static inline void framemeta_push(struct framemeta_ring *ring,
+				  const struct framemeta *m)
+{
+	u64 now = ktime_get_ns();
+	u32 *rec;
+
+	spin_lock(&ring->lock);
+
+	if (ring->seq && !memcmp(&ring->last, m, sizeof(*m))) {
+		spin_unlock(&ring->lock);
+		return;
+	}
+
+	rec = ring->rec[ring->head];
+	rec[0] = lower_32_bits(now);
+	rec[1] = upper_32_bits(now);
+	rec[2] = ++ring->seq;
+	rec[3] = m->exposure;
+	rec[4] = m->gain;
+	rec[5] = m->awb[0];
+	rec[6] = m->awb[1];
+	rec[7] = m->awb[2];
+
+	ring->last = *m;
+	ring->head = (ring->head + 1) % FRAMEMETA_DEPTH;
+
+	spin_unlock(&ring->lock);
+}
+
+/* Copy the ring, oldest record first, into a FRAMEMETA_CID payload. */
+static inline void framemeta_read(struct framemeta_ring *ring, u32 *out)
+{
+	unsigned int i;
+
+	spin_lock(&ring->lock);
+	for (i = 0; i < FRAMEMETA_DEPTH; i++)
+		memcpy(out + i * FRAMEMETA_WORDS,
+		       ring->rec[(ring->head + i) % FRAMEMETA_DEPTH],
+		       sizeof(ring->rec[0]));
+	spin_unlock(&ring->lock);
+}
+
+#endif /* SENSOR_CORE_FRAMEMETA_H */
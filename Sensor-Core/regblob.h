@@ -0,0 +1,123 @@
+/*
+ * Burst-packed sensor register tables.
+ *
+ * Register tables are written as text (.regs) and compiled by regc.py
+ * into const byte blobs, replacing arrays of struct reg_value { u16; u8; }
+ * that take 4 bytes per write and one CCI transaction each. A blob is a
+ * sequence of records:
+ *
+ *	0x01..0x7f n, reg_hi, reg_lo, val[n]	write n consecutive registers
+ *	0x80, ms_hi, ms_lo			sleep ms milliseconds
+ *	0x81, reg_hi, reg_lo, mask, val		reg = (reg & ~mask) | val
+ *	0x00					end of table
+ *
+ * Bursts rely on the sensor auto-incrementing the register address, which
+ * all OmniVision and Sony sensors on the adapter do.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef SENSOR_CORE_REGBLOB_H
+#define SENSOR_CORE_REGBLOB_H
+
+#include <linux/delay.h>
+#include <linux/errno.h>
+#include <linux/types.h>
+
+#define REGBLOB_END		0x00
+#define REGBLOB_BURST_MAX	0x7f
+#define REGBLOB_DELAY		0x80
+#define REGBLOB_MASK		0x81
+
+struct regblob_io {
+	/* Write @n bytes to registers @reg, @reg + 1, ... */
+	int (*write)(void *priv, u16 reg, const u8 *val, unsigned int n);
+	int (*read)(void *priv, u16 reg, u8 *val);
+	void *priv;
+};
+
+/*
+ * Check that @blob is well formed and ends within @size bytes, without
+ * touching the sensor. Returns the length up to and including
+ * REGBLOB_END, or -EINVAL.
+ */
+static inline int regblob_validate(const u8 *blob, size_t size)
+{
+	size_t pos = 0;
+
+	while (pos < size) {
+		u8 op = blob[pos++];
+
+		if (op == REGBLOB_END)
+			return pos;
+
+		if (op <= REGBLOB_BURST_MAX)
+			pos += 2 + op;
+		else if (op == REGBLOB_DELAY)
+			pos += 2;
+		else if (op == REGBLOB_MASK)
+			pos += 4;
+		else
+			return -EINVAL;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Replay @blob (of @size bytes, as generated by regc.py). Stops at the
+ * first failed access and returns its error, or -EINVAL if the blob is
+ * malformed.
+ */
+static inline int regblob_apply(const struct regblob_io *io, const u8 *blob,
+				size_t size)
+{
+	const u8 *end = blob + size;
+	int ret;
+
+	while (blob < end) {
+		u8 op = *blob++;
+		u16 reg;
+		u8 val;
+
+		if (op == REGBLOB_END)
+			return 0;
+
+		if (op <= REGBLOB_BURST_MAX) {
+			if (end - blob < 2 + op)
+				return -EINVAL;
+			reg = blob[0] << 8 | blob[1];
+			ret = io->write(io->priv, reg, blob + 2, op);
+			if (ret < 0)
+				return ret;
+			blob += 2 + op;
+		} else if (op == REGBLOB_DELAY) {
+			if (end - blob < 2)
+				return -EINVAL;
+			msleep(blob[0] << 8 | blob[1]);
+			blob += 2;
+		} else if (op == REGBLOB_MASK) {
+			if (end - blob < 4)
+				return -EINVAL;
+			reg = blob[0] << 8 | blob[1];
+			ret = io->read(io->priv, reg, &val);
+			if (ret < 0)
+				return ret;
+			val = (val & ~blob[2]) | blob[3];
+			ret = io->write(io->priv, reg, &val, 1);
+			if (ret < 0)
+				return ret;
+			blob += 4;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	/* Ran off the end without REGBLOB_END. */
+	return -EINVAL;
+}
+
+#endif /* SENSOR_CORE_REGBLOB_H */
@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+#
+# regc - compile sensor register descriptions into burst-packed blobs
+#
+# Reads a .regs text file and writes a C header with one
+# "static const u8 name[]" blob per table, in the format described in
+# regblob.h. Writes to consecutive registers become one burst, writes that
+# are overwritten before they can matter are dropped, and the order of the
+# remaining writes is kept.
+#
+#	regc.py ov5645.regs -o ov5645_regs.h
+#
+# With --firmware it also writes the tables that have a slot into a file
+# for request_firmware() (layout in regfw.h), which the drivers prefer over
+# their built-in tables:
+#
+#	regc.py ov5645.regs --firmware ov5645-regs.bin --chip 5645 -r 3
+#
+# Input format, one statement per line, '#' starts a comment, registers and
+# values are hexadecimal, delays decimal milliseconds:
+#
+#	volatile 3008		# never dropped, merged or bursted
+#	table ov5640_init_1080p init	# start a blob, for firmware slot init
+#					# ("mode N" for mode N, or no slot)
+#	3103 11			# write 0x11 to 0x3103
+#	delay 5			# sleep 5 ms (decimal)
+#	mask 3820 06 02		# read-modify-write: bits 0x06 of 0x3820 = 0x02
+#	end
+#
+# Redundant writes are removed under these rules:
+#  - a write is dropped if the same register is written again later in the
+#    table with no delay, mask on it or volatile write in between;
+#  - a write is dropped if it stores the value the table last wrote to that
+#    register, unless a volatile write (soft reset, group hold...) came in
+#    between;
+#  - volatile registers are written exactly as listed.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+# Opcodes, see regblob.h.
+OP_END = 0x00
+OP_DELAY = 0x80
+OP_MASK = 0x81
+BURST_MAX = 0x7f
+
+# Firmware container, see regfw.h.
+FW_MAGIC = 0x57464252
+FW_VERSION = 1
+FW_MAX_TABLES = 16
+FW_SLOT_INIT = 0
+
+
+class RegcError(Exception):
+    pass
+
+
+class Table:
+    def __init__(self, name, slot, line):
+        self.name = name
+        self.slot = slot	# firmware slot or None
+        self.line = line
+        self.ops = []		# ('w', reg, val) / ('d', ms) / ('m', reg, mask, val)
+
+
+def parse_hex(tok, what, bits, lineno):
+    try:
+        v = int(tok, 16)
+    except ValueError:
+        raise RegcError('line %d: bad %s "%s"' % (lineno, what, tok))
+    if v < 0 or v >= 1 << bits:
+        raise RegcError('line %d: %s 0x%x out of range' % (lineno, what, v))
+    return v
+
+
+def parse_slot(tok, lineno):
+    if not tok:
+        return None
+    if tok == ['init']:
+        return FW_SLOT_INIT
+    if len(tok) == 2 and tok[0] == 'mode' and tok[1].isdigit():
+        slot = FW_SLOT_INIT + 1 + int(tok[1])
+        if slot < FW_MAX_TABLES:
+            return slot
+    raise RegcError('line %d: bad slot "%s"' % (lineno, ' '.join(tok)))
+
+
+def parse(f):
+    tables = []
+    volatile = set()
+    cur = None
+
+    for lineno, line in enumerate(f, 1):
+        tok = line.split('#', 1)[0].split()
+        if not tok:
+            continue
+
+        kw = tok[0]
+        if kw == 'volatile':
+            for t in tok[1:]:
+                volatile.add(parse_hex(t, 'register', 16, lineno))
+        elif kw == 'table':
+            if cur or len(tok) < 2 or not tok[1].isidentifier():
+                raise RegcError('line %d: bad table statement' % lineno)
+            if any(t.name == tok[1] for t in tables):
+                raise RegcError('line %d: table %s redefined' %
+                                (lineno, tok[1]))
+            slot = parse_slot(tok[2:], lineno)
+            if slot is not None and any(t.slot == slot for t in tables):
+                raise RegcError('line %d: slot %s used twice' %
+                                (lineno, ' '.join(tok[2:])))
+            cur = Table(tok[1], slot, lineno)
+        elif kw == 'end':
+            if not cur:
+                raise RegcError('line %d: end outside a table' % lineno)
+            tables.append(cur)
+            cur = None
+        elif not cur:
+            raise RegcError('line %d: statement outside a table' % lineno)
+        elif kw == 'delay':
+            if len(tok) != 2 or not tok[1].isdigit() or int(tok[1]) > 0xffff:
+                raise RegcError('line %d: bad delay' % lineno)
+            cur.ops.append(('d', int(tok[1])))
+        elif kw == 'mask':
+            if len(tok) != 4:
+                raise RegcError('line %d: bad mask statement' % lineno)
+            reg = parse_hex(tok[1], 'register', 16, lineno)
+            mask = parse_hex(tok[2], 'mask', 8, lineno)
+            val = parse_hex(tok[3], 'value', 8, lineno)
+            if val & ~mask:
+                raise RegcError('line %d: value 0x%02x outside mask 0x%02x' %
+                                (lineno, val, mask))
+            cur.ops.append(('m', reg, mask, val))
+        elif len(tok) == 2:
+            cur.ops.append(('w', parse_hex(tok[0], 'register', 16, lineno),
+                            parse_hex(tok[1], 'value', 8, lineno)))
+        else:
+            raise RegcError('line %d: cannot parse "%s"' %
+                            (lineno, line.strip()))
+
+    if cur:
+        raise RegcError('line %d: table %s not ended' % (cur.line, cur.name))
+
+    return tables, volatile
+
+
+def optimise(ops, volatile):
+    """Drop redundant writes, keeping the order of everything else."""
+    keep = [True] * len(ops)
+
+    # Overwritten: scan backwards, remembering registers written later in
+    # the current barrier-free stretch.
+    later = set()
+    for i in range(len(ops) - 1, -1, -1):
+        op = ops[i]
+        if op[0] == 'd':
+            later.clear()
+        elif op[0] == 'm':
+            later.discard(op[1])
+        elif op[1] in volatile:
+            later.clear()
+        elif op[1] in later:
+            keep[i] = False
+        else:
+            later.add(op[1])
+
+    # Rewrites of the value already there: scan forwards.
+    known = {}
+    for i, op in enumerate(ops):
+        if not keep[i]:
+            continue
+        if op[0] == 'm':
+            known.pop(op[1], None)
+        elif op[0] == 'w':
+            if op[1] in volatile:
+                known.clear()
+            elif known.get(op[1]) == op[2]:
+                keep[i] = False
+            else:
+                known[op[1]] = op[2]
+
+    return [op for i, op in enumerate(ops) if keep[i]]
+
+
+def pack(ops, volatile, burst_max):
+    """Turn writes into bursts; returns a list of (comment, bytes)."""
+    out = []
+    run = None
+
+    def flush():
+        if run:
+            reg, vals = run
+            out.append(('0x%04x' % reg if len(vals) == 1 else
+                        '0x%04x-0x%04x' % (reg, reg + len(vals) - 1),
+                        [len(vals), reg >> 8, reg & 0xff] + vals))
+
+    for op in ops:
+        if op[0] == 'w':
+            reg, val = op[1], op[2]
+            if (run and reg not in volatile and
+                    run[0] not in volatile and
+                    reg == run[0] + len(run[1]) and
+                    len(run[1]) < burst_max):
+                run[1].append(val)
+                continue
+            flush()
+            run = (reg, [val])
+            continue
+
+        flush()
+        run = None
+        if op[0] == 'd':
+            out.append(('delay %d ms' % op[1],
+                        [OP_DELAY, op[1] >> 8, op[1] & 0xff]))
+        else:
+            out.append(('0x%04x &= ~0x%02x |= 0x%02x' % (op[1], op[2], op[3]),
+                        [OP_MASK, op[1] >> 8, op[1] & 0xff, op[2], op[3]]))
+    flush()
+
+    out.append(('end', [OP_END]))
+
+    return out
+
+
+def compile_table(t, volatile, burst_max):
+    ops = optimise(t.ops, volatile)
+    return ops, pack(ops, volatile, burst_max)
+
+
+def write_firmware(path, tables, volatile, burst_max, chip, revision):
+    entries = []
+    data = b''
+    fw = [t for t in tables if t.slot is not None]
+    base = 20 + 12 * len(fw)
+
+    for t in fw:
+        _, rec = compile_table(t, volatile, burst_max)
+        blob = bytes(x for _, b in rec for x in b)
+        entries.append(struct.pack('<HHII', t.slot, 0, base + len(data),
+                                   len(blob)))
+        data += blob
+
+    body = b''.join(entries) + data
+    hdr = struct.pack('<IHHIII', FW_MAGIC, FW_VERSION, len(fw), chip,
+                      revision, zlib.crc32(body) & 0xffffffff)
+
+    with open(path, 'wb') as f:
+        f.write(hdr + body)
+
+    return len(fw), len(hdr) + len(body)
+
+
+def emit(out, tables, volatile, burst_max, src):
+    guard = os.path.basename(out.name).upper().replace('.', '_').replace('-', '_')
+    total_in = total_out = 0
+
+    out.write('/*\n * Generated by Sensor-Core/regc.py from %s, do not edit.\n'
+              ' * Blob format: see regblob.h.\n */\n\n' %
+              os.path.basename(src))
+    out.write('#ifndef %s\n#define %s\n\n' % (guard, guard))
+
+    for t in tables:
+        ops, rec = compile_table(t, volatile, burst_max)
+        writes = sum(1 for op in t.ops if op[0] == 'w')
+        kept = sum(1 for op in ops if op[0] == 'w')
+        size = sum(len(b) for _, b in rec)
+        bursts = sum(1 for _, b in rec if 0 < b[0] <= BURST_MAX)
+
+        total_in += writes * 4
+        total_out += size
+
+        out.write('/* %d writes, %d after removing redundant ones, in %d '
+                  'transfers; %d bytes */\n' % (writes, kept, bursts, size))
+        out.write('static const u8 %s[] = {\n' % t.name)
+        for comment, b in rec:
+            out.write('\t%s\t/* %s */\n' %
+                      (', '.join('0x%02x' % x for x in b) + ',', comment))
+        out.write('};\n\n')
+
+    out.write('#endif /* %s */\n' % guard)
+
+    return total_in, total_out
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Compile a .regs file into '
+                                 'burst-packed register blobs.')
+    ap.add_argument('input')
+    ap.add_argument('-o', '--output', help='header to write (default: '
+                    'input with _regs.h instead of .regs)')
+    ap.add_argument('-b', '--burst', type=int, default=16,
+                    help='maximum registers per transfer (default 16)')
+    ap.add_argument('-f', '--firmware', help='also write the slotted '
+                    'tables to this request_firmware() file')
+    ap.add_argument('-c', '--chip', type=lambda v: int(v, 16),
+                    help='chip ID the firmware is for, hex (required '
+                    'with --firmware)')
+    ap.add_argument('-r', '--revision', type=int, default=0,
+                    help='tuning revision stored in the firmware')
+    args = ap.parse_args()
+
+    if not 1 <= args.burst <= BURST_MAX:
+        ap.error('burst must be 1..%d' % BURST_MAX)
+    if args.firmware and args.chip is None:
+        ap.error('--firmware needs --chip')
+
+    output = args.output or os.path.splitext(args.input)[0] + '_regs.h'
+
+    try:
+        with open(args.input) as f:
+            tables, volatile = parse(f)
+    except RegcError as e:
+        sys.exit('%s: %s' % (args.input, e))
+
+    with open(output, 'w') as out:
+        before, after = emit(out, tables, volatile, args.burst, args.input)
+
+    print('%s: %d tables, %d -> %d bytes' % (output, len(tables),
+                                             before, after))
+
+    if args.firmware:
+        n, size = write_firmware(args.firmware, tables, volatile,
+                                 args.burst, args.chip, args.revision)
+        print('%s: %d tables, %d bytes, chip 0x%x revision %d' %
+              (args.firmware, n, size, args.chip, args.revision))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,190 @@
+/*
+ * Register tables loaded at runtime through request_firmware().
+ *
+ * A firmware file (built by regc.py --firmware) carries regblob tables for
+ * one sensor, so modes can be tuned or added without rebuilding the
+ * kernel. Its layout, all fields little endian:
+ *
+ *	struct regfw_header
+ *	struct regfw_entry[num_tables]
+ *	table data (regblobs, each ending in REGBLOB_END)
+ *
+ * The CRC32 covers everything after the header. The file is validated once
+ * when it is loaded and the tables are kept in memory as they are, already
+ * in burst form, so replaying one costs the same as a built-in table. Any
+ * slot the file leaves out falls back to the driver's own table.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef SENSOR_CORE_REGFW_H
+#define SENSOR_CORE_REGFW_H
+
+#include <linux/crc32.h>
+#include <linux/device.h>
+#include <linux/firmware.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <asm/unaligned.h>
+
+#include "regblob.h"
+
+#define REGFW_MAGIC		0x57464252	/* "RBFW" */
+#define REGFW_VERSION		1
+
+/* Table slots. */
+#define REGFW_INIT		0
+#define REGFW_MODE(n)		(1 + (n))
+#define REGFW_MAX_TABLES	16
+
+struct regfw_header {
+	__le32 magic;
+	__le16 version;		/* of this layout, REGFW_VERSION */
+	__le16 num_tables;
+	__le32 chip_id;		/* sensor the tables were written for */
+	__le32 revision;	/* of the tuning, for the log */
+	__le32 crc32;
+} __packed;
+
+struct regfw_entry {
+	__le16 slot;
+	__le16 reserved;
+	__le32 offset;		/* from the start of the file */
+	__le32 size;
+} __packed;
+
+struct regfw {
+	void *data;		/* NULL when no firmware is loaded */
+	const u8 *table[REGFW_MAX_TABLES];
+	size_t size[REGFW_MAX_TABLES];
+	u32 revision;
+};
+
+static inline int regfw_parse(struct device *dev, struct regfw *rf,
+			      const u8 *data, size_t size, u32 chip_id)
+{
+	const struct regfw_header *hdr = (const void *)data;
+	unsigned int i, num;
+	u32 crc;
+	int ret;
+
+	if (size < sizeof(*hdr) ||
+	    get_unaligned_le32(&hdr->magic) != REGFW_MAGIC) {
+		dev_err(dev, "register firmware: bad magic\n");
+		return -EINVAL;
+	}
+
+	if (get_unaligned_le16(&hdr->version) != REGFW_VERSION) {
+		dev_err(dev, "register firmware: unsupported version %u\n",
+			get_unaligned_le16(&hdr->version));
+		return -EINVAL;
+	}
+
+	if (get_unaligned_le32(&hdr->chip_id) != chip_id) {
+		dev_err(dev, "register firmware is for chip 0x%x, not 0x%x\n",
+			get_unaligned_le32(&hdr->chip_id), chip_id);
+		return -EINVAL;
+	}
+
+	crc = crc32_le(~0, data + sizeof(*hdr), size - sizeof(*hdr)) ^ ~0;
+	if (crc != get_unaligned_le32(&hdr->crc32)) {
+		dev_err(dev, "register firmware: CRC mismatch\n");
+		return -EINVAL;
+	}
+
+	num = get_unaligned_le16(&hdr->num_tables);
+	if (num > REGFW_MAX_TABLES ||
+	    size < sizeof(*hdr) + num * sizeof(struct regfw_entry)) {
+		dev_err(dev, "register firmware: bad table count %u\n", num);
+		return -EINVAL;
+	}
+
+	rf->data = kmemdup(data, size, GFP_KERNEL);
+	if (!rf->data)
+		return -ENOMEM;
+
+	for (i = 0; i < num; i++) {
+		const struct regfw_entry *e = (const void *)(data +
+			sizeof(*hdr) + i * sizeof(*e));
+		unsigned int slot = get_unaligned_le16(&e->slot);
+		u32 offset = get_unaligned_le32(&e->offset);
+		u32 len = get_unaligned_le32(&e->size);
+
+		if (slot >= REGFW_MAX_TABLES || rf->table[slot] ||
+		    offset > size || len > size - offset) {
+			dev_err(dev, "register firmware: bad entry %u\n", i);
+			ret = -EINVAL;
+			goto err;
+		}
+
+		ret = regblob_validate(data + offset, len);
+		if (ret < 0 || (u32)ret != len) {
+			dev_err(dev, "register firmware: malformed table %u\n",
+				slot);
+			ret = -EINVAL;
+			goto err;
+		}
+
+		rf->table[slot] = (const u8 *)rf->data + offset;
+		rf->size[slot] = len;
+	}
+
+	rf->revision = get_unaligned_le32(&hdr->revision);
+
+	return 0;
+
+err:
+	kfree(rf->data);
+	memset(rf, 0, sizeof(*rf));
+	return ret;
+}
+
+/*
+ * Load and validate @name. A missing file is not an error: the driver
+ * then keeps using its built-in tables, and so it does for a file that
+ * fails validation.
+ */
+static inline void regfw_load(struct device *dev, struct regfw *rf,
+			      const char *name, u32 chip_id)
+{
+	const struct firmware *fw;
+
+	memset(rf, 0, sizeof(*rf));
+
+	if (request_firmware_direct(&fw, name, dev))
+		return;
+
+	if (!regfw_parse(dev, rf, fw->data, fw->size, chip_id))
+		dev_info(dev, "using register tables from %s, revision %u\n",
+			 name, rf->revision);
+	else
+		dev_warn(dev, "ignoring %s, using built-in tables\n", name);
+
+	release_firmware(fw);
+}
+
+static inline void regfw_release(struct regfw *rf)
+{
+	kfree(rf->data);
+	memset(rf, 0, sizeof(*rf));
+}
+
+/*
+ * The firmware's table for @slot if it has one, else @builtin. @size holds
+ * the built-in table's size on entry and the returned one's on exit.
+ */
+static inline const u8 *regfw_table(const struct regfw *rf, unsigned int slot,
+				    const u8 *builtin, size_t *size)
+{
+	if (slot < REGFW_MAX_TABLES && rf->table[slot]) {
+		*size = rf->size[slot];
+		return rf->table[slot];
+	}
+
+	return builtin;
+}
+
+#endif /* SENSOR_CORE_REGFW_H */
@@ -0,0 +1,1624 @@
+/*
+ * Table-driven core for the adapter's CCI sensor drivers.
+ *
+ * A driver describes its sensor in a const struct sensor_desc (supplies and
+ * power-up timing, chip ID, mode tables per variant, and which registers
+ * each control writes) and embeds struct sensor in its own state. The core
+ * does the rest the drivers used to copy from one another: regulators,
+ * clock and GPIO sequencing, runtime PM, identification, register tables,
+ * the pad and stream ops, and the mapped controls.
+ *
+ * Registers are accessed through a regmap on the sensor's I2C client (CCI
+ * is an I2C adapter like any other), so a table replays as the bursts
+ * regc.py packed it into (regblob.h), split only where the adapter limits
+ * the transfer length. Registers named in the control map are non-volatile
+ * and held in the regmap cache, which every write keeps up to date, tables
+ * included: read-modify-write controls need no bus read and a control that
+ * already holds its value costs nothing. All other registers are volatile.
+ * Controls set while the sensor is off are kept by the control framework
+ * and reach it at the next stream start, after the mode table. The regmap
+ * debugfs directory dumps the registers of a powered sensor.
+ *
+ * With a PLL description (sensor_pll.h) and the modes' HTS and VTS, the
+ * frame rate can be lowered with s_frame_interval: the pixel clock then
+ * drops to what HTS x VTS at that rate needs, with the lowest lane rate
+ * the PLL reaches from the board's XCLK, and the driver's set_pll hook
+ * rewrites those of its PLL registers that differ from the mode table.
+ * The same happens at full rate when the board's XCLK is not the one the
+ * tables were written for.
+ *
+ * s_power holds a runtime PM reference; the sensor stays powered and
+ * initialised for SENSOR_AUTOSUSPEND_MS after the last user lets go, so
+ * reopening it right away skips the power-up and the init table. Without
+ * CONFIG_PM s_power powers it up and down directly.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef SENSOR_CORE_SENSOR_CORE_H
+#define SENSOR_CORE_SENSOR_CORE_H
+
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/gpio/consumer.h>
+#include <linux/i2c.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/of_graph.h>
+#include <linux/pm_runtime.h>
+#include <linux/regmap.h>
+#include <linux/regulator/consumer.h>
+#include <linux/types.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-of.h>
+#include <media/v4l2-subdev.h>
+
+#include "regblob.h"
+#include "regfw.h"
+#include "sensor_pll.h"
+
+#define SENSOR_MAX_SUPPLIES	3
+#define SENSOR_MAX_CACHED	32
+#define SENSOR_MAX_CLUSTER	4	/* mapped controls written together */
+#define SENSOR_AUTOSUSPEND_MS	1000
+
+/* Per lane, without DT link-frequencies: what the CSIPHY takes. */
+#define SENSOR_LANE_RATE_MAX	1000000000ULL
+#define SENSOR_MAX_LINK_FREQS	8
+
+/* Transient bus errors: retry with 1, 2, 4 ms back-off. */
+#define SENSOR_RETRIES		3
+
+struct sensor;
+
+struct sensor_supply {
+	const char *name;
+	int microvolt;
+};
+
+/*
+ * Power-up after the clock and supplies are on: wait @supply_us, release
+ * reset or powerdown (reset first if @reset_first), wait @gpio_us, release
+ * the other and wait @boot_ms before the first register access. Power-down
+ * asserts both before cutting the supplies.
+ */
+struct sensor_power_seq {
+	bool reset_first;
+	unsigned int supply_us;
+	unsigned int gpio_us;
+	unsigned int boot_ms;
+};
+
+#define SENSOR_CTRL_LE		BIT(0)	/* multi-byte value, LSB first */
+#define SENSOR_CTRL_INVERT	BIT(1)	/* boolean: mask set when off */
+#define SENSOR_CTRL_HOLD	BIT(2)	/* write inside the group hold */
+
+/*
+ * A register field driven by a control. Without @mask, @len registers from
+ * @reg take to_reg(val) (or val), big endian unless SENSOR_CTRL_LE. With
+ * @mask (@len 1) only those bits change: they take to_reg(val), or for a
+ * boolean control all or none of them. A control may own several
+ * consecutive entries; they are written in order.
+ */
+struct sensor_ctrl_map {
+	u32 id;
+	u16 reg;
+	u8 len;
+	u8 mask;
+	u32 flags;
+	u32 (*to_reg)(struct sensor *s, s32 val);
+};
+
+struct sensor_mode {
+	u32 width;
+	u32 height;
+	u32 fps;		/* maximum, with the table's timing */
+	u16 hts;		/* pixel clocks per line, 0: fixed rate */
+	u16 vts;		/* lines per frame */
+	const u8 *data;		/* regblob */
+	u32 data_size;
+};
+
+#define SENSOR_MODE(w, h, f, table) {		\
+	.width = (w),				\
+	.height = (h),				\
+	.fps = (f),				\
+	.data = (table),			\
+	.data_size = sizeof(table),		\
+}
+
+#define SENSOR_MODE_TIMED(w, h, f, h_total, v_total, table) {	\
+	.width = (w),						\
+	.height = (h),						\
+	.fps = (f),						\
+	.hts = (h_total),					\
+	.vts = (v_total),					\
+	.data = (table),					\
+	.data_size = sizeof(table),				\
+}
+
+/*
+ * A media bus format for every mode, for sensors with more than one. The
+ * mode tables are shared; @data, if any, is replayed after them.
+ */
+struct sensor_format {
+	u32 code;
+	u8 bpp;			/* bits per pixel on the link */
+	const u8 *data;		/* regblob, NULL: nothing to change */
+	u32 data_size;
+};
+
+#define SENSOR_FORMAT(c, b, table) {		\
+	.code = (c),				\
+	.bpp = (b),				\
+	.data = (table),			\
+	.data_size = sizeof(table),		\
+}
+
+/*
+ * Chips sharing a driver but not their tuning, picked by chip ID. Modes
+ * are sorted by size. The optional firmware (regfw.h) replaces the init
+ * table in slot REGFW_INIT and mode n in REGFW_MODE(n).
+ */
+struct sensor_variant {
+	const char *name;
+	u16 chip_id;
+	const u8 *init;		/* NULL: the mode tables are complete */
+	u32 init_size;
+	const struct sensor_mode *modes;
+	unsigned int num_modes;
+	const char *firmware;
+	unsigned long driver_data;	/* the driver's own flags */
+};
+
+struct sensor_ops {
+	/* Optional. The sensor lost its registers: reset or powered off. */
+	void (*reset)(struct sensor *s);
+
+	/*
+	 * Optional. Controls the map does not cover; lock held, as the
+	 * control handler's lock (see sensor_register()).
+	 */
+	int (*s_ctrl)(struct sensor *s, struct v4l2_ctrl *ctrl);
+	int (*g_volatile_ctrl)(struct sensor *s, struct v4l2_ctrl *ctrl);
+	/* Optional. A mapped control reached the sensor; lock held. */
+	void (*ctrl_written)(struct sensor *s, struct v4l2_ctrl *ctrl);
+
+	/*
+	 * With desc->pll. After the mode table, when the PLL must differ
+	 * from the table's; lock held.
+	 */
+	int (*set_pll)(struct sensor *s, const struct sensor_pll *pll);
+
+	/*
+	 * Optional. After set_fmt changed the active mode; lock held, so
+	 * controls are changed with the __v4l2_ctrl_*() calls.
+	 */
+	void (*mode_changed)(struct sensor *s);
+	/* Optional. After streaming started, before it stops. */
+	void (*stream_on)(struct sensor *s);
+	void (*stream_off)(struct sensor *s);
+};
+
+struct sensor_desc {
+	const struct sensor_ops *ops;
+	const struct sensor_variant *variants;
+	unsigned int num_variants;
+	u16 chip_id_reg;	/* MSB here, LSB in the next register */
+	u16 max_register;
+	u32 code;		/* media bus format, without @formats */
+	const struct sensor_format *formats;	/* NULL: @code and @bpp */
+	unsigned int num_formats;
+	u32 xclk_freq;		/* the tables', DT "clock-frequency" wins */
+	const struct sensor_supply *supplies;	/* in power-up order */
+	unsigned int num_supplies;
+	struct sensor_power_seq power;
+	u16 stream_reg;
+	u8 stream_on;
+	u8 stream_off;		/* also written after the init table */
+	u16 hold_reg;		/* group hold, 0: none */
+	u8 hold_on;
+	u8 hold_off;
+	u8 hold_launch;		/* written after hold_off, 0: none */
+	const struct sensor_ctrl_map *ctrl_map;
+	unsigned int num_ctrl_map;
+	const u16 *cached_regs;	/* non-volatile besides the control map */
+	unsigned int num_cached_regs;
+	const struct sensor_pll_limits *pll;	/* NULL: the tables' clocks */
+	u8 bpp;			/* bits per pixel on the link */
+};
+
+struct sensor {
+	const struct sensor_desc *desc;
+	const struct sensor_variant *variant;	/* NULL until identified */
+	struct i2c_client *i2c_client;
+	struct device *dev;
+	struct regmap *regmap;
+	unsigned int max_burst;	/* registers per write, 0: no limit */
+	struct v4l2_subdev sd;
+	struct media_pad pad;
+	struct v4l2_of_endpoint ep;
+	struct v4l2_mbus_framefmt fmt;
+	struct v4l2_rect crop;
+	struct clk *xclk;
+	u32 xclk_freq;
+	struct regulator *supplies[SENSOR_MAX_SUPPLIES];
+	struct gpio_desc *enable_gpio;
+	struct gpio_desc *rst_gpio;
+
+	struct v4l2_ctrl_handler ctrls;
+	struct regfw regfw;
+
+	struct mutex lock;	/* power state, register access, controls */
+	bool power;		/* powered up and initialised */
+	bool streaming;
+	bool fault;		/* an access failed after all retries */
+	unsigned int users;	/* s_power references, without runtime PM */
+	unsigned int current_mode;	/* index in variant->modes */
+	unsigned int current_format;	/* index in desc->formats */
+	u32 fps;		/* requested, 0: the mode's maximum */
+	u64 link_budget;	/* bit/s over all lanes of the port */
+	struct sensor_pll pll;	/* lane_rate 0: the mode table's PLL */
+
+	u16 cached[SENSOR_MAX_CACHED];	/* the non-volatile registers */
+	unsigned int num_cached;
+};
+
+static inline struct sensor *to_sensor(struct v4l2_subdev *sd)
+{
+	return container_of(sd, struct sensor, sd);
+}
+
+static inline bool sensor_is_cached(struct sensor *s, u16 reg)
+{
+	unsigned int i;
+
+	for (i = 0; i < s->num_cached; i++)
+		if (s->cached[i] == reg)
+			return true;
+
+	return false;
+}
+
+static inline bool sensor_volatile_reg(struct device *dev, unsigned int reg)
+{
+	struct sensor *s = to_sensor(i2c_get_clientdata(to_i2c_client(dev)));
+
+	return !sensor_is_cached(s, reg);
+}
+
+/* Called when the sensor's registers went back to their defaults. */
+static inline void sensor_cache_drop(struct sensor *s)
+{
+	regcache_drop_region(s->regmap, 0, s->desc->max_register);
+}
+
+static inline void sensor_cache_add(struct sensor *s, u16 reg)
+{
+	if (sensor_is_cached(s, reg))
+		return;
+	if (WARN_ON(s->num_cached == SENSOR_MAX_CACHED))
+		return;
+	s->cached[s->num_cached++] = reg;
+}
+
+/*
+ * The registers the control map names are the ones worth caching, and
+ * those the driver adds, such as the PLL registers set_pll compares.
+ */
+static inline void sensor_cache_init(struct sensor *s)
+{
+	const struct sensor_desc *desc = s->desc;
+	unsigned int i, j;
+
+	for (i = 0; i < desc->num_ctrl_map; i++)
+		for (j = 0; j < desc->ctrl_map[i].len; j++)
+			sensor_cache_add(s, desc->ctrl_map[i].reg + j);
+
+	for (i = 0; i < desc->num_cached_regs; i++)
+		sensor_cache_add(s, desc->cached_regs[i]);
+}
+
+/* The cached value of @reg, without going to the sensor for it. */
+static inline int sensor_cache_peek(struct sensor *s, u16 reg, u8 *val)
+{
+	unsigned int v;
+	int ret;
+
+	regcache_cache_only(s->regmap, true);
+	ret = regmap_read(s->regmap, reg, &v);
+	regcache_cache_only(s->regmap, false);
+	if (ret < 0)
+		return ret;
+
+	*val = v;
+
+	return 0;
+}
+
+static inline int sensor_write_burst(struct sensor *s, u16 reg, const u8 *val,
+				     unsigned int n)
+{
+	unsigned int attempt;
+	int ret;
+
+	for (attempt = 0; ; attempt++) {
+		ret = regmap_raw_write(s->regmap, reg, val, n);
+		if (ret >= 0 || attempt == SENSOR_RETRIES)
+			break;
+		usleep_range(1000 << attempt, 2000 << attempt);
+	}
+
+	if (ret < 0) {
+		dev_err(s->dev, "write error %d: reg=0x%04x, n=%u\n",
+			ret, reg, n);
+		s->fault = true;
+		/* The cache took the values, the sensor maybe not. */
+		regcache_drop_region(s->regmap, reg, reg + n - 1);
+	}
+
+	return ret;
+}
+
+/* Write @n registers from @reg. Called with the lock held from here on. */
+static inline int sensor_write(struct sensor *s, u16 reg, const u8 *val,
+			       unsigned int n)
+{
+	unsigned int len;
+	int ret;
+
+	for (; n; reg += len, val += len, n -= len) {
+		len = s->max_burst ? min(n, s->max_burst) : n;
+		ret = sensor_write_burst(s, reg, val, len);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static inline int sensor_write_reg(struct sensor *s, u16 reg, u8 val)
+{
+	return sensor_write(s, reg, &val, 1);
+}
+
+static inline int sensor_read_reg(struct sensor *s, u16 reg, u8 *val)
+{
+	unsigned int attempt, v;
+	int ret;
+
+	for (attempt = 0; ; attempt++) {
+		ret = regmap_read(s->regmap, reg, &v);
+		if (ret >= 0 || attempt == SENSOR_RETRIES)
+			break;
+		usleep_range(1000 << attempt, 2000 << attempt);
+	}
+
+	if (ret < 0) {
+		dev_err(s->dev, "read error %d: reg=0x%04x\n", ret, reg);
+		s->fault = true;
+		return ret;
+	}
+
+	*val = v;
+
+	return 0;
+}
+
+/*
+ * Read @n consecutive registers from @reg. Volatile ones come back in one
+ * transfer, which also keeps values the sensor latches together in step.
+ */
+static inline int sensor_read(struct sensor *s, u16 reg, u8 *val,
+			      unsigned int n)
+{
+	unsigned int attempt;
+	int ret;
+
+	for (attempt = 0; ; attempt++) {
+		ret = regmap_bulk_read(s->regmap, reg, val, n);
+		if (ret >= 0 || attempt == SENSOR_RETRIES)
+			break;
+		usleep_range(1000 << attempt, 2000 << attempt);
+	}
+
+	if (ret < 0) {
+		dev_err(s->dev, "read error %d: reg=0x%04x, n=%u\n",
+			ret, reg, n);
+		s->fault = true;
+	}
+
+	return ret;
+}
+
+/* Like sensor_write(), but skipped when the cache says it is a no-op. */
+static inline int sensor_update(struct sensor *s, u16 reg, const u8 *val,
+				unsigned int n)
+{
+	unsigned int i;
+	u8 old;
+
+	for (i = 0; i < n; i++)
+		if (!sensor_is_cached(s, reg + i) ||
+		    sensor_cache_peek(s, reg + i, &old) < 0 || old != val[i])
+			return sensor_write(s, reg, val, n);
+
+	return 0;
+}
+
+static inline int sensor_blob_write(void *priv, u16 reg, const u8 *val,
+				    unsigned int n)
+{
+	return sensor_write(priv, reg, val, n);
+}
+
+static inline int sensor_blob_read(void *priv, u16 reg, u8 *val)
+{
+	return sensor_read_reg(priv, reg, val);
+}
+
+static inline int sensor_load_table(struct sensor *s, const u8 *blob,
+				    size_t size)
+{
+	struct regblob_io io = {
+		.write = sensor_blob_write,
+		.read = sensor_blob_read,
+		.priv = s,
+	};
+	int ret;
+
+	ret = regblob_apply(&io, blob, size);
+	if (ret == -EINVAL)
+		dev_err(s->dev, "malformed register table\n");
+
+	return ret;
+}
+
+static inline unsigned int sensor_num_formats(struct sensor *s)
+{
+	return s->desc->formats ? s->desc->num_formats : 1;
+}
+
+static inline u32 sensor_format_code(struct sensor *s, unsigned int format)
+{
+	return s->desc->formats ? s->desc->formats[format].code :
+				  s->desc->code;
+}
+
+static inline u8 sensor_bpp(struct sensor *s)
+{
+	return s->desc->formats ?
+	       s->desc->formats[s->current_format].bpp : s->desc->bpp;
+}
+
+/* Index of media bus format @code, the first format if not offered. */
+static inline unsigned int sensor_find_format(struct sensor *s, u32 code)
+{
+	unsigned int i;
+
+	for (i = 0; i < sensor_num_formats(s); i++)
+		if (sensor_format_code(s, i) == code)
+			return i;
+
+	return 0;
+}
+
+/*
+ * The mode table, the format's registers, then the PLL if it has to
+ * differ from the table's.
+ */
+static inline int sensor_set_mode(struct sensor *s, unsigned int mode)
+{
+	const struct sensor_mode *info = &s->variant->modes[mode];
+	const struct sensor_format *format = NULL;
+	size_t size = info->data_size;
+	const u8 *table;
+	int ret;
+
+	table = regfw_table(&s->regfw, REGFW_MODE(mode), info->data, &size);
+
+	ret = sensor_load_table(s, table, size);
+	if (ret < 0)
+		return ret;
+
+	if (s->desc->formats)
+		format = &s->desc->formats[s->current_format];
+	if (format && format->data) {
+		ret = sensor_load_table(s, format->data, format->data_size);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (!s->pll.lane_rate)
+		return 0;
+
+	return s->desc->ops->set_pll(s, &s->pll);
+}
+
+/* Init table if the variant has one, then standby. */
+static inline int sensor_init_regs(struct sensor *s)
+{
+	const struct sensor_variant *variant = s->variant;
+	size_t size = variant->init_size;
+	const u8 *table;
+	int ret;
+
+	if (variant->init) {
+		table = regfw_table(&s->regfw, REGFW_INIT, variant->init,
+				    &size);
+		ret = sensor_load_table(s, table, size);
+		if (ret < 0)
+			return ret;
+	}
+
+	return sensor_write_reg(s, s->desc->stream_reg, s->desc->stream_off);
+}
+
+/*
+ * Pulse the reset pin and replay the init and current mode tables, leaving
+ * the sensor in standby.
+ */
+static inline int sensor_reset(struct sensor *s)
+{
+	int ret;
+
+	gpiod_set_value_cansleep(s->rst_gpio, 1);
+	usleep_range(1000, 2000);
+	gpiod_set_value_cansleep(s->rst_gpio, 0);
+	msleep(s->desc->power.boot_ms);
+
+	sensor_cache_drop(s);
+	s->fault = false;
+	if (s->desc->ops->reset)
+		s->desc->ops->reset(s);
+
+	ret = sensor_init_regs(s);
+	if (ret < 0)
+		return ret;
+
+	ret = sensor_set_mode(s, s->current_mode);
+	if (ret < 0)
+		return ret;
+
+	return sensor_write_reg(s, s->desc->stream_reg, s->desc->stream_off);
+}
+
+static inline int sensor_power_up(struct sensor *s)
+{
+	const struct sensor_desc *desc = s->desc;
+	const struct sensor_power_seq *seq = &desc->power;
+	unsigned int i;
+	int ret;
+
+	clk_set_rate(s->xclk, s->xclk_freq);
+
+	ret = clk_prepare_enable(s->xclk);
+	if (ret < 0) {
+		dev_err(s->dev, "clk prepare enable failed\n");
+		return ret;
+	}
+
+	for (i = 0; i < desc->num_supplies; i++) {
+		ret = regulator_enable(s->supplies[i]);
+		if (ret < 0) {
+			dev_err(s->dev, "could not enable %s\n",
+				desc->supplies[i].name);
+			goto err_supplies;
+		}
+	}
+
+	usleep_range(seq->supply_us, 2 * seq->supply_us);
+	gpiod_set_value_cansleep(seq->reset_first ? s->rst_gpio :
+				 s->enable_gpio, 0);
+	usleep_range(seq->gpio_us, 2 * seq->gpio_us);
+	gpiod_set_value_cansleep(seq->reset_first ? s->enable_gpio :
+				 s->rst_gpio, 0);
+	msleep(seq->boot_ms);
+
+	return 0;
+
+err_supplies:
+	while (i--)
+		regulator_disable(s->supplies[i]);
+	clk_disable_unprepare(s->xclk);
+
+	return ret;
+}
+
+static inline void sensor_power_down(struct sensor *s)
+{
+	const struct sensor_desc *desc = s->desc;
+	unsigned int i = desc->num_supplies;
+
+	gpiod_set_value_cansleep(s->rst_gpio, 1);
+	gpiod_set_value_cansleep(s->enable_gpio, 1);
+
+	while (i--)
+		if (regulator_disable(s->supplies[i]) < 0)
+			dev_err(s->dev, "could not disable %s\n",
+				desc->supplies[i].name);
+	clk_disable_unprepare(s->xclk);
+
+	sensor_cache_drop(s);
+	s->fault = false;
+	if (desc->ops->reset)
+		desc->ops->reset(s);
+}
+
+/* Power up and program the init table. */
+static inline int sensor_start(struct sensor *s)
+{
+	int ret;
+
+	ret = sensor_power_up(s);
+	if (ret < 0) {
+		dev_err(s->dev, "could not power up\n");
+		return ret;
+	}
+
+	ret = sensor_init_regs(s);
+	if (ret < 0) {
+		/* A table aborted halfway: start over once. */
+		dev_warn(s->dev, "init failed, resetting sensor\n");
+		ret = sensor_reset(s);
+	}
+	if (ret < 0) {
+		dev_err(s->dev, "could not set init registers\n");
+		sensor_power_down(s);
+		return ret;
+	}
+
+	s->power = true;
+
+	return 0;
+}
+
+static inline void sensor_stop(struct sensor *s)
+{
+	sensor_power_down(s);
+	s->power = false;
+}
+
+static inline int sensor_runtime_suspend(struct device *dev)
+{
+	struct sensor *s = to_sensor(i2c_get_clientdata(to_i2c_client(dev)));
+
+	mutex_lock(&s->lock);
+	if (s->power)
+		sensor_stop(s);
+	mutex_unlock(&s->lock);
+
+	return 0;
+}
+
+static inline int sensor_runtime_resume(struct device *dev)
+{
+	struct sensor *s = to_sensor(i2c_get_clientdata(to_i2c_client(dev)));
+	int ret = 0;
+
+	mutex_lock(&s->lock);
+	if (!s->power)
+		ret = sensor_start(s);
+	mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static const struct dev_pm_ops sensor_pm_ops = {
+	SET_RUNTIME_PM_OPS(sensor_runtime_suspend, sensor_runtime_resume, NULL)
+};
+
+static inline int sensor_s_power(struct v4l2_subdev *sd, int on)
+{
+	struct sensor *s = to_sensor(sd);
+	int ret = 0;
+
+	if (pm_runtime_enabled(s->dev)) {
+		if (!on) {
+			pm_runtime_mark_last_busy(s->dev);
+			pm_runtime_put_autosuspend(s->dev);
+			return 0;
+		}
+
+		ret = pm_runtime_get_sync(s->dev);
+		if (ret < 0) {
+			pm_runtime_put_noidle(s->dev);
+			return ret;
+		}
+
+		return 0;
+	}
+
+	mutex_lock(&s->lock);
+	if (on && !s->users++) {
+		ret = sensor_start(s);
+		if (ret < 0)
+			s->users--;
+	} else if (!on && s->users && !--s->users) {
+		sensor_stop(s);
+	}
+	mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static inline const struct sensor_ctrl_map *
+sensor_find_ctrl(const struct sensor_desc *desc, u32 id)
+{
+	unsigned int i;
+
+	for (i = 0; i < desc->num_ctrl_map; i++)
+		if (desc->ctrl_map[i].id == id)
+			return &desc->ctrl_map[i];
+
+	return NULL;
+}
+
+static inline int sensor_write_field(struct sensor *s,
+				     const struct sensor_ctrl_map *map,
+				     s32 val)
+{
+	u32 bits = map->to_reg ? map->to_reg(s, val) : val;
+	u8 buf[4], old;
+	unsigned int i;
+	int ret;
+
+	if (map->mask) {
+		if (!map->to_reg)
+			bits = !val == !(map->flags & SENSOR_CTRL_INVERT) ?
+			       0 : map->mask;
+
+		ret = sensor_read_reg(s, map->reg, &old);
+		if (ret < 0)
+			return ret;
+
+		buf[0] = (old & ~map->mask) | (bits & map->mask);
+		return sensor_update(s, map->reg, buf, 1);
+	}
+
+	for (i = 0; i < map->len && i < sizeof(buf); i++)
+		buf[i] = bits >> 8 * (map->flags & SENSOR_CTRL_LE ? i :
+				      map->len - 1 - i);
+
+	return sensor_update(s, map->reg, buf, i);
+}
+
+/* Write every field of the control @map starts. */
+static inline int sensor_write_ctrl(struct sensor *s,
+				    const struct sensor_ctrl_map *map, s32 val)
+{
+	const struct sensor_ctrl_map *end = s->desc->ctrl_map +
+					    s->desc->num_ctrl_map;
+	const struct sensor_ctrl_map *m;
+	int ret = 0;
+
+	for (m = map; m < end && m->id == map->id && ret >= 0; m++)
+		ret = sensor_write_field(s, m, val);
+
+	return ret;
+}
+
+static inline bool sensor_ctrl_held(struct sensor *s,
+				    const struct sensor_ctrl_map *map)
+{
+	const struct sensor_ctrl_map *end = s->desc->ctrl_map +
+					    s->desc->num_ctrl_map;
+	const struct sensor_ctrl_map *m;
+
+	for (m = map; m < end && m->id == map->id; m++)
+		if (m->flags & SENSOR_CTRL_HOLD)
+			return true;
+
+	return false;
+}
+
+/*
+ * The framework calls s_ctrl with the lock held, once per cluster
+ * (v4l2_ctrl_cluster()), with the master and every member's new value.
+ * All members that changed are written, inside a single group hold if any
+ * of their fields asks for one, so clustered exposure and gain reach the
+ * same frame. Every member of a cluster of mapped controls must be mapped.
+ */
+static inline int sensor_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct sensor *s = container_of(ctrl->handler, struct sensor, ctrls);
+	const struct sensor_desc *desc = s->desc;
+	const struct sensor_ops *ops = desc->ops;
+	const struct sensor_ctrl_map *map[SENSOR_MAX_CLUSTER];
+	struct v4l2_ctrl *c;
+	bool hold = false;
+	unsigned int i;
+	int ret = 0, ret2;
+
+	if (!sensor_find_ctrl(desc, ctrl->id))
+		return ops->s_ctrl ? ops->s_ctrl(s, ctrl) : -EINVAL;
+
+	if (WARN_ON(ctrl->ncontrols > SENSOR_MAX_CLUSTER))
+		return -EINVAL;
+
+	for (i = 0; i < ctrl->ncontrols; i++) {
+		c = ctrl->cluster[i];
+		map[i] = c && c->is_new ? sensor_find_ctrl(desc, c->id) : NULL;
+		if (c && c->is_new && WARN_ON(!map[i]))
+			return -EINVAL;
+		if (map[i])
+			hold |= desc->hold_reg && sensor_ctrl_held(s, map[i]);
+	}
+
+	/* Kept by the framework, written at the next stream start. */
+	if (!s->power)
+		return 0;
+
+	if (hold) {
+		ret = sensor_write_reg(s, desc->hold_reg, desc->hold_on);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = 0; i < ctrl->ncontrols && ret >= 0; i++) {
+		if (!map[i])
+			continue;
+
+		c = ctrl->cluster[i];
+		ret = sensor_write_ctrl(s, map[i], c->val);
+		if (ret >= 0 && ops->ctrl_written)
+			ops->ctrl_written(s, c);
+	}
+
+	if (hold) {
+		/* Always release it, or the sensor ignores later updates. */
+		ret2 = sensor_write_reg(s, desc->hold_reg, desc->hold_off);
+		if (ret2 >= 0 && desc->hold_launch)
+			ret2 = sensor_write_reg(s, desc->hold_reg,
+						desc->hold_launch);
+		if (ret >= 0)
+			ret = ret2;
+	}
+
+	return ret;
+}
+
+static inline int sensor_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct sensor *s = container_of(ctrl->handler, struct sensor, ctrls);
+
+	if (!s->desc->ops->g_volatile_ctrl)
+		return -EINVAL;
+
+	return s->desc->ops->g_volatile_ctrl(s, ctrl);
+}
+
+static const struct v4l2_ctrl_ops sensor_ctrl_ops = {
+	.g_volatile_ctrl = sensor_g_volatile_ctrl,
+	.s_ctrl = sensor_s_ctrl,
+};
+
+static inline int sensor_enum_mbus_code(struct v4l2_subdev *sd,
+					struct v4l2_subdev_pad_config *cfg,
+					struct v4l2_subdev_mbus_code_enum *code)
+{
+	struct sensor *s = to_sensor(sd);
+
+	if (code->index >= sensor_num_formats(s))
+		return -EINVAL;
+
+	code->code = sensor_format_code(s, code->index);
+
+	return 0;
+}
+
+static inline int sensor_enum_frame_size(struct v4l2_subdev *sd,
+				struct v4l2_subdev_pad_config *cfg,
+				struct v4l2_subdev_frame_size_enum *fse)
+{
+	struct sensor *s = to_sensor(sd);
+	const struct sensor_mode *info;
+
+	if (fse->index >= s->variant->num_modes ||
+	    sensor_format_code(s, sensor_find_format(s, fse->code)) !=
+	    fse->code)
+		return -EINVAL;
+
+	info = &s->variant->modes[fse->index];
+	fse->min_width = info->width;
+	fse->max_width = info->width;
+	fse->min_height = info->height;
+	fse->max_height = info->height;
+
+	return 0;
+}
+
+/* Lower rates enumerated for modes the PLL can slow down. */
+static const u32 sensor_fps_steps[] = { 60, 30, 25, 20, 15, 10, 5 };
+
+static inline bool sensor_has_pll(struct sensor *s, unsigned int mode)
+{
+	return s->desc->pll && s->variant->modes[mode].hts;
+}
+
+static inline int sensor_enum_frame_interval(struct v4l2_subdev *sd,
+				struct v4l2_subdev_pad_config *cfg,
+				struct v4l2_subdev_frame_interval_enum *fie)
+{
+	struct sensor *s = to_sensor(sd);
+	const struct sensor_variant *variant = s->variant;
+	unsigned int i, j, n;
+
+	for (i = 0; i < variant->num_modes; i++)
+		if (variant->modes[i].width == fie->width &&
+		    variant->modes[i].height == fie->height)
+			break;
+
+	if (i == variant->num_modes)
+		return -EINVAL;
+
+	/* The fastest the mode table runs at, then the slower steps. */
+	fie->interval.numerator = 1;
+	fie->interval.denominator = variant->modes[i].fps;
+	if (!fie->index)
+		return 0;
+	if (!sensor_has_pll(s, i))
+		return -EINVAL;
+
+	for (j = 0, n = 0; j < ARRAY_SIZE(sensor_fps_steps); j++) {
+		if (sensor_fps_steps[j] >= variant->modes[i].fps)
+			continue;
+		if (++n == fie->index) {
+			fie->interval.denominator = sensor_fps_steps[j];
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Work out the PLL for the current mode at s->fps. The mode table's own
+ * clocking stands at the mode's full rate from the XCLK the tables were
+ * written for; otherwise the PLL is solved for the lowest lane rate that
+ * carries HTS x VTS x fps pixels a second. Called with the lock held.
+ */
+static inline void sensor_pll_update(struct sensor *s)
+{
+	const struct sensor_desc *desc = s->desc;
+	const struct sensor_mode *mode = &s->variant->modes[s->current_mode];
+	u32 lanes = s->ep.bus.mipi_csi2.num_data_lanes ?: 1;
+	u32 fps = s->fps ? min(s->fps, mode->fps) : mode->fps;
+	u64 rate;
+
+	memset(&s->pll, 0, sizeof(s->pll));
+	if (!sensor_has_pll(s, s->current_mode) ||
+	    (fps == mode->fps && s->xclk_freq == desc->xclk_freq))
+		return;
+
+	rate = (u64)mode->hts * mode->vts * fps * sensor_bpp(s);
+	if (sensor_pll_solve(desc->pll, s->xclk_freq,
+			     DIV_ROUND_UP_ULL(rate, lanes), &s->pll) < 0) {
+		dev_warn(s->dev, "no PLL setting for %ux%u at %u fps\n",
+			 mode->width, mode->height, fps);
+		return;
+	}
+
+	s->pll.pixel_rate = div_u64(s->pll.lane_rate * lanes, sensor_bpp(s));
+}
+
+/* The current mode's frame interval, to 1/1000 fps once clocked down. */
+static inline void sensor_get_interval(struct sensor *s,
+				       struct v4l2_fract *interval)
+{
+	const struct sensor_mode *mode = &s->variant->modes[s->current_mode];
+
+	if (!s->pll.lane_rate) {
+		interval->numerator = 1;
+		interval->denominator = mode->fps;
+		return;
+	}
+
+	interval->numerator = 1000;
+	interval->denominator = div_u64(s->pll.pixel_rate * 1000,
+					(u32)mode->hts * mode->vts);
+}
+
+static inline int sensor_g_frame_interval(struct v4l2_subdev *sd,
+					  struct v4l2_subdev_frame_interval *fi)
+{
+	struct sensor *s = to_sensor(sd);
+
+	mutex_lock(&s->lock);
+	sensor_get_interval(s, &fi->interval);
+	mutex_unlock(&s->lock);
+
+	return 0;
+}
+
+/*
+ * Any rate up to the mode's maximum, rounded to whole frames per second,
+ * if the driver can clock the sensor down; the request is kept across
+ * mode changes and applies from the next stream start.
+ */
+static inline int sensor_s_frame_interval(struct v4l2_subdev *sd,
+					  struct v4l2_subdev_frame_interval *fi)
+{
+	struct sensor *s = to_sensor(sd);
+	struct v4l2_fract *interval = &fi->interval;
+	int ret = 0;
+
+	mutex_lock(&s->lock);
+	if (s->streaming) {
+		ret = -EBUSY;
+	} else if (s->desc->pll) {
+		s->fps = interval->numerator ?
+			 max(DIV_ROUND_CLOSEST(interval->denominator,
+					       interval->numerator), 1U) : 0;
+		sensor_pll_update(s);
+	}
+
+	sensor_get_interval(s, interval);
+	mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static inline struct v4l2_mbus_framefmt *
+sensor_pad_format(struct sensor *s, struct v4l2_subdev_pad_config *cfg,
+		  unsigned int pad, enum v4l2_subdev_format_whence which)
+{
+	if (which == V4L2_SUBDEV_FORMAT_TRY)
+		return v4l2_subdev_get_try_format(&s->sd, cfg, pad);
+
+	return &s->fmt;
+}
+
+static inline struct v4l2_rect *
+sensor_pad_crop(struct sensor *s, struct v4l2_subdev_pad_config *cfg,
+		unsigned int pad, enum v4l2_subdev_format_whence which)
+{
+	if (which == V4L2_SUBDEV_FORMAT_TRY)
+		return v4l2_subdev_get_try_crop(&s->sd, cfg, pad);
+
+	return &s->crop;
+}
+
+static inline int sensor_get_format(struct v4l2_subdev *sd,
+				    struct v4l2_subdev_pad_config *cfg,
+				    struct v4l2_subdev_format *format)
+{
+	struct sensor *s = to_sensor(sd);
+
+	mutex_lock(&s->lock);
+	format->format = *sensor_pad_format(s, cfg, format->pad,
+					    format->which);
+	mutex_unlock(&s->lock);
+
+	return 0;
+}
+
+/*
+ * What a candidate for set_fmt misses, worst first: a mode the link
+ * cannot carry fails at stream start, a smaller one loses pixels and a
+ * slower one only frames.
+ */
+#define SENSOR_MISS_BUDGET	BIT(2)
+#define SENSOR_MISS_SIZE	BIT(1)
+#define SENSOR_MISS_RATE	BIT(0)
+
+struct sensor_candidate {
+	unsigned int mode;
+	unsigned int format;
+	unsigned int miss;
+	u64 key[2];		/* lower is better, after @miss */
+};
+
+/*
+ * Pixel clocks read out and bits sent per second by @mode in @format at
+ * the requested rate. Without HTS and VTS only the active pixels are
+ * known, without a PLL the mode always runs at its maximum, and without
+ * the bits per pixel the link cost is unknown and taken as 0.
+ */
+static inline void sensor_mode_cost(struct sensor *s, unsigned int mode,
+				    unsigned int format, u64 *readout,
+				    u64 *link)
+{
+	const struct sensor_mode *info = &s->variant->modes[mode];
+	u32 fps = info->fps;
+	u8 bpp;
+
+	if (s->fps && sensor_has_pll(s, mode))
+		fps = min(s->fps, info->fps);
+
+	*readout = (info->hts ? (u64)info->hts * info->vts :
+				(u64)info->width * info->height) * fps;
+
+	bpp = s->desc->formats ? s->desc->formats[format].bpp : s->desc->bpp;
+	*link = *readout * bpp;
+}
+
+/*
+ * Rank @mode in @format for a @width x @height request at s->fps. Among
+ * the candidates that miss nothing the cheapest readout wins: pixel
+ * clocks per second at the requested rate, per frame if no rate was
+ * asked for. Otherwise the fastest of those large enough, the largest of
+ * those that are not, or the least over the link budget.
+ */
+static inline void sensor_rate_mode(struct sensor *s, unsigned int mode,
+				    unsigned int format, u32 width,
+				    u32 height, struct sensor_candidate *c)
+{
+	const struct sensor_mode *info = &s->variant->modes[mode];
+	u64 readout, link;
+
+	sensor_mode_cost(s, mode, format, &readout, &link);
+
+	c->mode = mode;
+	c->format = format;
+	c->miss = 0;
+	if (link > s->link_budget)
+		c->miss |= SENSOR_MISS_BUDGET;
+	if (info->width < width || info->height < height)
+		c->miss |= SENSOR_MISS_SIZE;
+	if (s->fps > info->fps)
+		c->miss |= SENSOR_MISS_RATE;
+
+	c->key[1] = readout;
+	if (!s->fps)
+		c->key[1] = info->hts ? (u64)info->hts * info->vts :
+					(u64)info->width * info->height;
+
+	if (c->miss & SENSOR_MISS_BUDGET)
+		c->key[0] = link;
+	else if (c->miss & SENSOR_MISS_SIZE)
+		c->key[0] = U64_MAX - (u64)info->width * info->height;
+	else if (c->miss & SENSOR_MISS_RATE)
+		c->key[0] = U32_MAX - info->fps;
+	else
+		c->key[0] = c->key[1];
+}
+
+static inline bool sensor_candidate_better(const struct sensor_candidate *a,
+					   const struct sensor_candidate *b)
+{
+	if (a->miss != b->miss)
+		return a->miss < b->miss;
+	if (a->key[0] != b->key[0])
+		return a->key[0] < b->key[0];
+
+	return a->key[1] < b->key[1];
+}
+
+/*
+ * The mode and format set_fmt answers @width x @height in @code with: every
+ * mode in the requested format, or in every format if @code is not one,
+ * rated by sensor_rate_mode(). Called with the lock held.
+ */
+static inline void sensor_select_mode(struct sensor *s, u32 width,
+				      u32 height, u32 code,
+				      unsigned int *mode, unsigned int *format)
+{
+	struct sensor_candidate best = { .miss = UINT_MAX }, c;
+	unsigned int f, m, first = 0, last = sensor_num_formats(s) - 1;
+
+	f = sensor_find_format(s, code);
+	if (sensor_format_code(s, f) == code)
+		first = last = f;
+
+	for (f = first; f <= last; f++) {
+		for (m = 0; m < s->variant->num_modes; m++) {
+			sensor_rate_mode(s, m, f, width, height, &c);
+			if (sensor_candidate_better(&c, &best))
+				best = c;
+		}
+	}
+
+	if (best.miss & SENSOR_MISS_BUDGET)
+		dev_warn(s->dev, "no mode within the %llu bit/s link budget\n",
+			 s->link_budget);
+
+	*mode = best.mode;
+	*format = best.format;
+}
+
+static inline int sensor_set_format(struct v4l2_subdev *sd,
+				    struct v4l2_subdev_pad_config *cfg,
+				    struct v4l2_subdev_format *format)
+{
+	struct sensor *s = to_sensor(sd);
+	struct v4l2_mbus_framefmt *__format;
+	struct v4l2_rect *__crop;
+	unsigned int new_mode, new_format;
+	int ret = 0;
+
+	mutex_lock(&s->lock);
+	if (format->which == V4L2_SUBDEV_FORMAT_ACTIVE && s->streaming) {
+		format->format = s->fmt;
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	sensor_select_mode(s, format->format.width, format->format.height,
+			   format->format.code, &new_mode, &new_format);
+
+	__crop = sensor_pad_crop(s, cfg, format->pad, format->which);
+	__crop->width = s->variant->modes[new_mode].width;
+	__crop->height = s->variant->modes[new_mode].height;
+
+	__format = sensor_pad_format(s, cfg, format->pad, format->which);
+	__format->width = __crop->width;
+	__format->height = __crop->height;
+	__format->code = sensor_format_code(s, new_format);
+	__format->field = V4L2_FIELD_NONE;
+	__format->colorspace = V4L2_COLORSPACE_SRGB;
+
+	format->format = *__format;
+
+	if (format->which == V4L2_SUBDEV_FORMAT_ACTIVE) {
+		s->current_mode = new_mode;
+		s->current_format = new_format;
+		sensor_pll_update(s);
+
+		if (s->desc->ops->mode_changed)
+			s->desc->ops->mode_changed(s);
+	}
+
+unlock:
+	mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static inline int sensor_get_selection(struct v4l2_subdev *sd,
+				       struct v4l2_subdev_pad_config *cfg,
+				       struct v4l2_subdev_selection *sel)
+{
+	struct sensor *s = to_sensor(sd);
+
+	if (sel->target != V4L2_SEL_TGT_CROP)
+		return -EINVAL;
+
+	mutex_lock(&s->lock);
+	sel->r = *sensor_pad_crop(s, cfg, sel->pad, sel->which);
+	mutex_unlock(&s->lock);
+
+	return 0;
+}
+
+static inline int sensor_s_stream(struct v4l2_subdev *sd, int enable)
+{
+	struct sensor *s = to_sensor(sd);
+	const struct sensor_desc *desc = s->desc;
+	int ret;
+
+	if (!enable) {
+		mutex_lock(&s->lock);
+		s->streaming = false;
+		mutex_unlock(&s->lock);
+
+		if (desc->ops->stream_off)
+			desc->ops->stream_off(s);
+
+		mutex_lock(&s->lock);
+		ret = sensor_write_reg(s, desc->stream_reg, desc->stream_off);
+		mutex_unlock(&s->lock);
+
+		return ret;
+	}
+
+	mutex_lock(&s->lock);
+	ret = sensor_set_mode(s, s->current_mode);
+	mutex_unlock(&s->lock);
+	if (ret < 0) {
+		dev_err(s->dev, "could not set mode %ux%u\n",
+			s->variant->modes[s->current_mode].width,
+			s->variant->modes[s->current_mode].height);
+		return ret;
+	}
+
+	/* Mode tables rewrite some mapped registers; takes the lock. */
+	ret = v4l2_ctrl_handler_setup(&s->ctrls);
+	if (ret < 0) {
+		dev_err(s->dev, "could not sync v4l2 controls\n");
+		return ret;
+	}
+
+	mutex_lock(&s->lock);
+	ret = sensor_write_reg(s, desc->stream_reg, desc->stream_on);
+	if (ret >= 0)
+		s->streaming = true;
+	mutex_unlock(&s->lock);
+	if (ret < 0)
+		return ret;
+
+	if (desc->ops->stream_on)
+		desc->ops->stream_on(s);
+
+	return 0;
+}
+
+static const struct v4l2_subdev_core_ops sensor_core_ops = {
+	.s_power = sensor_s_power,
+};
+
+static const struct v4l2_subdev_video_ops sensor_video_ops = {
+	.s_stream = sensor_s_stream,
+	.g_frame_interval = sensor_g_frame_interval,
+	.s_frame_interval = sensor_s_frame_interval,
+};
+
+static const struct v4l2_subdev_pad_ops sensor_pad_ops = {
+	.enum_mbus_code = sensor_enum_mbus_code,
+	.enum_frame_size = sensor_enum_frame_size,
+	.enum_frame_interval = sensor_enum_frame_interval,
+	.get_fmt = sensor_get_format,
+	.set_fmt = sensor_set_format,
+	.get_selection = sensor_get_selection,
+};
+
+static const struct v4l2_subdev_ops sensor_subdev_ops = {
+	.core = &sensor_core_ops,
+	.video = &sensor_video_ops,
+	.pad = &sensor_pad_ops,
+};
+
+/*
+ * The port's link budget: the fastest of the endpoint's DT
+ * "link-frequencies" (two bits per lane and cycle), else
+ * SENSOR_LANE_RATE_MAX, on each data lane.
+ */
+static inline u64 sensor_link_budget(struct sensor *s,
+				     struct device_node *endpoint)
+{
+	u32 lanes = s->ep.bus.mipi_csi2.num_data_lanes ?: 1;
+	u64 freqs[SENSOR_MAX_LINK_FREQS], rate = 0;
+	int i, n;
+
+	n = of_property_count_u64_elems(endpoint, "link-frequencies");
+	n = min_t(int, n, ARRAY_SIZE(freqs));
+	if (n > 0 && !of_property_read_u64_array(endpoint, "link-frequencies",
+						 freqs, n))
+		for (i = 0; i < n; i++)
+			rate = max(rate, 2 * freqs[i]);
+
+	return (rate ?: SENSOR_LANE_RATE_MAX) * lanes;
+}
+
+/*
+ * Take the endpoint, clock, supplies and GPIOs described by @desc and set
+ * up the subdev. Everything is device managed.
+ */
+static inline int sensor_probe(struct sensor *s, struct i2c_client *client,
+			       const struct sensor_desc *desc)
+{
+	struct device *dev = &client->dev;
+	const struct i2c_adapter_quirks *quirks;
+	struct regmap_config config = {
+		.reg_bits = 16,
+		.val_bits = 8,
+		.max_register = desc->max_register,
+		.volatile_reg = sensor_volatile_reg,
+		.cache_type = REGCACHE_RBTREE,
+	};
+	struct device_node *endpoint;
+	unsigned int i;
+	int ret;
+
+	if (WARN_ON(desc->num_supplies > SENSOR_MAX_SUPPLIES))
+		return -EINVAL;
+
+	s->desc = desc;
+	s->i2c_client = client;
+	s->dev = dev;
+
+	endpoint = of_graph_get_next_endpoint(dev->of_node, NULL);
+	if (!endpoint) {
+		dev_err(dev, "endpoint node not found\n");
+		return -EINVAL;
+	}
+
+	ret = v4l2_of_parse_endpoint(endpoint, &s->ep);
+	if (ret >= 0)
+		s->link_budget = sensor_link_budget(s, endpoint);
+	of_node_put(endpoint);
+	if (ret < 0) {
+		dev_err(dev, "parsing endpoint node failed\n");
+		return ret;
+	}
+	if (s->ep.bus_type != V4L2_MBUS_CSI2) {
+		dev_err(dev, "invalid bus type, must be CSI2\n");
+		return -EINVAL;
+	}
+
+	s->xclk = devm_clk_get(dev, "xclk");
+	if (IS_ERR(s->xclk)) {
+		dev_err(dev, "could not get xclk\n");
+		return PTR_ERR(s->xclk);
+	}
+
+	/* Boards with another reference clock say so in the DT. */
+	s->xclk_freq = desc->xclk_freq;
+	ret = of_property_read_u32(dev->of_node, "clock-frequency",
+				   &s->xclk_freq);
+	if (ret && !s->xclk_freq) {
+		dev_err(dev, "could not get xclk frequency\n");
+		return ret;
+	}
+
+	for (i = 0; i < desc->num_supplies; i++) {
+		s->supplies[i] = devm_regulator_get(dev,
+						    desc->supplies[i].name);
+		if (IS_ERR(s->supplies[i])) {
+			dev_err(dev, "cannot get %s regulator\n",
+				desc->supplies[i].name);
+			return PTR_ERR(s->supplies[i]);
+		}
+
+		ret = regulator_set_voltage(s->supplies[i],
+					    desc->supplies[i].microvolt,
+					    desc->supplies[i].microvolt);
+		if (ret < 0) {
+			dev_err(dev, "cannot set %s voltage\n",
+				desc->supplies[i].name);
+			return ret;
+		}
+	}
+
+	s->enable_gpio = devm_gpiod_get(dev, "enable", GPIOD_OUT_HIGH);
+	if (IS_ERR(s->enable_gpio)) {
+		dev_err(dev, "cannot get enable gpio\n");
+		return PTR_ERR(s->enable_gpio);
+	}
+
+	s->rst_gpio = devm_gpiod_get(dev, "reset", GPIOD_OUT_HIGH);
+	if (IS_ERR(s->rst_gpio)) {
+		dev_err(dev, "cannot get reset gpio\n");
+		return PTR_ERR(s->rst_gpio);
+	}
+
+	mutex_init(&s->lock);
+	sensor_cache_init(s);
+
+	/* Before the regmap: its volatile_reg callback finds us from here. */
+	v4l2_i2c_subdev_init(&s->sd, client, &sensor_subdev_ops);
+	s->sd.flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
+	s->sd.dev = dev;
+	s->pad.flags = MEDIA_PAD_FL_SOURCE;
+
+	s->regmap = devm_regmap_init_i2c(client, &config);
+	if (IS_ERR(s->regmap)) {
+		dev_err(dev, "regmap init failed\n");
+		return PTR_ERR(s->regmap);
+	}
+
+	/* Two bytes of each transfer are the register address. */
+	quirks = client->adapter->quirks;
+	if (quirks && quirks->max_write_len)
+		s->max_burst = quirks->max_write_len - 2;
+
+	return 0;
+}
+
+/*
+ * Power up just long enough to read the chip ID, pick the variant and
+ * load its register firmware. The active format defaults to the mode
+ * set_fmt picks for @width x @height.
+ */
+static inline int sensor_identify(struct sensor *s, u32 width, u32 height)
+{
+	const struct sensor_desc *desc = s->desc;
+	struct v4l2_subdev_format fmt = {
+		.which = V4L2_SUBDEV_FORMAT_ACTIVE,
+		.format = { .width = width, .height = height },
+	};
+	u8 id_high, id_low;
+	unsigned int i;
+	int ret;
+
+	mutex_lock(&s->lock);
+	ret = sensor_power_up(s);
+	if (ret < 0) {
+		mutex_unlock(&s->lock);
+		dev_err(s->dev, "could not power up sensor\n");
+		return ret;
+	}
+
+	ret = sensor_read_reg(s, desc->chip_id_reg, &id_high);
+	if (ret >= 0)
+		ret = sensor_read_reg(s, desc->chip_id_reg + 1, &id_low);
+
+	sensor_power_down(s);
+	mutex_unlock(&s->lock);
+
+	if (ret < 0) {
+		dev_err(s->dev, "could not read chip ID\n");
+		return -ENODEV;
+	}
+
+	for (i = 0; i < desc->num_variants; i++)
+		if (desc->variants[i].chip_id == (id_high << 8 | id_low))
+			break;
+
+	if (i == desc->num_variants) {
+		dev_err(s->dev, "unknown chip ID 0x%02x%02x\n",
+			id_high, id_low);
+		return -ENODEV;
+	}
+
+	s->variant = &desc->variants[i];
+	dev_info(s->dev, "%s detected at address 0x%02x\n",
+		 s->variant->name, s->i2c_client->addr);
+
+	if (s->variant->firmware)
+		regfw_load(s->dev, &s->regfw, s->variant->firmware,
+			   s->variant->chip_id);
+
+	sensor_set_format(&s->sd, NULL, &fmt);
+
+	return 0;
+}
+
+/* Once the driver has added its controls: make the subdev available. */
+static inline int sensor_register(struct sensor *s)
+{
+	int ret;
+
+	/*
+	 * One lock for registers and controls: s_ctrl runs under it, and
+	 * set_fmt can move control ranges along with the mode.
+	 */
+	s->ctrls.lock = &s->lock;
+	s->sd.ctrl_handler = &s->ctrls;
+	if (s->ctrls.error) {
+		dev_err(s->dev, "control initialization error %d\n",
+			s->ctrls.error);
+		return s->ctrls.error;
+	}
+
+	ret = media_entity_init(&s->sd.entity, 1, &s->pad, 0);
+	if (ret < 0) {
+		dev_err(s->dev, "could not register media entity\n");
+		return ret;
+	}
+
+	pm_runtime_set_suspended(s->dev);
+	pm_runtime_set_autosuspend_delay(s->dev, SENSOR_AUTOSUSPEND_MS);
+	pm_runtime_use_autosuspend(s->dev);
+	pm_runtime_enable(s->dev);
+
+	ret = v4l2_async_register_subdev(&s->sd);
+	if (ret < 0) {
+		dev_err(s->dev, "could not register v4l2 device\n");
+		pm_runtime_disable(s->dev);
+		pm_runtime_dont_use_autosuspend(s->dev);
+		media_entity_cleanup(&s->sd.entity);
+		return ret;
+	}
+
+	return 0;
+}
+
+static inline void sensor_unregister(struct sensor *s)
+{
+	v4l2_async_unregister_subdev(&s->sd);
+
+	pm_runtime_disable(s->dev);
+	pm_runtime_dont_use_autosuspend(s->dev);
+	mutex_lock(&s->lock);
+	if (s->power)
+		sensor_stop(s);
+	mutex_unlock(&s->lock);
+	pm_runtime_set_suspended(s->dev);
+
+	media_entity_cleanup(&s->sd.entity);
+}
+
+/* Undo sensor_probe() and sensor_identify(), and free the controls. */
+static inline void sensor_release(struct sensor *s)
+{
+	v4l2_ctrl_handler_free(&s->ctrls);
+	regfw_release(&s->regfw);
+	mutex_destroy(&s->lock);
+}
+
+#endif /* SENSOR_CORE_SENSOR_CORE_H */
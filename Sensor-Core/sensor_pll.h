@@ -0,0 +1,106 @@
+/*
+ * PLL solver for the sensors' MIPI clocks.
+ *
+ * The sensors' clock trees come down to the same chain: XCLK through a
+ * pre-divider into the VCO, times the multiplier, and a system divider
+ * from the VCO to the bit rate of each CSI-2 lane:
+ *
+ *	lane_rate = xclk / prediv * mult / sysdiv
+ *
+ * sensor_pll_solve() picks the lowest lane rate at or above the one asked
+ * for that the driver's limits allow, the lower VCO frequency on a tie.
+ * Some PLLs only divide the VCO by powers of two (@sysdiv_pow2) or take a
+ * limited range of reference frequencies after the pre-divider.
+ * The search is exhaustive but small: each pre-divider and system divider
+ * pair with the one multiplier that lands just above the target.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef SENSOR_CORE_SENSOR_PLL_H
+#define SENSOR_CORE_SENSOR_PLL_H
+
+#ifdef __KERNEL__
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#else
+#include "sensor_host.h"
+#endif
+
+struct sensor_pll_limits {
+	u32 prediv_min;
+	u32 prediv_max;
+	u32 mult_min;
+	u32 mult_max;
+	u32 sysdiv_min;
+	u32 sysdiv_max;
+	bool sysdiv_pow2;	/* sysdiv_min, twice that, ... */
+	u32 ref_min;		/* Hz after the pre-divider, 0: any */
+	u32 ref_max;
+	u64 vco_min;		/* Hz */
+	u64 vco_max;
+	u64 lane_max;		/* bit/s */
+};
+
+struct sensor_pll {
+	u32 prediv;
+	u32 mult;
+	u32 sysdiv;
+	u64 lane_rate;		/* bit/s, 0: no setting */
+	u64 pixel_rate;		/* pixel/s */
+};
+
+static inline int sensor_pll_solve(const struct sensor_pll_limits *lim,
+				   u32 xclk, u64 min_rate,
+				   struct sensor_pll *pll)
+{
+	u64 mult, vco, rate, best_vco = 0;
+	u32 prediv, sysdiv, ref;
+
+	memset(pll, 0, sizeof(*pll));
+	if (!xclk || !lim->sysdiv_min)
+		return -EINVAL;
+
+	for (prediv = lim->prediv_min; prediv <= lim->prediv_max; prediv++) {
+		ref = xclk / prediv;
+		if (ref < lim->ref_min || (lim->ref_max && ref > lim->ref_max))
+			continue;
+
+		for (sysdiv = lim->sysdiv_min; sysdiv <= lim->sysdiv_max;
+		     sysdiv = lim->sysdiv_pow2 ? sysdiv * 2 : sysdiv + 1) {
+			/* The smallest multiplier reaching both minimums. */
+			mult = max(div64_u64(min_rate * prediv * sysdiv +
+					     xclk - 1, xclk),
+				   div64_u64(lim->vco_min * prediv + xclk - 1,
+					     xclk));
+			mult = max_t(u64, mult, lim->mult_min);
+			if (mult > lim->mult_max)
+				continue;
+
+			vco = div_u64(xclk * mult, prediv);
+			rate = div_u64(vco, sysdiv);
+			if (vco > lim->vco_max || rate > lim->lane_max)
+				continue;
+
+			if (pll->lane_rate && (rate > pll->lane_rate ||
+			    (rate == pll->lane_rate && vco >= best_vco)))
+				continue;
+
+			pll->prediv = prediv;
+			pll->mult = mult;
+			pll->sysdiv = sysdiv;
+			pll->lane_rate = rate;
+			best_vco = vco;
+		}
+	}
+
+	return pll->lane_rate ? 0 : -ERANGE;
+}
+
+#endif /* SENSOR_CORE_SENSOR_PLL_H */
@@ -0,0 +1,928 @@
+/*
+ * Driver for the Toshiba TC358746/TC358748 parallel to MIPI CSI-2 bridge.
+ *
+ * The AISTAR MIPI bridge board puts the adapter's parallel sensors
+ * (MT9V024, MT9M034, MT9M031, AR0130, AR0134) behind this chip. The bridge
+ * is a subdev between the sensor's own subdev and the CSI-2 receiver: pad 0
+ * takes the parallel bus, pad 1 sends the same frames out on CSI-2. Once
+ * the bridge is registered it binds the sensor its parallel endpoint points
+ * to and links it to pad 0; the sensor's formats and controls stay with
+ * the sensor driver. CAMSS starts the subdevs upstream of the CSI receiver
+ * one after the other, so the bridge is running before the sensor is.
+ *
+ * Nothing about the bridge's clocks is fixed in a table. At stream start
+ * the PLL, the CSI-2 timing and the FIFO level are worked out from the
+ * format on pad 0, the sensor's V4L2_CID_PIXEL_RATE, REFCLK and the number
+ * of CSI-2 lanes (tc358746_config.h):
+ *
+ * - the link runs at the lowest lane rate (Sensor-Core/sensor_pll.h) that
+ *   carries TC358746_LINK_MARGIN times the parallel bit rate, so a line
+ *   leaves the FIFO faster than it comes in;
+ * - CSI-2 transmission of a line starts once the FIFO holds the part of
+ *   the line the faster side would otherwise catch up with, so the FIFO
+ *   never runs dry mid-line. From then on it only drains: that level plus
+ *   what arrives during the HS start-up is the most it ever holds, and is
+ *   checked against the FIFO size.
+ *
+ * The resulting CSI-2 pixel rate is the bridge's own V4L2_CID_PIXEL_RATE,
+ * which the CSI receiver reads to time its PHY.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/bitops.h>
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/gpio/consumer.h>
+#include <linux/i2c.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/of_graph.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/workqueue.h>
+#include <media/v4l2-async.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-of.h>
+#include <media/v4l2-subdev.h>
+
+#include "tc358746_config.h"
+
+/* 16-bit registers; the CSI-2 ones are 32 bits wide, low half first. */
+#define TC358746_CHIPID			0x0000
+#define		TC358746_CHIPID_MASK		0xff00
+#define		TC358746_CHIPID_VAL		0x4400
+#define TC358746_SYSCTL			0x0002
+#define		TC358746_SRESET			BIT(0)
+#define TC358746_CONFCTL		0x0004
+#define		TC358746_PDATAF(x)		((x) << 8)
+#define		TC358746_PPEN			BIT(6)
+#define		TC358746_AUTO_INCR		BIT(2)
+#define		TC358746_DATALANE(n)		((n) - 1)
+#define TC358746_FIFOCTL		0x0006	/* level, 16-bit words */
+#define TC358746_DATAFMT		0x0008
+#define		TC358746_PDFMT(x)		((x) << 4)
+#define TC358746_PLLCTL0		0x0016
+#define		TC358746_PLL_PRD(x)		(((x) - 1) << 12)
+#define		TC358746_PLL_FBD(x)		((x) - 1)
+#define TC358746_PLLCTL1		0x0018
+#define		TC358746_PLL_FRS(x)		((x) << 10)
+#define		TC358746_PLL_LBWS_50		(2 << 8)
+#define		TC358746_PLL_LFBREN		BIT(6)
+#define		TC358746_PLL_CKEN		BIT(4)
+#define		TC358746_PLL_RESETB		BIT(1)
+#define		TC358746_PLL_EN			BIT(0)
+#define TC358746_CLKCTL			0x0020
+#define		TC358746_PPICLKDIV(x)		((x) << 4)
+#define		TC358746_SCLKDIV(x)		(x)
+#define TC358746_WORDCNT		0x0022	/* bytes per line */
+#define TC358746_PP_MISC		0x0032
+#define		TC358746_FRMSTOP		BIT(15)
+#define		TC358746_RSTPTR			BIT(14)
+#define TC358746_CLW_CNTRL		0x0140
+#define TC358746_DNW_CNTRL(n)		(0x0144 + 4 * (n))
+#define TC358746_STARTCNTRL		0x0204
+#define		TC358746_START			BIT(0)
+#define TC358746_LINEINITCNT		0x0210
+#define TC358746_LPTXTIMECNT		0x0214
+#define TC358746_TCLK_HEADERCNT		0x0218	/* zero << 8 | prepare */
+#define TC358746_TCLK_TRAILCNT		0x021c
+#define TC358746_THS_HEADERCNT		0x0220	/* zero << 8 | prepare */
+#define TC358746_TWAKEUP		0x0224
+#define TC358746_TCLK_POSTCNT		0x0228
+#define TC358746_THS_TRAILCNT		0x022c
+#define TC358746_HSTXVREGCNT		0x0230
+#define TC358746_HSTXVREGEN		0x0234	/* clock lane, then data */
+#define TC358746_TXOPTIONCNTRL		0x0238
+#define		TC358746_CONTCLKMODE		BIT(0)
+#define TC358746_CSI_CONTROL		0x040c
+#define		TC358746_CSI_MODE		BIT(15)
+#define		TC358746_TXHSMD			BIT(7)
+#define		TC358746_NOL(n)			(((n) - 1) << 1)
+#define TC358746_CSI_CONFW		0x0500
+#define		TC358746_CONFW_SET		(5 << 29)
+#define		TC358746_CONFW_CSI_CONTROL	(3 << 24)
+#define TC358746_CSI_START		0x0518
+#define		TC358746_STRT			BIT(0)
+#define TC358746_MAX_REGISTER		0x051a
+
+#define TC358746_MAX_WIDTH		4095
+#define TC358746_MAX_HEIGHT		4095
+
+/* At most one frame of a sensor running at 20 fps or more. */
+#define TC358746_STOP_MS		50
+
+enum {
+	TC358746_PAD_SINK,
+	TC358746_PAD_SOURCE,
+	TC358746_NUM_PADS,
+};
+
+struct tc358746 {
+	struct i2c_client *i2c_client;
+	struct device *dev;
+	struct regmap *regmap;
+	struct v4l2_subdev sd;
+	struct media_pad pads[TC358746_NUM_PADS];
+	struct v4l2_mbus_framefmt fmt;	/* both pads */
+	struct clk *refclk;
+	u32 refclk_freq;
+	struct gpio_desc *rst_gpio;
+	unsigned int lanes;
+	bool cont_clock;
+
+	struct device_node *sensor_node;
+	struct v4l2_async_subdev asd;
+	struct v4l2_async_subdev *asds[1];
+	struct v4l2_async_notifier notifier;
+	struct work_struct notify_work;
+	bool notifier_registered;
+	struct v4l2_subdev *sensor;
+
+	struct v4l2_ctrl_handler ctrls;
+	struct v4l2_ctrl *pixel_rate;
+
+	struct mutex lock;	/* power state and register access */
+	unsigned int users;
+};
+
+static inline struct tc358746 *to_tc358746(struct v4l2_subdev *sd)
+{
+	return container_of(sd, struct tc358746, sd);
+}
+
+static int tc358746_write(struct tc358746 *t, u16 reg, u16 val)
+{
+	int ret;
+
+	ret = regmap_write(t->regmap, reg, val);
+	if (ret < 0)
+		dev_err(t->dev, "write error %d: reg=0x%04x\n", ret, reg);
+
+	return ret;
+}
+
+static int tc358746_write32(struct tc358746 *t, u16 reg, u32 val)
+{
+	u16 buf[2] = { val & 0xffff, val >> 16 };
+	int ret;
+
+	ret = regmap_bulk_write(t->regmap, reg, buf, ARRAY_SIZE(buf));
+	if (ret < 0)
+		dev_err(t->dev, "write error %d: reg=0x%04x\n", ret, reg);
+
+	return ret;
+}
+
+/*
+ * Work out the bridge settings for the format on pad 0 and the pixel rate
+ * the sensor reports. Called with the lock held.
+ */
+static int tc358746_configure(struct tc358746 *t, struct tc358746_config *cfg)
+{
+	struct v4l2_ctrl *ctrl;
+	u64 pixel_rate;
+	int ret;
+
+	if (!t->sensor) {
+		dev_err(t->dev, "no sensor bound\n");
+		return -ENODEV;
+	}
+
+	ctrl = v4l2_ctrl_find(t->sensor->ctrl_handler, V4L2_CID_PIXEL_RATE);
+	if (!ctrl) {
+		dev_err(t->dev, "%s has no pixel rate control\n",
+			t->sensor->name);
+		return -EINVAL;
+	}
+	pixel_rate = v4l2_ctrl_g_ctrl_int64(ctrl);
+
+	ret = tc358746_solve(t->fmt.code, t->fmt.width, pixel_rate,
+			     t->refclk_freq, t->lanes, cfg);
+	if (ret == -ERANGE)
+		dev_err(t->dev, "no PLL setting for %llu pixel/s on %u lanes\n",
+			pixel_rate, t->lanes);
+	else if (ret == -EOVERFLOW)
+		dev_err(t->dev, "line of %u pixels overflows the FIFO\n",
+			t->fmt.width);
+
+	return ret;
+}
+
+static u32 tc358746_ps_to_cnt(u64 ps, u64 period_ps)
+{
+	return DIV_ROUND_UP_ULL(ps, period_ps);
+}
+
+/*
+ * D-PHY timing, counted in HS byte clocks: the middle of the spec's range
+ * where it has one, the minimum plus a margin elsewhere.
+ */
+static int tc358746_set_dphy(struct tc358746 *t,
+			     const struct tc358746_config *cfg)
+{
+	u64 ui = div64_u64(1000000000000ULL, cfg->pll.lane_rate);
+	u64 byte = 8 * ui;
+	u32 lptx, clk_prepare, clk_zero, hs_prepare, hs_zero;
+	int ret;
+
+	lptx = tc358746_ps_to_cnt(50000, byte);
+	clk_prepare = tc358746_ps_to_cnt(60000, byte);
+	clk_zero = tc358746_ps_to_cnt(300000, byte) - clk_prepare;
+	hs_prepare = tc358746_ps_to_cnt(60000 + 5 * ui, byte);
+	hs_zero = tc358746_ps_to_cnt(145000 + 10 * ui, byte) - hs_prepare;
+
+	ret = tc358746_write32(t, TC358746_LINEINITCNT,
+			       tc358746_ps_to_cnt(100000000, byte));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_LPTXTIMECNT, lptx - 1);
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_TCLK_HEADERCNT,
+				       min(clk_zero, 0xffU) << 8 |
+				       min(clk_prepare, 0x7fU));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_TCLK_TRAILCNT,
+				       tc358746_ps_to_cnt(70000, byte));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_THS_HEADERCNT,
+				       min(hs_zero, 0x7fU) << 8 |
+				       min(hs_prepare, 0x7fU));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_TWAKEUP,
+				       tc358746_ps_to_cnt(1000000000,
+							  lptx * byte));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_TCLK_POSTCNT,
+				       tc358746_ps_to_cnt(70000 + 52 * ui,
+							  byte));
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_THS_TRAILCNT,
+				       tc358746_ps_to_cnt(max(8 * ui,
+							      70000 + 4 * ui),
+							  byte));
+	/* The regulator settling count from the datasheet's examples. */
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_HSTXVREGCNT, 5);
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_HSTXVREGEN,
+				       GENMASK(t->lanes, 0));
+	if (!ret && t->cont_clock)
+		ret = tc358746_write32(t, TC358746_TXOPTIONCNTRL,
+				       TC358746_CONTCLKMODE);
+
+	return ret;
+}
+
+static int tc358746_start(struct tc358746 *t)
+{
+	struct tc358746_config cfg;
+	unsigned int i;
+	u16 confctl;
+	int ret;
+
+	ret = tc358746_configure(t, &cfg);
+	if (ret < 0)
+		return ret;
+
+	dev_dbg(t->dev, "%llu bit/s per lane, FIFO level %u\n",
+		cfg.pll.lane_rate, cfg.fifo_level);
+
+	/* A soft reset leaves the PLL off and the CSI-2 side idle. */
+	ret = tc358746_write(t, TC358746_SYSCTL, TC358746_SRESET);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_SYSCTL, 0);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_PLLCTL0,
+				     TC358746_PLL_PRD(cfg.pll.prediv) |
+				     TC358746_PLL_FBD(cfg.pll.mult));
+	if (!ret)
+		ret = tc358746_write(t, TC358746_PLLCTL1,
+				     TC358746_PLL_FRS(ilog2(cfg.pll.sysdiv)) |
+				     TC358746_PLL_LBWS_50 |
+				     TC358746_PLL_LFBREN |
+				     TC358746_PLL_RESETB | TC358746_PLL_EN);
+	if (ret < 0)
+		return ret;
+
+	usleep_range(1000, 2000);
+
+	ret = regmap_update_bits(t->regmap, TC358746_PLLCTL1,
+				 TC358746_PLL_CKEN, TC358746_PLL_CKEN);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_CLKCTL,
+				     TC358746_PPICLKDIV(cfg.clkdiv) |
+				     TC358746_SCLKDIV(cfg.clkdiv));
+	if (!ret)
+		ret = tc358746_write(t, TC358746_FIFOCTL, cfg.fifo_level);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_DATAFMT,
+				     TC358746_PDFMT(cfg.fmt->pdformat));
+	if (!ret)
+		ret = tc358746_write(t, TC358746_WORDCNT, cfg.word_count);
+
+	confctl = TC358746_PDATAF(0) | TC358746_AUTO_INCR |
+		  TC358746_DATALANE(t->lanes);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_CONFCTL, confctl);
+
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_CLW_CNTRL, 0);
+	for (i = 0; i < t->lanes && !ret; i++)
+		ret = tc358746_write32(t, TC358746_DNW_CNTRL(i), 0);
+	if (!ret)
+		ret = tc358746_set_dphy(t, &cfg);
+
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_STARTCNTRL, TC358746_START);
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_CSI_START, TC358746_STRT);
+	if (!ret)
+		ret = tc358746_write32(t, TC358746_CSI_CONFW,
+				       TC358746_CONFW_SET |
+				       TC358746_CONFW_CSI_CONTROL |
+				       TC358746_CSI_MODE | TC358746_TXHSMD |
+				       TC358746_NOL(t->lanes));
+
+	/* Last: from here on the FIFO fills from the parallel bus. */
+	if (!ret)
+		ret = tc358746_write(t, TC358746_CONFCTL,
+				     confctl | TC358746_PPEN);
+
+	return ret;
+}
+
+static int tc358746_stop(struct tc358746 *t)
+{
+	int ret;
+
+	ret = regmap_update_bits(t->regmap, TC358746_CONFCTL,
+				 TC358746_PPEN, 0);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_PP_MISC, TC358746_FRMSTOP);
+	if (ret < 0)
+		return ret;
+
+	/* Let the frame in flight leave the FIFO. */
+	msleep(TC358746_STOP_MS);
+
+	ret = tc358746_write(t, TC358746_PP_MISC, TC358746_RSTPTR);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_SYSCTL, TC358746_SRESET);
+	if (!ret)
+		ret = tc358746_write(t, TC358746_SYSCTL, 0);
+
+	return ret;
+}
+
+static int tc358746_s_stream(struct v4l2_subdev *sd, int enable)
+{
+	struct tc358746 *t = to_tc358746(sd);
+	int ret;
+
+	mutex_lock(&t->lock);
+	if (!t->users) {
+		mutex_unlock(&t->lock);
+		return -EIO;
+	}
+
+	ret = enable ? tc358746_start(t) : tc358746_stop(t);
+	mutex_unlock(&t->lock);
+
+	return ret;
+}
+
+static int tc358746_power_on(struct tc358746 *t)
+{
+	int ret;
+
+	clk_set_rate(t->refclk, t->refclk_freq);
+
+	ret = clk_prepare_enable(t->refclk);
+	if (ret < 0) {
+		dev_err(t->dev, "clk prepare enable failed\n");
+		return ret;
+	}
+
+	usleep_range(1000, 2000);
+	gpiod_set_value_cansleep(t->rst_gpio, 0);
+	usleep_range(1000, 2000);
+
+	return 0;
+}
+
+static void tc358746_power_off(struct tc358746 *t)
+{
+	gpiod_set_value_cansleep(t->rst_gpio, 1);
+	clk_disable_unprepare(t->refclk);
+}
+
+static int tc358746_s_power(struct v4l2_subdev *sd, int on)
+{
+	struct tc358746 *t = to_tc358746(sd);
+	int ret = 0;
+
+	mutex_lock(&t->lock);
+	if (on && !t->users++) {
+		ret = tc358746_power_on(t);
+		if (ret < 0)
+			t->users--;
+	} else if (!on && t->users && !--t->users) {
+		tc358746_power_off(t);
+	}
+	mutex_unlock(&t->lock);
+
+	return ret;
+}
+
+/* The receiver times its PHY by this, before the bridge starts. */
+static int tc358746_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct tc358746 *t = container_of(ctrl->handler, struct tc358746,
+					  ctrls);
+	struct tc358746_config cfg;
+	int ret;
+
+	if (ctrl->id != V4L2_CID_PIXEL_RATE)
+		return -EINVAL;
+
+	mutex_lock(&t->lock);
+	ret = tc358746_configure(t, &cfg);
+	mutex_unlock(&t->lock);
+	if (ret < 0)
+		return ret;
+
+	*ctrl->p_new.p_s64 = cfg.pll.pixel_rate;
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops tc358746_ctrl_ops = {
+	.g_volatile_ctrl = tc358746_g_volatile_ctrl,
+};
+
+static struct v4l2_mbus_framefmt *
+tc358746_pad_format(struct tc358746 *t, struct v4l2_subdev_pad_config *cfg,
+		    unsigned int pad, enum v4l2_subdev_format_whence which)
+{
+	if (which == V4L2_SUBDEV_FORMAT_TRY)
+		return v4l2_subdev_get_try_format(&t->sd, cfg, pad);
+
+	return &t->fmt;
+}
+
+static int tc358746_enum_mbus_code(struct v4l2_subdev *sd,
+				   struct v4l2_subdev_pad_config *cfg,
+				   struct v4l2_subdev_mbus_code_enum *code)
+{
+	struct tc358746 *t = to_tc358746(sd);
+
+	/* The source pad sends what the sink pad takes. */
+	if (code->pad == TC358746_PAD_SOURCE) {
+		if (code->index > 0)
+			return -EINVAL;
+		code->code = tc358746_pad_format(t, cfg, TC358746_PAD_SINK,
+						 code->which)->code;
+		return 0;
+	}
+
+	if (code->index >= ARRAY_SIZE(tc358746_formats))
+		return -EINVAL;
+
+	code->code = tc358746_formats[code->index].code;
+
+	return 0;
+}
+
+static int tc358746_get_format(struct v4l2_subdev *sd,
+			       struct v4l2_subdev_pad_config *cfg,
+			       struct v4l2_subdev_format *format)
+{
+	struct tc358746 *t = to_tc358746(sd);
+
+	mutex_lock(&t->lock);
+	format->format = *tc358746_pad_format(t, cfg, TC358746_PAD_SINK,
+					      format->which);
+	mutex_unlock(&t->lock);
+
+	return 0;
+}
+
+static int tc358746_set_format(struct v4l2_subdev *sd,
+			       struct v4l2_subdev_pad_config *cfg,
+			       struct v4l2_subdev_format *format)
+{
+	struct tc358746 *t = to_tc358746(sd);
+	struct v4l2_mbus_framefmt *__format;
+
+	mutex_lock(&t->lock);
+	__format = tc358746_pad_format(t, cfg, TC358746_PAD_SINK,
+				       format->which);
+
+	if (format->pad == TC358746_PAD_SINK) {
+		if (!tc358746_find_format(format->format.code))
+			format->format.code = tc358746_formats[0].code;
+
+		__format->code = format->format.code;
+		__format->width = clamp_t(u32, format->format.width, 1,
+					  TC358746_MAX_WIDTH);
+		__format->height = clamp_t(u32, format->format.height, 1,
+					   TC358746_MAX_HEIGHT);
+		__format->field = V4L2_FIELD_NONE;
+		__format->colorspace = format->format.colorspace;
+	}
+
+	format->format = *__format;
+	mutex_unlock(&t->lock);
+
+	return 0;
+}
+
+static const struct v4l2_subdev_core_ops tc358746_core_ops = {
+	.s_power = tc358746_s_power,
+};
+
+static const struct v4l2_subdev_video_ops tc358746_video_ops = {
+	.s_stream = tc358746_s_stream,
+};
+
+static const struct v4l2_subdev_pad_ops tc358746_pad_ops = {
+	.enum_mbus_code = tc358746_enum_mbus_code,
+	.get_fmt = tc358746_get_format,
+	.set_fmt = tc358746_set_format,
+	.link_validate = v4l2_subdev_link_validate_default,
+};
+
+static const struct v4l2_subdev_ops tc358746_subdev_ops = {
+	.core = &tc358746_core_ops,
+	.video = &tc358746_video_ops,
+	.pad = &tc358746_pad_ops,
+};
+
+static const struct media_entity_operations tc358746_entity_ops = {
+	.link_validate = v4l2_subdev_link_validate,
+};
+
+static int tc358746_notify_bound(struct v4l2_async_notifier *notifier,
+				 struct v4l2_subdev *subdev,
+				 struct v4l2_async_subdev *asd)
+{
+	struct tc358746 *t = container_of(notifier, struct tc358746,
+					  notifier);
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < subdev->entity.num_pads; i++)
+		if (subdev->entity.pads[i].flags & MEDIA_PAD_FL_SOURCE)
+			break;
+
+	if (i == subdev->entity.num_pads) {
+		dev_err(t->dev, "%s has no source pad\n", subdev->name);
+		return -EINVAL;
+	}
+
+	ret = media_entity_create_link(&subdev->entity, i, &t->sd.entity,
+				       TC358746_PAD_SINK,
+				       MEDIA_LNK_FL_ENABLED |
+				       MEDIA_LNK_FL_IMMUTABLE);
+	if (ret < 0) {
+		dev_err(t->dev, "could not link %s\n", subdev->name);
+		return ret;
+	}
+
+	mutex_lock(&t->lock);
+	t->sensor = subdev;
+	mutex_unlock(&t->lock);
+
+	dev_info(t->dev, "bound %s\n", subdev->name);
+
+	return 0;
+}
+
+static void tc358746_notify_unbind(struct v4l2_async_notifier *notifier,
+				   struct v4l2_subdev *subdev,
+				   struct v4l2_async_subdev *asd)
+{
+	struct tc358746 *t = container_of(notifier, struct tc358746,
+					  notifier);
+
+	mutex_lock(&t->lock);
+	t->sensor = NULL;
+	mutex_unlock(&t->lock);
+}
+
+/* The receiver's notifier created its device nodes before ours bound. */
+static int tc358746_notify_complete(struct v4l2_async_notifier *notifier)
+{
+	return v4l2_device_register_subdev_nodes(notifier->v4l2_dev);
+}
+
+/*
+ * Registering a notifier takes the async list lock, which is held while
+ * the bridge itself is being registered: do it from a work item.
+ */
+static void tc358746_notify_register(struct work_struct *work)
+{
+	struct tc358746 *t = container_of(work, struct tc358746, notify_work);
+	int ret;
+
+	/* The receiver rebinding the bridge keeps the first notifier. */
+	if (t->notifier_registered)
+		return;
+
+	t->asd.match_type = V4L2_ASYNC_MATCH_OF;
+	t->asd.match.of.node = t->sensor_node;
+	t->asds[0] = &t->asd;
+	t->notifier.subdevs = t->asds;
+	t->notifier.num_subdevs = ARRAY_SIZE(t->asds);
+	t->notifier.bound = tc358746_notify_bound;
+	t->notifier.unbind = tc358746_notify_unbind;
+	t->notifier.complete = tc358746_notify_complete;
+
+	ret = v4l2_async_notifier_register(t->sd.v4l2_dev, &t->notifier);
+	if (ret < 0) {
+		dev_err(t->dev, "could not register sensor notifier\n");
+		return;
+	}
+
+	t->notifier_registered = true;
+}
+
+static int tc358746_registered(struct v4l2_subdev *sd)
+{
+	struct tc358746 *t = to_tc358746(sd);
+
+	schedule_work(&t->notify_work);
+
+	return 0;
+}
+
+/*
+ * No .unregistered: it runs under the async list lock (from our own
+ * v4l2_async_unregister_subdev() or the receiver's notifier teardown),
+ * where unregistering the sensor notifier or waiting for the work, which
+ * may itself wait for that lock, would deadlock. tc358746_remove() does
+ * both first. Until then a receiver going away leaves the sensor bound to
+ * the notifier, and unregistering it later skips the sensor's subdev,
+ * which v4l2_device_unregister() already took off the device.
+ */
+static const struct v4l2_subdev_internal_ops tc358746_internal_ops = {
+	.registered = tc358746_registered,
+};
+
+/* Port 0: the parallel sensor. Port 1: the CSI-2 receiver. */
+static int tc358746_parse_dt(struct tc358746 *t)
+{
+	struct device_node *endpoint, *remote;
+	struct v4l2_of_endpoint ep;
+	int ret;
+
+	endpoint = of_graph_get_next_endpoint(t->dev->of_node, NULL);
+	while (endpoint) {
+		ret = v4l2_of_parse_endpoint(endpoint, &ep);
+		if (ret < 0) {
+			dev_err(t->dev, "parsing endpoint node failed\n");
+			of_node_put(endpoint);
+			return ret;
+		}
+
+		if (ep.base.port == TC358746_PAD_SINK) {
+			remote = of_graph_get_remote_port_parent(endpoint);
+			of_node_put(t->sensor_node);
+			t->sensor_node = remote;
+		} else if (ep.base.port == TC358746_PAD_SOURCE) {
+			if (ep.bus_type != V4L2_MBUS_CSI2) {
+				dev_err(t->dev, "port 1 must be CSI2\n");
+				of_node_put(endpoint);
+				return -EINVAL;
+			}
+			t->lanes = ep.bus.mipi_csi2.num_data_lanes;
+			t->cont_clock = !(ep.bus.mipi_csi2.flags &
+					  V4L2_MBUS_CSI2_NONCONTINUOUS_CLOCK);
+		}
+
+		endpoint = of_graph_get_next_endpoint(t->dev->of_node,
+						      endpoint);
+	}
+
+	if (!t->sensor_node) {
+		dev_err(t->dev, "no sensor on port 0\n");
+		return -EINVAL;
+	}
+
+	if (!t->lanes || t->lanes > TC358746_MAX_LANES) {
+		dev_err(t->dev, "port 1 needs 1 to %u data lanes\n",
+			TC358746_MAX_LANES);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int tc358746_identify(struct tc358746 *t)
+{
+	unsigned int id;
+	int ret;
+
+	mutex_lock(&t->lock);
+	ret = tc358746_power_on(t);
+	if (ret < 0) {
+		mutex_unlock(&t->lock);
+		return ret;
+	}
+
+	ret = regmap_read(t->regmap, TC358746_CHIPID, &id);
+	tc358746_power_off(t);
+	mutex_unlock(&t->lock);
+
+	if (ret < 0) {
+		dev_err(t->dev, "could not read chip ID\n");
+		return -ENODEV;
+	}
+
+	if ((id & TC358746_CHIPID_MASK) != TC358746_CHIPID_VAL) {
+		dev_err(t->dev, "unknown chip ID 0x%04x\n", id);
+		return -ENODEV;
+	}
+
+	dev_info(t->dev, "TC358746 rev 0x%02x detected at address 0x%02x\n",
+		 id & 0xff, t->i2c_client->addr);
+
+	return 0;
+}
+
+static const struct regmap_config tc358746_regmap_config = {
+	.reg_bits = 16,
+	.val_bits = 16,
+	.reg_stride = 2,
+	.max_register = TC358746_MAX_REGISTER,
+	.cache_type = REGCACHE_NONE,
+};
+
+static int tc358746_probe(struct i2c_client *client,
+			  const struct i2c_device_id *id)
+{
+	struct device *dev = &client->dev;
+	struct tc358746 *t;
+	int ret;
+
+	t = devm_kzalloc(dev, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	t->i2c_client = client;
+	t->dev = dev;
+	mutex_init(&t->lock);
+	INIT_WORK(&t->notify_work, tc358746_notify_register);
+
+	ret = tc358746_parse_dt(t);
+	if (ret < 0)
+		goto err_node;
+
+	t->refclk = devm_clk_get(dev, "refclk");
+	if (IS_ERR(t->refclk)) {
+		dev_err(dev, "could not get refclk\n");
+		ret = PTR_ERR(t->refclk);
+		goto err_node;
+	}
+
+	ret = of_property_read_u32(dev->of_node, "clock-frequency",
+				   &t->refclk_freq);
+	if (ret) {
+		dev_err(dev, "could not get refclk frequency\n");
+		goto err_node;
+	}
+
+	t->rst_gpio = devm_gpiod_get(dev, "reset", GPIOD_OUT_HIGH);
+	if (IS_ERR(t->rst_gpio)) {
+		dev_err(dev, "cannot get reset gpio\n");
+		ret = PTR_ERR(t->rst_gpio);
+		goto err_node;
+	}
+
+	t->regmap = devm_regmap_init_i2c(client, &tc358746_regmap_config);
+	if (IS_ERR(t->regmap)) {
+		dev_err(dev, "regmap init failed\n");
+		ret = PTR_ERR(t->regmap);
+		goto err_node;
+	}
+
+	ret = tc358746_identify(t);
+	if (ret < 0)
+		goto err_node;
+
+	v4l2_i2c_subdev_init(&t->sd, client, &tc358746_subdev_ops);
+	t->sd.flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
+	t->sd.internal_ops = &tc358746_internal_ops;
+	t->sd.dev = dev;
+	t->sd.entity.ops = &tc358746_entity_ops;
+
+	t->fmt.code = tc358746_formats[0].code;
+	t->fmt.width = 752;
+	t->fmt.height = 480;
+	t->fmt.field = V4L2_FIELD_NONE;
+	t->fmt.colorspace = V4L2_COLORSPACE_SRGB;
+
+	v4l2_ctrl_handler_init(&t->ctrls, 1);
+	t->pixel_rate = v4l2_ctrl_new_std(&t->ctrls, &tc358746_ctrl_ops,
+					  V4L2_CID_PIXEL_RATE, 1, INT_MAX, 1,
+					  1);
+	if (t->pixel_rate)
+		t->pixel_rate->flags |= V4L2_CTRL_FLAG_VOLATILE |
+					V4L2_CTRL_FLAG_READ_ONLY;
+	t->sd.ctrl_handler = &t->ctrls;
+	if (t->ctrls.error) {
+		dev_err(dev, "control initialization error %d\n",
+			t->ctrls.error);
+		ret = t->ctrls.error;
+		goto err_ctrls;
+	}
+
+	t->pads[TC358746_PAD_SINK].flags = MEDIA_PAD_FL_SINK;
+	t->pads[TC358746_PAD_SOURCE].flags = MEDIA_PAD_FL_SOURCE;
+	ret = media_entity_init(&t->sd.entity, TC358746_NUM_PADS, t->pads, 0);
+	if (ret < 0) {
+		dev_err(dev, "could not register media entity\n");
+		goto err_ctrls;
+	}
+
+	ret = v4l2_async_register_subdev(&t->sd);
+	if (ret < 0) {
+		dev_err(dev, "could not register v4l2 device\n");
+		goto err_entity;
+	}
+
+	return 0;
+
+err_entity:
+	media_entity_cleanup(&t->sd.entity);
+err_ctrls:
+	v4l2_ctrl_handler_free(&t->ctrls);
+err_node:
+	of_node_put(t->sensor_node);
+	mutex_destroy(&t->lock);
+
+	return ret;
+}
+
+static int tc358746_remove(struct i2c_client *client)
+{
+	struct v4l2_subdev *sd = i2c_get_clientdata(client);
+	struct tc358746 *t = to_tc358746(sd);
+
+	cancel_work_sync(&t->notify_work);
+	if (t->notifier_registered)
+		v4l2_async_notifier_unregister(&t->notifier);
+	v4l2_async_unregister_subdev(&t->sd);
+	media_entity_cleanup(&t->sd.entity);
+	v4l2_ctrl_handler_free(&t->ctrls);
+	of_node_put(t->sensor_node);
+
+	mutex_lock(&t->lock);
+	if (t->users)
+		tc358746_power_off(t);
+	mutex_unlock(&t->lock);
+	mutex_destroy(&t->lock);
+
+	return 0;
+}
+
+static const struct i2c_device_id tc358746_id[] = {
+	{ "tc358746", 0 },
+	{ "tc358748", 0 },
+	{}
+};
+MODULE_DEVICE_TABLE(i2c, tc358746_id);
+
+static const struct of_device_id tc358746_of_match[] = {
+	{ .compatible = "toshiba,tc358746" },
+	{ .compatible = "toshiba,tc358748" },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, tc358746_of_match);
+
+static struct i2c_driver tc358746_i2c_driver = {
+	.driver = {
+		.of_match_table = of_match_ptr(tc358746_of_match),
+		.name  = "tc358746",
+	},
+	.probe  = tc358746_probe,
+	.remove = tc358746_remove,
+	.id_table = tc358746_id,
+};
+
+module_i2c_driver(tc358746_i2c_driver);
+
+MODULE_DESCRIPTION("Toshiba TC358746/TC358748 parallel to CSI-2 bridge driver");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,264 @@
+/*
+ * tc358746_check - check the bridge settings tc358746.c would program
+ *
+ * Solves the AISTAR board's modes (MT9V024 752x480 at 60 fps in RAW10,
+ * MT9M034 720p in RAW12) on 1, 2 and 4 lanes and prints the settings, then
+ * sweeps the pixel rate for every format and lane count and checks each
+ * solution against the chip's limits independently of the solver: the PLL
+ * and PPI clock ranges, the 5/4 link margin and the FIFO. Cases without a
+ * solution must be beyond what the PLL can reach.
+ *
+ *	tc358746_check
+ *	tc358746_check -x 26000000 -W 1280 -p 74250000 -f y12
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tc358746_config.h"
+
+struct check_mode {
+	const char *name;
+	u32 code;
+	u32 width;
+	u64 pixel_rate;
+};
+
+static const struct check_mode modes[] = {
+	{ "752x480@60 RAW10", MEDIA_BUS_FMT_Y10_1X10, 752, 27000000 },
+	{ "1280x720@60 RAW12", MEDIA_BUS_FMT_SGRBG12_1X12, 1280, 74250000 },
+};
+
+static const struct {
+	const char *name;
+	u32 code;
+} format_names[] = {
+	{ "y8", MEDIA_BUS_FMT_Y8_1X8 },
+	{ "y10", MEDIA_BUS_FMT_Y10_1X10 },
+	{ "y12", MEDIA_BUS_FMT_Y12_1X12 },
+	{ "uyvy", MEDIA_BUS_FMT_UYVY8_2X8 },
+};
+
+static const unsigned int lane_counts[] = { 1, 2, 4 };
+
+/* Everything the driver relies on, recomputed from @cfg alone. */
+static const char *check_config(const struct tc358746_config *cfg,
+				u32 width, u32 refclk, unsigned int lanes)
+{
+	const struct sensor_pll *pll = &cfg->pll;
+	u64 ref = refclk / pll->prediv;
+	u64 vco = (u64)refclk * pll->mult / pll->prediv;
+	u64 ppi = pll->lane_rate / (8 >> cfg->clkdiv);
+	u64 in_rate = cfg->pixel_rate * cfg->fmt->bpp;
+	u64 out_rate = pll->lane_rate * lanes;
+	u64 words = (width * cfg->fmt->bpp + 15) / 16;
+	double startup;
+
+	if (pll->prediv < 1 || pll->prediv > 16 || pll->mult < 1 ||
+	    pll->mult > 512 || pll->sysdiv < 1 || pll->sysdiv > 8 ||
+	    pll->sysdiv & (pll->sysdiv - 1))
+		return "PLL divider out of range";
+	if (ref < 4000000 || ref > 40000000)
+		return "PLL reference out of range";
+	if (vco < 500000000 || vco > 1000000000)
+		return "VCO out of range";
+	if (vco / pll->sysdiv != pll->lane_rate)
+		return "lane rate does not match the dividers";
+	if (cfg->clkdiv > 2)
+		return "bad CLKCTL divider";
+	if (ppi < TC358746_PPI_CLK_MIN || ppi > TC358746_PPI_CLK_MAX)
+		return "PPI clock out of range";
+	if (out_rate * TC358746_LINK_MARGIN_DEN <
+	    in_rate * TC358746_LINK_MARGIN_NUM)
+		return "link below the 5/4 margin";
+	if (cfg->word_count != (width * cfg->fmt->bpp + 7) / 8)
+		return "bad word count";
+	if (cfg->pll.pixel_rate != out_rate / cfg->fmt->bpp)
+		return "bad CSI-2 pixel rate";
+
+	/* The FIFO must not run dry mid-line, nor overflow. */
+	if (cfg->fifo_level * out_rate < words * (out_rate - in_rate))
+		return "FIFO runs dry";
+	startup = in_rate * (TC358746_HS_STARTUP_PS * 1e-12) / 16;
+	if (cfg->fifo_level + startup > TC358746_FIFO_LEVEL_MAX + 1)
+		return "FIFO overflows";
+
+	return NULL;
+}
+
+static void print_config(const char *name, unsigned int lanes, int ret,
+			 const struct tc358746_config *cfg)
+{
+	printf("%-18s %u lane%s ", name, lanes, lanes > 1 ? "s" : " ");
+	if (ret == -ERANGE) {
+		printf("no PLL setting\n");
+		return;
+	}
+	if (ret == -EOVERFLOW) {
+		printf("line overflows the FIFO\n");
+		return;
+	}
+
+	printf("%7.2f Mbit/s  PRD %2u FBD %3u FRS %u  PPI /%u %6.2f MHz  "
+	       "FIFO %3u  CSI-2 %6.2f Mpixel/s\n",
+	       cfg->pll.lane_rate / 1e6, cfg->pll.prediv, cfg->pll.mult,
+	       __builtin_ctz(cfg->pll.sysdiv), 8 >> cfg->clkdiv,
+	       cfg->pll.lane_rate / (8 >> cfg->clkdiv) / 1e6,
+	       cfg->fifo_level, cfg->pll.pixel_rate / 1e6);
+}
+
+enum {
+	SWEEP_SOLVED,
+	SWEEP_UNSOLVED,
+	SWEEP_OVERFLOW,
+	SWEEP_FAILED,
+	SWEEP_RESULTS,
+};
+
+/*
+ * One point of the sweep. The PLL steps by at most a percent near the top
+ * of its range, so anything needing less than 99% of it has to solve.
+ */
+static int sweep_one(const struct tc358746_format *fmt, u32 width, u64 rate,
+		     u32 refclk, unsigned int lanes)
+{
+	struct tc358746_config cfg;
+	const char *err = NULL;
+	int ret;
+
+	ret = tc358746_solve(fmt->code, width, rate, refclk, lanes, &cfg);
+	if (!ret)
+		err = check_config(&cfg, width, refclk, lanes);
+	else if (ret == -EOVERFLOW)
+		return SWEEP_OVERFLOW;
+	else if (rate * fmt->bpp * TC358746_LINK_MARGIN_NUM * 100 <=
+		 tc358746_pll.lane_max * 99 * lanes * TC358746_LINK_MARGIN_DEN)
+		err = "no PLL setting";
+	else
+		return SWEEP_UNSOLVED;
+
+	if (err) {
+		fprintf(stderr, "%u-bit %u px at %llu pixel/s, %u lanes: %s\n",
+			fmt->bpp, width, (unsigned long long)rate, lanes,
+			err);
+		return SWEEP_FAILED;
+	}
+
+	return SWEEP_SOLVED;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -x, --refclk HZ       REFCLK (default 27000000)\n"
+		"  -W, --width N         extra mode: line width\n"
+		"  -p, --pixel-rate HZ   extra mode: sensor pixel rate\n"
+		"  -f, --format NAME     extra mode: y8, y10, y12 or uyvy\n"
+		"  -s, --step HZ         sweep step (default 50000)\n",
+		argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "refclk", required_argument, NULL, 'x' },
+		{ "width", required_argument, NULL, 'W' },
+		{ "pixel-rate", required_argument, NULL, 'p' },
+		{ "format", required_argument, NULL, 'f' },
+		{ "step", required_argument, NULL, 's' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static const u32 widths[] = { 640, 752, 1280, 1920, 4095 };
+	struct check_mode extra = { "extra", MEDIA_BUS_FMT_Y10_1X10, 0, 0 };
+	u32 refclk = 27000000, step = 50000;
+	unsigned int count[SWEEP_RESULTS] = { 0 }, failed = 0;
+	struct tc358746_config cfg;
+	const char *err;
+	unsigned int i, j, k;
+	u64 rate;
+	int ret;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "x:W:p:f:s:h", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'x':
+			refclk = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			extra.width = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			extra.pixel_rate = strtoull(optarg, NULL, 0);
+			break;
+		case 'f':
+			for (i = 0; i < ARRAY_SIZE(format_names); i++)
+				if (!strcmp(optarg, format_names[i].name))
+					break;
+			if (i == ARRAY_SIZE(format_names)) {
+				usage(argv[0]);
+				return 1;
+			}
+			extra.code = format_names[i].code;
+			break;
+		case 's':
+			step = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (refclk < 4000000 || !step || !extra.width != !extra.pixel_rate) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("REFCLK %.3f MHz\n", refclk / 1e6);
+	for (i = 0; i < ARRAY_SIZE(modes) + !!extra.width; i++) {
+		const struct check_mode *m = i < ARRAY_SIZE(modes) ?
+					     &modes[i] : &extra;
+
+		for (j = 0; j < ARRAY_SIZE(lane_counts); j++) {
+			ret = tc358746_solve(m->code, m->width, m->pixel_rate,
+					     refclk, lane_counts[j], &cfg);
+			print_config(m->name, lane_counts[j], ret, &cfg);
+			err = ret ? NULL : check_config(&cfg, m->width, refclk,
+							lane_counts[j]);
+			if (err) {
+				fprintf(stderr, "%s, %u lanes: %s\n", m->name,
+					lane_counts[j], err);
+				failed++;
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tc358746_formats); i++)
+		for (j = 0; j < ARRAY_SIZE(lane_counts); j++)
+			for (k = 0; k < ARRAY_SIZE(widths); k++)
+				for (rate = step; rate <= 200000000;
+				     rate += step)
+					count[sweep_one(&tc358746_formats[i],
+							widths[k], rate, refclk,
+							lane_counts[j])]++;
+
+	failed += count[SWEEP_FAILED];
+	printf("sweep: %u solved, %u beyond the link, %u over the FIFO, "
+	       "%u failed\n", count[SWEEP_SOLVED], count[SWEEP_UNSOLVED],
+	       count[SWEEP_OVERFLOW], count[SWEEP_FAILED]);
+
+	return failed ? 1 : 0;
+}
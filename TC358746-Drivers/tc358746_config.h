@@ -0,0 +1,189 @@
+/*
+ * TC358746 bridge settings from the stream's format and clocks.
+ *
+ * tc358746_solve() is everything tc358746.c programs at stream start that
+ * follows from the media bus code, the line width, the sensor's pixel
+ * rate, REFCLK and the number of CSI-2 lanes. It touches no device, so
+ * tc358746_check.c builds it on the host.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef TC358746_CONFIG_H
+#define TC358746_CONFIG_H
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/media-bus-format.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#else
+#include <linux/media-bus-format.h>
+#include "sensor_host.h"
+#endif
+
+#include "sensor_pll.h"
+
+/* CLKCTL divider fields: 0 divides the PLL output by 8, 1 by 4, 2 by 2. */
+#define TC358746_PPI_CLK_MIN		66000000
+#define TC358746_PPI_CLK_MAX		125000000
+
+#define TC358746_FIFO_LEVEL_MAX		511
+#define TC358746_MAX_LANES		4
+
+/* The link's bit rate over the parallel bus's: 5/4. */
+#define TC358746_LINK_MARGIN_NUM	5
+#define TC358746_LINK_MARGIN_DEN	4
+
+/* HS start-up of a line: LP-11 to the first payload bit, roughly. */
+#define TC358746_HS_STARTUP_PS		1000000
+
+struct tc358746_format {
+	u32 code;
+	u8 bpp;		/* bits per pixel on both buses */
+	u8 pdformat;	/* DATAFMT.PDFormat */
+};
+
+static const struct tc358746_format tc358746_formats[] = {
+	{ MEDIA_BUS_FMT_Y8_1X8, 8, 0 },
+	{ MEDIA_BUS_FMT_SGRBG8_1X8, 8, 0 },
+	{ MEDIA_BUS_FMT_Y10_1X10, 10, 1 },
+	{ MEDIA_BUS_FMT_SGRBG10_1X10, 10, 1 },
+	{ MEDIA_BUS_FMT_Y12_1X12, 12, 2 },
+	{ MEDIA_BUS_FMT_SGRBG12_1X12, 12, 2 },
+	{ MEDIA_BUS_FMT_UYVY8_2X8, 16, 6 },
+};
+
+/*
+ * PLL output = REFCLK / PRD * FBD / 2^FRS, one bit per lane per cycle.
+ * The VCO runs at 500 MHz to 1 GHz and FRS brings it down to the lane
+ * rate; the link has to be fast enough for a 66 MHz PPI clock.
+ */
+static const struct sensor_pll_limits tc358746_pll = {
+	.prediv_min = 1,
+	.prediv_max = 16,
+	.mult_min = 1,
+	.mult_max = 512,
+	.sysdiv_min = 1,
+	.sysdiv_max = 8,
+	.sysdiv_pow2 = true,
+	.ref_min = 4000000,
+	.ref_max = 40000000,
+	.vco_min = 500000000,
+	.vco_max = 1000000000,
+	.lane_max = 1000000000,
+};
+
+/* What a stream start programs, worked out from the formats and clocks. */
+struct tc358746_config {
+	const struct tc358746_format *fmt;
+	struct sensor_pll pll;
+	u32 clkdiv;		/* CLKCTL divider field */
+	u32 word_count;
+	u32 fifo_level;
+	u64 pixel_rate;		/* of the sensor */
+};
+
+static inline const struct tc358746_format *tc358746_find_format(u32 code)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(tc358746_formats); i++)
+		if (tc358746_formats[i].code == code)
+			return &tc358746_formats[i];
+
+	return NULL;
+}
+
+/*
+ * The FIFO level for @cfg: of a line of n words, the parallel side
+ * delivers n * in / out while CSI-2 sends all n, so transmission waits
+ * for the other n * (1 - in / out). Returns -EOVERFLOW if the FIFO cannot
+ * hold that plus what arrives during @startup_ps.
+ */
+static inline int tc358746_fifo_level(struct tc358746_config *cfg,
+				      u32 width, unsigned int lanes,
+				      u32 startup_ps)
+{
+	u64 in_rate = cfg->pixel_rate * cfg->fmt->bpp;
+	u64 out_rate = cfg->pll.lane_rate * lanes;
+	u32 words = DIV_ROUND_UP(width * cfg->fmt->bpp, 16);
+	u32 during_startup;
+
+	cfg->fifo_level = DIV_ROUND_UP_ULL((u64)words * (out_rate - in_rate),
+					   out_rate);
+	during_startup = DIV_ROUND_UP_ULL(in_rate * startup_ps,
+					  16 * 1000000000000ULL);
+
+	if (cfg->fifo_level + during_startup > TC358746_FIFO_LEVEL_MAX)
+		return -EOVERFLOW;
+
+	return 0;
+}
+
+/*
+ * The bridge settings for lines of @width pixels of @code at @pixel_rate.
+ * Returns -EINVAL for a format or rate the bridge does not take, -ERANGE
+ * if no PLL setting carries the link and -EOVERFLOW if a line does not
+ * fit the FIFO; @cfg is filled in as far as it got.
+ */
+static inline int tc358746_solve(u32 code, u32 width, u64 pixel_rate,
+				 u32 refclk, unsigned int lanes,
+				 struct tc358746_config *cfg)
+{
+	u64 min_rate, ppi;
+	int clkdiv, ret;
+
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->fmt = tc358746_find_format(code);
+	if (!cfg->fmt || !pixel_rate || !lanes ||
+	    lanes > TC358746_MAX_LANES)
+		return -EINVAL;
+	cfg->pixel_rate = pixel_rate;
+
+	min_rate = DIV_ROUND_UP_ULL(pixel_rate * cfg->fmt->bpp *
+				    TC358746_LINK_MARGIN_NUM,
+				    TC358746_LINK_MARGIN_DEN * lanes);
+	/* The PPI clock is the PLL output divided by 2 at the most. */
+	min_rate = max_t(u64, min_rate, 2ULL * TC358746_PPI_CLK_MIN);
+
+	/*
+	 * The PPI clock window takes lane rates of 132-250, 264-500 and
+	 * 528-1000 Mbit/s through the three dividers. A PLL setting in one
+	 * of the gaps between them is too fast for the next divider up and
+	 * too slow for the one below, so search again from the bottom of
+	 * the lower range.
+	 */
+	for (;;) {
+		ret = sensor_pll_solve(&tc358746_pll, refclk, min_rate,
+				       &cfg->pll);
+		if (ret < 0)
+			return ret;
+
+		/* The fastest PPI and system clock within the limit. */
+		for (clkdiv = 2; clkdiv > 0; clkdiv--) {
+			ppi = div_u64(cfg->pll.lane_rate, 8 >> clkdiv);
+			if (ppi <= TC358746_PPI_CLK_MAX)
+				break;
+		}
+		ppi = div_u64(cfg->pll.lane_rate, 8 >> clkdiv);
+		if (ppi > TC358746_PPI_CLK_MAX)
+			return -ERANGE;
+		if (ppi >= TC358746_PPI_CLK_MIN)
+			break;
+
+		min_rate = (u64)TC358746_PPI_CLK_MIN * (8 >> clkdiv);
+	}
+
+	cfg->clkdiv = clkdiv;
+	cfg->pll.pixel_rate = div_u64(cfg->pll.lane_rate * lanes,
+				      cfg->fmt->bpp);
+	cfg->word_count = DIV_ROUND_UP(width * cfg->fmt->bpp, 8);
+
+	return tc358746_fifo_level(cfg, width, lanes, TC358746_HS_STARTUP_PS);
+}
+
+#endif /* TC358746_CONFIG_H */